@@ -1,3 +1,7 @@
+# Finds Intel Hyperscan or an API compatible port such as Vectorscan, which
+# is what provides libhs on aarch64 and other non-x86 targets.  Both install
+# libhs.pc and the same headers so they are found the same way.  Vectorscan
+# is commonly built as a static library which also needs the C++ runtime.
 
 find_package(PkgConfig)
 pkg_check_modules(PC_HYPERSCAN libhs)
@@ -5,10 +9,16 @@ pkg_check_modules(PC_HYPERSCAN libhs)
 # Use HS_INCLUDE_DIR and HS_LIBRARY_DIR from configure_cmake.sh as primary hints
 # and then package config information after that.
 find_path(HS_INCLUDE_DIRS hs_compile.h
-    HINTS ${HS_INCLUDE_DIR} ${PC_HYPERSCAN_INCLUDEDIR} ${PC_HYPERSCAN_INCLUDE_DIRS})
+    HINTS ${HS_INCLUDE_DIR} ${PC_HYPERSCAN_INCLUDEDIR} ${PC_HYPERSCAN_INCLUDE_DIRS}
+    PATH_SUFFIXES hs)
 find_library(HS_LIBRARIES NAMES hs
     HINTS ${HS_LIBRARIES_DIR} ${PC_HYPERSCAN_LIBDIR} ${PC_HYPERSCAN_LIBRARY_DIRS})
 
+if (HS_LIBRARIES MATCHES "\\.a$")
+    set(HS_STATIC_DEPS stdc++ m)
+    list(APPEND HS_LIBRARIES ${HS_STATIC_DEPS})
+endif()
+
 include(FindPackageHandleStandardArgs)
 find_package_handle_standard_args(HS REQUIRED_VARS HS_LIBRARIES HS_INCLUDE_DIRS VERSION_VAR PC_HYPERSCAN_VERSION)
 
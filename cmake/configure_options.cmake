@@ -5,6 +5,11 @@
 
 set ( SHELL ${ENABLE_SHELL} )
 set ( UNIT_TEST ${ENABLE_UNIT_TESTS} )
+
+if ( ENABLE_BENCHMARK_TESTS AND NOT ENABLE_UNIT_TESTS )
+    message ( SEND_ERROR "Benchmark tests require unit tests to be enabled!" )
+endif ()
+set ( BENCHMARK_TEST ${ENABLE_BENCHMARK_TESTS} )
 set ( PIGLET ${ENABLE_PIGLET} )
 
 if ( NOT ENABLE_COREFILES )
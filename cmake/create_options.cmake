@@ -17,6 +17,7 @@ option ( ENABLE_STATIC_DAQ "link static DAQ modules" ON )
 # features
 option ( ENABLE_SHELL "enable shell support" OFF )
 option ( ENABLE_UNIT_TESTS "enable unit tests" OFF )
+option ( ENABLE_BENCHMARK_TESTS "enable benchmark tests" OFF )
 option ( ENABLE_PIGLET "enable piglet test harness" OFF )
 
 option ( ENABLE_COREFILES "Prevent Snort from generating core files" ON )
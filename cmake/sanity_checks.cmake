@@ -54,6 +54,20 @@ endif()
 cmake_pop_check_state()
 # ^^^^^^^^^  GETRPCENT TEST ^^^^^^^^^
 
+# vvvvvvvvv  TIMER_CREATE TEST vvvvvvvvv
+cmake_push_check_state(RESET)
+check_function_exists(timer_create HAVE_TIMER_CREATE)
+if (NOT HAVE_TIMER_CREATE)
+    set(CMAKE_REQUIRED_LIBRARIES rt)
+    check_function_exists(timer_create HAVE_RT_TIMER_CREATE)
+    if (HAVE_RT_TIMER_CREATE)
+        set(HAVE_TIMER_CREATE TRUE)
+        set(RT_LIBRARIES rt)
+    endif()
+endif()
+cmake_pop_check_state()
+# ^^^^^^^^^  TIMER_CREATE TEST ^^^^^^^^^
+
 #--------------------------------------------------------------------------
 # Checks for typedefs, structures, and compiler characteristics.
 #--------------------------------------------------------------------------
@@ -131,14 +145,16 @@ endif()
 
 # set library variables
 if (HS_FOUND)
-    check_library_exists (${HS_LIBRARIES} hs_scan "" HAVE_HYPERSCAN)
+    # HS_LIBRARIES may be a list (static libhs plus the C++ runtime) so
+    # check_library_exists can't be used here
+    cmake_push_check_state(RESET)
+    set(CMAKE_REQUIRED_INCLUDES ${HS_INCLUDE_DIRS})
+    set(CMAKE_REQUIRED_LIBRARIES ${HS_LIBRARIES})
+    check_function_exists(hs_scan HAVE_HYPERSCAN)
     if (HAVE_HYPERSCAN)
-        cmake_push_check_state(RESET)
-        set(CMAKE_REQUIRED_INCLUDES ${HS_INCLUDE_DIRS})
-        set(CMAKE_REQUIRED_LIBRARIES ${HS_LIBRARIES})
         check_function_exists(hs_compile_lit HAVE_HS_COMPILE_LIT)
-        cmake_pop_check_state()
     endif()
+    cmake_pop_check_state()
 endif()
 
 if (DEFINED LIBLZMA_LIBRARIES)
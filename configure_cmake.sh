@@ -68,6 +68,8 @@ Optional Features:
     --enable-appid-third-party
                             enable third party appid
     --enable-unit-tests     build unit tests
+    --enable-benchmark-tests
+                            build benchmarks into the unit tests (requires unit tests)
     --enable-piglet         build piglet test harness
     --enable-ccache         enable ccache support
     --disable-static-daq    link static DAQ modules
@@ -100,9 +102,9 @@ Optional Packages:
                             DAQ library directory
     --with-openssl=DIR      openssl installation root directory
     --with-hyperscan-includes=DIR
-                            libhs include directory
+                            libhs include directory (hyperscan or vectorscan)
     --with-hyperscan-libraries=DIR
-                            libhs library directory
+                            libhs library directory (hyperscan or vectorscan)
     --with-flatbuffers-includes=DIR
                             flatbuffers include directory
     --with-flatbuffers-libraries=DIR
@@ -321,6 +323,12 @@ while [ $# -ne 0 ]; do
         --disable-unit-tests)
             append_cache_entry ENABLE_UNIT_TESTS        BOOL false
             ;;
+        --enable-benchmark-tests)
+            append_cache_entry ENABLE_BENCHMARK_TESTS   BOOL true
+            ;;
+        --disable-benchmark-tests)
+            append_cache_entry ENABLE_BENCHMARK_TESTS   BOOL false
+            ;;
         --enable-piglet)
             append_cache_entry ENABLE_PIGLET            BOOL true
             ;;
@@ -27,6 +27,11 @@
 // provide test cases from dynamic plugins to the global list of tests to be
 // run. This header should be used instead of including catch.hpp directly.
 
+// benchmarks are only built when configured with --enable-benchmark-tests
+#ifdef BENCHMARK_TEST
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#endif
+
 // pragma for running unit tests on dynamic modules
 #pragma GCC visibility push(default)
 #include "catch.hpp"
@@ -90,7 +90,8 @@ void DetectionEngine::thread_init()
         {
             // If the search method is not async capable then offloaded searches will be performed
             // in a separate processing thread that the RegexOffload instance needs to create.
-            offloader = RegexOffload::get_offloader(sc->offload_threads, true);
+            offloader = RegexOffload::get_offloader(
+                sc->offload_threads, true, sc->offload_workers, sc->offload_pool);
         }
     }
 }
@@ -74,9 +74,26 @@ static const Parameter detection_params[] =
     { "offload_threads", Parameter::PT_INT, "0:max32", "0",
       "maximum number of simultaneous offloads (defaults to disabled)" },
 
+    { "offload_workers", Parameter::PT_INT, "0:max32", "0",
+      "number of threads fed by lock-free rings that do offloaded searches, "
+      "at most offload_threads (0 = one locked thread per offload)" },
+
+    { "offload_pool", Parameter::PT_BOOL, nullptr, "false",
+      "share offload_workers among all packet threads with work stealing "
+      "(allows offload with more than one packet thread)" },
+
     { "pcre_enable", Parameter::PT_BOOL, nullptr, "true",
       "enable pcre pattern matching" },
 
+    { "pcre_jit", Parameter::PT_BOOL, nullptr, "true",
+      "use pcre just-in-time compilation when supported by libpcre" },
+
+    { "pcre_jit_fallback", Parameter::PT_BOOL, nullptr, "true",
+      "use the pcre interpreter when an expression can't be jit compiled or runs out of jit stack" },
+
+    { "pcre_jit_stack", Parameter::PT_INT, "32:1048576", "1024",
+      "maximum size of the per packet thread pcre jit stack in KB" },
+
     { "pcre_match_limit", Parameter::PT_INT, "0:max32", "1500",
       "limit pcre backtracking, 0 = off" },
 
@@ -114,9 +131,15 @@ const TraceOption* DetectionModule::get_trace_options() const
 
 bool DetectionModule::end(const char*, int, SnortConfig* sc)
 {
-    if ( sc->offload_threads and ThreadConfig::get_instance_max() != 1 )
+    if ( sc->offload_threads and !sc->offload_pool and ThreadConfig::get_instance_max() != 1 )
         ParseError("You can not enable experimental offload with more than one packet thread.");
 
+    if ( sc->offload_pool and !sc->offload_workers )
+        sc->offload_workers = sc->offload_threads;
+
+    if ( sc->offload_workers > sc->offload_threads )
+        sc->offload_workers = sc->offload_threads;
+
     return true;
 }
 
@@ -142,9 +165,24 @@ bool DetectionModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("offload_threads") )
         sc->offload_threads = v.get_uint32();
 
+    else if ( v.is("offload_workers") )
+        sc->offload_workers = v.get_uint32();
+
+    else if ( v.is("offload_pool") )
+        sc->offload_pool = v.get_bool();
+
     else if ( v.is("pcre_enable") )
         v.update_mask(sc->run_flags, RUN_FLAG__NO_PCRE, true);
 
+    else if ( v.is("pcre_jit") )
+        sc->pcre_jit = v.get_bool();
+
+    else if ( v.is("pcre_jit_fallback") )
+        sc->pcre_jit_fallback = v.get_bool();
+
+    else if ( v.is("pcre_jit_stack") )
+        sc->pcre_jit_stack = v.get_uint32();
+
     else if ( v.is("pcre_match_limit") )
         sc->pcre_match_limit = v.get_uint32();
 
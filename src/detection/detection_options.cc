@@ -50,7 +50,9 @@
 #include "managers/ips_manager.h"
 #include "parser/parser.h"
 #include "profiler/rule_profiler_defs.h"
+#include "profiler/sample_profiler_defs.h"
 #include "protocols/packet_manager.h"
+#include "utils/stats.h"
 #include "utils/util.h"
 #include "utils/util_cstring.h"
 
@@ -345,6 +347,135 @@ void* add_detection_option_tree(SnortConfig* sc, detection_option_tree_node_t* o
     return nullptr;
 }
 
+//-------------------------------------------------------------------------
+// evaluation memo
+//
+// relative nodes can't use last_check because their result depends on where
+// the parent left the cursor.  large rule sets reach the same relative node
+// from several fast pattern matches on one packet so the subtree result is
+// memoized per context on the cursor and byte_extract state.  the memo is
+// direct mapped and stamped with the context number so it never needs to be
+// cleared; a collision just costs a reevaluation.
+//-------------------------------------------------------------------------
+
+#define EVAL_MEMO_BITS 8
+#define EVAL_MEMO_SIZE (1 << EVAL_MEMO_BITS)
+
+struct EvalMemoEntry
+{
+    uint64_t context_num;
+    const detection_option_tree_node_t* node;
+    const Packet* p;
+    const uint8_t* buf;
+    unsigned size;
+    unsigned pos;
+    unsigned delta;
+    uint32_t vars[NUM_IPS_OPTIONS_VARS];
+    char noalert;
+    int result;
+
+    void set(const detection_option_tree_node_t*, const detection_option_eval_data_t&,
+        const Cursor&);
+
+    bool operator==(const EvalMemoEntry&) const;
+    unsigned index() const;
+};
+
+struct EvalMemo
+{
+    EvalMemoEntry entries[EVAL_MEMO_SIZE];
+};
+
+EvalMemo* detection_option_memo_new()
+{ return (EvalMemo*)snort_calloc(sizeof(EvalMemo)); }
+
+void detection_option_memo_free(EvalMemo* memo)
+{ snort_free(memo); }
+
+void EvalMemoEntry::set(
+    const detection_option_tree_node_t* n, const detection_option_eval_data_t& eval_data,
+    const Cursor& c)
+{
+    context_num = eval_data.p->context->context_num;
+    node = n;
+    p = eval_data.p;
+    buf = c.buffer();
+    size = c.size();
+    pos = c.get_pos();
+    delta = c.get_delta();
+    noalert = eval_data.flowbit_noalert;
+
+    for ( unsigned i = 0; i < NUM_IPS_OPTIONS_VARS; ++i )
+        GetVarValueByIndex(&vars[i], (int8_t)i);
+}
+
+bool EvalMemoEntry::operator==(const EvalMemoEntry& rhs) const
+{
+    if ( node != rhs.node or context_num != rhs.context_num or p != rhs.p or
+        buf != rhs.buf or size != rhs.size or pos != rhs.pos or delta != rhs.delta or
+        noalert != rhs.noalert )
+        return false;
+
+    for ( unsigned i = 0; i < NUM_IPS_OPTIONS_VARS; ++i )
+    {
+        if ( vars[i] != rhs.vars[i] )
+            return false;
+    }
+    return true;
+}
+
+unsigned EvalMemoEntry::index() const
+{
+    uint64_t h = (uintptr_t)node ^ ((uintptr_t)buf << 7) ^ ((uint64_t)pos << 32) ^ delta;
+
+    for ( unsigned i = 0; i < NUM_IPS_OPTIONS_VARS; ++i )
+        h = (h ^ vars[i]) * 0x9E3779B97F4A7C15ull;
+
+    h *= 0x9E3779B97F4A7C15ull;
+    return (unsigned)(h >> (64 - EVAL_MEMO_BITS));
+}
+
+// same exclusions as last_check, plus cursors carrying option data such as
+// http_param retry state which isn't part of the key
+static bool memo_allowed(const detection_option_eval_data_t& eval_data, const Cursor& c)
+{
+    const Packet* p = eval_data.p;
+
+    if ( p->packet_flags & (PKT_ALLOW_MULTIPLE_DETECT | PKT_IP_RULE_2ND) )
+        return false;
+
+    return !p->is_udp_tunneled() and !c.has_data();
+}
+
+// results are only stored if nothing below the node changed flow or
+// filter state and no flowbit check failed, so a hit is exactly what a
+// reevaluation would have returned
+class MemoScope
+{
+public:
+    MemoScope(detection_option_eval_data_t& ed, EvalMemoEntry* key) :
+        eval_data(ed), key(key), outer_no_memo(ed.no_memo)
+    { eval_data.no_memo = 0; }
+
+    ~MemoScope()
+    { eval_data.no_memo |= outer_no_memo; }
+
+    void store(int result)
+    {
+        if ( !key or eval_data.no_memo or eval_data.flowbit_failed )
+            return;
+
+        EvalMemoEntry& slot = eval_data.p->context->eval_memo->entries[key->index()];
+        slot = *key;
+        slot.result = result;
+    }
+
+private:
+    detection_option_eval_data_t& eval_data;
+    const EvalMemoEntry* key;
+    char outer_no_memo;
+};
+
 int detection_option_node_evaluate(
     detection_option_tree_node_t* node, detection_option_eval_data_t& eval_data,
     const Cursor& orig_cursor)
@@ -354,6 +485,12 @@ int detection_option_node_evaluate(
     auto& state = node->state[get_instance_id()];
     RuleContext profile(state);
 
+    // samples are only attributed to a rule below the point where the tree
+    // stops being shared with other rules
+    uint64_t rule_frame = (node->otn and SampleStack::is_enabled()) ?
+        SampleStack::rule_frame(node->otn->sigInfo.gid, node->otn->sigInfo.sid) : 0;
+    SampleContext sample(rule_frame);
+
     int result = 0;
     int rval;
     char tmp_noalert_flag = 0;
@@ -363,6 +500,8 @@ int detection_option_node_evaluate(
     int loop_count = 0;
     uint32_t tmp_byte_extract_vars[NUM_IPS_OPTIONS_VARS];
     uint64_t cur_eval_context_num = eval_data.p->context->context_num;
+    EvalMemoEntry memo_key;
+    bool use_memo = false;
 
     node_eval_trace(node, cursor, eval_data.p);
 
@@ -389,6 +528,22 @@ int detection_option_node_evaluate(
             }
         }
     }
+    else if ( memo_allowed(eval_data, cursor) )
+    {
+        memo_key.set(node, eval_data, cursor);
+        const EvalMemoEntry& slot = p->context->eval_memo->entries[memo_key.index()];
+
+        if ( slot == memo_key )
+        {
+            pc.eval_memo_hits++;
+            debug_log(detection_trace, TRACE_RULE_EVAL, p,
+                "Was evaluated before at this cursor, returning memoized result\n");
+            return slot.result;
+        }
+        pc.eval_memo_misses++;
+        use_memo = true;
+    }
+    MemoScope memo(eval_data, use_memo ? &memo_key : nullptr);
 
     state.last_check.ts = eval_data.p->pkth->ts;
     state.last_check.run_num = get_run_num();
@@ -452,6 +607,7 @@ int detection_option_node_evaluate(
 
                 if ( otn->detection_filter )
                 {
+                    eval_data.no_memo = 1;
                     debug_log(detection_trace, TRACE_RULE_EVAL, p,
                         "Evaluating detection filter\n");
                     f_result = !detection_filter_test(otn->detection_filter,
@@ -529,6 +685,7 @@ int detection_option_node_evaluate(
         {
             debug_log(detection_trace, TRACE_RULE_EVAL, p, "no match\n");
             state.last_check.result = result;
+            memo.store(result);
             return result;
         }
         else if ( rval == (int)IpsOption::FAILED_BIT )
@@ -703,6 +860,8 @@ int detection_option_node_evaluate(
         rval = node->evaluate(node->option_data, cursor, p);
         if ( rval != (int)IpsOption::MATCH )
             result = rval;
+
+        eval_data.no_memo = 1;
     }
 
     if ( eval_data.flowbit_failed )
@@ -713,6 +872,7 @@ int detection_option_node_evaluate(
     }
 
     state.last_check.result = result;
+    memo.store(result);
     profile.stop(result != (int)IpsOption::NO_MATCH);
 
     return result;
@@ -730,8 +890,11 @@ struct node_profile_stats
     uint64_t latency_suspends;
 };
 
+using OtnStateMap = std::unordered_map<const OptTreeNode*, OtnState>;
+
 static void detection_option_node_update_otn_stats(detection_option_tree_node_t* node,
-    node_profile_stats* stats, uint64_t checks, uint64_t timeouts, uint64_t suspends)
+    node_profile_stats* stats, uint64_t checks, uint64_t timeouts, uint64_t suspends,
+    OtnStateMap* otn_stats)
 {
     node_profile_stats local_stats; /* cumulative stats for this node */
     node_profile_stats node_stats;  /* sum of all instances */
@@ -777,7 +940,7 @@ static void detection_option_node_update_otn_stats(detection_option_tree_node_t*
         // Right now, it looks like we're missing out on some stats although it's possible
         // that this is "corrected" in the profiler code
         auto* otn = (OptTreeNode*)node->option_data;
-        auto& state = otn->state[get_instance_id()];
+        auto& state = otn_stats ? (*otn_stats)[otn] : otn->state[get_instance_id()];
 
         state.elapsed += local_stats.elapsed;
         state.elapsed_match += local_stats.elapsed_match;
@@ -794,11 +957,11 @@ static void detection_option_node_update_otn_stats(detection_option_tree_node_t*
     {
         for ( int i = 0; i < node->num_children; ++i )
             detection_option_node_update_otn_stats(node->children[i], &local_stats, checks,
-                timeouts, suspends);
+                timeouts, suspends, otn_stats);
     }
 }
 
-void detection_option_tree_update_otn_stats(XHash* doth)
+static void detection_option_tree_otn_stats(XHash* doth, OtnStateMap* otn_stats)
 {
     if ( !doth )
         return;
@@ -820,10 +983,17 @@ void detection_option_tree_update_otn_stats(XHash* doth)
         }
 
         if ( checks )
-            detection_option_node_update_otn_stats(node, nullptr, checks, timeouts, suspends);
+            detection_option_node_update_otn_stats(node, nullptr, checks, timeouts, suspends,
+                otn_stats);
     }
 }
 
+void detection_option_tree_update_otn_stats(XHash* doth)
+{ detection_option_tree_otn_stats(doth, nullptr); }
+
+void detection_option_tree_get_otn_stats(XHash* doth, OtnStateMap& otn_stats)
+{ detection_option_tree_otn_stats(doth, &otn_stats); }
+
 detection_option_tree_root_t* new_root(OptTreeNode* otn)
 {
     detection_option_tree_root_t* p = (detection_option_tree_root_t*)
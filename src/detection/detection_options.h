@@ -33,6 +33,8 @@
 
 #include <sys/time.h>
 
+#include <unordered_map>
+
 #include "detection/rule_option_types.h"
 #include "time/clock_defs.h"
 #include "main/snort_debug.h"
@@ -44,6 +46,8 @@ class XHash;
 struct Packet;
 struct SnortConfig;
 }
+struct OptTreeNode;
+struct OtnState;
 struct RuleLatencyState;
 
 typedef int (* eval_func_t)(void* option_data, class Cursor&, snort::Packet*);
@@ -114,6 +118,7 @@ struct detection_option_eval_data_t
     snort::Packet* p;
     char flowbit_failed;
     char flowbit_noalert;
+    char no_memo;  // subtree had side effects so its result can't be reused
 };
 
 // return existing data or add given and return nullptr
@@ -123,9 +128,19 @@ void* add_detection_option_tree(struct snort::SnortConfig*, detection_option_tre
 int detection_option_node_evaluate(
     detection_option_tree_node_t*, detection_option_eval_data_t&, const class Cursor&);
 
+// per packet memo of relative subtree results, one per IpsContext
+struct EvalMemo;
+EvalMemo* detection_option_memo_new();
+void detection_option_memo_free(EvalMemo*);
+
 void print_option_tree(detection_option_tree_node_t*, int level);
 void detection_option_tree_update_otn_stats(snort::XHash*);
 
+// adds the rule profile data held in the tree nodes to the given states
+// without changing the otns; used for live snapshots while packet threads run
+void detection_option_tree_get_otn_stats(
+    snort::XHash*, std::unordered_map<const OptTreeNode*, OtnState>&);
+
 detection_option_tree_root_t* new_root(OptTreeNode*);
 void free_detection_option_root(void** existing_tree);
 
@@ -25,6 +25,8 @@
 #ifndef FP_CONFIG_H
 #define FP_CONFIG_H
 
+#include <string>
+
 namespace snort
 {
     struct MpseApi;
@@ -132,6 +134,12 @@ public:
     unsigned get_queue_limit() const
     { return queue_limit; }
 
+    void set_cache_dir(const char* dir)
+    { cache_dir = dir; }
+
+    const std::string& get_cache_dir() const
+    { return cache_dir; }
+
     const snort::MpseApi* get_search_api() const
     { return search_api; }
 
@@ -159,6 +167,8 @@ private:
 
     unsigned queue_limit = 0;
 
+    std::string cache_dir;
+
     int portlists_flags = 0;
     int num_patterns_truncated = 0;  // due to max_pattern_len
 };
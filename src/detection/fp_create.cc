@@ -34,6 +34,8 @@
 
 #include "fp_create.h"
 
+#include <memory>
+
 #include "framework/mpse.h"
 #include "framework/mpse_batch.h"
 #include "hash/ghash.h"
@@ -48,6 +50,7 @@
 #include "parser/parser.h"
 #include "ports/port_table.h"
 #include "ports/rule_port_tables.h"
+#include "search_engines/mpse_cache.h"
 #include "utils/stats.h"
 #include "utils/util.h"
 
@@ -1533,6 +1536,19 @@ static void fpCreateServicePortGroups(SnortConfig* sc)
     sc->srmmTable = nullptr;
 }
 
+static void log_mpse_cache(const MpseCache::Stats& stats)
+{
+    LogLabel("search engine cache");
+    LogCount("hits", stats.hits);
+    LogCount("misses", stats.misses);
+    LogCount("write failures", stats.write_failures);
+    LogCount("usecs saved", stats.usecs_saved);
+
+    proc_stats.mpse_cache_hits += stats.hits;
+    proc_stats.mpse_cache_misses += stats.misses;
+    proc_stats.mpse_cache_usecs_saved += stats.usecs_saved;
+}
+
 static unsigned can_build_mt(FastPatternConfig* fp)
 {
     if ( Snort::is_reloading() )
@@ -1615,12 +1631,20 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
 
     if ( !sc->test_mode() or sc->mem_check() )
     {
-        unsigned c = compile_mpses(sc, can_build_mt(fp));
+        std::unique_ptr<MpseCache> cache;
+
+        if ( !fp->get_cache_dir().empty() )
+            cache.reset(new MpseCache(fp->get_cache_dir()));
+
+        unsigned c = compile_mpses(sc, can_build_mt(fp), cache.get());
         unsigned expected = mpse_count + offload_mpse_count;
 
         if ( c != expected )
             ParseError("Failed to compile %u search engines", expected - c);
 
+        if ( cache )
+            log_mpse_cache(cache->get_stats());
+
         fixup_trees(sc);
     }
 
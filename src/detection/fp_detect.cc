@@ -357,6 +357,7 @@ static void rule_tree_match(
     eval_data.pmd = pmx->pmd;
     eval_data.flowbit_failed = 0;
     eval_data.flowbit_noalert = 0;
+    eval_data.no_memo = 0;
 
     print_pattern(pmx->pmd, eval_data.p);
 
@@ -810,6 +811,7 @@ void fp_set_context(IpsContext& c)
     c.stash = new MpseStash(fp->get_queue_limit());
     c.otnx = (OtnxMatchData*)snort_calloc(sizeof(OtnxMatchData));
     c.otnx->matchInfo = (MatchInfo*)snort_calloc(MAX_NUM_RULE_TYPES, sizeof(MatchInfo));
+    c.eval_memo = detection_option_memo_new();
     c.context_num = 0;
 }
 
@@ -818,6 +820,7 @@ void fp_clear_context(IpsContext& c)
     delete c.stash;
     snort_free(c.otnx->matchInfo);
     snort_free(c.otnx);
+    detection_option_memo_free(c.eval_memo);
 }
 
 static int rule_tree_queue(
@@ -1030,6 +1033,7 @@ static inline void eval_nfp(
             eval_data.pmd = nullptr;
             eval_data.flowbit_failed = 0;
             eval_data.flowbit_noalert = 0;
+            eval_data.no_memo = 0;
 
             int rval = 0;
             {
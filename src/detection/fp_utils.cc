@@ -33,6 +33,7 @@
 #include "parser/parse_conf.h"
 #include "pattern_match_data.h"
 #include "ports/port_group.h"
+#include "search_engines/mpse_cache.h"
 #include "target_based/snort_protocols.h"
 #include "treenodes.h"
 #include "utils/util.h"
@@ -375,14 +376,14 @@ static Mpse* get_mpse()
     return m;
 }
 
-static void compile_mpse(SnortConfig* sc, unsigned id, unsigned* count)
+static void compile_mpse(SnortConfig* sc, unsigned id, unsigned* count, MpseCache* cache)
 {
     set_instance_id(id);
     unsigned c = 0;
 
     while ( Mpse* m = get_mpse() )
     {
-        if ( !m->prep_patterns(sc) )
+        if ( !(cache ? cache->prep(m, sc) : m->prep_patterns(sc)) )
             c++;
     }
     std::lock_guard<std::mutex> lock(s_mutex);
@@ -394,7 +395,7 @@ void queue_mpse(Mpse* m)
     s_tbd.push_back(m);
 }
 
-unsigned compile_mpses(struct SnortConfig* sc, bool parallel)
+unsigned compile_mpses(struct SnortConfig* sc, bool parallel, MpseCache* cache)
 {
     std::list<std::thread*> workers;
     unsigned max = parallel ? sc->num_slots : 1;
@@ -402,12 +403,12 @@ unsigned compile_mpses(struct SnortConfig* sc, bool parallel)
 
     if ( max == 1 )
     {
-        compile_mpse(sc, get_instance_id(), &count);
+        compile_mpse(sc, get_instance_id(), &count, cache);
         return count;
     }
 
     for ( unsigned i = 0; i < max; ++i )
-        workers.push_back(new std::thread(compile_mpse, sc, i, &count));
+        workers.push_back(new std::thread(compile_mpse, sc, i, &count, cache));
 
     for ( auto* w : workers )
     {
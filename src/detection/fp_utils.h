@@ -27,6 +27,7 @@
 #include "framework/mpse.h"
 #include "ports/port_group.h"
 
+class MpseCache;
 struct OptFpList;
 struct OptTreeNode;
 
@@ -43,7 +44,7 @@ std::vector <PatternMatchData*> get_fp_content(
     OptTreeNode*, OptFpList*&, bool srvc, bool only_literals, bool& exclude);
 
 void queue_mpse(snort::Mpse*);
-unsigned compile_mpses(struct snort::SnortConfig*, bool parallel = false);
+unsigned compile_mpses(struct snort::SnortConfig*, bool parallel = false, MpseCache* = nullptr);
 
 void validate_services(struct snort::SnortConfig*, OptTreeNode*);
 
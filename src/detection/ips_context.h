@@ -35,6 +35,7 @@
 #include "protocols/packet.h" // required to get a decent decl of pkth
 
 class MpseStash;
+struct EvalMemo;
 struct OtnxMatchData;
 struct SF_EVENTQ;
 struct RegexRequest;
@@ -149,6 +150,7 @@ public:
     MpseBatch searches;
     MpseStash* stash;
     OtnxMatchData* otnx;
+    EvalMemo* eval_memo;
     std::list<RegexRequest*>::iterator regex_req_it;
     SF_EVENTQ* equeue;
 
@@ -26,14 +26,17 @@
 
 #include <cassert>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <mutex>
+#include <string>
 #include <vector>
 #include <thread>
 
 #include "fp_detect.h"
+#include "helpers/spsc_ring.h"
 #include "ips_context.h"
 #include "latency/packet_latency.h"
 #include "latency/rule_latency.h"
@@ -41,6 +44,7 @@
 #include "main/thread.h"
 #include "main/thread_config.h"
 #include "managers/module_manager.h"
+#include "time/clock_defs.h"
 #include "utils/stats.h"
 
 using namespace snort;
@@ -63,16 +67,68 @@ struct RegexRequest
     std::atomic<bool> offload { false };
 
     bool go = true;
+
+    // ring and pool offload only
+    hr_time queued;
+    hr_time done;
+
+    // pool offload only
+    PoolRegexOffload* owner = nullptr;
+    hr_time started;
+    bool stolen = false;
 };
 
-RegexOffload* RegexOffload::get_offloader(unsigned max, bool async)
+RegexOffload* RegexOffload::get_offloader(
+    unsigned max, bool async, unsigned workers, bool shared)
 {
+    if ( async and workers and shared )
+        return new PoolRegexOffload(max, workers);
+
+    if ( async and workers )
+        return new RingRegexOffload(max, workers);
+
     if ( async )
         return new ThreadRegexOffload(max);
 
     return new MpseRegexOffload(max);
 }
 
+// run the searches for an offloaded packet in the calling thread
+static void offload_search(IpsContext* c)
+{
+    Mpse::MpseRespType resp_ret;
+
+    c->searches.offload_search();
+
+    do
+    {
+        resp_ret = c->searches.receive_offload_responses();
+    }
+    while (resp_ret == Mpse::MPSE_RESP_NOT_COMPLETE);
+
+    if (resp_ret == Mpse::MPSE_RESP_COMPLETE_FAIL)
+    {
+        if (c->searches.can_fallback())
+        {
+            c->searches.search_sync();
+            pc.offload_fallback++;
+        }
+        pc.offload_failures++;
+    }
+
+    c->searches.items.clear();
+}
+
+static void offload_tterm()
+{
+    ModuleManager::accumulate_offload("search_engine");
+    ModuleManager::accumulate_offload("detection");
+
+    // FIXIT-M break this over-coupling. In reality we shouldn't be evaluating latency in offload.
+    PacketLatency::tterm();
+    RuleLatency::tterm();
+}
+
 //--------------------------------------------------------------------------
 // base offload implementation
 //--------------------------------------------------------------------------
@@ -290,42 +346,535 @@ void ThreadRegexOffload::worker(
         assert(req->packet->context->searches.items.size() > 0);
 
         SnortConfig::set_conf(req->packet->context->conf);
-        IpsContext* c = req->packet->context;
-        Mpse::MpseRespType resp_ret;
+        offload_search(req->packet->context);
+        req->offload = false;
+
+#ifdef REG_TEST
+        {
+            std::unique_lock<std::mutex> lock(req->sync_mutex);
+            req->sync_cond.notify_one();
+        }
+#endif
+    }
+    offload_tterm();
+}
 
-        c->searches.offload_search();
+//--------------------------------------------------------------------------
+// async (rings) offload implementation
+//--------------------------------------------------------------------------
+
+// workers poll an empty ring up to the spin limit before sleeping.  the limit
+// doubles when a request arrives while spinning and halves when the worker
+// has to sleep, so workers of a busy packet thread rarely sleep and those of
+// an idle one don't burn a cpu.
+static const unsigned min_spins = 64;
+static const unsigned max_spins = 64 * 1024;
+
+struct OffloadWorker
+{
+    OffloadWorker(unsigned max) : requests(max), completed(max) { }
+
+    // each ring holds all requests of the packet thread so a push can't fail
+    SpscRing<RegexRequest> requests;    // packet thread to worker
+    SpscRing<RegexRequest> completed;   // worker to packet thread
+
+    std::thread* thread = nullptr;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    std::atomic<bool> parked { false };
+    std::atomic<bool> go { true };
+
+    unsigned pending = 0;   // packet thread only
+};
+
+static inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+static void count_latency(hr_duration d)
+{
+    auto usecs = clock_usecs(TO_USECS(d));
+
+    if ( usecs < 2 )
+        pc.offload_under_2us++;
+    else if ( usecs < 8 )
+        pc.offload_under_8us++;
+    else if ( usecs < 32 )
+        pc.offload_under_32us++;
+    else if ( usecs < 128 )
+        pc.offload_under_128us++;
+    else if ( usecs < 512 )
+        pc.offload_under_512us++;
+    else
+        pc.offload_over_512us++;
+}
 
-        do
+RingRegexOffload::RingRegexOffload(unsigned max, unsigned num) : RegexOffload(max)
+{
+    unsigned id = ThreadConfig::get_instance_max();
+    const SnortConfig* sc = SnortConfig::get_conf();
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        OffloadWorker* w = new OffloadWorker(max);
+        w->thread = new std::thread(worker, w, sc, id++);
+        workers.emplace_back(w);
+    }
+}
+
+RingRegexOffload::~RingRegexOffload()
+{
+    for ( auto* w : workers )
+    {
+        w->thread->join();
+        delete w->thread;
+        delete w;
+    }
+}
+
+void RingRegexOffload::stop()
+{
+    RegexOffload::stop();
+
+    for ( auto* w : workers )
+    {
+        std::lock_guard<std::mutex> lock(w->mutex);
+        w->go = false;
+        w->cond.notify_one();
+    }
+}
+
+void RingRegexOffload::put(Packet* p)
+{
+    Profile profile(mpsePerfStats);
+
+    assert(p);
+    assert(!idle.empty());
+    assert(p->context->searches.items.size() > 0);
+
+    RegexRequest* req = idle.front();
+    idle.pop_front();
+
+    busy.emplace_back(req);
+    p->context->regex_req_it = std::prev(busy.end());
+
+    req->packet = p;
+    req->queued = SnortClock::now();
+
+    // least loaded worker, starting after the last one picked
+    unsigned ix = next;
+
+    for ( unsigned i = 1; i < workers.size(); ++i )
+    {
+        unsigned j = (next + i) % workers.size();
+
+        if ( workers[j]->pending < workers[ix]->pending )
+            ix = j;
+    }
+    next = (ix + 1) % workers.size();
+
+    OffloadWorker* w = workers[ix];
+    w->pending++;
+    w->requests.push(req);
+
+    // pairs with the fence in worker() so that either the worker sees the
+    // request before it sleeps or this sees that it is sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if ( w->parked.load(std::memory_order_relaxed) )
+    {
+        std::lock_guard<std::mutex> lock(w->mutex);
+        w->cond.notify_one();
+        pc.offload_wakes++;
+    }
+
+#ifdef REG_TEST
+    while ( w->completed.empty() )
+        std::this_thread::yield();
+#endif
+}
+
+bool RingRegexOffload::get(Packet*& p)
+{
+    Profile profile(mpsePerfStats);
+    assert(!busy.empty());
+
+    for ( auto* w : workers )
+    {
+        RegexRequest* req = w->completed.pop();
+
+        if ( !req )
+            continue;
+
+        w->pending--;
+        count_latency(req->done - req->queued);
+
+        p = req->packet;
+        req->packet = nullptr;
+
+        busy.erase(p->context->regex_req_it);
+        idle.emplace_back(req);
+
+        return true;
+    }
+
+    p = nullptr;
+    return false;
+}
+
+void RingRegexOffload::worker(
+    OffloadWorker* w, const SnortConfig* initial_config, unsigned id)
+{
+    set_instance_id(id);
+    SnortConfig::set_conf(initial_config);
+
+    unsigned spin_limit = min_spins;
+    unsigned spins = 0;
+
+    while ( true )
+    {
+        RegexRequest* req = w->requests.pop();
+
+        if ( req )
         {
-            resp_ret = c->searches.receive_offload_responses();
+            if ( spins )
+                spin_limit = std::min(spin_limit * 2, max_spins);
+            spins = 0;
+
+            assert(req->packet);
+            assert(req->packet->is_offloaded());
+            assert(req->packet->context->searches.items.size() > 0);
+
+            SnortConfig::set_conf(req->packet->context->conf);
+            offload_search(req->packet->context);
+
+            req->done = SnortClock::now();
+            w->completed.push(req);
+            continue;
         }
-        while (resp_ret == Mpse::MPSE_RESP_NOT_COMPLETE);
 
-        if (resp_ret == Mpse::MPSE_RESP_COMPLETE_FAIL)
+        if ( !w->go )
+            break;
+
+        if ( spins < spin_limit )
         {
-            if (c->searches.can_fallback())
-            {
-                c->searches.search_sync();
-                pc.offload_fallback++;
-            }
-            pc.offload_failures++;
+            ++spins;
+            cpu_relax();
+            continue;
         }
 
-        c->searches.items.clear();
-        req->offload = false;
+        spin_limit = std::max(spin_limit / 2, min_spins);
+        spins = 0;
+        pc.offload_parks++;
 
-#ifdef REG_TEST
+        std::unique_lock<std::mutex> lock(w->mutex);
+        w->parked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if ( w->go and w->requests.empty() )
+            w->cond.wait_for(lock, std::chrono::seconds(1));
+
+        w->parked.store(false, std::memory_order_relaxed);
+    }
+    offload_tterm();
+}
+
+//--------------------------------------------------------------------------
+// async (shared pool) offload implementation
+//--------------------------------------------------------------------------
+
+struct PoolWorker
+{
+    // the owner takes the oldest request from the front; thieves take the
+    // newest from the back
+    std::mutex mutex;
+    std::deque<RegexRequest*> queue;
+    std::thread* thread = nullptr;
+};
+
+class OffloadPool
+{
+public:
+    // the first packet thread starts the pool and the last one stops it
+    static OffloadPool* acquire(unsigned workers);
+    static void release();
+
+    unsigned size() const
+    { return workers.size(); }
+
+    void submit(RegexRequest*, unsigned home);
+
+private:
+    OffloadPool(unsigned workers);
+    ~OffloadPool();
+
+    RegexRequest* take(unsigned ix);
+    void work(unsigned ix, const SnortConfig*, unsigned id);
+
+private:
+    std::vector<PoolWorker*> workers;
+
+    std::atomic<unsigned> queued { 0 };
+    std::atomic<unsigned> sleepers { 0 };
+    std::atomic<bool> go { true };
+
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    static std::mutex pool_mutex;
+    static OffloadPool* pool;
+    static unsigned users;
+};
+
+std::mutex OffloadPool::pool_mutex;
+OffloadPool* OffloadPool::pool = nullptr;
+unsigned OffloadPool::users = 0;
+
+OffloadPool* OffloadPool::acquire(unsigned num)
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+
+    if ( !pool )
+        pool = new OffloadPool(num);
+
+    ++users;
+    return pool;
+}
+
+void OffloadPool::release()
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    assert(pool and users);
+
+    if ( --users )
+        return;
+
+    delete pool;
+    pool = nullptr;
+}
+
+OffloadPool::OffloadPool(unsigned num)
+{
+    unsigned id = ThreadConfig::get_instance_max();
+    const SnortConfig* sc = SnortConfig::get_conf();
+
+    for ( unsigned i = 0; i < num; ++i )
+        workers.emplace_back(new PoolWorker);
+
+    for ( unsigned i = 0; i < num; ++i )
+        workers[i]->thread = new std::thread(&OffloadPool::work, this, i, sc, id++);
+}
+
+OffloadPool::~OffloadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        go = false;
+    }
+    cond.notify_all();
+
+    for ( auto* w : workers )
+    {
+        w->thread->join();
+        delete w->thread;
+        assert(w->queue.empty());
+        delete w;
+    }
+}
+
+void OffloadPool::submit(RegexRequest* req, unsigned home)
+{
+    // either a worker going to sleep sees the count or this sees the sleeper
+    queued++;
+
+    PoolWorker* w = workers[home];
+    {
+        std::lock_guard<std::mutex> lock(w->mutex);
+        w->queue.emplace_back(req);
+    }
+
+    if ( sleepers )
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cond.notify_one();
+        pc.offload_wakes++;
+    }
+}
+
+RegexRequest* OffloadPool::take(unsigned ix)
+{
+    if ( !queued.load(std::memory_order_relaxed) )
+        return nullptr;
+
+    RegexRequest* req = nullptr;
+    unsigned n = workers.size();
+
+    for ( unsigned i = 0; i < n and !req; ++i )
+    {
+        PoolWorker* w = workers[(ix + i) % n];
+        std::lock_guard<std::mutex> lock(w->mutex);
+
+        if ( w->queue.empty() )
+            continue;
+
+        if ( !i )
         {
-            std::unique_lock<std::mutex> lock(req->sync_mutex);
-            req->sync_cond.notify_one();
+            req = w->queue.front();
+            w->queue.pop_front();
         }
-#endif
+        else
+        {
+            req = w->queue.back();
+            w->queue.pop_back();
+        }
+        req->stolen = (i != 0);
     }
-    ModuleManager::accumulate_offload("search_engine");
-    ModuleManager::accumulate_offload("detection");
 
-    // FIXIT-M break this over-coupling. In reality we shouldn't be evaluating latency in offload.
-    PacketLatency::tterm();
-    RuleLatency::tterm();
+    if ( req )
+        queued--;
+
+    return req;
 }
 
+void OffloadPool::work(unsigned ix, const SnortConfig* initial_config, unsigned id)
+{
+    set_instance_id(id);
+    SnortConfig::set_conf(initial_config);
+    initial_config->thread_config->implement_named_thread_affinity(
+        "offload_" + std::to_string(ix));
+
+    unsigned spin_limit = min_spins;
+    unsigned spins = 0;
+
+    while ( true )
+    {
+        RegexRequest* req = take(ix);
+
+        if ( req )
+        {
+            if ( spins )
+                spin_limit = std::min(spin_limit * 2, max_spins);
+            spins = 0;
+
+            assert(req->packet);
+            assert(req->packet->is_offloaded());
+            assert(req->packet->context->searches.items.size() > 0);
+
+            req->started = SnortClock::now();
+            SnortConfig::set_conf(req->packet->context->conf);
+            offload_search(req->packet->context);
+            req->done = SnortClock::now();
+
+            req->owner->complete(req);
+            continue;
+        }
+
+        if ( !go )
+            break;
+
+        if ( spins < spin_limit )
+        {
+            ++spins;
+            cpu_relax();
+            continue;
+        }
+
+        spin_limit = std::max(spin_limit / 2, min_spins);
+        spins = 0;
+        pc.offload_parks++;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        sleepers++;
+
+        if ( go and !queued )
+            cond.wait_for(lock, std::chrono::seconds(1));
+
+        sleepers--;
+    }
+    offload_tterm();
+}
+
+PoolRegexOffload::PoolRegexOffload(unsigned max, unsigned num) : RegexOffload(max)
+{
+    pool = OffloadPool::acquire(num);
+    home = get_instance_id() % pool->size();
+}
+
+PoolRegexOffload::~PoolRegexOffload()
+{
+    assert(done.empty());
+    OffloadPool::release();
+}
+
+void PoolRegexOffload::complete(RegexRequest* req)
+{
+    std::lock_guard<std::mutex> lock(done_mutex);
+    done.emplace_back(req);
+    num_done++;
+}
+
+void PoolRegexOffload::put(Packet* p)
+{
+    Profile profile(mpsePerfStats);
+
+    assert(p);
+    assert(!idle.empty());
+    assert(p->context->searches.items.size() > 0);
+
+    RegexRequest* req = idle.front();
+    idle.pop_front();
+
+    busy.emplace_back(req);
+    p->context->regex_req_it = std::prev(busy.end());
+
+    req->packet = p;
+    req->owner = this;
+    req->queued = SnortClock::now();
+
+    pool->submit(req, home);
+
+#ifdef REG_TEST
+    while ( !num_done )
+        std::this_thread::yield();
+#endif
+}
+
+bool PoolRegexOffload::get(Packet*& p)
+{
+    Profile profile(mpsePerfStats);
+    assert(!busy.empty());
+
+    if ( !num_done )
+    {
+        p = nullptr;
+        return false;
+    }
+
+    RegexRequest* req;
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        req = done.front();
+        done.pop_front();
+        num_done--;
+    }
+
+    if ( req->stolen )
+        pc.offload_stolen++;
+
+    pc.offload_pool_usecs += clock_usecs(TO_USECS(req->done - req->started));
+    count_latency(req->done - req->queued);
+
+    p = req->packet;
+    req->packet = nullptr;
+
+    busy.erase(p->context->regex_req_it);
+    idle.emplace_back(req);
+
+    return true;
+}
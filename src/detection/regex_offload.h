@@ -25,13 +25,26 @@
 // There are two flavors: MPSE and thread.  The MpseRegexOffload interfaces to
 // an MPSE that is capable of regex offload such as the RXP whereas
 // ThreadRegexOffload implements the regex search in auxiliary threads w/o
-// requiring extra MPSE instances.  presently all offload is per packet thread;
-// packet threads do not share offload resources.
+// requiring extra MPSE instances.  except for PoolRegexOffload, offload is
+// per packet thread; packet threads do not share offload resources.
+//
+// RingRegexOffload is a thread flavor that hands requests to a few worker
+// threads over lock-free rings instead of waking a dedicated thread under a
+// lock for each request.  workers spin for a while before sleeping so that a
+// busy packet thread rarely pays for a wakeup.
+//
+// PoolRegexOffload queues requests to one pool of workers shared by all
+// packet threads.  each worker has its own deque and each packet thread a
+// home worker; idle workers steal from the other deques so a thread with a
+// burst of large PDUs gets help from workers other threads aren't using.
 
+#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <list>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 namespace snort
 {
@@ -44,7 +57,8 @@ struct RegexRequest;
 class RegexOffload
 {
 public:
-    static RegexOffload* get_offloader(unsigned max, bool async);
+    static RegexOffload* get_offloader(
+        unsigned max, bool async, unsigned workers = 0, bool shared = false);
     virtual ~RegexOffload();
 
     virtual void stop();
@@ -92,5 +106,51 @@ private:
     static void worker(RegexRequest*, const snort::SnortConfig*, unsigned id);
 };
 
+struct OffloadWorker;
+
+class RingRegexOffload : public RegexOffload
+{
+public:
+    RingRegexOffload(unsigned max, unsigned workers);
+    ~RingRegexOffload() override;
+
+    void stop() override;
+
+    void put(snort::Packet*) override;
+    bool get(snort::Packet*&) override;
+
+private:
+    static void worker(OffloadWorker*, const snort::SnortConfig*, unsigned id);
+
+private:
+    std::vector<OffloadWorker*> workers;
+    unsigned next = 0;
+};
+
+class OffloadPool;
+
+class PoolRegexOffload : public RegexOffload
+{
+public:
+    PoolRegexOffload(unsigned max, unsigned workers);
+    ~PoolRegexOffload() override;
+
+    void put(snort::Packet*) override;
+    bool get(snort::Packet*&) override;
+
+private:
+    friend class OffloadPool;
+    void complete(RegexRequest*);
+
+private:
+    OffloadPool* pool;
+    unsigned home;
+
+    // completions are pushed by any worker and popped by the packet thread
+    std::mutex done_mutex;
+    std::deque<RegexRequest*> done;
+    std::atomic<unsigned> num_done { 0 };
+};
+
 #endif
 
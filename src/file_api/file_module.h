@@ -48,6 +48,8 @@ public:
     PegCount* get_counts() const override;
 
     void sum_stats(bool) override;
+    bool snapshot_stats() const override
+    { return false; }
 
     void load_config(FileConfig*& dst);
 
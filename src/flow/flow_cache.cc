@@ -26,7 +26,6 @@
 
 #include "detection/detection_engine.h"
 #include "hash/hash_defs.h"
-#include "hash/zhash.h"
 #include "helpers/flag_context.h"
 #include "ips_options/ips_flowbits.h"
 #include "memory/memory_cap.h"
@@ -37,6 +36,7 @@
 
 #include "flow.h"
 #include "flow_key.h"
+#include "flow_table.h"
 #include "flow_uni_list.h"
 #include "ha.h"
 #include "session.h"
@@ -55,7 +55,7 @@ static const unsigned ALL_FLOWS = 3;
 
 FlowCache::FlowCache(const FlowCacheConfig& cfg) : config(cfg)
 {
-    hash_table = new ZHash(config.max_flows, sizeof(FlowKey));
+    hash_table = FlowTable::create(config.table_type, config.max_flows);
     uni_flows = new FlowUniList;
     uni_ip_flows = new FlowUniList;
     flags = 0x0;
@@ -90,6 +90,9 @@ unsigned FlowCache::get_count()
     return hash_table ? hash_table->get_num_nodes() : 0;
 }
 
+unsigned FlowCache::prefetch(const FlowKey* keys, unsigned num)
+{ return hash_table->prefetch(keys, num); }
+
 Flow* FlowCache::find(const FlowKey* key)
 {
     Flow* flow = (Flow*)hash_table->get_user_data(key);
@@ -203,6 +206,7 @@ unsigned FlowCache::prune_stale(uint32_t thetime, const Flow* save_me)
     ActiveSuspendContext act_susp(Active::ASP_PRUNE);
 
     unsigned pruned = 0;
+    unsigned skipped = 0;
     auto flow = static_cast<Flow*>(hash_table->lru_first());
 
     {
@@ -229,7 +233,16 @@ unsigned FlowCache::prune_stale(uint32_t thetime, const Flow* save_me)
                 break;
 
             if ( flow->last_data_seen + config.pruning_timeout >= thetime )
-                break;
+            {
+                // lru order means the rest are newer but the clock only
+                // approximates that so give this one another chance
+                if ( hash_table->is_ordered() or ++skipped > unordered_scan_limit )
+                    break;
+
+                hash_table->lru_touch();
+                flow = static_cast<Flow*>(hash_table->lru_first());
+                continue;
+            }
 
             flow->ssn_state.session_flags |= SSNFLAG_TIMEDOUT;
             if ( release(flow, PruneReason::IDLE) )
@@ -361,6 +374,8 @@ unsigned FlowCache::timeout(unsigned num_flows, time_t thetime)
     ActiveSuspendContext act_susp(Active::ASP_TIMEOUT);
 
     unsigned retired = 0;
+    unsigned skipped = 0;
+    bool ordered = hash_table->is_ordered();
 
     {
         PacketTracerSuspend pt_susp;
@@ -372,17 +387,24 @@ unsigned FlowCache::timeout(unsigned num_flows, time_t thetime)
 
         while ( flow and (retired < num_flows) )
         {
+            bool expired;
+
             if ( flow->is_hard_expiration() )
-            {
-                if ( flow->expire_time > (uint64_t) thetime )
-                    break;
-            }
-            else if ( flow->last_data_seen + config.proto[to_utype(flow->key->pkt_type)].nominal_timeout > thetime )
+                expired = flow->expire_time <= (uint64_t) thetime;
+            else
+                expired = flow->last_data_seen +
+                    config.proto[to_utype(flow->key->pkt_type)].nominal_timeout <= thetime;
+
+            if ( !expired and ordered )
                 break;
 
-            if ( HighAvailabilityManager::in_standby(flow) or
+            if ( !expired or HighAvailabilityManager::in_standby(flow) or
                     flow->is_suspended() )
             {
+                // an unordered table wraps around so the walk must be bounded
+                if ( !ordered and ++skipped > unordered_scan_limit )
+                    break;
+
                 flow = static_cast<Flow*>(hash_table->lru_next());
                 continue;
             }
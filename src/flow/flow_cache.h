@@ -23,7 +23,7 @@
 #define FLOW_CACHE_H
 
 // there is a FlowCache instance for each protocol.
-// Flows are stored in a ZHash instance by FlowKey.
+// Flows are stored in a FlowTable instance by FlowKey.
 
 #include <ctime>
 #include <type_traits>
@@ -39,6 +39,7 @@ class Flow;
 struct FlowKey;
 }
 
+class FlowTable;
 class FlowUniList;
 
 class FlowCache
@@ -64,6 +65,9 @@ public:
     unsigned purge();
     unsigned get_count();
 
+    // hint that these keys will be looked up soon; see FlowTable::prefetch()
+    unsigned prefetch(const snort::FlowKey*, unsigned num);
+
     unsigned get_max_flows() const
     { return config.max_flows; }
 
@@ -108,10 +112,15 @@ private:
 
 private:
     static const unsigned cleanup_flows = 1;
+
+    // with an unordered table, the number of flows checked beyond the
+    // first before giving up on finding a stale or timed out flow
+    static const unsigned unordered_scan_limit = 8;
+
     FlowCacheConfig config;
     uint32_t flags;
 
-    class ZHash* hash_table;
+    FlowTable* hash_table;
     unsigned flows_allocated = 0;
     FlowUniList* uni_flows;
     FlowUniList* uni_ip_flows;
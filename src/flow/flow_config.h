@@ -30,10 +30,15 @@ struct FlowTypeConfig
     unsigned cap_weight = 0;
 };
 
+enum class FlowTableType : uint8_t
+{ CHAINED, CUCKOO };
+
 struct FlowCacheConfig
 {
     unsigned max_flows = 0;
     unsigned pruning_timeout = 0;
+    FlowTableType table_type = FlowTableType::CHAINED;
+    bool prefetch = false;
     FlowTypeConfig proto[to_utype(PktType::MAX)];
 };
 
@@ -20,7 +20,10 @@
 #include "config.h"
 #endif
 
+#include <algorithm>
+
 #include <daq_common.h>
+#include <daq_dlt.h>
 
 #include "flow_control.h"
 
@@ -30,7 +33,10 @@
 #include "memory/memory_cap.h"
 #include "packet_io/active.h"
 #include "packet_tracer/packet_tracer.h"
+#include "protocols/eth.h"
 #include "protocols/icmp4.h"
+#include "protocols/ipv4.h"
+#include "protocols/ipv6.h"
 #include "protocols/tcp.h"
 #include "protocols/udp.h"
 #include "protocols/vlan.h"
@@ -39,6 +45,7 @@
 
 #include "expect_cache.h"
 #include "flow_cache.h"
+#include "flow_table.h"
 #include "ha.h"
 #include "session.h"
 
@@ -78,6 +85,7 @@ void FlowControl::clear_counts()
 {
     cache->reset_stats();
     num_flows = 0;
+    prefetch_batches = prefetch_keys = prefetch_hits = 0;
 }
 
 //-------------------------------------------------------------------------
@@ -153,6 +161,160 @@ Flow* FlowControl::stale_flow_cleanup(FlowCache* cache, Flow* flow, Packet* p)
     return flow;
 }
 
+//-------------------------------------------------------------------------
+// prefetch foo
+//-------------------------------------------------------------------------
+
+// build the key that set_key() will build for plain tcp and udp over
+// ethernet, vlan, or raw ip.  anything else (tunnels, fragments, ip6
+// extension headers, etc.) is skipped since a wrong key only costs a
+// wasted prefetch.
+static bool get_prefetch_key(const SnortConfig* sc, int dlt, DAQ_Msg_h msg, FlowKey& key)
+{
+    if ( daq_msg_get_type(msg) != DAQ_MSG_TYPE_PACKET )
+        return false;
+
+    const uint8_t* data = daq_msg_get_data(msg);
+    uint32_t len = daq_msg_get_data_len(msg);
+    ProtocolId type;
+    uint16_t vlan = 0;
+
+    switch ( dlt )
+    {
+    case DLT_EN10MB:
+    {
+        if ( len < eth::ETH_HEADER_LEN )
+            return false;
+
+        type = ((const eth::EtherHdr*)data)->ethertype();
+        data += eth::ETH_HEADER_LEN;
+        len -= eth::ETH_HEADER_LEN;
+
+        // set_key() uses the innermost tag
+        while ( type == ProtocolId::ETHERTYPE_8021Q or type == ProtocolId::ETHERTYPE_8021AD or
+            type == ProtocolId::ETHERTYPE_QINQ_NS1 or type == ProtocolId::ETHERTYPE_QINQ_NS2 )
+        {
+            if ( len < sizeof(vlan::VlanTagHdr) )
+                return false;
+
+            const vlan::VlanTagHdr* vh = (const vlan::VlanTagHdr*)data;
+            vlan = vh->vid();
+            type = (ProtocolId)ntohs(vh->vth_proto);
+            data += sizeof(vlan::VlanTagHdr);
+            len -= sizeof(vlan::VlanTagHdr);
+        }
+        break;
+    }
+    case DLT_RAW:
+        if ( !len )
+            return false;
+
+        type = ((data[0] >> 4) == 6) ? ProtocolId::ETHERTYPE_IPV6 : ProtocolId::ETHERTYPE_IPV4;
+        break;
+
+    case DLT_IPV4:
+        type = ProtocolId::ETHERTYPE_IPV4;
+        break;
+
+    case DLT_IPV6:
+        type = ProtocolId::ETHERTYPE_IPV6;
+        break;
+
+    default:
+        return false;
+    }
+
+    SfIp src, dst;
+    IpProtocol proto;
+
+    if ( type == ProtocolId::ETHERTYPE_IPV4 )
+    {
+        const ip::IP4Hdr* ip4 = (const ip::IP4Hdr*)data;
+
+        if ( len < ip::IP4_HEADER_LEN or ip4->hlen() < ip::IP4_HEADER_LEN or len < ip4->hlen() )
+            return false;
+
+        if ( ip4->mf() or ip4->off() )
+            return false;
+
+        proto = ip4->proto();
+        src.set(&ip4->ip_src, AF_INET);
+        dst.set(&ip4->ip_dst, AF_INET);
+        data += ip4->hlen();
+        len -= ip4->hlen();
+    }
+    else if ( type == ProtocolId::ETHERTYPE_IPV6 )
+    {
+        const ip::IP6Hdr* ip6 = (const ip::IP6Hdr*)data;
+
+        if ( len < ip::IP6_HEADER_LEN )
+            return false;
+
+        proto = ip6->next();
+        src.set(ip6->get_src(), AF_INET6);
+        dst.set(ip6->get_dst(), AF_INET6);
+        data += ip::IP6_HEADER_LEN;
+        len -= ip::IP6_HEADER_LEN;
+    }
+    else
+        return false;
+
+    PktType pkt_type;
+
+    if ( proto == IpProtocol::TCP and len >= tcp::TCP_MIN_HEADER_LEN )
+        pkt_type = PktType::TCP;
+
+    else if ( proto == IpProtocol::UDP and len >= udp::UDP_HEADER_LEN )
+        pkt_type = PktType::UDP;
+
+    else
+        return false;
+
+    // tcp and udp both start with the ports
+    const udp::UDPHdr* uh = (const udp::UDPHdr*)data;
+
+    key.init(sc, pkt_type, proto, &src, uh->src_port(), &dst, uh->dst_port(),
+        vlan, 0, *daq_msg_get_pkthdr(msg));
+
+    return true;
+}
+
+// the window is refilled once no more than half of it is left so the
+// misses for the new messages overlap while those already prefetched are
+// still cached when they are processed.  prefetching a whole large batch up
+// front evicts the first flows before they are looked up.
+unsigned FlowControl::prefetch_flows(
+    const DAQ_Msg_h* msgs, unsigned num, unsigned num_done, int dlt)
+{
+    const unsigned window = FlowTable::max_prefetch;
+
+    if ( !get_flow_cache_config().prefetch or num < 2 )
+        return num_done;
+
+    if ( num_done >= num or num_done > window / 2 )
+        return num_done;
+
+    if ( !num_done )
+        ++prefetch_batches;
+
+    const SnortConfig* sc = SnortConfig::get_conf();
+    FlowKey keys[window];
+    unsigned end = std::min(num, window);
+    unsigned n = 0;
+
+    for ( unsigned i = num_done; i < end; ++i )
+    {
+        if ( get_prefetch_key(sc, dlt, msgs[i], keys[n]) )
+            ++n;
+    }
+    if ( n )
+    {
+        prefetch_keys += n;
+        prefetch_hits += cache->prefetch(keys, n);
+    }
+    return end;
+}
+
 //-------------------------------------------------------------------------
 // packet foo
 //-------------------------------------------------------------------------
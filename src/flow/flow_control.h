@@ -28,6 +28,8 @@
 #include <cstdint>
 #include <vector>
 
+#include <daq_common.h>
+
 #include "flow/flow_config.h"
 #include "framework/counts.h"
 #include "framework/decode_data.h"
@@ -65,6 +67,11 @@ public:
     void release_flow(snort::Flow*, PruneReason);
     void purge_flows();
     unsigned delete_flows(unsigned num_to_delete);
+
+    // peek at the next few pending messages ahead of decode and prefetch
+    // their flows; the first num_done were prefetched by an earlier call.
+    // returns the number of pending messages prefetched so far.
+    unsigned prefetch_flows(const DAQ_Msg_h*, unsigned num, unsigned num_done, int dlt);
     bool prune_one(PruneReason, bool do_cleanup);
     snort::Flow* stale_flow_cleanup(FlowCache*, snort::Flow*, snort::Packet*);
     void timeout_flows(time_t cur_time);
@@ -91,6 +98,16 @@ public:
     PegCount get_prunes(PruneReason) const;
     PegCount get_total_deletes() const;
     PegCount get_deletes(FlowDeleteState state) const;
+
+    PegCount get_prefetch_batches() const
+    { return prefetch_batches; }
+
+    PegCount get_prefetch_keys() const
+    { return prefetch_keys; }
+
+    PegCount get_prefetch_hits() const
+    { return prefetch_hits; }
+
     void clear_counts();
 
 private:
@@ -102,6 +119,9 @@ private:
 private:
     snort::InspectSsnFunc get_proto_session[to_utype(PktType::MAX)] = {};
     PegCount num_flows = 0;
+    PegCount prefetch_batches = 0;
+    PegCount prefetch_keys = 0;
+    PegCount prefetch_hits = 0;
     FlowCache* cache = nullptr;
     snort::Flow* mem = nullptr;
     class ExpectCache* exp_cache = nullptr;
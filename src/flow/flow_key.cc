@@ -467,6 +467,9 @@ bool FlowKey::is_equal(const void* s1, const void* s2, size_t)
 
 unsigned FlowHashKeyOps::do_hash(const unsigned char* k, int)
 {
+    if ( use_crc() )
+        return do_crc_hash(k, sizeof(FlowKey));
+
     uint32_t a, b, c;
     a = b = c = hardener;
 
@@ -509,3 +512,63 @@ bool FlowHashKeyOps::key_compare(const void* k1, const void* k2, size_t len)
 }
 
 
+
+//-------------------------------------------------------------------------
+// benchmarks
+//-------------------------------------------------------------------------
+
+#ifdef BENCHMARK_TEST
+
+#include <vector>
+
+#include "catch/snort_catch.h"
+
+class BenchFlowHashKeyOps : public FlowHashKeyOps
+{
+public:
+    BenchFlowHashKeyOps(bool crc) : FlowHashKeyOps(1 << 16)
+    {
+        if ( !crc )
+            crc_hash = nullptr;
+    }
+
+    bool crc() const
+    { return use_crc(); }
+};
+
+static void bench_flow_hash(bool crc)
+{
+    const unsigned num = 16 << 16;
+
+    BenchFlowHashKeyOps ops(crc);
+
+    if ( crc and !ops.crc() )
+        return;
+
+    std::vector<FlowKey> keys(num);
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        FlowKey& k = keys[i];
+        memset(&k, 0, sizeof(k));
+        k.ip_l[2] = k.ip_h[2] = htonl(0xffff);
+        k.ip_l[3] = htonl(0x0a000000 + (i >> 4));
+        k.ip_h[3] = htonl(0xc0a80001);
+        k.port_l = 1024 + (i & 0xf);
+        k.port_h = 80;
+        k.ip_protocol = 6;
+        k.pkt_type = PktType::TCP;
+        k.version = 4;
+    }
+
+    bench_hash_keys(crc ? "flow crc" : "flow scalar", ops,
+        (const uint8_t*)keys.data(), sizeof(FlowKey), num);
+}
+
+TEST_CASE("flow key hash", "[hash][benchmark]")
+{
+    bench_flow_hash(false);
+    bench_flow_hash(true);
+}
+
+#endif
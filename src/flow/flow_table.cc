@@ -0,0 +1,643 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// flow_table.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "flow_table.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "hash/hash_defs.h"
+#include "hash/zhash.h"
+
+using namespace snort;
+
+//-------------------------------------------------------------------------
+// chained table
+//-------------------------------------------------------------------------
+
+class ChainedFlowTable : public FlowTable
+{
+public:
+    ChainedFlowTable(unsigned max_flows) : table(max_flows, sizeof(FlowKey))
+    { }
+
+    void* push(void* flow) override
+    { return table.push(flow); }
+
+    void* pop() override
+    { return table.pop(); }
+
+    void* get_user_data(const void* key) override
+    { return table.get_user_data(key); }
+
+    void* get(const void* key) override
+    { return table.get(key); }
+
+    int release_node(const void* key) override
+    { return table.release_node(key); }
+
+    void* remove() override
+    { return table.remove(); }
+
+    void* lru_first() override
+    { return table.lru_first(); }
+
+    void* lru_next() override
+    { return table.lru_next(); }
+
+    void* lru_current() override
+    { return table.lru_current(); }
+
+    void lru_touch() override
+    { table.lru_touch(); }
+
+    unsigned get_num_nodes() override
+    { return table.get_num_nodes(); }
+
+    bool is_ordered() const override
+    { return true; }
+
+protected:
+    uint32_t prefetch_bucket(const void* key) override
+    { return table.prefetch_row(key); }
+
+    const void* prefetch_node(const void*, uint32_t row) override
+    { return table.prefetch_node(row); }
+
+    // the first node in the row is only likely to be the match
+    void prefetch_flow(const void* node) override
+    {
+        const HashNode* hnode = (const HashNode*)node;
+        __builtin_prefetch(hnode->key);
+        __builtin_prefetch(hnode->data);
+    }
+
+private:
+    ZHash table;
+};
+
+FlowTable* FlowTable::create(FlowTableType type, unsigned max_flows)
+{
+    if ( type == FlowTableType::CUCKOO )
+        return new CuckooFlowTable(max_flows);
+
+    return new ChainedFlowTable(max_flows);
+}
+
+unsigned FlowTable::prefetch(const FlowKey* keys, unsigned num)
+{
+    assert(num <= max_prefetch);
+
+    uint32_t hash[max_prefetch];
+    const void* node[max_prefetch];
+    unsigned found = 0;
+
+    for ( unsigned i = 0; i < num; ++i )
+        hash[i] = prefetch_bucket(keys + i);
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        if ( (node[i] = prefetch_node(keys + i, hash[i])) )
+            ++found;
+    }
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        if ( node[i] )
+            prefetch_flow(node[i]);
+    }
+    return found;
+}
+
+//-------------------------------------------------------------------------
+// cuckoo table
+//-------------------------------------------------------------------------
+
+// inserts give up and grow the table after this many displacements.  the
+// table is sized for a load factor of at most 1/2 so that is rare.
+static const unsigned max_kicks = 128;
+
+CuckooFlowTable::CuckooFlowTable(unsigned max_flows)
+{
+    static_assert(sizeof(Bucket) == 64, "buckets must be one cache line");
+
+    int rows = hash_nearest_power_of_2((2 * max_flows) / slots + 1);
+
+    if ( rows < 8 )
+        rows = 8;
+
+    hash_ops = new FlowHashKeyOps(rows);
+    allocate_buckets(rows);
+}
+
+CuckooFlowTable::~CuckooFlowTable()
+{
+    for ( unsigned b = 0; b < num_buckets; ++b )
+    {
+        for ( unsigned s = 0; s < slots; ++s )
+            delete buckets[b].node[s];
+    }
+
+    for ( auto* node : free_nodes )
+        delete node;
+
+    free(buckets);
+    delete hash_ops;
+}
+
+void CuckooFlowTable::allocate_buckets(unsigned count)
+{
+    void* p = nullptr;
+
+    if ( posix_memalign(&p, alignof(Bucket), count * sizeof(Bucket)) )
+        throw std::bad_alloc();
+
+    memset(p, 0, count * sizeof(Bucket));
+
+    buckets = (Bucket*)p;
+    num_buckets = count;
+    mask = count - 1;
+
+    hand_bucket = hand_slot = 0;
+}
+
+CuckooFlowTable::Node* CuckooFlowTable::lookup(
+    const void* key, uint32_t hash, Bucket*& bucket, unsigned& slot)
+{
+    uint32_t b = hash & mask;
+    uint32_t alt = alt_bucket(b, hash);
+
+    __builtin_prefetch(buckets + alt);
+
+    for ( int i = 0; i < 2; ++i, b = alt )
+    {
+        Bucket& bk = buckets[b];
+
+        for ( unsigned s = 0; s < slots; ++s )
+        {
+            if ( bk.hash[s] != hash or !bk.node[s] )
+                continue;
+
+            if ( FlowKey::is_equal(&bk.node[s]->key, key, sizeof(FlowKey)) )
+            {
+                bucket = &bk;
+                slot = s;
+                return bk.node[s];
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool CuckooFlowTable::place(Bucket& bk, Node* node)
+{
+    for ( unsigned s = 0; s < slots; ++s )
+    {
+        if ( !bk.node[s] )
+        {
+            bk.node[s] = node;
+            bk.hash[s] = node->hash;
+            bk.ref |= (1u << s);
+            return true;
+        }
+    }
+    return false;
+}
+
+// on failure node is set to the displaced node that couldn't be placed
+bool CuckooFlowTable::insert(Node*& node)
+{
+    uint32_t b = node->hash & mask;
+
+    if ( place(buckets[b], node) )
+        return true;
+
+    b = alt_bucket(b, node->hash);
+
+    if ( place(buckets[b], node) )
+        return true;
+
+    for ( unsigned kick = 0; kick < max_kicks; ++kick )
+    {
+        Bucket& bk = buckets[b];
+        unsigned s = (kick + node->hash) % slots;
+
+        Node* victim = bk.node[s];
+        bk.node[s] = node;
+        bk.hash[s] = node->hash;
+        bk.ref |= (1u << s);
+
+        node = victim;
+        b = alt_bucket(b, node->hash);
+
+        if ( place(buckets[b], node) )
+            return true;
+    }
+    return false;
+}
+
+bool CuckooFlowTable::rehash(const Bucket* old, unsigned count)
+{
+    for ( unsigned b = 0; b < count; ++b )
+    {
+        for ( unsigned s = 0; s < slots; ++s )
+        {
+            Node* node = old[b].node[s];
+
+            if ( node and !insert(node) )
+                return false;
+        }
+    }
+    return true;
+}
+
+void CuckooFlowTable::grow()
+{
+    Bucket* old = buckets;
+    unsigned count = num_buckets;
+    unsigned size = count;
+
+    do
+    {
+        if ( buckets != old )
+            free(buckets);
+
+        size *= 2;
+        allocate_buckets(size);
+    }
+    while ( !rehash(old, count) );
+
+    free(old);
+}
+
+void* CuckooFlowTable::push(void* flow)
+{
+    Node* node = new Node;
+    node->flow = flow;
+    free_nodes.emplace_back(node);
+    return &node->key;
+}
+
+void* CuckooFlowTable::pop()
+{
+    if ( free_nodes.empty() )
+        return nullptr;
+
+    Node* node = free_nodes.back();
+    free_nodes.pop_back();
+
+    void* flow = node->flow;
+    delete node;
+    return flow;
+}
+
+void* CuckooFlowTable::get_user_data(const void* key)
+{
+    uint32_t hash = hash_ops->do_hash((const unsigned char*)key, sizeof(FlowKey));
+    Bucket* bk;
+    unsigned s;
+
+    Node* node = lookup(key, hash, bk, s);
+
+    if ( !node )
+        return nullptr;
+
+    bk->ref |= (1u << s);
+    return node->flow;
+}
+
+void* CuckooFlowTable::get(const void* key)
+{
+    uint32_t hash = hash_ops->do_hash((const unsigned char*)key, sizeof(FlowKey));
+    Bucket* bk;
+    unsigned s;
+
+    if ( Node* node = lookup(key, hash, bk, s) )
+        return node->flow;
+
+    if ( free_nodes.empty() )
+        return nullptr;
+
+    Node* node = free_nodes.back();
+    free_nodes.pop_back();
+
+    memcpy(&node->key, key, sizeof(FlowKey));
+    node->hash = hash;
+
+    void* flow = node->flow;
+
+    while ( !insert(node) )
+        grow();
+
+    ++num_nodes;
+    return flow;
+}
+
+int CuckooFlowTable::release_node(const void* key)
+{
+    Node* node = (Node*)key;
+    uint32_t b = node->hash & mask;
+
+    for ( int i = 0; i < 2; ++i, b = alt_bucket(b, node->hash) )
+    {
+        Bucket& bk = buckets[b];
+
+        for ( unsigned s = 0; s < slots; ++s )
+        {
+            if ( bk.node[s] != node )
+                continue;
+
+            bk.node[s] = nullptr;
+            bk.hash[s] = 0;
+            bk.ref &= ~(1u << s);
+
+            free_nodes.emplace_back(node);
+            --num_nodes;
+            return HASH_OK;
+        }
+    }
+    return HASH_NOT_FOUND;
+}
+
+void* CuckooFlowTable::remove()
+{
+    Bucket& bk = buckets[hand_bucket];
+    Node* node = bk.node[hand_slot];
+    assert(node);
+
+    bk.node[hand_slot] = nullptr;
+    bk.hash[hand_slot] = 0;
+    bk.ref &= ~(1u << hand_slot);
+    --num_nodes;
+
+    void* flow = node->flow;
+    delete node;
+    return flow;
+}
+
+void CuckooFlowTable::advance()
+{
+    if ( ++hand_slot < slots )
+        return;
+
+    hand_slot = 0;
+
+    if ( ++hand_bucket == num_buckets )
+        hand_bucket = 0;
+}
+
+// clear reference bits until an unreferenced node is found; terminates
+// within 2 sweeps since the first clears every bit
+void* CuckooFlowTable::lru_first()
+{
+    if ( !num_nodes )
+        return nullptr;
+
+    while ( true )
+    {
+        Bucket& bk = buckets[hand_bucket];
+
+        if ( bk.node[hand_slot] )
+        {
+            uint32_t bit = 1u << hand_slot;
+
+            if ( !(bk.ref & bit) )
+                return bk.node[hand_slot]->flow;
+
+            bk.ref &= ~bit;
+        }
+        advance();
+    }
+}
+
+void* CuckooFlowTable::lru_current()
+{
+    if ( !num_nodes )
+        return nullptr;
+
+    while ( !buckets[hand_bucket].node[hand_slot] )
+        advance();
+
+    return buckets[hand_bucket].node[hand_slot]->flow;
+}
+
+void* CuckooFlowTable::lru_next()
+{
+    if ( !num_nodes )
+        return nullptr;
+
+    advance();
+    return lru_current();
+}
+
+// give the current node a second chance
+void CuckooFlowTable::lru_touch()
+{
+    Bucket& bk = buckets[hand_bucket];
+    assert(bk.node[hand_slot]);
+
+    bk.ref |= (1u << hand_slot);
+    advance();
+}
+
+uint32_t CuckooFlowTable::prefetch_bucket(const void* key)
+{
+    uint32_t hash = hash_ops->do_hash((const unsigned char*)key, sizeof(FlowKey));
+    uint32_t b = hash & mask;
+
+    __builtin_prefetch(buckets + b);
+    __builtin_prefetch(buckets + alt_bucket(b, hash));
+
+    return hash;
+}
+
+// match on the inline hash only; comparing keys here would take the miss
+// on the node that we are trying to hide
+const void* CuckooFlowTable::prefetch_node(const void*, uint32_t hash)
+{
+    uint32_t b = hash & mask;
+
+    for ( int i = 0; i < 2; ++i, b = alt_bucket(b, hash) )
+    {
+        const Bucket& bk = buckets[b];
+
+        for ( unsigned s = 0; s < slots; ++s )
+        {
+            if ( bk.hash[s] == hash and bk.node[s] )
+            {
+                __builtin_prefetch(bk.node[s]);
+                return bk.node[s];
+            }
+        }
+    }
+    return nullptr;
+}
+
+void CuckooFlowTable::prefetch_flow(const void* node)
+{ __builtin_prefetch(((const Node*)node)->flow); }
+
+//-------------------------------------------------------------------------
+// benchmarks
+//-------------------------------------------------------------------------
+
+#ifdef BENCHMARK_TEST
+
+#include <string>
+
+#include "catch/snort_catch.h"
+
+static void make_key(FlowKey& key, unsigned i)
+{
+    memset(&key, 0, sizeof(key));
+    key.ip_l[3] = i;
+    key.ip_h[3] = ~i;
+    key.port_l = (uint16_t)i;
+    key.port_h = 80;
+    key.pkt_type = PktType::TCP;
+}
+
+// flows are stand ins since the tables only store the pointer
+static void bench_table(FlowTableType type, unsigned num)
+{
+    FlowTable* table = FlowTable::create(type, num);
+    std::vector<uint8_t> flows(num);
+    std::vector<void*> storage(num);
+    std::vector<FlowKey> keys(num);
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        storage[i] = table->push(&flows[i]);
+        make_key(keys[i], i);
+        table->get(&keys[i]);
+    }
+
+    std::string name = (type == FlowTableType::CUCKOO) ? "cuckoo " : "chained ";
+    name += std::to_string(num);
+
+    // stride through the keys so lookups aren't cache hits
+    unsigned i = 0;
+
+    BENCHMARK(name + " find")
+    {
+        i = (i + 7919) % num;
+        return table->get_user_data(&keys[i]);
+    };
+
+    // prune the oldest flow and reuse it for a new key
+    unsigned next = num;
+    FlowKey key;
+
+    BENCHMARK(name + " prune + allocate")
+    {
+        uint8_t* flow = (uint8_t*)table->lru_first();
+        table->release_node(storage[flow - flows.data()]);
+        make_key(key, next++);
+        return table->get(&key);
+    };
+
+    delete table;
+}
+
+TEST_CASE("flow table 1M", "[flow_table][benchmark]")
+{
+    bench_table(FlowTableType::CHAINED, 1000000);
+    bench_table(FlowTableType::CUCKOO, 1000000);
+}
+
+// each iteration looks up a batch of keys that are almost certainly not
+// cached, optionally keeping a window of keys ahead of each lookup
+// prefetched like the analyzer does
+static void bench_prefetch(FlowTableType type, unsigned num, unsigned batch, bool prefetch)
+{
+    FlowTable* table = FlowTable::create(type, num);
+    std::vector<uint8_t> flows(num);
+    FlowKey key;
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        table->push(&flows[i]);
+        make_key(key, i);
+        table->get(&key);
+    }
+
+    std::vector<FlowKey> keys(batch);
+    unsigned i = 0;
+
+    std::string name = (type == FlowTableType::CUCKOO) ? "cuckoo " : "chained ";
+    name += "batch " + std::to_string(batch);
+
+    BENCHMARK(name + (prefetch ? " prefetch + find" : " find"))
+    {
+        for ( auto& k : keys )
+        {
+            i = (i + 7919) % num;
+            make_key(k, i);
+        }
+
+        const unsigned window = FlowTable::max_prefetch;
+        unsigned ahead = 0;
+        unsigned found = 0;
+
+        for ( unsigned j = 0; j < batch; ++j )
+        {
+            if ( prefetch and ahead <= window / 2 and j + ahead < batch )
+            {
+                unsigned end = std::min(batch, j + window);
+                table->prefetch(&keys[j + ahead], end - j - ahead);
+                ahead = end - j;
+            }
+            found += (table->get_user_data(&keys[j]) != nullptr);
+
+            if ( ahead )
+                --ahead;
+        }
+        return found;
+    };
+
+    delete table;
+}
+
+TEST_CASE("flow prefetch 1M", "[flow_table][benchmark]")
+{
+    for ( auto type : { FlowTableType::CHAINED, FlowTableType::CUCKOO } )
+    {
+        for ( unsigned batch : { 1, 16, 64, 256 } )
+        {
+            bench_prefetch(type, 1000000, batch, false);
+            bench_prefetch(type, 1000000, batch, true);
+        }
+    }
+}
+
+// hidden by default; needs a few GB
+TEST_CASE("flow table 10M", "[.][flow_table][benchmark]")
+{
+    bench_table(FlowTableType::CHAINED, 10000000);
+    bench_table(FlowTableType::CUCKOO, 10000000);
+}
+
+#endif
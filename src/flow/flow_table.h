@@ -0,0 +1,174 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// flow_table.h
+
+#ifndef FLOW_TABLE_H
+#define FLOW_TABLE_H
+
+// FlowTable maps FlowKeys to Flows for FlowCache.  The table owns the key
+// storage for each flow; flows are pushed onto a free list and move between
+// the free list and the table with get() and release_node().
+//
+// the lru_*() methods walk flows for pruning and timeouts.  the chained
+// table (ZHash) keeps flows in exact allocation order.  the cuckoo table
+// only approximates lru with a clock so callers can't assume that flows
+// after the first are newer.
+//
+// prefetch() is a hint for a batch of keys that are about to be looked up.
+// it runs in stages over the batch so that each stage only touches memory
+// requested by the previous one and the misses overlap instead of being
+// taken one lookup at a time.
+
+#include <vector>
+
+#include "flow_config.h"
+#include "flow_key.h"
+
+class FlowTable
+{
+public:
+    static FlowTable* create(FlowTableType, unsigned max_flows);
+
+    virtual ~FlowTable() = default;
+
+    // add a free node for the given flow and return its key storage
+    virtual void* push(void* flow) = 0;
+
+    // delete a free node and return its flow
+    virtual void* pop() = 0;
+
+    virtual void* get_user_data(const void* key) = 0;
+
+    // find or insert the key using a free node; nullptr if none are free
+    virtual void* get(const void* key) = 0;
+
+    // return the node holding key (from push) to the free list
+    virtual int release_node(const void* key) = 0;
+
+    // delete the current node and return its flow
+    virtual void* remove() = 0;
+
+    virtual void* lru_first() = 0;
+    virtual void* lru_next() = 0;
+    virtual void* lru_current() = 0;
+    virtual void lru_touch() = 0;
+
+    virtual unsigned get_num_nodes() = 0;
+
+    // true if lru_first() and lru_next() return flows strictly oldest first
+    virtual bool is_ordered() const = 0;
+
+    // prefetch buckets, nodes, and flows for up to max_prefetch keys;
+    // returns the number of keys that appear to be in the table
+    unsigned prefetch(const snort::FlowKey*, unsigned num);
+
+    static constexpr unsigned max_prefetch = 32;
+
+protected:
+    // returns the hash or row needed by prefetch_node()
+    virtual uint32_t prefetch_bucket(const void* key) = 0;
+
+    // returns the candidate node for key or nullptr
+    virtual const void* prefetch_node(const void* key, uint32_t hash) = 0;
+
+    virtual void prefetch_flow(const void* node) = 0;
+};
+
+// bucketized cuckoo hash with the flow hashes inline in cache line sized
+// buckets so a lookup touches at most 2 buckets plus the matching key.
+// pruning uses a clock sweep of the buckets with a reference bit per slot.
+class CuckooFlowTable : public FlowTable
+{
+public:
+    CuckooFlowTable(unsigned max_flows);
+    ~CuckooFlowTable() override;
+
+    CuckooFlowTable(const CuckooFlowTable&) = delete;
+    CuckooFlowTable& operator=(const CuckooFlowTable&) = delete;
+
+    void* push(void* flow) override;
+    void* pop() override;
+
+    void* get_user_data(const void* key) override;
+    void* get(const void* key) override;
+    int release_node(const void* key) override;
+    void* remove() override;
+
+    void* lru_first() override;
+    void* lru_next() override;
+    void* lru_current() override;
+    void lru_touch() override;
+
+    unsigned get_num_nodes() override
+    { return num_nodes; }
+
+    bool is_ordered() const override
+    { return false; }
+
+    unsigned get_num_buckets() const
+    { return num_buckets; }
+
+    static constexpr unsigned slots = 5;
+
+protected:
+    uint32_t prefetch_bucket(const void* key) override;
+    const void* prefetch_node(const void* key, uint32_t hash) override;
+    void prefetch_flow(const void* node) override;
+
+private:
+    struct Node
+    {
+        snort::FlowKey key;  // must be first; see release_node()
+        void* flow;
+        uint32_t hash;
+    };
+
+    struct alignas(64) Bucket
+    {
+        Node* node[slots];
+        uint32_t hash[slots];
+        uint32_t ref;        // clock reference bit per slot
+    };
+
+    uint32_t alt_bucket(uint32_t b, uint32_t h) const
+    { return (b ^ ((h >> 16) * 0x5bd1e995)) & mask; }
+
+    Node* lookup(const void* key, uint32_t hash, Bucket*&, unsigned& slot);
+    bool place(Bucket&, Node*);
+    bool insert(Node*&);
+    void grow();
+    bool rehash(const Bucket*, unsigned count);
+    void allocate_buckets(unsigned count);
+    void advance();
+
+private:
+    snort::HashKeyOperations* hash_ops;
+    Bucket* buckets = nullptr;
+    unsigned num_buckets = 0;
+    uint32_t mask = 0;
+    unsigned num_nodes = 0;
+
+    // clock hand; also the current node
+    unsigned hand_bucket = 0;
+    unsigned hand_slot = 0;
+
+    std::vector<Node*> free_nodes;
+};
+
+#endif
@@ -41,6 +41,7 @@
 #include "utils/util.h"
 #include "flow/expect_cache.h"
 #include "flow/flow_cache.h"
+#include "flow/flow_table.h"
 #include "flow/ha.h"
 #include "flow/session.h"
 
@@ -258,6 +259,203 @@ TEST(flow_prune, prune_all_blocked_flows)
     delete cache;
 }
 
+TEST_GROUP(cuckoo_flow_prune) { };
+
+TEST(cuckoo_flow_prune, prune_flows)
+{
+    FlowCacheConfig fcg;
+    fcg.max_flows = 3;
+    fcg.table_type = FlowTableType::CUCKOO;
+    FlowCache *cache = new FlowCache(fcg);
+    int port = 1;
+
+    for ( unsigned i = 0; i < fcg.max_flows; i++ )
+    {
+        FlowKey flow_key;
+        memset(&flow_key, 0, sizeof(FlowKey));
+        flow_key.port_l = port++;
+        flow_key.pkt_type = PktType::TCP;
+        cache->allocate(&flow_key);
+    }
+
+    CHECK(cache->get_count() == fcg.max_flows);
+    CHECK(cache->delete_flows(1) == 1);
+    CHECK(cache->get_count() == fcg.max_flows-1);
+    cache->purge();
+    CHECK(cache->get_flows_allocated() == 0);
+    delete cache;
+}
+
+// Do not delete blocked flow
+TEST(cuckoo_flow_prune, blocked_flow_prune_flows)
+{
+    FlowCacheConfig fcg;
+    fcg.max_flows = 2;
+    fcg.table_type = FlowTableType::CUCKOO;
+    FlowCache *cache = new FlowCache(fcg);
+
+    FlowKey flow_key;
+    memset(&flow_key, 0, sizeof(FlowKey));
+    flow_key.pkt_type = PktType::TCP;
+
+    flow_key.port_l = 1;
+    cache->allocate(&flow_key);
+
+    flow_key.port_l = 2;
+    Flow* flow = cache->allocate(&flow_key);
+    flow->block();
+
+    CHECK(cache->get_count() == fcg.max_flows);
+    CHECK(cache->delete_flows(1) == 1);
+
+    // Blocked Flow should still be there
+    CHECK(cache->find(&flow_key) == flow);
+
+    flow_key.port_l = 1;
+    CHECK(cache->find(&flow_key) == nullptr);
+
+    cache->purge();
+    CHECK(cache->get_flows_allocated() == 0);
+    delete cache;
+}
+
+// allocating beyond max_flows prunes instead of growing the cache
+TEST(cuckoo_flow_prune, allocate_excess)
+{
+    FlowCacheConfig fcg;
+    fcg.max_flows = 16;
+    fcg.table_type = FlowTableType::CUCKOO;
+    FlowCache *cache = new FlowCache(fcg);
+
+    FlowKey flow_key;
+    memset(&flow_key, 0, sizeof(FlowKey));
+    flow_key.pkt_type = PktType::UDP;
+
+    for ( unsigned i = 0; i < 4 * fcg.max_flows; i++ )
+    {
+        flow_key.port_l = i + 1;
+        CHECK(cache->allocate(&flow_key) != nullptr);
+        CHECK(cache->find(&flow_key) != nullptr);
+    }
+
+    CHECK(cache->get_count() <= fcg.max_flows);
+    CHECK(cache->get_flows_allocated() == fcg.max_flows);
+
+    cache->purge();
+    CHECK(cache->get_count() == 0);
+    CHECK(cache->get_flows_allocated() == 0);
+    delete cache;
+}
+
+TEST_GROUP(cuckoo_flow_table) { };
+
+// more flows than sized for forces the table to grow
+TEST(cuckoo_flow_table, grow)
+{
+    const unsigned num = 1000;
+    CuckooFlowTable table(8);
+    unsigned buckets = table.get_num_buckets();
+    std::vector<int> flows(num);
+
+    for ( unsigned i = 0; i < num; i++ )
+        table.push(&flows[i]);
+
+    FlowKey key;
+    memset(&key, 0, sizeof(key));
+
+    for ( unsigned i = 0; i < num; i++ )
+    {
+        key.ip_l[0] = i;
+        CHECK(table.get(&key) != nullptr);
+    }
+
+    CHECK(table.get_num_nodes() == num);
+    CHECK(table.get_num_buckets() > buckets);
+    CHECK(table.get(&key) != nullptr);
+    CHECK(table.get_num_nodes() == num);
+
+    for ( unsigned i = 0; i < num; i++ )
+    {
+        key.ip_l[0] = i;
+        CHECK(table.get_user_data(&key) != nullptr);
+    }
+
+    key.ip_l[0] = num;
+    CHECK(table.get_user_data(&key) == nullptr);
+    CHECK(table.get(&key) == nullptr);
+}
+
+// the clock returns unreferenced flows before referenced ones
+TEST(cuckoo_flow_table, clock)
+{
+    CuckooFlowTable table(64);
+    int flows[4];
+
+    for ( auto& f : flows )
+        table.push(&f);
+
+    FlowKey key;
+    memset(&key, 0, sizeof(key));
+
+    for ( unsigned i = 0; i < 4; i++ )
+    {
+        key.port_l = i;
+        CHECK(table.get(&key) != nullptr);
+    }
+
+    // first sweep clears the insert references
+    void* victim = table.lru_first();
+    CHECK(victim != nullptr);
+
+    // referencing the victim moves the clock on
+    table.lru_touch();
+    CHECK(table.lru_first() != victim);
+
+    while ( table.lru_first() )
+        table.remove();
+
+    CHECK(table.get_num_nodes() == 0);
+    CHECK(table.pop() == nullptr);
+}
+
+// prefetch is only a hint so it must not change the table
+TEST(cuckoo_flow_table, prefetch)
+{
+    for ( auto type : { FlowTableType::CHAINED, FlowTableType::CUCKOO } )
+    {
+        FlowTable* table = FlowTable::create(type, 64);
+        int flows[8];
+
+        for ( auto& f : flows )
+            table->push(&f);
+
+        FlowKey keys[FlowTable::max_prefetch];
+        memset(keys, 0, sizeof(keys));
+
+        for ( unsigned i = 0; i < FlowTable::max_prefetch; i++ )
+            keys[i].port_l = i;
+
+        for ( unsigned i = 0; i < 8; i++ )
+            CHECK(table->get(&keys[i]) != nullptr);
+
+        CHECK(table->prefetch(keys, 0) == 0);
+
+        unsigned found = table->prefetch(keys, FlowTable::max_prefetch);
+        CHECK(found >= 8);
+        CHECK(found <= FlowTable::max_prefetch);
+
+        if ( type == FlowTableType::CUCKOO )
+            CHECK(found == 8);
+
+        CHECK(table->get_num_nodes() == 8);
+
+        for ( unsigned i = 0; i < FlowTable::max_prefetch; i++ )
+            CHECK((table->get_user_data(&keys[i]) != nullptr) == (i < 8));
+
+        delete table;
+    }
+}
+
 int main(int argc, char** argv)
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
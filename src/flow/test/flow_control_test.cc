@@ -23,6 +23,7 @@
 #endif
 
 #include <daq_common.h>
+#include <daq_dlt.h>
 
 #include "flow/flow_control.h"
 
@@ -79,6 +80,8 @@ void FlowCache::push(Flow*) { }
 bool FlowCache::prune_one(PruneReason, bool) { return true; }
 unsigned FlowCache::delete_flows(unsigned) { return 0; }
 unsigned FlowCache::timeout(unsigned, time_t) { return 1; }
+unsigned FlowCache::prefetch(const FlowKey*, unsigned num) { return num; }
+SfIpRet SfIp::set(void const*, int) { return SFIP_SUCCESS; }
 void Flow::init(PktType) { }
 void set_network_policy(const SnortConfig*, unsigned) { }
 void DataBus::publish(const char*, const uint8_t*, unsigned, Flow*) { }
@@ -198,6 +201,131 @@ TEST(stale_flow, stale_flow)
     delete cache;
 }
 
+TEST_GROUP(prefetch) { };
+
+static void set_msg(DAQ_Msg_t& msg, DAQ_PktHdr_t& dh, uint8_t* data, size_t len)
+{
+    msg.type = DAQ_MSG_TYPE_PACKET;
+    msg.hdr_len = sizeof(dh);
+    msg.hdr = &dh;
+    msg.data = data;
+    msg.data_len = len;
+}
+
+TEST(prefetch, prefetch_flows)
+{
+    // eth | ip4 | tcp
+    uint8_t tcp4[14 + 20 + 20] = { };
+    tcp4[12] = 0x08;
+    tcp4[14] = 0x45;
+    tcp4[14 + 9] = 6;
+
+    // eth | vlan | ip6 | udp
+    uint8_t udp6[14 + 4 + 40 + 8] = { };
+    udp6[12] = 0x81;
+    udp6[16] = 0x86;
+    udp6[17] = 0xdd;
+    udp6[18] = 0x60;
+    udp6[18 + 6] = 17;
+
+    // eth | ip4 fragment
+    uint8_t frag4[sizeof(tcp4)];
+    memcpy(frag4, tcp4, sizeof(tcp4));
+    frag4[14 + 6] = 0x20;
+
+    // truncated tcp
+    uint8_t short4[14 + 20 + 4];
+    memcpy(short4, tcp4, sizeof(short4));
+
+    DAQ_PktHdr_t dh = { };
+    DAQ_Msg_t msgs[5] = { };
+
+    set_msg(msgs[0], dh, tcp4, sizeof(tcp4));
+    set_msg(msgs[1], dh, udp6, sizeof(udp6));
+    set_msg(msgs[2], dh, frag4, sizeof(frag4));
+    set_msg(msgs[3], dh, short4, sizeof(short4));
+    set_msg(msgs[4], dh, tcp4, sizeof(tcp4));
+    msgs[4].type = DAQ_MSG_TYPE_SOF;
+
+    DAQ_Msg_h batch[5] = { &msgs[0], &msgs[1], &msgs[2], &msgs[3], &msgs[4] };
+
+    FlowCacheConfig fcg;
+    FlowControl* flow_con = new FlowControl(fcg);
+
+    CHECK(flow_con->prefetch_flows(batch, 5, 0, DLT_EN10MB) == 0);
+    CHECK(flow_con->get_prefetch_batches() == 0);
+    delete flow_con;
+
+    fcg.prefetch = true;
+    flow_con = new FlowControl(fcg);
+
+    CHECK(flow_con->prefetch_flows(batch, 5, 0, DLT_EN10MB) == 5);
+    CHECK(flow_con->get_prefetch_batches() == 1);
+    CHECK(flow_con->get_prefetch_keys() == 2);
+    CHECK(flow_con->get_prefetch_hits() == 2);
+
+    // already prefetched
+    CHECK(flow_con->prefetch_flows(batch + 1, 4, 4, DLT_EN10MB) == 4);
+    CHECK(flow_con->get_prefetch_keys() == 2);
+
+    // a lone message isn't worth it
+    CHECK(flow_con->prefetch_flows(batch, 1, 0, DLT_EN10MB) == 0);
+    CHECK(flow_con->get_prefetch_keys() == 2);
+
+    // raw ip starts at the ip header
+    flow_con->prefetch_flows(batch, 2, 0, DLT_IPV4);
+    CHECK(flow_con->get_prefetch_keys() == 2);
+
+    msgs[0].data = tcp4 + 14;
+    msgs[0].data_len = sizeof(tcp4) - 14;
+    flow_con->prefetch_flows(batch, 2, 0, DLT_RAW);
+    CHECK(flow_con->get_prefetch_keys() == 3);
+
+    flow_con->clear_counts();
+    CHECK(flow_con->get_prefetch_batches() == 0);
+    CHECK(flow_con->get_prefetch_keys() == 0);
+
+    delete flow_con;
+}
+
+TEST(prefetch, prefetch_window)
+{
+    // eth | ip4 | udp
+    uint8_t udp4[14 + 20 + 8] = { };
+    udp4[12] = 0x08;
+    udp4[14] = 0x45;
+    udp4[14 + 9] = 17;
+
+    DAQ_PktHdr_t dh = { };
+    DAQ_Msg_t msgs[40] = { };
+    DAQ_Msg_h batch[40];
+
+    for ( unsigned i = 0; i < 40; ++i )
+    {
+        set_msg(msgs[i], dh, udp4, sizeof(udp4));
+        batch[i] = &msgs[i];
+    }
+
+    FlowCacheConfig fcg;
+    fcg.prefetch = true;
+    FlowControl* flow_con = new FlowControl(fcg);
+
+    // only the first window
+    CHECK(flow_con->prefetch_flows(batch, 40, 0, DLT_EN10MB) == 32);
+    CHECK(flow_con->get_prefetch_keys() == 32);
+
+    // more than half the window is left after 15 are processed
+    CHECK(flow_con->prefetch_flows(batch + 15, 25, 17, DLT_EN10MB) == 17);
+    CHECK(flow_con->get_prefetch_keys() == 32);
+
+    // refilled after 16 up to the end of the batch
+    CHECK(flow_con->prefetch_flows(batch + 16, 24, 16, DLT_EN10MB) == 24);
+    CHECK(flow_con->get_prefetch_keys() == 40);
+    CHECK(flow_con->get_prefetch_batches() == 1);
+
+    delete flow_con;
+}
+
 int main(int argc, char** argv)
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
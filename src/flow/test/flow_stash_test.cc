@@ -79,23 +79,31 @@ const char* DBConsumer<Type>::STASH_EVENT = "foo.stash.event";
 
 // DataBus mock: most functions are stubs, but _subscribe() and  _publish()
 // are (close to) real.
+static std::unordered_map<std::string, DataEventId> event_ids;
+
 DataBus::DataBus() = default;
 
 DataBus::~DataBus()
 {
-    for ( auto& p : map )
-        for ( auto* h : p.second )
+    for ( auto& v : map )
+        for ( auto* h : v )
             delete h;
 }
 
+DataEventId DataBus::get_id(const char* key)
+{
+    auto r = event_ids.emplace(key, event_ids.size());
+    return r.first->second;
+}
+
 void DataBus::clone(DataBus&, const char*) {}
 void DataBus::subscribe(const char* key, DataHandler* h)
 {
-    DB->_subscribe(key, h);
+    DB->_subscribe(get_id(key), h);
 }
 void DataBus::subscribe_global(const char* key, DataHandler* h, SnortConfig*)
 {
-    DB->_subscribe(key, h);
+    DB->_subscribe(get_id(key), h);
 }
 
 void DataBus::unsubscribe(const char*, DataHandler*) {}
@@ -103,27 +111,27 @@ void DataBus::unsubscribe_global(const char*, DataHandler*, SnortConfig*) {}
 
 void DataBus::publish(const char* key, DataEvent& e, Flow* f)
 {
-    DB->_publish(key, e, f);
+    DB->_publish(get_id(key), e, f);
 }
 
 void DataBus::publish(const char*, const uint8_t*, unsigned, Flow*) {}
 void DataBus::publish(const char*, Packet*, Flow*) {}
 
-void DataBus::_subscribe(const char* key, DataHandler* h)
+void DataBus::_subscribe(DataEventId id, DataHandler* h)
 {
-    DataList& v = map[key];
-    v.emplace_back(h);
+    if ( id >= map.size() )
+        map.resize(id + 1);
+
+    map[id].emplace_back(h);
 }
 
-void DataBus::_unsubscribe(const char*, DataHandler*) {}
+void DataBus::_unsubscribe(DataEventId, DataHandler*) {}
 
-void DataBus::_publish(const char* key, DataEvent& e, Flow* f)
+void DataBus::_publish(DataEventId id, DataEvent& e, Flow* f)
 {
-    auto v = map.find(key);
-
-    if ( v != map.end() )
+    if ( id < map.size() )
     {
-        for ( auto* h : v->second )
+        for ( auto* h : map[id] )
             h->handle(e, f);
     }
 }
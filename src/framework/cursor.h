@@ -108,6 +108,9 @@ public:
 
     CursorData* get_data(unsigned id) const;
 
+    bool has_data() const
+    { return data != nullptr; }
+
     bool add_pos(unsigned n)
     {
         if (pos + n > sz)
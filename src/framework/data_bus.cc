@@ -23,8 +23,12 @@
 
 #include "data_bus.h"
 
+#include <cstring>
+#include <mutex>
+
 #include "main/policy.h"
 #include "main/snort_config.h"
+#include "main/thread.h"
 #include "protocols/packet.h"
 
 using namespace snort;
@@ -59,6 +63,58 @@ private:
     const Packet* packet;
 };
 
+//--------------------------------------------------------------------------
+// event ids
+//--------------------------------------------------------------------------
+
+// the key table only grows and its nodes never move so the names can be
+// read without the lock once an id is known.  each thread keeps a small
+// direct mapped cache of name, id pairs so the string publish methods only
+// take the lock the first time a thread sees a key.
+
+static std::mutex key_mutex;
+static std::unordered_map<std::string, DataEventId> key_ids;
+
+struct KeyCacheEntry
+{
+    const char* name;
+    DataEventId id;
+};
+
+static constexpr unsigned key_cache_size = 256;
+static THREAD_LOCAL KeyCacheEntry key_cache[key_cache_size];
+
+static unsigned hash_key(const char* key)
+{
+    // fnv-1a
+    unsigned h = 2166136261u;
+
+    while ( *key )
+    {
+        h ^= (uint8_t)*key++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static const char* intern(const char* key, DataEventId& id)
+{
+    std::lock_guard<std::mutex> lock(key_mutex);
+    auto r = key_ids.emplace(key, key_ids.size());
+    id = r.first->second;
+    return r.first->first.c_str();
+}
+
+DataEventId DataBus::get_id(const char* key)
+{
+    KeyCacheEntry& e = key_cache[hash_key(key) & (key_cache_size - 1)];
+
+    if ( !e.name or strcmp(e.name, key) )
+        e.name = intern(key, e.id);
+
+    return e.id;
+}
+
 //--------------------------------------------------------------------------
 // public methods
 //--------------------------------------------------------------------------
@@ -67,8 +123,8 @@ DataBus::DataBus() = default;
 
 DataBus::~DataBus()
 {
-    for ( auto& p : map )
-        for ( auto* h : p.second )
+    for ( auto& v : map )
+        for ( auto* h : v )
         {
             // If the object is cloned, pass the ownership to the next config.
             // When the object is no further cloned (e.g., the last config), delete it.
@@ -81,12 +137,12 @@ DataBus::~DataBus()
 
 void DataBus::clone(DataBus& from, const char* exclude_name)
 {
-    for ( auto& p : from.map )
-        for ( auto* h : p.second )
+    for ( DataEventId id = 0; id < from.map.size(); ++id )
+        for ( auto* h : from.map[id] )
             if ( nullptr == exclude_name || 0 != strcmp(exclude_name, h->module_name) )
             {
                 h->cloned = true;
-                _subscribe(p.first.c_str(), h);
+                _subscribe(id, h);
             }
 }
 
@@ -94,81 +150,172 @@ void DataBus::clone(DataBus& from, const char* exclude_name)
 // publication of given event
 void DataBus::subscribe(const char* key, DataHandler* h)
 {
-    get_data_bus()._subscribe(key, h);
+    get_data_bus()._subscribe(get_id(key), h);
 }
 
 // for subscribers that need to receive events regardless of active inspection policy
 void DataBus::subscribe_global(const char* key, DataHandler* h, SnortConfig* sc)
 {
     assert(sc);
-    sc->global_dbus->_subscribe(key, h);
+    sc->global_dbus->_subscribe(get_id(key), h);
 }
 
 void DataBus::unsubscribe(const char* key, DataHandler* h)
 {
-    get_data_bus()._unsubscribe(key, h);
+    get_data_bus()._unsubscribe(get_id(key), h);
 }
 
 void DataBus::unsubscribe_global(const char* key, DataHandler* h, SnortConfig* sc)
 {
     assert(sc);
-    sc->global_dbus->_unsubscribe(key, h);
+    sc->global_dbus->_unsubscribe(get_id(key), h);
 }
 
 // notify subscribers of event
-void DataBus::publish(const char* key, DataEvent& e, Flow* f)
+void DataBus::publish(DataEventId id, DataEvent& e, Flow* f)
 {
     InspectionPolicy* pi = get_inspection_policy();
-    pi->dbus._publish(key, e, f);
+    pi->dbus._publish(id, e, f);
 
-    SnortConfig::get_conf()->global_dbus->_publish(key, e, f);
+    SnortConfig::get_conf()->global_dbus->_publish(id, e, f);
 }
 
-void DataBus::publish(const char* key, const uint8_t* buf, unsigned len, Flow* f)
+void DataBus::publish(DataEventId id, const uint8_t* buf, unsigned len, Flow* f)
 {
     BufferEvent e(buf, len);
-    publish(key, e, f);
+    publish(id, e, f);
 }
 
-void DataBus::publish(const char* key, Packet* p, Flow* f)
+void DataBus::publish(DataEventId id, Packet* p, Flow* f)
 {
     PacketEvent e(p);
     if ( p && !f )
         f = p->flow;
-    publish(key, e, f);
+    publish(id, e, f);
 }
 
+void DataBus::publish(const char* key, DataEvent& e, Flow* f)
+{ publish(get_id(key), e, f); }
+
+void DataBus::publish(const char* key, const uint8_t* buf, unsigned len, Flow* f)
+{ publish(get_id(key), buf, len, f); }
+
+void DataBus::publish(const char* key, Packet* p, Flow* f)
+{ publish(get_id(key), p, f); }
+
 //--------------------------------------------------------------------------
 // private methods
 //--------------------------------------------------------------------------
 
-void DataBus::_subscribe(const char* key, DataHandler* h)
+void DataBus::_subscribe(DataEventId id, DataHandler* h)
 {
-    DataList& v = map[key];
-    v.emplace_back(h);
+    if ( id >= map.size() )
+        map.resize(id + 1);
+
+    map[id].emplace_back(h);
 }
 
-void DataBus::_unsubscribe(const char* key, DataHandler* h)
+void DataBus::_unsubscribe(DataEventId id, DataHandler* h)
 {
-    DataList& v = map[key];
+    if ( id >= map.size() )
+        return;
+
+    DataList& v = map[id];
 
     for ( unsigned i = 0; i < v.size(); i++ )
         if ( v[i] == h )
             v.erase(v.begin() + i--);
-
-    if ( v.empty() )
-        map.erase(key);
 }
 
 // notify subscribers of event
-void DataBus::_publish(const char* key, DataEvent& e, Flow* f)
+void DataBus::_publish(DataEventId id, DataEvent& e, Flow* f)
+{
+    if ( id >= map.size() )
+        return;
+
+    for ( auto* h : map[id] )
+        h->handle(e, f);
+}
+
+#ifdef BENCHMARK_TEST
+
+#include "catch/snort_catch.h"
+
+class BenchHandler : public DataHandler
 {
-    auto v = map.find(key);
+public:
+    BenchHandler() : DataHandler("bench") { }
+
+    void handle(DataEvent&, Flow*) override
+    { ++count; }
+
+    unsigned count = 0;
+};
+
+// the policy and global buses each have a handler for the benchmark key
+// and a few dozen other keys are registered to give the table some size.
+// the string map case is the lookup publish did before keys were interned.
+TEST_CASE("data bus publish", "[data_bus][benchmark]")
+{
+    const SnortConfig* sc = SnortConfig::get_conf();
+
+    if ( !sc or !sc->global_dbus )
+        return;
+
+    InspectionPolicy* saved = get_inspection_policy();
+    InspectionPolicy ip;
+    set_inspection_policy(&ip);
 
-    if ( v != map.end() )
+    const char* key = "benchmark.data_bus.event";
+    std::unordered_map<std::string, DataList> str_map;
+    BenchHandler* h = new BenchHandler;
+    BenchHandler* g = new BenchHandler;
+
+    for ( unsigned i = 0; i < 32; ++i )
     {
-        for ( auto* h : v->second )
-            h->handle(e, f);
+        std::string other = "benchmark.data_bus.other." + std::to_string(i);
+        DataBus::get_id(other.c_str());
+        str_map[other];
     }
+    str_map[key].emplace_back(h);
+
+    DataBus::subscribe(key, h);
+    DataBus::subscribe_global(key, g, SnortConfig::get_main_conf());
+
+    DataEventId id = DataBus::get_id(key);
+    BareDataEvent e;
+
+    BENCHMARK("string map")
+    {
+        for ( unsigned i = 0; i < 2; ++i )
+        {
+            auto v = str_map.find(key);
+
+            if ( v != str_map.end() )
+                for ( auto* dh : v->second )
+                    dh->handle(e, nullptr);
+        }
+        return h->count;
+    };
+
+    BENCHMARK("string key")
+    {
+        DataBus::publish(key, e);
+        return h->count;
+    };
+
+    BENCHMARK("event id")
+    {
+        DataBus::publish(id, e);
+        return h->count;
+    };
+
+    CHECK(g->count > 0);
+
+    DataBus::unsubscribe_global(key, g, SnortConfig::get_main_conf());
+    delete g;
+
+    set_inspection_policy(saved);
 }
 
+#endif
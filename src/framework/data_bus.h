@@ -82,9 +82,13 @@ protected:
     DataHandler(const char* mod_name) : module_name(mod_name), cloned(false) { }
 };
 
-// FIXIT-P evaluate perf; focus is on correctness
+// event keys are interned into dense ids when first seen; each bus keeps a
+// handler list per id so publishing is an index instead of a string lookup.
+// ids are process wide, never reused, and stable across reloads so
+// publishers may look them up once and cache them.
+typedef unsigned DataEventId;
 typedef std::vector<DataHandler*> DataList;
-typedef std::unordered_map<std::string, DataList> DataMap;
+typedef std::vector<DataList> DataMap;
 
 class SO_PUBLIC DataBus
 {
@@ -95,6 +99,9 @@ public:
     // configure time methods - main thread only
     void clone(DataBus& from, const char* exclude_name = nullptr);
 
+    // any thread; returns the id for key, adding it if new
+    static DataEventId get_id(const char* key);
+
     // FIXIT-L ideally these would not be static or would take an inspection policy*
     static void subscribe(const char* key, DataHandler*);
     static void subscribe_global(const char* key, DataHandler*, SnortConfig*);
@@ -104,16 +111,24 @@ public:
     static void unsubscribe_global(const char* key, DataHandler*, SnortConfig*);
 
     // runtime methods
-    static void publish(const char* key, DataEvent&, Flow* = nullptr);
+    static void publish(DataEventId, DataEvent&, Flow* = nullptr);
 
     // convenience methods
+    static void publish(DataEventId, const uint8_t*, unsigned, Flow* = nullptr);
+    static void publish(DataEventId, Packet*, Flow* = nullptr);
+
+    // string keyed versions of the above; these hash key and look it up in
+    // a per thread cache of ids on each call, only taking the intern lock the
+    // first time a thread sees key, so frequent publishers should still use
+    // get_id() once instead
+    static void publish(const char* key, DataEvent&, Flow* = nullptr);
     static void publish(const char* key, const uint8_t*, unsigned, Flow* = nullptr);
     static void publish(const char* key, Packet*, Flow* = nullptr);
 
 private:
-    void _subscribe(const char* key, DataHandler*);
-    void _unsubscribe(const char* key, DataHandler*);
-    void _publish(const char* key, DataEvent&, Flow*);
+    void _subscribe(DataEventId, DataHandler*);
+    void _unsubscribe(DataEventId, DataHandler*);
+    void _publish(DataEventId, DataEvent&, Flow*);
 
 private:
     DataMap map;
@@ -127,6 +142,8 @@ private:
 #define PACKET_EVENT "detection.packet"
 #define FLOW_STATE_EVENT "flow.state_change"
 #define THREAD_IDLE_EVENT "thread.idle"
+// published by packet threads when packet time moves to a new second
+#define THREAD_TICK_EVENT "thread.tick"
 #define THREAD_ROTATE_EVENT "thread.rotate"
 
 // A packet is being detained.
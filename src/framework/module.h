@@ -169,6 +169,12 @@ public:
     virtual bool global_stats() const
     { return false; }
 
+    // packet threads publish thread local counts without locking and the
+    // main thread merges them when stats are shown.  return false if the
+    // counts are shared or sum_stats() does more than merge them by type.
+    virtual bool snapshot_stats() const
+    { return true; }
+
     virtual void sum_stats(bool accumulate_now_stats);
     virtual void show_interval_stats(IndexVec&, FILE*);
     virtual void show_stats();
@@ -36,7 +36,7 @@
 namespace snort
 {
 // this is the current version of the api
-#define SEAPI_VERSION ((BASE_API_VERSION << 16) | 0)
+#define SEAPI_VERSION ((BASE_API_VERSION << 16) | 1)
 
 struct SnortConfig;
 class Mpse;
@@ -81,6 +81,16 @@ public:
 
     virtual void reuse_search() { }
 
+    // optional support for the compiled search engine cache.  the key must
+    // identify the engine, its options, and the patterns added in order.  a
+    // state machine from get_compiled() can be given to set_compiled() on an
+    // instance with the same key instead of calling prep_patterns().
+    // set_compiled() returns 0 on success and -1 if the state machine was
+    // rejected without changes, in which case prep_patterns() may be called.
+    virtual bool get_cache_key(std::string&) { return false; }
+    virtual bool get_compiled(std::string&) { return false; }
+    virtual int set_compiled(SnortConfig*, const uint8_t*, size_t) { return -1; }
+
     int search(
         const uint8_t* T, int n, MpseMatch, void* context, int* current_state);
 
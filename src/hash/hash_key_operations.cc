@@ -24,6 +24,11 @@
 #include "hash_key_operations.h"
 
 #include <cassert>
+#include <cstring>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
 
 #include "main/snort_config.h"
 #include "utils/util.h"
@@ -32,6 +37,147 @@
 
 using namespace snort;
 
+//-------------------------------------------------------------------------
+// crc32c
+//-------------------------------------------------------------------------
+
+// the instructions are emitted directly instead of with intrinsics so that
+// the whole build doesn't need -msse4.2 or +crc; the cpu is checked once
+// at runtime.  the table driven version gives the same results.
+
+#if defined(__x86_64__)
+#define HAVE_HW_CRC
+
+static inline uint32_t crc32c_hw(uint32_t crc, uint64_t v)
+{
+    uint64_t c = crc;
+    __asm__("crc32q %1, %0" : "+r" (c) : "rm" (v));
+    return (uint32_t)c;
+}
+
+static bool cpu_has_crc()
+{ return __builtin_cpu_supports("sse4.2"); }
+
+#elif defined(__aarch64__) && defined(__linux__)
+#define HAVE_HW_CRC
+
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+
+static inline uint32_t crc32c_hw(uint32_t crc, uint64_t v)
+{
+    __asm__(".arch_extension crc\n\tcrc32cx %w0, %w0, %x1" : "+r" (crc) : "r" (v));
+    return crc;
+}
+
+static bool cpu_has_crc()
+{ return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0; }
+
+#endif
+
+struct CrcTable
+{
+    CrcTable()
+    {
+        for ( uint32_t i = 0; i < 256; ++i )
+        {
+            uint32_t c = i;
+
+            for ( int k = 0; k < 8; ++k )
+                c = (c >> 1) ^ (0x82F63B78 & (0 - (c & 1)));
+
+            entry[i] = c;
+        }
+    }
+    uint32_t entry[256];
+};
+
+static const CrcTable crc_table;
+
+static inline uint32_t crc32c_sw(uint32_t crc, uint64_t v)
+{
+    for ( int i = 0; i < 8; ++i, v >>= 8 )
+        crc = crc_table.entry[(crc ^ v) & 0xff] ^ (crc >> 8);
+
+    return crc;
+}
+
+// 2 lanes to hide the latency of the crc instruction
+template <uint32_t (*crc64)(uint32_t, uint64_t)>
+static uint32_t crc_hash(const unsigned char* key, int len, const CrcSeed& s)
+{
+    uint32_t a = s.init[0];
+    uint32_t b = s.init[1];
+    uint64_t x, y;
+
+    for ( ; len >= 16; key += 16, len -= 16 )
+    {
+        memcpy(&x, key, 8);
+        memcpy(&y, key + 8, 8);
+        a = crc64(a, x * s.mult[0]);
+        b = crc64(b, y * s.mult[1]);
+    }
+
+    if ( len >= 8 )
+    {
+        memcpy(&x, key, 8);
+        a = crc64(a, x * s.mult[0]);
+        key += 8;
+        len -= 8;
+    }
+
+    // the tail reads overlap but cover every byte without a variable length copy
+    if ( len > 0 )
+    {
+        if ( len >= 4 )
+        {
+            uint32_t lo, hi;
+            memcpy(&lo, key, 4);
+            memcpy(&hi, key + len - 4, 4);
+            y = ((uint64_t)hi << 32) | lo;
+        }
+        else
+            y = ((uint64_t)key[0] << 16) | ((uint64_t)key[len / 2] << 8) | key[len - 1];
+
+        b = crc64(b, (y ^ ((uint64_t)len << 56)) * s.mult[1]);
+    }
+
+    // the table index comes from the low bits so spread the lanes over them
+    uint64_t h = ((uint64_t)b << 32) | a;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+
+    return (uint32_t)h;
+}
+
+bool HashKeyOperations::hw_crc_supported()
+{
+#ifdef HAVE_HW_CRC
+    static const bool supported = cpu_has_crc();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+static CrcHashFunc get_crc_hash()
+{
+#ifdef HAVE_HW_CRC
+    if ( HashKeyOperations::hw_crc_supported() )
+        return crc_hash<crc32c_hw>;
+#endif
+    return crc_hash<crc32c_sw>;
+}
+
+static uint64_t rand64()
+{ return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand(); }
+
+//-------------------------------------------------------------------------
+// hash key operations
+//-------------------------------------------------------------------------
+
 HashKeyOperations::HashKeyOperations(int rows)
 {
     static bool one = true;
@@ -54,10 +200,38 @@ HashKeyOperations::HashKeyOperations(int rows)
         scale = nearest_prime( (rand() % rows) + 709);
         hardener = ((unsigned) rand() * rand()) + 133824503;
     }
+
+    HashMethod method = SnortConfig::get_hash_method();
+
+    if ( method == HashMethod::CRC or (method == HashMethod::AUTO and hw_crc_supported()) )
+        init_crc();
+}
+
+void HashKeyOperations::init_crc()
+{
+    crc_hash = get_crc_hash();
+
+    if ( SnortConfig::static_hash() )
+    {
+        crc_seed.init[0] = 3193;
+        crc_seed.init[1] = 719;
+        crc_seed.mult[0] = 0x9e3779b97f4a7c15ull;
+        crc_seed.mult[1] = 0xc2b2ae3d27d4eb4full;
+    }
+    else
+    {
+        crc_seed.init[0] = rand();
+        crc_seed.init[1] = rand();
+        crc_seed.mult[0] = rand64() | 1;
+        crc_seed.mult[1] = rand64() | 1;
+    }
 }
 
 unsigned HashKeyOperations::do_hash(const unsigned char* key, int len)
 {
+    if ( crc_hash )
+        return crc_hash(key, len, crc_seed);
+
     unsigned hash = seed;
     while ( len )
     {
@@ -161,3 +335,117 @@ uint32_t str_to_hash(const uint8_t *str, size_t length)
     return c;
 }
 } //namespace snort
+
+//-------------------------------------------------------------------------
+// benchmarks
+//-------------------------------------------------------------------------
+
+#ifdef BENCHMARK_TEST
+
+#include <arpa/inet.h>
+
+#include <string>
+#include <vector>
+
+#include "catch/snort_catch.h"
+
+class BenchHashKeyOps : public HashKeyOperations
+{
+public:
+    BenchHashKeyOps(CrcHashFunc f) : HashKeyOperations(1 << 16)
+    {
+        if ( !crc_hash )
+        {
+            crc_seed.init[0] = crc_seed.init[1] = 1;
+            crc_seed.mult[0] = crc_seed.mult[1] = 0x9e3779b97f4a7c15ull;
+        }
+        crc_hash = f;
+    }
+};
+
+// like real traffic, the keys only differ in the low address bytes and
+// the ports.  host keys are 16 byte ips and tag keys are 2 ips and 2 ports
+// (36 bytes).  see flow_key.cc for flow keys.
+static std::vector<uint8_t> make_keys(unsigned len, unsigned num)
+{
+    std::vector<uint8_t> keys(len * num);
+    bool ports = (len > 16);
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        uint8_t* k = &keys[i * len];
+        uint32_t ip = htonl(0x0a000000 + (ports ? (i >> 4) : i));
+        uint16_t port = 1024 + (i & 0xf);
+
+        memcpy(k + 12, &ip, sizeof(ip));
+
+        if ( ports )
+            memcpy(k + 32, &port, sizeof(port));
+    }
+    return keys;
+}
+
+namespace snort
+{
+void bench_hash_keys(const char* name, HashKeyOperations& ops,
+    const uint8_t* keys, unsigned key_len, unsigned num_keys)
+{
+    const unsigned rows = num_keys / 16;
+    std::vector<unsigned> count(rows);
+
+    for ( unsigned i = 0; i < num_keys; ++i )
+        count[ops.do_hash(keys + i * key_len, key_len) & (rows - 1)]++;
+
+    // chi squared per row is about 1 for a uniform hash
+    double chi = 0;
+    unsigned max = 0;
+
+    for ( auto c : count )
+    {
+        double d = (double)c - 16;
+        chi += d * d / 16;
+
+        if ( c > max )
+            max = c;
+    }
+
+    WARN(name << ": chi^2 / rows = " << chi / rows << ", max row = " << max);
+
+    // cycle through a cache resident subset to time the hash, not memory
+    unsigned i = 0;
+
+    BENCHMARK(name)
+    {
+        i = (i + 1) & 0xfff;
+        return ops.do_hash(keys + i * key_len, key_len);
+    };
+}
+}
+
+static void bench_hash(const char* type, unsigned len, const char* method, CrcHashFunc f)
+{
+    const unsigned num = 16 << 16;
+    std::vector<uint8_t> keys = make_keys(len, num);
+    BenchHashKeyOps ops(f);
+
+    std::string name = std::string(type) + " " + method;
+    bench_hash_keys(name.c_str(), ops, keys.data(), len, num);
+}
+
+TEST_CASE("hash key operations", "[hash][benchmark]")
+{
+    struct { const char* type; unsigned len; } key_types[] =
+    { { "host", 16 }, { "tag", 36 } };
+
+    for ( auto& kt : key_types )
+    {
+        bench_hash(kt.type, kt.len, "scalar", nullptr);
+        bench_hash(kt.type, kt.len, "crc sw", crc_hash<crc32c_sw>);
+#ifdef HAVE_HW_CRC
+        if ( HashKeyOperations::hw_crc_supported() )
+            bench_hash(kt.type, kt.len, "crc hw", crc_hash<crc32c_hw>);
+#endif
+    }
+}
+
+#endif
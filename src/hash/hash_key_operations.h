@@ -76,6 +76,17 @@ static inline uint64_t hash_mac(const uint8_t* a)
     return hash;
 }
 
+// seeds for crc hashing; the multipliers are odd so that multiplying each
+// word of the key before it goes into the crc is a bijection.  that makes
+// collisions depend on the seed since crc alone is linear.
+struct CrcSeed
+{
+    uint32_t init[2];
+    uint64_t mult[2];
+};
+
+typedef uint32_t (* CrcHashFunc)(const unsigned char* key, int len, const CrcSeed&);
+
 class HashKeyOperations
 {
 public:
@@ -86,11 +97,34 @@ public:
     virtual unsigned do_hash(const unsigned char* key, int len);
     virtual bool key_compare(const void* key1, const void* key2, size_t len);
 
+    // crc32c instructions are available (sse4.2 or armv8 crc)
+    static bool hw_crc_supported();
+
 protected:
+    // subclasses with their own do_hash() should use this when set
+    bool use_crc() const
+    { return crc_hash != nullptr; }
+
+    unsigned do_crc_hash(const unsigned char* key, int len)
+    { return crc_hash(key, len, crc_seed); }
+
     unsigned seed;
     unsigned scale;
     unsigned hardener;
+
+    CrcHashFunc crc_hash = nullptr;
+    CrcSeed crc_seed;
+
+private:
+    void init_crc();
 };
+
+#ifdef BENCHMARK_TEST
+// num_keys keys of key_len bytes each, 16 per row over a power of 2 rows.
+// reports how uniformly ops spreads the keys and times ops.do_hash().
+void bench_hash_keys(const char* name, HashKeyOperations& ops,
+    const uint8_t* keys, unsigned key_len, unsigned num_keys);
+#endif
 }
 
 #endif
@@ -33,5 +33,7 @@ const PegInfo lru_cache_shared_peg_names[] =
     { CountType::SUM, "reload_prunes", "lru cache pruned entry for lower memcap during reload" },
     { CountType::SUM, "removes", "lru cache found entry and removed it" },
     { CountType::SUM, "replaced", "lru cache found entry and replaced it" },
+    { CountType::SUM, "lock_waits", "lru cache waited for another thread to release the cache" },
+    { CountType::SUM, "shared_hits", "lru cache found entry without exclusive access to the cache" },
     { CountType::END, nullptr, nullptr },
 };
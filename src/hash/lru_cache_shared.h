@@ -23,12 +23,18 @@
 
 // LruCacheShared -- Implements a thread-safe unordered map where the
 // least-recently-used (LRU) entries are removed once a fixed size is hit.
+//
+// Lookups that hit an entry near the front of the LRU list only need the
+// cache lock shared since moving such an entry would not change which
+// entries are pruned.  Entries further back are moved to the front with the
+// lock held exclusively.
 
 #include <atomic>
 #include <cassert>
 #include <list>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <typeinfo>
 #include <unordered_map>
 #include <vector>
@@ -46,6 +52,8 @@ struct LruCacheSharedStats
     PegCount reload_prunes = 0; // when an old entry is removed due to lower memcap during reload
     PegCount removes = 0;       // found entry and removed it
     PegCount replaced = 0;      // found entry and replaced it
+    PegCount lock_waits = 0;    // waited for another thread to release the cache lock
+    PegCount shared_hits = 0;   // found entry with the cache lock shared
 };
 
 template<typename Key, typename Value, typename Hash, typename Eq = std::equal_to<Key>>
@@ -86,19 +94,19 @@ public:
     //  Get current number of elements in the LruCache.
     size_t size()
     {
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
+        LruSharedLock cache_lock(cache_mutex);
         return list.size();
     }
 
     virtual size_t mem_size()
     {
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
+        LruSharedLock cache_lock(cache_mutex);
         return list.size() * mem_chunk;
     }
 
     size_t get_max_size()
     {
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
+        LruSharedLock cache_lock(cache_mutex);
         return max_size;
     }
 
@@ -130,23 +138,104 @@ public:
 protected:
     using LruList = std::list<std::pair<Key, Data>>;
     using LruListIter = typename LruList::iterator;
-    using LruMap = std::unordered_map<Key, LruListIter, Hash, Eq>;
+
+    struct LruEntry
+    {
+        LruListIter iter;
+        uint64_t touched;   // clock when last moved to the front
+    };
+
+    using LruMap = std::unordered_map<Key, LruEntry, Hash, Eq>;
     using LruMapIter = typename LruMap::iterator;
 
+    using LruMutex = std::shared_timed_mutex;
+    using LruLock = std::unique_lock<LruMutex>;
+    using LruSharedLock = std::shared_lock<LruMutex>;
+
     static constexpr size_t mem_chunk = sizeof(Data) + sizeof(Value);
 
+    // Entries moved to the front within the last size >> recent_shift moves
+    // are still in the most recently used part of the list.
+    static constexpr unsigned recent_shift = 3;
+
     size_t max_size;   // Once max_size elements are in the cache, start to
                        // remove the least-recently-used elements.
 
     std::atomic<size_t> current_size;// Number of entries currently in the cache.
 
-    std::mutex cache_mutex;
+    LruMutex cache_mutex;
     LruList list;  //  Contains key/data pairs. Maintains LRU order with
                    //  least recently used at the end.
     LruMap map;    //  Maps key to list iterator for fast lookup.
+    uint64_t clock = 0;  // Number of moves to the front of list.
 
     struct LruCacheSharedStats stats;
 
+    // Lock the cache exclusively, counting the times it is held by another thread.
+    LruLock lock_cache()
+    {
+        LruLock cache_lock(cache_mutex, std::try_to_lock);
+
+        if ( !cache_lock.owns_lock() )
+        {
+            cache_lock.lock();
+            ++stats.lock_waits;
+        }
+        return cache_lock;
+    }
+
+    // Shared holders may count concurrently so their stats must be atomic.
+    LruSharedLock lock_cache_shared()
+    {
+        LruSharedLock cache_lock(cache_mutex, std::try_to_lock);
+
+        if ( !cache_lock.owns_lock() )
+        {
+            cache_lock.lock();
+            count_shared(stats.lock_waits);
+        }
+        return cache_lock;
+    }
+
+    static void count_shared(PegCount& count)
+    { __atomic_fetch_add(&count, 1, __ATOMIC_RELAXED); }
+
+    // Each move to the front pushes every other entry back by at most one, so
+    // an entry moved recently enough can't have drifted toward the end of the
+    // list and doesn't need to be moved again.  Caller must hold the lock.
+    bool is_recent(const LruEntry& entry) const
+    { return clock - entry.touched < (list.size() >> recent_shift); }
+
+    // Caller must hold the lock exclusively.
+    void touch(LruEntry& entry)
+    {
+        list.splice(list.begin(), list, entry.iter);
+        entry.touched = ++clock;
+    }
+
+    // Caller must hold the lock exclusively.
+    void add_front(const Key& key, const Data& data)
+    {
+        list.emplace_front(std::make_pair(key, data));
+        map[key] = { list.begin(), ++clock };
+    }
+
+    // Look up an entry with the lock shared; returns false if the entry must
+    // be looked up again with the lock held exclusively.
+    bool find_shared(const Key& key, Data& data)
+    {
+        LruSharedLock cache_lock = lock_cache_shared();
+        LruMapIter map_iter = map.find(key);
+
+        if ( map_iter == map.end() or !is_recent(map_iter->second) )
+            return false;
+
+        count_shared(stats.find_hits);
+        count_shared(stats.shared_hits);
+        data = map_iter->second.iter->second;
+        return true;
+    }
+
     // The reason for these functions is to allow derived classes to do their
     // size book keeping differently (e.g. host_cache). This effectively
     // decouples the current_size variable from the actual size in memory,
@@ -191,7 +280,7 @@ bool LruCacheShared<Key, Value, Hash, Eq>::set_max_size(size_t newsize)
     // after the cache_lock does.
     std::vector<Data> data;
 
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    LruLock cache_lock = lock_cache();
 
     //  Remove the oldest entries if we have to reduce cache size.
     max_size = newsize;
@@ -204,8 +293,13 @@ bool LruCacheShared<Key, Value, Hash, Eq>::set_max_size(size_t newsize)
 template<typename Key, typename Value, typename Hash, typename Eq>
 std::shared_ptr<Value> LruCacheShared<Key, Value, Hash, Eq>::find(const Key& key)
 {
+    Data data;
+
+    if ( find_shared(key, data) )
+        return data;
+
     LruMapIter map_iter;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    LruLock cache_lock = lock_cache();
 
     map_iter = map.find(key);
     if (map_iter == map.end())
@@ -215,9 +309,9 @@ std::shared_ptr<Value> LruCacheShared<Key, Value, Hash, Eq>::find(const Key& key
     }
 
     //  Move entry to front of LruList
-    list.splice(list.begin(), list, map_iter->second);
+    touch(map_iter->second);
     stats.find_hits++;
-    return map_iter->second->second;
+    return map_iter->second.iter->second;
 }
 
 template<typename Key, typename Value, typename Hash, typename Eq>
@@ -239,30 +333,31 @@ find_else_create(const Key& key, bool* new_data)
     // return the data pointer (below), or else, some other thread might
     // delete it before we got a chance to return it.
     std::vector<Data> tmp_data;
+    Data data;
+
+    if ( find_shared(key, data) )
+        return data;
 
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    LruLock cache_lock = lock_cache();
 
     map_iter = map.find(key);
     if (map_iter != map.end())
     {
         stats.find_hits++;
-        list.splice(list.begin(), list, map_iter->second); // update LRU
-        return map_iter->second->second;
+        touch(map_iter->second); // update LRU
+        return map_iter->second.iter->second;
     }
 
     stats.find_misses++;
     stats.adds++;
     if ( new_data )
         *new_data = true;
-    Data data = Data(new Value);
+    data = Data(new Value);
 
-    //  Add key/data pair to front of list.
-    list.emplace_front(std::make_pair(key, data));
+    //  Add key/data pair to front of list and list iterator to map.
+    add_front(key, data);
     increase_size();
 
-    //  Add list iterator for the new entry to map.
-    map[key] = list.begin();
-
     prune(tmp_data);
 
     return data;
@@ -275,7 +370,7 @@ find_else_insert(const Key& key, std::shared_ptr<Value>& data, bool replace)
     LruMapIter map_iter;
 
     std::vector<Data> tmp_data;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    LruLock cache_lock = lock_cache();
 
     map_iter = map.find(key);
     if (map_iter != map.end())
@@ -284,24 +379,21 @@ find_else_insert(const Key& key, std::shared_ptr<Value>& data, bool replace)
         if (replace)
         {
             // Explicitly calling the reset so its more clear that destructor could be called for the object
-            map_iter->second->second.reset();
-            map_iter->second->second = data;
+            map_iter->second.iter->second.reset();
+            map_iter->second.iter->second = data;
             stats.replaced++;
         }
-        list.splice(list.begin(), list, map_iter->second); // update LRU
+        touch(map_iter->second); // update LRU
         return true;
     }
 
     stats.find_misses++;
     stats.adds++;
 
-    //  Add key/data pair to front of list.
-    list.emplace_front(std::make_pair(key, data));
+    //  Add key/data pair to front of list and list iterator to map.
+    add_front(key, data);
     increase_size();
 
-    //  Add list iterator for the new entry to map.
-    map[key] = list.begin();
-
     prune(tmp_data);
 
     return false;
@@ -312,7 +404,7 @@ std::vector< std::pair<Key, std::shared_ptr<Value>> >
 LruCacheShared<Key, Value, Hash, Eq>::get_all_data()
 {
     std::vector<std::pair<Key, Data> > vec;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    LruSharedLock cache_lock(cache_mutex);
 
     for (auto& entry : list )
     {
@@ -340,7 +432,7 @@ bool LruCacheShared<Key, Value, Hash, Eq>::remove(const Key& key)
     // data and cache_lock!
     Data data;
 
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    LruLock cache_lock = lock_cache();
 
     map_iter = map.find(key);
     if (map_iter == map.end())
@@ -348,10 +440,10 @@ bool LruCacheShared<Key, Value, Hash, Eq>::remove(const Key& key)
         return false;   //  Key is not in LruCache.
     }
 
-    data = map_iter->second->second;
+    data = map_iter->second.iter->second;
 
     decrease_size();
-    list.erase(map_iter->second);
+    list.erase(map_iter->second.iter);
     map.erase(map_iter);
     stats.removes++;
 
@@ -368,7 +460,7 @@ bool LruCacheShared<Key, Value, Hash, Eq>::remove(const Key& key, std::shared_pt
 {
     LruMapIter map_iter;
 
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    LruLock cache_lock = lock_cache();
 
     map_iter = map.find(key);
     if (map_iter == map.end())
@@ -376,10 +468,10 @@ bool LruCacheShared<Key, Value, Hash, Eq>::remove(const Key& key, std::shared_pt
         return false;   //  Key is not in LruCache.
     }
 
-    data = map_iter->second->second;
+    data = map_iter->second.iter->second;
 
     decrease_size();
-    list.erase(map_iter->second);
+    list.erase(map_iter->second.iter);
     map.erase(map_iter);
     stats.removes++;
 
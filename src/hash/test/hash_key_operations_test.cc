@@ -0,0 +1,168 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// hash_key_operations_test.cc
+// unit tests for hash method selection and crc hashing
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "hash/hash_key_operations.h"
+
+#include <arpa/inet.h>
+
+#include <cstring>
+#include <vector>
+
+#include "main/snort_config.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+// Stubs whose sole purpose is to make the test code link
+static SnortConfig my_config;
+THREAD_LOCAL SnortConfig* snort_conf = &my_config;
+
+SnortConfig::SnortConfig(const SnortConfig* const)
+{ snort_conf->run_flags = 0;}
+
+SnortConfig::~SnortConfig() = default;
+
+const SnortConfig* SnortConfig::get_conf()
+{ return snort_conf; }
+
+class TestHashKeyOps : public HashKeyOperations
+{
+public:
+    TestHashKeyOps() : HashKeyOperations(1024)
+    { }
+
+    bool crc() const
+    { return use_crc(); }
+};
+
+static void make_key(uint8_t* key, unsigned len)
+{
+    for ( unsigned i = 0; i < len; ++i )
+        key[i] = (uint8_t)(i * 7 + 1);
+}
+
+TEST_GROUP(hash_key_operations)
+{
+    void setup() override
+    {
+        my_config.run_flags = RUN_FLAG__STATIC_HASH;
+        my_config.hash_method = HashMethod::SCALAR;
+    }
+
+    void teardown() override
+    {
+        my_config.run_flags = 0;
+        my_config.hash_method = HashMethod::SCALAR;
+    }
+};
+
+TEST(hash_key_operations, select_method)
+{
+    CHECK(!TestHashKeyOps().crc());
+
+    my_config.hash_method = HashMethod::SCALAR;
+    CHECK(!TestHashKeyOps().crc());
+
+    my_config.hash_method = HashMethod::CRC;
+    CHECK(TestHashKeyOps().crc());
+
+    my_config.hash_method = HashMethod::AUTO;
+    CHECK(TestHashKeyOps().crc() == HashKeyOperations::hw_crc_supported());
+}
+
+// these must not depend on whether the crc instructions are used so that
+// static hashing gives the same tables on every platform
+TEST(hash_key_operations, static_crc)
+{
+    my_config.hash_method = HashMethod::CRC;
+    TestHashKeyOps ops;
+    uint8_t key[64];
+    make_key(key, sizeof(key));
+
+    // tag key, flow key, host key, and a short tail
+    UNSIGNED_LONGS_EQUAL(0x9a29c710, ops.do_hash(key, 36));
+    UNSIGNED_LONGS_EQUAL(0xb871ab82, ops.do_hash(key, 52));
+    UNSIGNED_LONGS_EQUAL(0xdb53a500, ops.do_hash(key, 16));
+    UNSIGNED_LONGS_EQUAL(0xe6ac89cf, ops.do_hash(key, 3));
+}
+
+TEST(hash_key_operations, crc_keys)
+{
+    my_config.hash_method = HashMethod::CRC;
+    TestHashKeyOps ops;
+    uint8_t key[52];
+    make_key(key, sizeof(key));
+
+    unsigned h = ops.do_hash(key, sizeof(key));
+    CHECK(ops.do_hash(key, sizeof(key)) == h);
+
+    // every bit counts, including the tail
+    for ( unsigned i = 0; i < sizeof(key) * 8; ++i )
+    {
+        key[i / 8] ^= (1 << (i % 8));
+        CHECK(ops.do_hash(key, sizeof(key)) != h);
+        key[i / 8] ^= (1 << (i % 8));
+    }
+
+    // random seeds
+    my_config.run_flags = 0;
+    TestHashKeyOps a, b;
+    CHECK(a.do_hash(key, sizeof(key)) != b.do_hash(key, sizeof(key)));
+}
+
+// sequential ipv4 host keys should spread evenly over a power of 2 table
+TEST(hash_key_operations, crc_distribution)
+{
+    my_config.hash_method = HashMethod::CRC;
+    TestHashKeyOps ops;
+
+    const unsigned rows = 4096;
+    const unsigned keys = 16 * rows;
+    std::vector<unsigned> count(rows);
+
+    uint32_t ip[4] = { 0, 0, htonl(0xffff), 0 };
+
+    for ( unsigned i = 0; i < keys; ++i )
+    {
+        ip[3] = htonl(0x0a000000 + i);
+        count[ops.do_hash((const unsigned char*)ip, sizeof(ip)) & (rows - 1)]++;
+    }
+
+    unsigned max = 0;
+
+    for ( auto c : count )
+        if ( c > max )
+            max = c;
+
+    // expected max is about 32 for a uniform hash
+    CHECK(max < 48);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -193,6 +193,38 @@ TEST(lru_cache_shared, stats_test)
     CHECK(!strcmp(pegs[3].name, "find_misses"));
     CHECK(!strcmp(pegs[4].name, "reload_prunes"));
     CHECK(!strcmp(pegs[5].name, "removes"));
+    CHECK(!strcmp(pegs[6].name, "replaced"));
+    CHECK(!strcmp(pegs[7].name, "lock_waits"));
+    CHECK(!strcmp(pegs[8].name, "shared_hits"));
+    CHECK(!pegs[9].name);
+}
+
+//  Test hits on recently used entries that don't change the LRU order.
+TEST(lru_cache_shared, shared_hits)
+{
+    LruCacheShared<int, std::string, std::hash<int> > lru_cache(64);
+
+    for (int i = 0; i < 64; i++)
+        lru_cache[i];
+
+    lru_cache.find(63);     //  Recent, left in place
+    lru_cache.find(0);      //  Oldest, moved to front
+    lru_cache.find(0);      //  Now recent
+
+    PegCount* stats = lru_cache.get_counts();
+    CHECK(stats[2] == 3);   //  find hits
+    CHECK(stats[7] == 0);   //  lock waits
+    CHECK(stats[8] == 2);   //  shared hits
+
+    //  Adding one more prunes 1, not 0.
+    lru_cache[64];
+    CHECK(nullptr == lru_cache.find(1));
+    CHECK(nullptr != lru_cache.find(0));
+
+    const auto&& vec = lru_cache.get_all_data();
+    CHECK(vec.size() == 64);
+    CHECK(vec[0].first == 64);
+    CHECK(vec[1].first == 0);
 }
 
 int main(int argc, char** argv)
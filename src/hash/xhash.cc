@@ -244,6 +244,23 @@ HashNode* XHash::find_node(const void* key)
     return find_node_row(key, rindex);
 }
 
+unsigned XHash::prefetch_row(const void* key)
+{
+    unsigned row = hashkey_ops->do_hash((const unsigned char*)key, keysize) & (nrows - 1);
+    __builtin_prefetch(table + row);
+    return row;
+}
+
+HashNode* XHash::prefetch_node(unsigned row)
+{
+    HashNode* hnode = table[row];
+
+    if ( hnode )
+        __builtin_prefetch(hnode);
+
+    return hnode;
+}
+
 HashNode* XHash::find_first_node()
 {
     for ( crow = 0; crow < nrows; crow++ )
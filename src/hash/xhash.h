@@ -67,6 +67,11 @@ public:
     void clear_hash();
     bool full() const { return !fhead; }
 
+    // batch lookahead: prefetch the row for key and return its index so
+    // the first node in the row can be prefetched once the row arrives
+    unsigned prefetch_row(const void* key);
+    HashNode* prefetch_node(unsigned row);
+
     // set max hash nodes, 0 == no limit
     void set_max_nodes(int max)
     { max_nodes = max; }
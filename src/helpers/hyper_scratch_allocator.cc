@@ -47,7 +47,18 @@ bool HyperScratchAllocator::setup(SnortConfig* sc)
         return false;
 
     for ( unsigned i = 0; i < sc->num_slots; ++i )
-        hs_clone_scratch(scratch, get_addr(sc, i));
+    {
+        if ( hs_clone_scratch(scratch, get_addr(sc, i)) != HS_SUCCESS )
+        {
+            // cleanup is only called if setup succeeds
+            set(sc, i, nullptr);
+            cleanup(sc);
+            hs_free_scratch(scratch);
+            scratch = nullptr;
+            ParseError("can't clone literal search scratch space");
+            return false;
+        }
+    }
 
     hs_free_scratch(scratch);
     scratch = nullptr;
@@ -0,0 +1,122 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// spsc_ring.h
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+// SpscRing passes pointers from exactly one producer thread to exactly one
+// consumer thread without locks.  The read and write indices are on separate
+// cache lines and each side keeps a private copy of the other side's index so
+// it only reads the shared one when the ring looks full or empty.  Unlike
+// Ring, it is safe to use between threads.
+
+#include <atomic>
+#include <cassert>
+
+template <typename T>
+class SpscRing
+{
+public:
+    // size is rounded up to a power of 2
+    SpscRing(unsigned size);
+    ~SpscRing()
+    { delete[] store; }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // producer only; returns false if full
+    bool push(T*);
+
+    // consumer only; returns nullptr if empty
+    T* pop();
+
+    // may be called from either side but only the caller's view is exact
+    bool empty() const
+    { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+    unsigned get_size() const
+    { return mask + 1; }
+
+private:
+    static constexpr unsigned line_size = 64;
+
+    // consumer side
+    std::atomic<unsigned> head { 0 };
+    unsigned tail_seen = 0;
+    char pad1[line_size - sizeof(std::atomic<unsigned>) - sizeof(unsigned)];
+
+    // producer side
+    std::atomic<unsigned> tail { 0 };
+    unsigned head_seen = 0;
+    char pad2[line_size - sizeof(std::atomic<unsigned>) - sizeof(unsigned)];
+
+    T** store;
+    unsigned mask;
+};
+
+template <typename T>
+SpscRing<T>::SpscRing(unsigned size)
+{
+    unsigned n = 1;
+
+    while ( n < size )
+        n <<= 1;
+
+    store = new T*[n];
+    mask = n - 1;
+}
+
+template <typename T>
+bool SpscRing<T>::push(T* v)
+{
+    unsigned t = tail.load(std::memory_order_relaxed);
+
+    if ( t - head_seen > mask )
+    {
+        head_seen = head.load(std::memory_order_acquire);
+
+        if ( t - head_seen > mask )
+            return false;
+    }
+    store[t & mask] = v;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+T* SpscRing<T>::pop()
+{
+    unsigned h = head.load(std::memory_order_relaxed);
+
+    if ( h == tail_seen )
+    {
+        tail_seen = tail.load(std::memory_order_acquire);
+
+        if ( h == tail_seen )
+            return nullptr;
+    }
+    T* v = store[h & mask];
+    head.store(h + 1, std::memory_order_release);
+    return v;
+}
+
+#endif
+
@@ -0,0 +1,106 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// spsc_ring_test.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <thread>
+#include <vector>
+
+#include "catch/catch.hpp"
+
+#include "../spsc_ring.h"
+
+TEST_CASE( "spsc ring", "[spsc_ring]" )
+{
+    SpscRing<int> ring(3);
+    int v[4] = { 0, 1, 2, 3 };
+
+    CHECK(ring.get_size() == 4);
+    CHECK(ring.empty());
+    CHECK(!ring.pop());
+
+    SECTION( "fill and drain" )
+    {
+        for ( int i = 0; i < 4; ++i )
+            CHECK(ring.push(v + i));
+
+        CHECK(!ring.push(v));
+        CHECK(!ring.empty());
+
+        for ( int i = 0; i < 4; ++i )
+            CHECK(ring.pop() == v + i);
+
+        CHECK(!ring.pop());
+        CHECK(ring.empty());
+    }
+
+    SECTION( "wrap" )
+    {
+        for ( int i = 0; i < 10; ++i )
+        {
+            CHECK(ring.push(v + (i & 3)));
+            CHECK(ring.push(v + ((i + 1) & 3)));
+            CHECK(ring.pop() == v + (i & 3));
+            CHECK(ring.pop() == v + ((i + 1) & 3));
+        }
+        CHECK(ring.empty());
+    }
+}
+
+TEST_CASE( "spsc ring threads", "[spsc_ring]" )
+{
+    const unsigned num = 100000;
+    std::vector<unsigned> values(num);
+    SpscRing<unsigned> ring(64);
+
+    for ( unsigned i = 0; i < num; ++i )
+        values[i] = i;
+
+    std::thread producer([&]()
+    {
+        for ( unsigned i = 0; i < num; ++i )
+        {
+            while ( !ring.push(&values[i]) )
+                std::this_thread::yield();
+        }
+    });
+
+    unsigned next = 0;
+    bool in_order = true;
+
+    while ( next < num )
+    {
+        unsigned* p = ring.pop();
+
+        if ( !p )
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if ( *p != next++ )
+            in_order = false;
+    }
+    producer.join();
+
+    CHECK(in_order);
+    CHECK(ring.empty());
+}
+
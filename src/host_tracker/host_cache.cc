@@ -31,3 +31,62 @@ using namespace snort;
 #define LRU_CACHE_INITIAL_SIZE 16384 * 512
 
 HostCacheIp host_cache(LRU_CACHE_INITIAL_SIZE);
+
+#ifdef BENCHMARK_TEST
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch/snort_catch.h"
+
+// each thread looks up hosts in a working set shared by all threads and
+// creates those not found, as rna does for each packet.  most lookups are
+// for a small number of busy hosts.
+static void lookup_hosts(HostCacheIp* cache, unsigned seed, unsigned lookups)
+{
+    uint32_t r = seed;
+
+    for ( unsigned i = 0; i < lookups; ++i )
+    {
+        r = r * 1103515245 + 12345;
+        uint32_t host = (r >> 8) % ((r & 0x7) ? 256 : 16384);
+        uint32_t addr = htonl(0x0a000000 + host);
+
+        SfIp ip;
+        ip.set(&addr, AF_INET);
+        cache->find_else_create(ip, nullptr);
+    }
+}
+
+static void bench_lookups(unsigned num_threads, unsigned num_shards)
+{
+    HostCacheIp cache(LRU_CACHE_INITIAL_SIZE, num_shards);
+
+    std::string name = std::to_string(num_threads) + " threads ";
+    name += std::to_string(num_shards) + " shards";
+
+    BENCHMARK(std::string(name))
+    {
+        std::vector<std::thread> threads;
+
+        for ( unsigned t = 0; t < num_threads; ++t )
+            threads.emplace_back(lookup_hosts, &cache, t + 1, 10000);
+
+        for ( auto& t : threads )
+            t.join();
+
+        return cache.size();
+    };
+}
+
+TEST_CASE("host cache lookups", "[host_cache][benchmark]")
+{
+    for ( unsigned num_threads : { 1, 4, 16 } )
+    {
+        bench_lookups(num_threads, 1);
+        bench_lookups(num_threads, 16);
+    }
+}
+
+#endif
@@ -24,7 +24,9 @@
 // The host cache is used to cache information about hosts so that it can
 // be shared among threads.
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
 
 #include "hash/lru_cache_shared.h"
 #include "host_cache_interface.h"
@@ -32,6 +34,7 @@
 #include "host_tracker.h"
 #include "log/messages.h"
 #include "main/snort_config.h"
+#include "main/thread.h"
 #include "sfip/sf_ip.h"
 #include "utils/stats.h"
 
@@ -65,6 +68,7 @@ public:
     using LruBase = LruCacheShared<Key, Value, Hash, Eq>;
     using LruBase::cache_mutex;
     using LruBase::current_size;
+    using LruBase::lock_cache;
     using LruBase::list;
     using LruBase::map;
     using LruBase::max_size;
@@ -72,6 +76,8 @@ public:
     using LruBase::stats;
     using Data = typename LruBase::Data;
     using LruListIter = typename LruBase::LruListIter;
+    using LruLock = typename LruBase::LruLock;
+    using LruSharedLock = typename LruBase::LruSharedLock;
     using ValueType = typename LruBase::ValueType;
 
     LruCacheSharedMemcap() = delete;
@@ -90,7 +96,7 @@ public:
     {
         if ( snort::SnortConfig::log_verbose() )
         {
-            std::lock_guard<std::mutex> cache_lock(cache_mutex);
+            LruSharedLock cache_lock(cache_mutex);
 
             snort::LogLabel("host_cache");
             snort::LogMessage("    memcap: %zu bytes\n", max_size);
@@ -105,7 +111,7 @@ public:
         if ( current_size > new_size )
             return true;
 
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
+        LruLock cache_lock = lock_cache();
         max_size = new_size;
         return false;
     }
@@ -126,7 +132,7 @@ public:
             // Get a local temporary reference of data being deleted (as if a trash can).
             // To avoid race condition, data needs to self-destruct after the cache_lock does.
             Data data;
-            std::lock_guard<std::mutex> cache_lock(cache_mutex);
+            LruLock cache_lock = lock_cache();
 
             if ( !list.empty() )
             {
@@ -204,7 +210,7 @@ private:
             // Do not change the order of data and cache_lock, as the data must
             // self destruct after cache_lock.
             std::vector<Data> data;
-            std::lock_guard<std::mutex> cache_lock(cache_mutex);
+            LruLock cache_lock = lock_cache();
             LruBase::prune(data);
         }
     }
@@ -226,7 +232,318 @@ private:
     friend class TEST_host_cache_module_misc_Test; // for unit test
 };
 
-typedef LruCacheSharedMemcap<snort::SfIp, snort::HostTracker, HashIp, IpEqualTo> HostCacheIp;
+// LruCacheShardedMemcap splits the cache into independent LruCacheSharedMemcap
+// shards, picked by key hash, so that threads looking up different hosts
+// rarely wait on the same lock.  The memcap is divided evenly among the shards
+// and each shard prunes its own least recently used entries; get_all_data()
+// returns the entries of each shard in turn.  With a single shard, which is
+// the default, this is the same as one LruCacheSharedMemcap.
+//
+// Memory allocated by the containers of an entry is charged to the shard that
+// created the entry.  The shard is noted in a thread local while the entry is
+// constructed and the allocators pick it up from get_allocator_cache().  Any
+// other allocation, e.g. by a standalone HostTracker, is charged to the shards
+// in turn, so it counts against the memcap and prunes like any other entry.
+template<typename Key, typename Value, typename Hash, typename Eq = std::equal_to<Key>>
+class LruCacheShardedMemcap : public HostCacheInterface
+{
+public:
+    using Shard = LruCacheSharedMemcap<Key, Value, Hash, Eq>;
+    using Data = typename Shard::Data;
+    using ValueType = typename Shard::ValueType;
+
+    LruCacheShardedMemcap() = delete;
+    LruCacheShardedMemcap(const LruCacheShardedMemcap& arg) = delete;
+    LruCacheShardedMemcap& operator=(const LruCacheShardedMemcap& arg) = delete;
+
+    LruCacheShardedMemcap(const size_t initial_size, unsigned num_shards = 1) :
+        max_size(initial_size), valid_id(invalid_id+1)
+    { add_shards(num_shards); }
+
+    ~LruCacheShardedMemcap()
+    {
+        // retired shards are still charged for entries that moved on
+        shards.clear();
+        retired.clear();
+    }
+
+    Data find(const Key& key)
+    { return get_shard(key).find(key); }
+
+    Data operator[](const Key& key)
+    { return find_else_create(key, nullptr); }
+
+    Data find_else_create(const Key& key, bool* new_data)
+    {
+        Shard& shard = get_shard(key);
+        creator = &shard;
+        Data data = shard.find_else_create(key, new_data);
+        creator = nullptr;
+        return data;
+    }
+
+    bool find_else_insert(const Key& key, Data& data, bool replace = false)
+    { return get_shard(key).find_else_insert(key, data, replace); }
+
+    bool remove(const Key& key)
+    { return get_shard(key).remove(key); }
+
+    bool remove(const Key& key, Data& data)
+    { return get_shard(key).remove(key, data); }
+
+    std::vector<std::pair<Key, Data>> get_all_data()
+    {
+        std::vector<std::pair<Key, Data>> vec;
+
+        for ( auto& shard : shards )
+        {
+            auto&& data = shard->get_all_data();
+            vec.insert(vec.end(), data.begin(), data.end());
+        }
+        return vec;
+    }
+
+    size_t size()
+    {
+        size_t n = 0;
+
+        for ( auto& shard : shards )
+            n += shard->size();
+
+        return n;
+    }
+
+    size_t mem_size()
+    {
+        size_t n = 0;
+
+        for ( auto& shard : shards )
+            n += shard->mem_size();
+
+        for ( auto& shard : retired )
+            n += shard->mem_size();
+
+        return n;
+    }
+
+    size_t get_max_size() const
+    { return max_size; }
+
+    unsigned get_shards() const
+    { return shards.size(); }
+
+    bool set_max_size(size_t new_size)
+    {
+        if ( new_size == 0 )
+            return false;
+
+        max_size = new_size;
+
+        for ( auto& shard : shards )
+            shard->set_max_size(get_share(new_size, shards.size()));
+
+        return true;
+    }
+
+    // Change the number of shards, moving existing entries to their new shard.
+    // This is not thread safe and must be done before packet threads start.
+    // The allocators of moved entries still charge their old shard, so old
+    // shards are kept until the cache is deleted.
+    void set_shards(unsigned num_shards)
+    {
+        if ( !num_shards or num_shards == shards.size() )
+            return;
+
+        std::vector<std::unique_ptr<Shard>> old;
+        old.swap(shards);
+        add_shards(num_shards);
+
+        for ( auto& shard : old )
+        {
+            auto&& data = shard->get_all_data();
+
+            // least recently used first to keep the order within each shard
+            for ( auto it = data.rbegin(); it != data.rend(); ++it )
+            {
+                get_shard(it->first).find_else_insert(it->first, it->second);
+                shard->remove(it->first);
+            }
+            retired.emplace_back(std::move(shard));
+        }
+    }
+
+    void print_config()
+    {
+        if ( snort::SnortConfig::log_verbose() )
+        {
+            snort::LogLabel("host_cache");
+            snort::LogMessage("    memcap: %zu bytes\n", max_size);
+            snort::LogMessage("    shards: %zu\n", shards.size());
+        }
+    }
+
+    // Resize each shard; returns true if any must be pruned gradually.
+    bool reload_resize(size_t new_size)
+    {
+        bool prune = false;
+
+        for ( auto& shard : shards )
+        {
+            if ( shard->reload_resize(get_share(new_size, shards.size())) )
+                prune = true;
+        }
+
+        if ( !prune )
+            max_size = new_size;
+
+        return prune;
+    }
+
+    // Prune up to max_prune entries from each shard still above its share of
+    // the new memcap.  Returns true when all shards are done.
+    bool reload_prune(size_t new_size, unsigned max_prune)
+    {
+        std::unique_lock<std::mutex> reload_lock(reload_mutex, std::try_to_lock);
+        if ( !reload_lock.owns_lock() )
+            return false; // some other thread wins this round
+
+        bool done = true;
+
+        for ( auto& shard : shards )
+        {
+            if ( !shard->reload_prune(get_share(new_size, shards.size()), max_prune) )
+                done = false;
+        }
+
+        if ( done )
+            max_size = new_size;
+
+        return done;
+    }
+
+    // Allocators for a container constructed along with a new entry charge
+    // the shard creating the entry; all others charge the next shard.
+    HostCacheInterface* get_allocator_cache()
+    {
+        if ( creator )
+            return creator;
+        return shards[next_shard++ % shards.size()].get();
+    }
+
+    const PegInfo* get_pegs() const
+    { return lru_cache_shared_peg_names; }
+
+    // With more than one shard, counts are moved from the shards to a total
+    // here so that they may be summed and cleared like any other counts.
+    PegCount* get_counts()
+    {
+        if ( shards.size() == 1 )
+            return shards[0]->get_counts();
+
+        for ( auto& shard : shards )
+        {
+            shard->lock();
+            PegCount* pc = shard->get_counts();
+
+            for ( unsigned i = 0; i < num_counts; ++i )
+            {
+                counts[i] += pc[i];
+                pc[i] = 0;
+            }
+            shard->unlock();
+        }
+        return counts;
+    }
+
+    void lock()
+    {
+        if ( shards.size() == 1 )
+            shards[0]->lock();
+        else
+            counts_mutex.lock();
+    }
+
+    void unlock()
+    {
+        if ( shards.size() == 1 )
+            shards[0]->unlock();
+        else
+            counts_mutex.unlock();
+    }
+
+    bool is_valid(size_t id) const
+    { return id == valid_id; }
+
+    void invalidate()
+    { valid_id++; }
+
+    size_t get_valid_id() const
+    { return valid_id; }
+
+    static constexpr size_t invalid_id = 0;
+    static constexpr size_t mem_chunk = Shard::mem_chunk;
+
+private:
+    Shard& get_shard(const Key& key)
+    {
+        if ( shards.size() == 1 )
+            return *shards[0];
+
+        // the same hash picks the bucket within the shard, so mix all of
+        // its bits into the ones that pick the shard
+        uint64_t h = Hash()(key);
+        h = (h ^ (h >> 32)) * 0x9e3779b97f4a7c15ull;
+        return *shards[(h >> 40) % shards.size()];
+    }
+
+    static size_t get_share(size_t size, size_t num_shards)
+    { return std::max<size_t>(size / num_shards, 1); }
+
+    void add_shards(unsigned num_shards)
+    {
+        for ( unsigned i = 0; i < num_shards; ++i )
+            shards.emplace_back(new Shard(get_share(max_size, num_shards)));
+    }
+
+    // allocators are given a shard, so this is only here for the interface
+    void update(int size) override
+    {
+        HostCacheInterface* shard = shards[0].get();
+        shard->update(size);
+    }
+
+    static constexpr unsigned num_counts = sizeof(LruCacheSharedStats) / sizeof(PegCount);
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<std::unique_ptr<Shard>> retired;
+
+    size_t max_size;
+    std::atomic<unsigned> next_shard { 0 };
+    std::atomic<size_t> valid_id;
+
+    std::mutex reload_mutex;
+    std::mutex counts_mutex;
+    PegCount counts[num_counts] = { };
+
+    static THREAD_LOCAL Shard* creator;
+
+    friend class TEST_host_cache_module_misc_Test; // for unit test
+};
+
+template<typename Key, typename Value, typename Hash, typename Eq>
+THREAD_LOCAL typename LruCacheShardedMemcap<Key, Value, Hash, Eq>::Shard*
+    LruCacheShardedMemcap<Key, Value, Hash, Eq>::creator = nullptr;
+
+template<typename Key, typename Value, typename Hash, typename Eq>
+constexpr size_t LruCacheShardedMemcap<Key, Value, Hash, Eq>::invalid_id;
+
+template<typename Key, typename Value, typename Hash, typename Eq>
+constexpr size_t LruCacheShardedMemcap<Key, Value, Hash, Eq>::mem_chunk;
+
+template<typename Key, typename Value, typename Hash, typename Eq>
+constexpr unsigned LruCacheShardedMemcap<Key, Value, Hash, Eq>::num_counts;
+
+typedef LruCacheShardedMemcap<snort::SfIp, snort::HostTracker, HashIp, IpEqualTo> HostCacheIp;
 
 extern SO_PUBLIC HostCacheIp host_cache;
 
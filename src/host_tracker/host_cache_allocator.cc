@@ -26,7 +26,7 @@
 template <class T>
 HostCacheAllocIp<T>::HostCacheAllocIp()
 {
-    lru = &host_cache;
+    lru = host_cache.get_allocator_cache();
 }
 
 #endif
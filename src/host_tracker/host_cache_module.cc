@@ -349,6 +349,9 @@ static const Parameter host_cache_params[] =
     { "memcap", Parameter::PT_INT, "512:maxSZ", "8388608",
       "maximum host cache size in bytes" },
 
+    { "shards", Parameter::PT_INT, "1:64", "1",
+      "number of independently locked partitions of the host cache; set at startup only" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -362,6 +365,8 @@ bool HostCacheModule::set(const char*, Value& v, SnortConfig*)
     }
     else if ( v.is("memcap") )
         memcap = v.get_size();
+    else if ( v.is("shards") )
+        shards = v.get_uint8();
     else
         return false;
 
@@ -378,6 +383,9 @@ bool HostCacheModule::end(const char* fqn, int, SnortConfig* sc)
             host_cache.set_max_size(memcap);
     }
 
+    if ( shards and !Snort::is_reloading() and !strcmp(fqn, HOST_CACHE_NAME) )
+        host_cache.set_shards(shards);
+
     return true;
 }
 
@@ -453,7 +461,7 @@ string HostCacheModule::get_host_cache_stats()
 
     const auto&& lru_data = host_cache.get_all_data();
     str = "Current host cache size: " + to_string(host_cache.mem_size()) + " bytes, "
-        + to_string(lru_data.size()) + " trackers, memcap: " + to_string(host_cache.max_size)
+        + to_string(lru_data.size()) + " trackers, memcap: " + to_string(host_cache.get_max_size())
         + " bytes\n";
 
     host_cache.lock();
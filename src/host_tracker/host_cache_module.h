@@ -62,6 +62,8 @@ public:
     const PegInfo* get_pegs() const override;
     PegCount* get_counts() const override;
     void sum_stats(bool) override;
+    bool snapshot_stats() const override
+    { return false; }
 
     Usage get_usage() const override
     { return GLOBAL; }
@@ -72,6 +74,7 @@ public:
 private:
     const char* dump_file = nullptr;
     size_t memcap = 0;
+    unsigned shards = 0;
 };
 
 #endif
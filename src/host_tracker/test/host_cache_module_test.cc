@@ -120,7 +120,9 @@ TEST(host_cache_module, misc)
     CHECK(!strcmp(ht_pegs[4].name, "reload_prunes"));
     CHECK(!strcmp(ht_pegs[5].name, "removes"));
     CHECK(!strcmp(ht_pegs[6].name, "replaced"));
-    CHECK(!ht_pegs[7].name);
+    CHECK(!strcmp(ht_pegs[7].name, "lock_waits"));
+    CHECK(!strcmp(ht_pegs[8].name, "shared_hits"));
+    CHECK(!ht_pegs[9].name);
 
     // add 3 entries
     SfIp ip1, ip2, ip3;
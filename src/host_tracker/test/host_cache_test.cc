@@ -65,6 +65,115 @@ TEST(host_cache, hash_test)
 #endif
 }
 
+static SfIp get_ip(uint32_t i)
+{
+    SfIp ip;
+    uint32_t addr = htonl(0x0a000000 + i);
+    ip.set(&addr, AF_INET);
+    return ip;
+}
+
+//  Test that each shard prunes to its share of the memcap.
+TEST(host_cache, shard_memcap)
+{
+    HostCacheIp cache(64 * HostCacheIp::mem_chunk, 4);
+    CHECK(cache.get_shards() == 4);
+    CHECK(cache.get_max_size() == 64 * HostCacheIp::mem_chunk);
+
+    for ( uint32_t i = 0; i < 256; i++ )
+        CHECK(cache[get_ip(i)] != nullptr);
+
+    CHECK(cache.size() == 64);
+    CHECK(cache.mem_size() == 64 * HostCacheIp::mem_chunk);
+    CHECK(cache.find(get_ip(255)) != nullptr);
+
+    PegCount* counts = cache.get_counts();
+    CHECK(counts[0] == 256);  // adds
+    CHECK(counts[1] == 192);  // alloc prunes
+    CHECK(counts[2] == 1);    // find hits
+
+    // counts are moved from the shards so they aren't added twice
+    counts = cache.get_counts();
+    CHECK(counts[0] == 256);
+}
+
+//  Test that entries and their memory move to the new shards.
+TEST(host_cache, set_shards)
+{
+    HostCacheIp cache(1024 * HostCacheIp::mem_chunk);
+    CHECK(cache.get_shards() == 1);
+
+    for ( uint32_t i = 0; i < 10; i++ )
+        cache[get_ip(i)];
+
+    CHECK(cache[get_ip(0)]->add_service(80, IpProtocol::TCP, 676, true));
+    size_t mem_size = cache.mem_size();
+    CHECK(mem_size > 10 * HostCacheIp::mem_chunk);
+
+    cache.set_shards(8);
+    CHECK(cache.get_shards() == 8);
+    CHECK(cache.size() == 10);
+    CHECK(cache.mem_size() == mem_size);
+
+    for ( uint32_t i = 0; i < 10; i++ )
+        CHECK(cache.find(get_ip(i)) != nullptr);
+
+    CHECK(cache.remove(get_ip(0)));
+    CHECK(cache.mem_size() == 9 * HostCacheIp::mem_chunk);
+}
+
+//  Test gradual pruning of all shards for a lower memcap.
+TEST(host_cache, shard_reload)
+{
+    HostCacheIp cache(128 * HostCacheIp::mem_chunk, 4);
+
+    for ( uint32_t i = 0; i < 32; i++ )
+        cache[get_ip(i)];
+
+    CHECK(cache.size() == 32);
+    CHECK(!cache.reload_resize(64 * HostCacheIp::mem_chunk));
+    CHECK(cache.get_max_size() == 64 * HostCacheIp::mem_chunk);
+
+    CHECK(cache.reload_resize(8 * HostCacheIp::mem_chunk));
+
+    unsigned rounds = 0;
+    while ( !cache.reload_prune(8 * HostCacheIp::mem_chunk, 2) )
+        rounds++;
+
+    CHECK(rounds > 0);
+    CHECK(cache.size() == 8);
+    CHECK(cache.get_max_size() == 8 * HostCacheIp::mem_chunk);
+}
+
+//  Test that memory of a tracker outside the cache is charged to a shard
+//  and counts against the memcap.
+TEST(host_cache, standalone_memcap)
+{
+    // allocators always charge the global cache
+    host_cache.set_shards(4);
+    host_cache.set_max_size(256 * HostCacheIp::mem_chunk);
+
+    for ( uint32_t i = 0; i < 64; i++ )
+        host_cache[get_ip(i)];
+
+    CHECK(host_cache.size() == 64);
+    CHECK(host_cache.mem_size() == 64 * HostCacheIp::mem_chunk);
+
+    {
+        HostTracker ht;
+        Port port = 1;
+
+        while ( host_cache.size() == 64 and port < 10000 )
+            ht.add_service(port++, IpProtocol::TCP, 676, true);
+
+        CHECK(host_cache.size() < 64);
+        CHECK(host_cache.mem_size() <= host_cache.get_max_size());
+    }
+
+    // the tracker's memory is returned to its shard
+    CHECK(host_cache.mem_size() == host_cache.size() * HostCacheIp::mem_chunk);
+}
+
 int main(int argc, char** argv)
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
@@ -26,6 +26,8 @@
 #include <pcre.h>
 
 #include <cassert>
+#include <string>
+#include <unordered_map>
 
 #include "detection/ips_context.h"
 #include "framework/cursor.h"
@@ -43,18 +45,12 @@
 
 using namespace snort;
 
-#ifndef PCRE_STUDY_JIT_COMPILE
-#define PCRE_STUDY_JIT_COMPILE 0
-#endif
-
-#define NO_JIT // uncomment to disable JIT for Xcode
-
-#ifdef NO_JIT
-#define PCRE_STUDY_FLAGS 0
-#define pcre_release(x) pcre_free(x)
-#else
-#define PCRE_STUDY_FLAGS PCRE_STUDY_JIT_COMPILE
+// define NO_JIT to build without pcre jit support (eg for Xcode)
+#if defined(PCRE_STUDY_JIT_COMPILE) && !defined(NO_JIT)
+#define USE_PCRE_JIT
 #define pcre_release(x) pcre_free_study(x)
+#else
+#define pcre_release(x) pcre_free(x)
 #endif
 
 #define SNORT_PCRE_RELATIVE         0x00010 // relative to the end of the last match
@@ -65,15 +61,44 @@ using namespace snort;
 #define s_name "pcre"
 #define mod_regex_name "regex"
 
+// identical expressions with the same compile flags and limits are compiled
+// and studied once and shared by all the pcre options using them since jit
+// compilation is expensive and the compiled code is read only at runtime.
+struct PcreCode
+{
+    std::string key;
+    pcre* re;
+    pcre_extra* pe;
+    bool free_pe;
+    bool jit;
+    unsigned refs;
+};
+
 struct PcreData
 {
     pcre* re;           /* compiled regex */
     pcre_extra* pe;     /* studied regex foo */
-    bool free_pe;
+    PcreCode* code;     /* shared owner of re and pe */
+    bool jit;           /* pe has executable jit code */
     int options;        /* sp_pcre specific options (relative & inverse) */
     char* expression;
 };
 
+struct PcreStats
+{
+    PegCount pcre_rules;
+#ifdef HAVE_HYPERSCAN
+    PegCount pcre_to_hyper;
+#endif
+    PegCount pcre_native;
+    PegCount pcre_negated;
+    PegCount pcre_jit_compiled;
+    PegCount pcre_jit_failures;
+    PegCount pcre_shared;
+};
+
+PcreStats pcre_stats;
+
 // we need to specify the vector length for our pcre_exec call.  we only care
 // about the first vector, which if the match is successful will include the
 // offset to the end of the full pattern match.  if we decide to store other
@@ -86,6 +111,15 @@ static int s_ovector_max = -1;
 static unsigned scratch_index;
 static ScratchAllocator* scratcher = nullptr;
 
+// likewise, this is set during parsing if any expression was jit compiled
+// and reset when the per thread jit stacks are allocated
+static bool s_jit_used = false;
+
+static unsigned jit_scratch_index;
+static ScratchAllocator* jit_scratcher = nullptr;
+
+static std::unordered_map<std::string, PcreCode*> s_code_cache;
+
 static THREAD_LOCAL ProfileStats pcrePerfStats;
 
 //-------------------------------------------------------------------------
@@ -104,6 +138,178 @@ static void pcre_capture(
         s_ovector_max = tmp_ovector_size;
 }
 
+#ifdef USE_PCRE_JIT
+static bool jit_supported()
+{
+    static int supported = -1;
+
+    if ( supported < 0 and pcre_config(PCRE_CONFIG_JIT, &supported) )
+        supported = 0;
+
+    return supported != 0;
+}
+
+// called by pcre_exec() on the packet thread running the jit code
+static pcre_jit_stack* get_jit_stack(void*)
+{
+    const SnortConfig* sc = SnortConfig::get_conf();
+    return (pcre_jit_stack*)sc->state[get_instance_id()][jit_scratch_index];
+}
+#endif
+
+static void set_limits(const SnortConfig* sc, pcre_extra* pe)
+{
+    if ( sc->get_pcre_match_limit() != 0 )
+    {
+        pe->flags |= PCRE_EXTRA_MATCH_LIMIT;
+        pe->match_limit = sc->get_pcre_match_limit();
+    }
+
+    if ( sc->get_pcre_match_limit_recursion() != 0 )
+    {
+        pe->flags |= PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+        pe->match_limit_recursion = sc->get_pcre_match_limit_recursion();
+    }
+}
+
+static PcreCode* acquire_code(
+    const SnortConfig* sc, const char* re, int compile_flags, bool limits)
+{
+    bool use_jit = false;
+
+#ifdef USE_PCRE_JIT
+    use_jit = sc->pcre_jit and jit_supported();
+#endif
+
+    std::string key = std::to_string(compile_flags) + (use_jit ? ":j:" : ":i:");
+
+    if ( limits )
+    {
+        key += std::to_string(sc->get_pcre_match_limit()) + ':';
+        key += std::to_string(sc->get_pcre_match_limit_recursion());
+    }
+    key += ':';
+    key += re;
+
+    auto it = s_code_cache.find(key);
+
+    if ( it != s_code_cache.end() )
+    {
+        pcre_stats.pcre_shared++;
+        it->second->refs++;
+        return it->second;
+    }
+
+    const char* error;
+    int erroffset;
+
+    pcre* cre = pcre_compile(re, compile_flags, &error, &erroffset, nullptr);
+
+    if ( !cre )
+    {
+        ParseError(": pcre compile of '%s' failed at offset "
+            "%d : %s", re, erroffset, error);
+        return nullptr;
+    }
+
+    int study_flags = 0;
+
+#ifdef USE_PCRE_JIT
+    if ( use_jit )
+        study_flags = PCRE_STUDY_JIT_COMPILE;
+#endif
+
+    pcre_extra* pe = pcre_study(cre, study_flags, &error);
+
+    if ( error != nullptr )
+    {
+        ParseError("pcre study failed : %s", error);
+
+        if ( pe )
+            pcre_release(pe);
+
+        free(cre);  // external allocation
+        return nullptr;
+    }
+
+    bool jit = false;
+
+#ifdef USE_PCRE_JIT
+    if ( use_jit )
+    {
+        int jit_ok = 0;
+
+        if ( pe )
+            pcre_fullinfo(cre, pe, PCRE_INFO_JIT, &jit_ok);
+
+        if ( jit_ok )
+        {
+            pcre_assign_jit_stack(pe, get_jit_stack, nullptr);
+            pcre_stats.pcre_jit_compiled++;
+            jit = true;
+        }
+        else
+        {
+            pcre_stats.pcre_jit_failures++;
+
+            if ( !sc->pcre_jit_fallback )
+            {
+                ParseError("pcre jit compile of '%s' failed", re);
+
+                if ( pe )
+                    pcre_release(pe);
+
+                free(cre);  // external allocation
+                return nullptr;
+            }
+        }
+    }
+#endif
+
+    bool free_pe = false;
+
+    if ( limits and (sc->get_pcre_match_limit() != 0 or
+        sc->get_pcre_match_limit_recursion() != 0) )
+    {
+        if ( !pe )
+        {
+            pe = (pcre_extra*)snort_calloc(sizeof(pcre_extra));
+            free_pe = true;
+        }
+        set_limits(sc, pe);
+    }
+
+    PcreCode* code = new PcreCode;
+    code->key = key;
+    code->re = cre;
+    code->pe = pe;
+    code->free_pe = free_pe;
+    code->jit = jit;
+    code->refs = 1;
+
+    s_code_cache[key] = code;
+    return code;
+}
+
+static void release_code(PcreCode* code)
+{
+    if ( --code->refs )
+        return;
+
+    s_code_cache.erase(code->key);
+
+    if ( code->pe )
+    {
+        if ( code->free_pe )
+            snort_free(code->pe);
+        else
+            pcre_release(code->pe);
+    }
+
+    free(code->re);  // external allocation
+    delete code;
+}
+
 static void pcre_check_anchored(PcreData* pcre_data)
 {
     int rc;
@@ -156,11 +362,9 @@ static void pcre_check_anchored(PcreData* pcre_data)
 
 static void pcre_parse(const SnortConfig* sc, const char* data, PcreData* pcre_data)
 {
-    const char* error;
     char* re, * free_me;
     char* opts;
     char delimit = '/';
-    int erroffset;
     int compile_flags = 0;
 
     if (data == nullptr)
@@ -258,69 +462,22 @@ static void pcre_parse(const SnortConfig* sc, const char* data, PcreData* pcre_d
         opts++;
     }
 
-    /* now compile the re */
-    pcre_data->re = pcre_compile(re, compile_flags, &error, &erroffset, nullptr);
+    /* now compile and study the re, or reuse an identical one */
+    pcre_data->code = acquire_code(
+        sc, re, compile_flags, !(pcre_data->options & SNORT_OVERRIDE_MATCH_LIMIT));
 
-    if (pcre_data->re == nullptr)
+    if ( !pcre_data->code )
     {
-        ParseError(": pcre compile of '%s' failed at offset "
-            "%d : %s", re, erroffset, error);
+        snort_free(free_me);
         return;
     }
 
-    /* now study it... */
-    pcre_data->pe = pcre_study(pcre_data->re, PCRE_STUDY_FLAGS, &error);
-
-    if (pcre_data->pe)
-    {
-        if ((sc->get_pcre_match_limit() != 0) &&
-            !(pcre_data->options & SNORT_OVERRIDE_MATCH_LIMIT))
-        {
-            if ( !(pcre_data->pe->flags & PCRE_EXTRA_MATCH_LIMIT) )
-                pcre_data->pe->flags |= PCRE_EXTRA_MATCH_LIMIT;
-
-            pcre_data->pe->match_limit = sc->get_pcre_match_limit();
-        }
+    pcre_data->re = pcre_data->code->re;
+    pcre_data->pe = pcre_data->code->pe;
+    pcre_data->jit = pcre_data->code->jit;
 
-        if ((sc->get_pcre_match_limit_recursion() != 0) &&
-            !(pcre_data->options & SNORT_OVERRIDE_MATCH_LIMIT))
-        {
-            if ( !(pcre_data->pe->flags & PCRE_EXTRA_MATCH_LIMIT_RECURSION) )
-                pcre_data->pe->flags |= PCRE_EXTRA_MATCH_LIMIT_RECURSION;
-
-            pcre_data->pe->match_limit_recursion =
-                sc->get_pcre_match_limit_recursion();
-        }
-    }
-    else
-    {
-        if (!(pcre_data->options & SNORT_OVERRIDE_MATCH_LIMIT) &&
-            ((sc->get_pcre_match_limit() != 0) ||
-             (sc->get_pcre_match_limit_recursion() != 0)))
-        {
-            pcre_data->pe = (pcre_extra*)snort_calloc(sizeof(pcre_extra));
-            pcre_data->free_pe = true;
-
-            if (sc->get_pcre_match_limit() != 0)
-            {
-                pcre_data->pe->flags |= PCRE_EXTRA_MATCH_LIMIT;
-                pcre_data->pe->match_limit = sc->get_pcre_match_limit();
-            }
-
-            if (sc->get_pcre_match_limit_recursion() != 0)
-            {
-                pcre_data->pe->flags |= PCRE_EXTRA_MATCH_LIMIT_RECURSION;
-                pcre_data->pe->match_limit_recursion =
-                    sc->get_pcre_match_limit_recursion();
-            }
-        }
-    }
-
-    if (error != nullptr)
-    {
-        ParseError("pcre study failed : %s", error);
-        return;
-    }
+    if ( pcre_data->jit )
+        s_jit_used = true;
 
     pcre_capture(pcre_data->re, pcre_data->pe);
     pcre_check_anchored(pcre_data);
@@ -354,8 +511,9 @@ static bool pcre_search(
 
     found_offset = -1;
 
-    std::vector<void *> ss = p->context->conf->state[get_instance_id()];
-    assert(ss[scratch_index]);
+    const SnortConfig* sc = p->context->conf;
+    int* ovector = (int*)sc->state[get_instance_id()][scratch_index];
+    assert(ovector);
 
     int result = pcre_exec(
         pcre_data->re,  /* result of pcre_compile() */
@@ -364,8 +522,33 @@ static bool pcre_search(
         len,            /* the length of the subject string */
         start_offset,   /* start at offset 0 in the subject */
         0,              /* options(handled at compile time */
-        (int*)ss[scratch_index], /* vector for substring information */
-        p->context->conf->pcre_ovector_size); /* number of elements in the vector */
+        ovector,        /* vector for substring information */
+        sc->pcre_ovector_size); /* number of elements in the vector */
+
+#ifdef USE_PCRE_JIT
+    if ( pcre_data->jit )
+    {
+        pc.pcre_jit_searches++;
+
+        if ( result == PCRE_ERROR_JIT_STACKLIMIT )
+        {
+            pc.pcre_jit_stack_limit++;
+
+            if ( sc->pcre_jit_fallback )
+            {
+                // rerun with the interpreter using the same study data
+                pcre_extra pe = *pcre_data->pe;
+                pe.flags &= ~PCRE_EXTRA_EXECUTABLE_JIT;
+                pc.pcre_interp_searches++;
+
+                result = pcre_exec(pcre_data->re, &pe, (const char*)buf, len,
+                    start_offset, 0, ovector, sc->pcre_ovector_size);
+            }
+        }
+    }
+    else
+#endif
+        pc.pcre_interp_searches++;
 
     if (result >= 0)
     {
@@ -390,7 +573,7 @@ static bool pcre_search(
          * and a single int for scratch space.
          */
 
-        found_offset = ((int*)ss[scratch_index])[1];
+        found_offset = ovector[1];
     }
     else if (result == PCRE_ERROR_NOMATCH)
     {
@@ -464,16 +647,8 @@ PcreOption::~PcreOption()
     if ( config->expression )
         snort_free(config->expression);
 
-    if ( config->pe )
-    {
-        if ( config->free_pe )
-            snort_free(config->pe);
-        else
-            pcre_release(config->pe);
-    }
-
-    if ( config->re )
-        free(config->re);  // external allocation
+    if ( config->code )
+        release_code(config->code);
 
     snort_free(config);
 }
@@ -614,16 +789,6 @@ static const Parameter s_params[] =
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
-struct PcreStats
-{
-    PegCount pcre_rules;
-#ifdef HAVE_HYPERSCAN
-    PegCount pcre_to_hyper;
-#endif
-    PegCount pcre_native;
-    PegCount pcre_negated;
-};
-
 const PegInfo pcre_pegs[] =
 {
     { CountType::SUM, "pcre_rules", "total rules processed with pcre option" },
@@ -632,11 +797,12 @@ const PegInfo pcre_pegs[] =
 #endif
     { CountType::SUM, "pcre_native", "total pcre rules compiled by pcre engine" },
     { CountType::SUM, "pcre_negated", "total pcre rules using negation syntax" },
+    { CountType::SUM, "pcre_jit_compiled", "total pcre expressions jit compiled" },
+    { CountType::SUM, "pcre_jit_failures", "total pcre expressions that failed jit compilation" },
+    { CountType::SUM, "pcre_shared", "total pcre rules sharing a previously compiled expression" },
     { CountType::END, nullptr, nullptr }
 };
 
-PcreStats pcre_stats;
-
 #define s_help \
     "rule option for matching payload data with pcre"
 
@@ -648,12 +814,16 @@ public:
         data = nullptr;
         scratcher = new SimpleScratchAllocator(scratch_setup, scratch_cleanup);
         scratch_index = scratcher->get_id();
+
+        jit_scratcher = new SimpleScratchAllocator(jit_scratch_setup, jit_scratch_cleanup);
+        jit_scratch_index = jit_scratcher->get_id();
     }
 
     ~PcreModule() override
     {
         delete data;
         delete scratcher;
+        delete jit_scratcher;
     }
 
 #ifdef HAVE_HYPERSCAN
@@ -668,6 +838,10 @@ public:
     const PegInfo* get_pegs() const override;
     PegCount* get_counts() const override;
 
+    // pcre_stats is shared by all threads
+    bool snapshot_stats() const override
+    { return false; }
+
     PcreData* get_data();
 
     Usage get_usage() const override
@@ -683,6 +857,9 @@ private:
 
     static bool scratch_setup(SnortConfig*);
     static void scratch_cleanup(SnortConfig*);
+
+    static bool jit_scratch_setup(SnortConfig*);
+    static void jit_scratch_cleanup(SnortConfig*);
 };
 
 PcreData* PcreModule::get_data()
@@ -774,6 +951,47 @@ void PcreModule::scratch_cleanup(SnortConfig* sc)
     }
 }
 
+bool PcreModule::jit_scratch_setup(SnortConfig* sc)
+{
+#ifdef USE_PCRE_JIT
+    if ( !s_jit_used )
+        return false;
+
+    s_jit_used = false;
+
+    // without a stack pcre uses 32K on the machine stack
+    const int start_size = 32 * 1024;
+    const int max_size = sc->pcre_jit_stack * 1024;
+
+    for ( unsigned i = 0; i < sc->num_slots; ++i )
+    {
+        std::vector<void *>& ss = sc->state[i];
+        ss[jit_scratch_index] = pcre_jit_stack_alloc(start_size, max_size);
+    }
+    return true;
+#else
+    UNUSED(sc);
+    return false;
+#endif
+}
+
+void PcreModule::jit_scratch_cleanup(SnortConfig* sc)
+{
+#ifdef USE_PCRE_JIT
+    for ( unsigned i = 0; i < sc->num_slots; ++i )
+    {
+        std::vector<void *>& ss = sc->state[i];
+
+        if ( ss[jit_scratch_index] )
+            pcre_jit_stack_free((pcre_jit_stack*)ss[jit_scratch_index]);
+
+        ss[jit_scratch_index] = nullptr;
+    }
+#else
+    UNUSED(sc);
+#endif
+}
+
 //-------------------------------------------------------------------------
 // api methods
 //-------------------------------------------------------------------------
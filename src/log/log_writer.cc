@@ -0,0 +1,393 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// log_writer.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "log_writer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utils/util.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+const PegInfo log_writer_pegs[] =
+{
+    { CountType::SUM, "writer_buffers", "log buffers queued for writer threads" },
+    { CountType::SUM, "writer_bytes", "log bytes queued for writer threads" },
+    { CountType::SUM, "writer_drops", "log buffers dropped because a writer queue was full" },
+    { CountType::SUM, "writer_waits", "times a packet thread waited for a full writer queue" },
+    { CountType::MAX, "writer_max_depth", "maximum buffers pending in a writer queue" },
+    { CountType::END, nullptr, nullptr }
+};
+
+THREAD_LOCAL LogWriterStats log_writer_stats;
+
+//-------------------------------------------------------------------------
+// queue
+//-------------------------------------------------------------------------
+
+struct LogBuffer
+{
+    char* data;
+    unsigned len;
+};
+
+class Writer;
+
+// the packet thread only moves head and the writer only moves tail
+class LogQueue
+{
+public:
+    LogQueue(unsigned max, bool drop, LogWriter::WriteFunc f, void* u) :
+        write(f), user(u), drop(drop)
+    {
+        size = 1;
+        while ( size < max )
+            size <<= 1;
+
+        ring = new LogBuffer[size];
+    }
+
+    ~LogQueue()
+    {
+        assert(head == tail);
+        delete[] ring;
+    }
+
+    bool push(const char*, unsigned, bool boundary);
+    bool pop();
+
+    Writer* writer = nullptr;
+
+private:
+    LogWriter::WriteFunc write;
+    void* user;
+
+    LogBuffer* ring;
+    unsigned size;
+
+    std::atomic<unsigned> head { 0 };
+    std::atomic<unsigned> tail { 0 };
+
+    bool drop;
+    bool partial = false;  // part of the current record was queued
+};
+
+//-------------------------------------------------------------------------
+// writer threads
+//-------------------------------------------------------------------------
+
+class Writer
+{
+public:
+    Writer()
+    { thread = new std::thread(&Writer::run, this); }
+
+    ~Writer();
+
+    void add(LogQueue*);
+    void remove(LogQueue*);
+
+    void wake()
+    { cv.notify_one(); }
+
+private:
+    void run();
+
+private:
+    std::thread* thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<LogQueue*> queues;
+    bool running = true;
+};
+
+Writer::~Writer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    cv.notify_one();
+    thread->join();
+    delete thread;
+}
+
+void Writer::add(LogQueue* q)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    queues.emplace_back(q);
+}
+
+void Writer::remove(LogQueue* q)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    while ( q->pop() )
+        ;
+
+    queues.erase(std::remove(queues.begin(), queues.end(), q), queues.end());
+}
+
+void Writer::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while ( running )
+    {
+        bool busy = false;
+
+        for ( auto* q : queues )
+        {
+            while ( q->pop() )
+                busy = true;
+        }
+
+        // producers only wake us when a queue goes from empty to not empty
+        // and may race with the check above, so don't sleep for long
+        if ( !busy )
+            cv.wait_for(lock, std::chrono::milliseconds(10));
+
+        // let attach and detach in while the queues are busy
+        else
+        {
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+// queue methods
+//-------------------------------------------------------------------------
+
+bool LogQueue::push(const char* buf, unsigned len, bool boundary)
+{
+    unsigned h = head.load(std::memory_order_relaxed);
+    unsigned depth = h - tail.load(std::memory_order_acquire);
+
+    if ( depth >= size )
+    {
+        // a record can only be dropped whole
+        if ( drop and boundary and !partial )
+        {
+            log_writer_stats.drops++;
+            return false;
+        }
+        log_writer_stats.waits++;
+
+        do
+        {
+            writer->wake();
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            depth = h - tail.load(std::memory_order_acquire);
+        }
+        while ( depth >= size );
+    }
+
+    LogBuffer& lb = ring[h & (size - 1)];
+    lb.data = (char*)snort_alloc(len);
+    lb.len = len;
+    memcpy(lb.data, buf, len);
+
+    head.store(h + 1, std::memory_order_release);
+    partial = !boundary;
+
+    log_writer_stats.buffers++;
+    log_writer_stats.bytes += len;
+
+    if ( ++depth > log_writer_stats.max_depth )
+        log_writer_stats.max_depth = depth;
+
+    if ( depth == 1 )
+        writer->wake();
+
+    return true;
+}
+
+bool LogQueue::pop()
+{
+    unsigned t = tail.load(std::memory_order_relaxed);
+
+    if ( t == head.load(std::memory_order_acquire) )
+        return false;
+
+    LogBuffer& lb = ring[t & (size - 1)];
+    write(user, lb.data, lb.len);
+    snort_free(lb.data);
+
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// pool
+//-------------------------------------------------------------------------
+
+static std::mutex pool_mutex;
+static std::vector<Writer*> writers;
+static unsigned attached = 0;
+static unsigned next_writer = 0;
+
+LogQueue* LogWriter::attach(const LogWriterConfig& cfg, WriteFunc f, void* user)
+{
+    if ( !cfg.threads )
+        return nullptr;
+
+    LogQueue* q = new LogQueue(cfg.queue, cfg.drop, f, user);
+    std::lock_guard<std::mutex> lock(pool_mutex);
+
+    // the writers are started with the first log and stopped with the last
+    if ( writers.empty() )
+    {
+        for ( unsigned i = 0; i < cfg.threads; ++i )
+            writers.emplace_back(new Writer);
+    }
+
+    q->writer = writers[next_writer++ % writers.size()];
+    q->writer->add(q);
+    ++attached;
+
+    return q;
+}
+
+void LogWriter::detach(LogQueue* q)
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    q->writer->remove(q);
+    delete q;
+
+    if ( --attached )
+        return;
+
+    for ( auto* w : writers )
+        delete w;
+
+    writers.clear();
+    next_writer = 0;
+}
+
+bool LogWriter::push(LogQueue* q, const char* buf, unsigned len, bool boundary)
+{ return q->push(buf, len, boundary); }
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+static void append(void* user, const char* buf, unsigned len)
+{ ((std::string*)user)->append(buf, len); }
+
+TEST_CASE("log writer disabled", "[log_writer]")
+{
+    LogWriterConfig cfg;
+    std::string s;
+    CHECK(LogWriter::attach(cfg, append, &s) == nullptr);
+}
+
+TEST_CASE("log writer preserves order", "[log_writer]")
+{
+    LogWriterConfig cfg;
+    cfg.threads = 2;
+    cfg.queue = 4;
+
+    std::string a, b;
+    LogQueue* qa = LogWriter::attach(cfg, append, &a);
+    LogQueue* qb = LogWriter::attach(cfg, append, &b);
+
+    REQUIRE(qa);
+    REQUIRE(qb);
+
+    std::string expect;
+
+    for ( unsigned i = 0; i < 1000; ++i )
+    {
+        std::string rec = std::to_string(i) + ",";
+        CHECK(LogWriter::push(qa, rec.c_str(), rec.size(), true));
+        CHECK(LogWriter::push(qb, rec.c_str(), rec.size(), i % 2));
+        expect += rec;
+    }
+    LogWriter::detach(qa);
+    LogWriter::detach(qb);
+
+    CHECK(a == expect);
+    CHECK(b == expect);
+}
+
+static void slow_append(void* user, const char* buf, unsigned len)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    append(user, buf, len);
+}
+
+TEST_CASE("log writer drops whole records", "[log_writer]")
+{
+    LogWriterConfig cfg;
+    cfg.threads = 1;
+    cfg.queue = 2;
+    cfg.drop = true;
+
+    std::string s;
+    LogQueue* q = LogWriter::attach(cfg, slow_append, &s);
+    REQUIRE(q);
+
+    PegCount drops = log_writer_stats.drops;
+    unsigned dropped = 0;
+
+    for ( unsigned i = 0; i < 50; ++i )
+    {
+        // the first part of each record must not be dropped
+        // so the last part never is either
+        CHECK(LogWriter::push(q, "<", 1, false));
+        CHECK(LogWriter::push(q, ">", 1, true));
+
+        if ( !LogWriter::push(q, "x", 1, true) )
+            ++dropped;
+    }
+    LogWriter::detach(q);
+
+    CHECK(log_writer_stats.drops - drops == dropped);
+    CHECK(dropped > 0);
+    CHECK(s.size() == 100 + 50 - dropped);
+
+    for ( unsigned i = 0; i < s.size(); ++i )
+    {
+        if ( s[i] == '<' )
+            CHECK(s[i + 1] == '>');
+    }
+}
+
+#endif
+
@@ -0,0 +1,73 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// log_writer.h
+
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+// LogWriter moves file output off the packet threads.  Each attached log gets
+// a bounded single producer, single consumer queue of formatted buffers which
+// is drained by exactly one writer thread, so the output of each log stays in
+// the order it was produced.  When a queue is full the producer either waits
+// for the writer or drops the buffer, depending on the configuration.
+
+#include "framework/counts.h"
+#include "main/thread.h"
+
+struct LogWriterConfig
+{
+    unsigned threads = 0;  // 0 disables the writers
+    unsigned queue = 256;  // max buffers pending per log
+    bool drop = false;     // drop instead of wait when a queue is full
+};
+
+struct LogWriterStats
+{
+    PegCount buffers;
+    PegCount bytes;
+    PegCount drops;
+    PegCount waits;
+    PegCount max_depth;
+};
+
+extern const PegInfo log_writer_pegs[];
+extern THREAD_LOCAL LogWriterStats log_writer_stats;
+
+class LogQueue;
+
+class LogWriter
+{
+public:
+    // called on the writer thread with each buffer in order
+    using WriteFunc = void (*)(void* user, const char* buf, unsigned len);
+
+    // returns nullptr if the writers are disabled
+    static LogQueue* attach(const LogWriterConfig&, WriteFunc, void* user);
+
+    // writes everything still queued before returning
+    static void detach(LogQueue*);
+
+    // copies the buffer to the queue; returns false if it was dropped.
+    // record boundaries may be dropped per the config, partial records
+    // are always queued so the output stays well formed.
+    static bool push(LogQueue*, const char* buf, unsigned len, bool boundary);
+};
+
+#endif
+
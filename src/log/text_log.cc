@@ -36,9 +36,11 @@
 #include <algorithm>
 #include <cstdarg>
 
+#include "main/snort_config.h"
 #include "utils/util.h"
 
 #include "log.h"
+#include "log_writer.h"
 
 using namespace snort;
 
@@ -56,6 +58,9 @@ struct TextLog
     size_t maxFile;
     time_t last;
 
+/* set when the file is written by a writer thread */
+    LogQueue* queue;
+
 /* buffer attributes: */
     unsigned int pos;
     unsigned int maxBuf;
@@ -97,6 +102,49 @@ static size_t TextLog_Size(FILE* file)
     return err ? 0 : sbuf.st_size;
 }
 
+/*-------------------------------------------------------------------
+ * TextLog_Roll: start writing to new file
+ * but don't roll over stdout or any sooner
+ * than resolution of filename discriminator
+ *-------------------------------------------------------------------
+ */
+static void TextLog_Roll(TextLog* const txt)
+{
+    if ( txt->file == stdout )
+        return;
+    if ( txt->last >= time(nullptr) )
+        return;
+
+    TextLog_Close(txt->file);
+    RollAlertFile(txt->name);
+    txt->file = TextLog_Open(txt->name);
+
+    txt->last = time(nullptr);
+    txt->size = 0;
+}
+
+/*-------------------------------------------------------------------
+ * TextLog_WriteFile: write to the file, rolling it first if needed
+ * called by a writer thread for async logs
+ *-------------------------------------------------------------------
+ */
+static bool TextLog_WriteFile(TextLog* const txt, const char* buf, unsigned len)
+{
+    if ( txt->maxFile and txt->size + len > txt->maxFile )
+        TextLog_Roll(txt);
+
+    if ( fwrite(buf, len, 1, txt->file) != 1 )
+        return false;
+
+    txt->size += len;
+    return true;
+}
+
+static void TextLog_WriteAsync(void* user, const char* buf, unsigned len)
+{
+    TextLog_WriteFile((TextLog*)user, buf, len);
+}
+
 namespace snort
 {
 int TextLog_Avail(TextLog* const txt)
@@ -115,7 +163,7 @@ void TextLog_Reset(TextLog* const txt)
  *-------------------------------------------------------------------
  */
 TextLog* TextLog_Init(
-    const char* name, unsigned int maxBuf, size_t maxFile)
+    const char* name, unsigned int maxBuf, size_t maxFile, bool async)
 {
     TextLog* txt;
 
@@ -133,70 +181,73 @@ TextLog* TextLog_Init(
     txt->maxBuf = maxBuf;
     TextLog_Reset(txt);
 
+    txt->queue = nullptr;
+
+    if ( async )
+    {
+        const SnortConfig* sc = SnortConfig::get_conf();
+        LogWriterConfig cfg;
+
+        cfg.threads = sc->log_writers;
+        cfg.queue = sc->log_writer_queue;
+        cfg.drop = sc->log_writer_drop;
+
+        txt->queue = LogWriter::attach(cfg, TextLog_WriteAsync, txt);
+    }
+
     return txt;
 }
 
 /*-------------------------------------------------------------------
- * TextLog_Term: destructor
+ * TextLog_Flush: write buffered stream to file
+ * callers flush at the end of each record so an async log may drop
+ * it here; flushes of a full buffer mid record are never dropped
  *-------------------------------------------------------------------
  */
-void TextLog_Term(TextLog* const txt)
+static bool TextLog_Send(TextLog* const txt, bool boundary)
 {
-    if ( !txt )
-        return;
+    if ( !txt->pos )
+        return false;
 
-    TextLog_Flush(txt);
-    TextLog_Close(txt->file);
+    if ( txt->queue )
+    {
+        bool ok = LogWriter::push(txt->queue, txt->buf, txt->pos, boundary);
+        TextLog_Reset(txt);
+        return ok;
+    }
 
-    if ( txt->name )
-        snort_free(txt->name);
-    snort_free(txt);
+    if ( !TextLog_WriteFile(txt, txt->buf, txt->pos) )
+        return false;
+
+    TextLog_Reset(txt);
+    return true;
 }
 
-/*-------------------------------------------------------------------
- * TextLog_Flush: start writing to new file
- * but don't roll over stdout or any sooner
- * than resolution of filename discriminator
- *-------------------------------------------------------------------
- */
-static void TextLog_Roll(TextLog* const txt)
+bool TextLog_Flush(TextLog* const txt)
 {
-    if ( txt->file == stdout )
-        return;
-    if ( txt->last >= time(nullptr) )
-        return;
-
-    TextLog_Close(txt->file);
-    RollAlertFile(txt->name);
-    txt->file = TextLog_Open(txt->name);
-
-    txt->last = time(nullptr);
-    txt->size = 0;
+    return TextLog_Send(txt, true);
 }
 
 /*-------------------------------------------------------------------
- * TextLog_Flush: write buffered stream to file
+ * TextLog_Term: destructor
  *-------------------------------------------------------------------
  */
-bool TextLog_Flush(TextLog* const txt)
+void TextLog_Term(TextLog* const txt)
 {
-    int ok;
+    if ( !txt )
+        return;
 
-    if ( !txt->pos )
-        return false;
+    // don't drop the tail on the way out
+    TextLog_Send(txt, false);
 
-    if ( txt->maxFile and txt->size + txt->pos > txt->maxFile )
-        TextLog_Roll(txt);
+    if ( txt->queue )
+        LogWriter::detach(txt->queue);
 
-    ok = fwrite(txt->buf, txt->pos, 1, txt->file);
+    TextLog_Close(txt->file);
 
-    if ( ok == 1 )
-    {
-        txt->size += txt->pos;
-        TextLog_Reset(txt);
-        return true;
-    }
-    return false;
+    if ( txt->name )
+        snort_free(txt->name);
+    snort_free(txt);
 }
 
 /*-------------------------------------------------------------------
@@ -207,7 +258,7 @@ bool TextLog_Putc(TextLog* const txt, char c)
 {
     if ( TextLog_Avail(txt) < 1 )
     {
-        TextLog_Flush(txt);
+        TextLog_Send(txt, false);
     }
     txt->buf[txt->pos++] = c;
     txt->buf[txt->pos] = '\0';
@@ -237,7 +288,7 @@ bool TextLog_Write(TextLog* const txt, const char* str, int len)
         len -= l;
 
         if ( n >= avail )
-            TextLog_Flush(txt);
+            TextLog_Send(txt, false);
     }
     while ( len > 0 );
 
@@ -260,7 +311,7 @@ bool TextLog_Print(TextLog* const txt, const char* fmt, ...)
 
     if ( len >= avail )
     {
-        TextLog_Flush(txt);
+        TextLog_Send(txt, false);
         avail = TextLog_Avail(txt);
 
         va_start(ap, fmt);
@@ -32,6 +32,10 @@
  * that, the file is closed, renamed, and reopened.  The current
  * file always has the same name.  Old files are renamed to that
  * name plus a timestamp.
+ *
+ * Logs opened with async true hand their buffers to the output
+ * writer threads when output.writers is configured; otherwise
+ * they are written by the calling thread.
  */
 
 #include <cstring>
@@ -49,7 +53,7 @@ struct TextLog;
 namespace snort
 {
 SO_PUBLIC TextLog* TextLog_Init(
-    const char* name, unsigned int maxBuf = 0, size_t maxFile = 0);
+    const char* name, unsigned int maxBuf = 0, size_t maxFile = 0, bool async = false);
 SO_PUBLIC void TextLog_Term(TextLog*);
 
 SO_PUBLIC bool TextLog_Putc(TextLog* const, char);
@@ -615,7 +615,7 @@ CsvLogger::CsvLogger(CsvModule* m)
 
 void CsvLogger::open()
 {
-    csv_log = TextLog_Init(file.c_str(), LOG_BUFFER, limit);
+    csv_log = TextLog_Init(file.c_str(), LOG_BUFFER, limit, true);
 }
 
 void CsvLogger::close()
@@ -34,6 +34,7 @@
 #include "detection/signature.h"
 #include "detection/detection_util.h"
 #include "events/event.h"
+#include "framework/data_bus.h"
 #include "framework/logger.h"
 #include "framework/module.h"
 #include "log/messages.h"
@@ -48,10 +49,16 @@
 #include "protocols/packet.h"
 #include "protocols/vlan.h"
 #include "stream/stream.h"
+#include "time/clock_defs.h"
+#include "time/stopwatch.h"
 #include "utils/safec.h"
 #include "utils/util.h"
 #include "utils/util_cstring.h"
 
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
 using namespace snort;
 using namespace std;
 
@@ -63,6 +70,8 @@ using namespace std;
 struct Unified2Config
 {
     size_t limit;
+    uint32_t buffer_size;
+    unsigned flush_interval;
     int nostamp;
     bool legacy_events;
 };
@@ -74,11 +83,26 @@ struct U2
     int base_proto;
     uint32_t timestamp;
     char filepath[STD_BUF];
+
+    // buffered mode only
+    uint8_t* buffer;
+    uint32_t buffered;
+    time_t last_flush;
+    Unified2Config* config;
+};
+
+struct U2Stats
+{
+    PegCount bytes_buffered;
+    PegCount flushes;
+    PegCount write_usecs;
+    PegCount max_write_usecs;
 };
 
 /* -------------------- Global Variables ----------------------*/
 
 static THREAD_LOCAL U2 u2;
+static THREAD_LOCAL U2Stats u2_stats;
 
 /* Used for buffering header and payload of unified records so only one
  * write is necessary. */
@@ -102,6 +126,7 @@ static THREAD_LOCAL char* io_buffer = nullptr;
 /* -------------------- Local Functions -----------------------*/
 
 static void Unified2Write(uint8_t*, uint32_t, Unified2Config*);
+static void Unified2Flush(Unified2Config*);
 
 static void Unified2InitFile(Unified2Config* config)
 {
@@ -143,6 +168,7 @@ static void Unified2InitFile(Unified2Config* config)
 
 static inline void Unified2RotateFile(Unified2Config* config)
 {
+    Unified2Flush(config);
     fclose(u2.stream);
     u2.current = 0;
     Unified2InitFile(config);
@@ -414,9 +440,9 @@ static void _Unified2LogPacketAlert(
 }
 
 /******************************************************************************
- * Function: Unified2Write()
+ * Function: Unified2WriteFile()
  *
- * Main function for writing to the unified2 file.
+ * Low level function for writing to the unified2 file.
  *
  * For low level I/O errors, the current unified2 file is closed and a new
  * one created and a write to the new unified2 file is done.  It was found
@@ -429,9 +455,8 @@ static void _Unified2LogPacketAlert(
  *
  * All other errors are treated as non-recoverable and Snort will fatal error.
  *
- * Upon successful completion of write, the length of the data written is
- * added to the current amount of total data written thus far to the
- * unified2 file.
+ * The caller is responsible for tracking the amount of data written thus far
+ * to the unified2 file.
  *
  * Arguments
  *  uint8_t *
@@ -444,13 +469,11 @@ static void _Unified2LogPacketAlert(
  * Returns: None
  *
  ******************************************************************************/
-static void Unified2Write(uint8_t* buf, uint32_t buf_len, Unified2Config* config)
+static void Unified2WriteFile(const uint8_t* buf, uint32_t buf_len, Unified2Config* config)
 {
     size_t fwcount = 0;
-
-    /* Nothing to write or nothing to write to */
-    if ((buf == nullptr) || (config == nullptr) || (u2.stream == nullptr))
-        return;
+    Stopwatch<SnortClock> timer;
+    timer.start();
 
     /* Don't use fsync().  It is a total performance killer */
     if (((fwcount = fwrite(buf, (size_t)buf_len, 1, u2.stream)) != 1) ||
@@ -574,6 +597,82 @@ static void Unified2Write(uint8_t* buf, uint32_t buf_len, Unified2Config* config
         }
     }
 
+    PegCount usecs = TO_USECS(timer.get());
+    u2_stats.write_usecs += usecs;
+
+    if ( usecs > u2_stats.max_write_usecs )
+        u2_stats.max_write_usecs = usecs;
+}
+
+// the buffer is detached before writing so that a rotation due to a write
+// error doesn't flush it again
+static void Unified2Flush(Unified2Config* config)
+{
+    if ( !u2.buffered )
+        return;
+
+    uint32_t len = u2.buffered;
+    u2.buffered = 0;
+    u2.last_flush = time(nullptr);
+
+    Unified2WriteFile(u2.buffer, len, config);
+    u2_stats.flushes++;
+}
+
+static void Unified2FlushExpired(Unified2Config* config)
+{
+    if ( config->flush_interval and u2.buffered and
+        time(nullptr) - u2.last_flush >= (time_t)config->flush_interval )
+        Unified2Flush(config);
+}
+
+// records buffered while alerts are sparse would otherwise wait for the
+// next write, so the packet threads check the interval when idle and on
+// each new second of packet time
+class U2FlushHandler : public DataHandler
+{
+public:
+    U2FlushHandler() : DataHandler(S_NAME) { }
+
+    void handle(DataEvent&, Flow*) override
+    {
+        if ( u2.config )
+            Unified2FlushExpired(u2.config);
+    }
+};
+
+// with buffering, complete records are accumulated and written together
+// (event, packet, and extra data records typically go out in one write) so
+// spoolers still never see a partial record
+static void Unified2Write(uint8_t* buf, uint32_t buf_len, Unified2Config* config)
+{
+    /* Nothing to write or nothing to write to */
+    if ((buf == nullptr) || (config == nullptr) || (u2.stream == nullptr))
+        return;
+
+    if ( !u2.buffer )
+    {
+        Unified2WriteFile(buf, buf_len, config);
+        u2_stats.flushes++;
+    }
+    else
+    {
+        if ( u2.buffered + buf_len > config->buffer_size )
+            Unified2Flush(config);
+
+        if ( buf_len > config->buffer_size )
+        {
+            Unified2WriteFile(buf, buf_len, config);
+            u2_stats.flushes++;
+        }
+        else
+        {
+            memcpy(u2.buffer + u2.buffered, buf, buf_len);
+            u2.buffered += buf_len;
+            u2_stats.bytes_buffered += buf_len;
+            Unified2FlushExpired(config);
+        }
+    }
     u2.current += buf_len;
 }
 
@@ -792,6 +891,12 @@ static const Parameter s_params[] =
     { "legacy_events", Parameter::PT_BOOL, nullptr, "false",
       "generate Snort 2.X style events for barnyard2 compatibility" },
 
+    { "buffer_size", Parameter::PT_INT, "0:65536", "0",
+      "size of per thread write buffer in KB (0 writes each record immediately)" },
+
+    { "flush_interval", Parameter::PT_INT, "0:max32", "1",
+      "maximum seconds to hold buffered records (0 flushes only when the buffer is full)" },
+
     { "limit", Parameter::PT_INT, "0:maxSZ", "0",
       "set maximum size in MB before rollover (0 is unlimited)" },
 
@@ -804,6 +909,15 @@ static const Parameter s_params[] =
 #define s_help \
     "output event and packet in unified2 format file"
 
+static const PegInfo u2_pegs[] =
+{
+    { CountType::SUM, "bytes_buffered", "total bytes of records buffered before writing" },
+    { CountType::SUM, "flushes", "total writes to the unified2 file" },
+    { CountType::SUM, "write_usecs", "total time spent writing to the unified2 file" },
+    { CountType::MAX, "max_write_usecs", "maximum time spent on a single write" },
+    { CountType::END, nullptr, nullptr }
+};
+
 class U2Module : public Module
 {
 public:
@@ -811,12 +925,21 @@ public:
 
     bool set(const char*, Value&, SnortConfig*) override;
     bool begin(const char*, int, SnortConfig*) override;
+    bool end(const char*, int, SnortConfig*) override;
+
+    const PegInfo* get_pegs() const override
+    { return u2_pegs; }
+
+    PegCount* get_counts() const override
+    { return (PegCount*)&u2_stats; }
 
     Usage get_usage() const override
     { return GLOBAL; }
 
 public:
     size_t limit = 0;
+    uint32_t buffer_size = 0;
+    unsigned flush_interval = 1;
     bool nostamp = true;
     bool legacy_events = false;
 };
@@ -826,6 +949,12 @@ bool U2Module::set(const char*, Value& v, SnortConfig*)
     if ( v.is("limit") )
         limit = v.get_size() * 1024 * 1024;
 
+    else if ( v.is("buffer_size") )
+        buffer_size = v.get_uint32() * 1024;
+
+    else if ( v.is("flush_interval") )
+        flush_interval = v.get_uint32();
+
     else if ( v.is("nostamp") )
         nostamp = v.get_bool();
 
@@ -841,11 +970,23 @@ bool U2Module::set(const char*, Value& v, SnortConfig*)
 bool U2Module::begin(const char*, int, SnortConfig* sc)
 {
     limit = 0;
+    buffer_size = 0;
+    flush_interval = 1;
     nostamp = sc->output_no_timestamp();
     legacy_events = false;
     return true;
 }
 
+bool U2Module::end(const char*, int, SnortConfig* sc)
+{
+    if ( buffer_size and flush_interval )
+    {
+        DataBus::subscribe_global(THREAD_IDLE_EVENT, new U2FlushHandler, sc);
+        DataBus::subscribe_global(THREAD_TICK_EVENT, new U2FlushHandler, sc);
+    }
+    return true;
+}
+
 //-------------------------------------------------------------------------
 // logger stuff
 //-------------------------------------------------------------------------
@@ -872,6 +1013,8 @@ private:
 U2Logger::U2Logger(U2Module* m)
 {
     config.limit = m->limit;
+    config.buffer_size = m->buffer_size;
+    config.flush_interval = m->flush_interval;
     config.nostamp = m->nostamp;
     config.legacy_events = m->legacy_events;
 }
@@ -896,6 +1039,14 @@ void U2Logger::open()
     write_pkt_buffer = new uint8_t[u2_buf_sz];
     io_buffer = new char[u2_buf_sz];
 
+    if ( config.buffer_size )
+    {
+        u2.buffer = new uint8_t[config.buffer_size];
+        u2.buffered = 0;
+        u2.last_flush = time(nullptr);
+        u2.config = &config;
+    }
+
     Unified2InitFile(&config);
 
     Stream::reg_xtra_data_log(AlertExtraData, &config);
@@ -904,13 +1055,19 @@ void U2Logger::open()
 void U2Logger::close()
 {
     if ( u2.stream )
+    {
+        Unified2Flush(&config);
         fclose(u2.stream);
+    }
 
     delete[] write_pkt_buffer;
     delete[] io_buffer;
+    delete[] u2.buffer;
 
     write_pkt_buffer = nullptr;
     io_buffer = nullptr;
+    u2.buffer = nullptr;
+    u2.config = nullptr;
 }
 
 void U2Logger::alert_legacy(Packet* p, const char* msg, const Event& event)
@@ -1040,3 +1197,46 @@ const BaseApi* eh_unified2[] =
     nullptr
 };
 
+#ifdef UNIT_TEST
+
+TEST_CASE("unified2 flushes buffered records after the interval", "[unified2]")
+{
+    Unified2Config config = { };
+    config.buffer_size = 64;
+    config.flush_interval = 2;
+
+    uint8_t buffer[64];
+    memset(buffer, 'x', sizeof(buffer));
+
+    u2.stream = tmpfile();
+    REQUIRE(u2.stream);
+    u2.buffer = buffer;
+    u2.buffered = 10;
+    u2.last_flush = time(nullptr);
+    u2.config = &config;
+
+    U2FlushHandler handler;
+    BareDataEvent e;
+
+    // held until the interval passes
+    handler.handle(e, nullptr);
+    CHECK(u2.buffered == 10);
+    CHECK(ftell(u2.stream) == 0);
+
+    u2.last_flush -= config.flush_interval;
+    handler.handle(e, nullptr);
+    CHECK(u2.buffered == 0);
+    CHECK(ftell(u2.stream) == 10);
+
+    // nothing is checked once the logger is closed
+    u2.buffered = 5;
+    u2.last_flush -= config.flush_interval;
+    u2.config = nullptr;
+    handler.handle(e, nullptr);
+    CHECK(u2.buffered == 5);
+
+    fclose(u2.stream);
+    u2 = { };
+}
+
+#endif
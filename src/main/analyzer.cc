@@ -340,6 +340,9 @@ void Analyzer::post_process_daq_pkt_msg(Packet* p)
         oops_handler->set_current_message(nullptr);
         p->pkth = nullptr;  // No longer avail after finalize_message.
 
+        if ( (p->packet_flags & PKT_RETAINED) and Stream::defer_verdict(p, verdict) )
+            return;
+
         {
             Profile profile(daqPerfStats);
             p->daq_instance->finalize_message(p->daq_msg, verdict);
@@ -381,6 +384,12 @@ void Analyzer::process_daq_pkt_msg(DAQ_Msg_h msg, bool retry)
 
     Stream::handle_timeouts(false);
     HighAvailabilityManager::process_receive();
+
+    if ( packet_time() != last_tick )
+    {
+        last_tick = packet_time();
+        DataBus::publish(THREAD_TICK_EVENT, nullptr);
+    }
 }
 
 void Analyzer::process_daq_msg(DAQ_Msg_h msg, bool retry)
@@ -791,6 +800,15 @@ void Analyzer::handle_uncompleted_commands()
     }
 }
 
+// Returns the number of messages not yet returned by next_message() whose flows were prefetched.
+unsigned Analyzer::prefetch_flows(unsigned num_done)
+{
+    unsigned num_pending;
+    const DAQ_Msg_h* pending = daq_instance->get_pending_messages(num_pending);
+    return Stream::prefetch_flows(pending, num_pending, num_done,
+        daq_instance->get_base_protocol());
+}
+
 DAQ_RecvStatus Analyzer::process_messages()
 {
     // Max receive becomes the minimum of the configured batch size, the remaining exit_after
@@ -811,10 +829,17 @@ DAQ_RecvStatus Analyzer::process_messages()
     // This conveniently handles servicing offloads in the no messages received case as well.
     DetectionEngine::onload();
 
+    // Keep the flow lookups for the next few messages started ahead of processing them.
+    unsigned num_prefetched = prefetch_flows(0);
+
     unsigned num_recv = 0;
     DAQ_Msg_h msg;
     while ((msg = daq_instance->next_message()) != nullptr)
     {
+        if (num_prefetched)
+            num_prefetched--;
+        num_prefetched = prefetch_flows(num_prefetched);
+
         // Dispose of any messages to be skipped first.
         if (skip_cnt > 0)
         {
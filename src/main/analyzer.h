@@ -118,6 +118,7 @@ private:
     void handle_commands();
     void handle_uncompleted_commands();
     DAQ_RecvStatus process_messages();
+    unsigned prefetch_flows(unsigned num_done);
     void process_daq_msg(DAQ_Msg_h, bool retry);
     void process_daq_pkt_msg(DAQ_Msg_h, bool retry);
     void post_process_daq_pkt_msg(snort::Packet*);
@@ -141,6 +142,7 @@ private:
     unsigned id;
     bool exit_requested = false;
     bool idling = false;
+    time_t last_tick = 0;
     uint64_t exit_after_cnt;
     uint64_t pause_after_cnt = 0;
     uint64_t skip_cnt = 0;
@@ -77,10 +77,8 @@ bool ACRotate::execute(Analyzer& analyzer, void**)
 
 bool ACGetStats::execute(Analyzer&, void**)
 {
-
-    // FIXIT-P This incurs locking on all threads to retrieve stats.  It
-    // could be reimplemented to optimize for large thread counts by
-    // retrieving stats in the command and accumulating in the main thread.
+    // counts are published per thread and merged by the main thread in
+    // DropStats() so this doesn't wait on the other packet threads
     ModuleManager::accumulate();
     return true;
 }
@@ -26,6 +26,8 @@
 
 #include <sys/resource.h>
 
+#include <lua.hpp>
+
 #include "codecs/codec_module.h"
 #include "detection/detection_module.h"
 #include "detection/fp_config.h"
@@ -40,7 +42,9 @@
 #include "host_tracker/host_tracker_module.h"
 #include "host_tracker/host_cache_module.h"
 #include "latency/latency_module.h"
+#include "log/log_writer.h"
 #include "log/messages.h"
+#include "main.h"
 #include "managers/module_manager.h"
 #include "managers/plugin_manager.h"
 #include "memory/memory_module.h"
@@ -54,6 +58,8 @@
 #include "parser/vars.h"
 #include "payload_injector/payload_injector_module.h"
 #include "profiler/profiler.h"
+#include "profiler/profiler_snapshot.h"
+#include "profiler/sample_profiler.h"
 #include "search_engines/pat_stats.h"
 #include "side_channel/side_channel_module.h"
 #include "sfip/sf_ipvar.h"
@@ -62,6 +68,7 @@
 #include "target_based/snort_protocols.h"
 #include "trace/trace_module.h"
 
+#include "analyzer_command.h"
 #include "snort_config.h"
 #include "snort_module.h"
 #include "thread_config.h"
@@ -148,6 +155,10 @@ static const Parameter search_engine_params[] =
     { "bleedover_warnings_enabled", Parameter::PT_BOOL, nullptr, "false",
       "print warning if a rule is demoted to any-any port group" },
 
+    { "cache_dir", Parameter::PT_STRING, nullptr, nullptr,
+      "directory for compiled search engines reused across starts and reloads "
+      "(ac_bnfa, ac_full, ac_full_simd, hyperscan)" },
+
     { "enable_single_rule_group", Parameter::PT_BOOL, nullptr, "false",
       "put all rules into one group" },
 
@@ -245,6 +256,9 @@ bool SearchEngineModule::set(const char*, Value& v, SnortConfig* sc)
         if ( v.get_bool() )
             fp->set_bleed_over_warnings();  // FIXIT-L these should take arg
     }
+    else if ( v.is("cache_dir") )
+        fp->set_cache_dir(v.get_string());
+
     else if ( v.is("enable_single_rule_group") )
     {
         if ( v.get_bool() )
@@ -368,6 +382,20 @@ static const Parameter profiler_rule_params[] =
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
+static const Parameter profiler_sample_params[] =
+{
+    { "show", Parameter::PT_BOOL, nullptr, "true",
+      "show sample profile stats" },
+
+    { "count", Parameter::PT_INT, "0:max32", "0",
+      "limit results to count items (0 = no limit)" },
+
+    { "rate", Parameter::PT_INT, "0:10000", "0",
+      "samples per second of packet thread cpu time (0 = disabled)" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
 static const Parameter profiler_params[] =
 {
     { "modules", Parameter::PT_TABLE, profiler_time_params, nullptr,
@@ -379,9 +407,61 @@ static const Parameter profiler_params[] =
     { "rules", Parameter::PT_TABLE, profiler_rule_params, nullptr,
       "rule time profiling" },
 
+    { "samples", Parameter::PT_TABLE, profiler_sample_params, nullptr,
+      "sampled module and rule profiling with folded stack output" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
+static const Parameter profiler_snapshot_params[] =
+{
+    { "format", Parameter::PT_ENUM, "text | json", "text",
+      "output format" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
+static int profiler_snapshot(lua_State* L, bool reset)
+{
+    SharedRequest request = get_current_request();
+    const ProfilerConfig* config = SnortConfig::get_conf()->get_profiler();
+
+    if ( !config->time.show and !config->rule.show )
+    {
+        request->respond("== profiler.modules and profiler.rules are not enabled\n");
+        return 0;
+    }
+
+    const char* format = L ? luaL_optstring(L, 1, "text") : "text";
+    bool json = !strcmp(format, "json");
+
+    if ( !json and strcmp(format, "text") )
+    {
+        request->respond("== format must be text or json\n");
+        return 0;
+    }
+
+    main_broadcast_command(new ACProfilerSnapshot(reset, json, request), L != nullptr);
+    return 0;
+}
+
+static int profiler_show(lua_State* L)
+{ return profiler_snapshot(L, false); }
+
+static int profiler_reset(lua_State* L)
+{ return profiler_snapshot(L, true); }
+
+static const Command profiler_cmds[] =
+{
+    { "show", profiler_show, profiler_snapshot_params,
+      "show module and rule profile stats collected so far or since the last reset" },
+
+    { "reset", profiler_reset, nullptr,
+      "start a new interval for profiler.show" },
+
+    { nullptr, nullptr, nullptr, nullptr }
+};
+
 #define profiler_help \
     "configure profiling of rules and/or modules"
 
@@ -413,6 +493,23 @@ static bool s_profiler_module_set(T& config, Value& v)
     return true;
 }
 
+static bool s_profiler_module_set_sample(SampleProfilerConfig& config, Value& v)
+{
+    if ( v.is("count") )
+        config.count = v.get_uint32();
+
+    else if ( v.is("show") )
+        config.show = v.get_bool();
+
+    else if ( v.is("rate") )
+        config.rate = v.get_uint32();
+
+    else
+        return false;
+
+    return true;
+}
+
 class ProfilerModule : public Module
 {
 public:
@@ -423,6 +520,9 @@ public:
 
     ProfileStats* get_profile(unsigned, const char*&, const char*&) const override;
 
+    const Command* get_commands() const override
+    { return profiler_cmds; }
+
     Usage get_usage() const override
     { return GLOBAL; }
 };
@@ -432,6 +532,7 @@ bool ProfilerModule::set(const char* fqn, Value& v, SnortConfig* sc)
     const char* spt = "profiler.modules";
     const char* spm = "profiler.memory";
     const char* spr = "profiler.rules";
+    const char* sps = "profiler.samples";
 
     if ( !strncmp(fqn, spt, strlen(spt)) )
         return s_profiler_module_set(sc->profiler->time, v);
@@ -442,13 +543,24 @@ bool ProfilerModule::set(const char* fqn, Value& v, SnortConfig* sc)
     else if ( !strncmp(fqn, spr, strlen(spr)) )
         return s_profiler_module_set(sc->profiler->rule, v);
 
+    else if ( !strncmp(fqn, sps, strlen(sps)) )
+        return s_profiler_module_set_sample(sc->profiler->sample, v);
+
     return false;
 }
 
-bool ProfilerModule::end(const char*, int, SnortConfig* sc)
+bool ProfilerModule::end(const char* fqn, int, SnortConfig* sc)
 {
+    if ( !strcmp(fqn, "profiler.samples") and sc->profiler->sample.rate and
+        !SampleProfiler::is_supported() )
+    {
+        ParseWarning(WARN_CONF, "profiler.samples not supported on this platform");
+        sc->profiler->sample.rate = 0;
+    }
+
     TimeProfilerStats::set_enabled(sc->profiler->time.show);
     RuleContext::set_enabled(sc->profiler->rule.show);
+    SampleStack::set_enabled(sc->profiler->sample.rate != 0);
     return true;
 }
 
@@ -734,6 +846,16 @@ static const Parameter output_params[] =
     { "verbose", Parameter::PT_BOOL, nullptr, "false",
       "be verbose (same as -v)" },
 
+    { "writers", Parameter::PT_INT, "0:32", "0",
+      "number of threads writing alert_fast, alert_full, alert_csv, and alert_json files; "
+      "0 writes them on the packet threads" },
+
+    { "writer_queue", Parameter::PT_INT, "1:max32", "256",
+      "maximum formatted buffers pending per log file for the writers" },
+
+    { "writer_drop", Parameter::PT_BOOL, nullptr, "false",
+      "drop records when a writer queue is full instead of waiting" },
+
     { "obfuscate", Parameter::PT_BOOL, nullptr, "false",
       "obfuscate the logged IP addresses (same as -O)" },
 
@@ -756,6 +878,12 @@ public:
     OutputModule() : Module("output", output_help, output_params) { }
     bool set(const char*, Value&, SnortConfig*) override;
 
+    const PegInfo* get_pegs() const override
+    { return log_writer_pegs; }
+
+    PegCount* get_counts() const override
+    { return (PegCount*)&log_writer_stats; }
+
     Usage get_usage() const override
     { return GLOBAL; }
 };
@@ -797,6 +925,15 @@ bool OutputModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("wide_hex_dump") )
         v.update_mask(sc->output_flags, OUTPUT_FLAG__WIDE_HEX);
 
+    else if ( v.is("writers") )
+        sc->log_writers = v.get_uint32();
+
+    else if ( v.is("writer_queue") )
+        sc->log_writer_queue = v.get_uint32();
+
+    else if ( v.is("writer_drop") )
+        sc->log_writer_drop = v.get_bool();
+
     else if ( v.is("obfuscate") )
         v.update_mask(sc->output_flags, OUTPUT_FLAG__OBFUSCATE);
 
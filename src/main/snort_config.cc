@@ -348,6 +348,7 @@ void SnortConfig::merge(SnortConfig* cmd_line)
     id_offset = cmd_line->id_offset;
     id_subdir = cmd_line->id_subdir;
     id_zero = cmd_line->id_zero;
+    hash_method = cmd_line->hash_method;
 
     /* Used because of a potential chroot */
     orig_log_dir = log_dir;
@@ -125,6 +125,15 @@ enum TunnelFlags
     TUNNEL_VXLAN  = 0x100
 };
 
+// hash function for HashKeyOperations; scalar unless configured otherwise,
+// auto picks crc if the cpu has it
+enum class HashMethod : uint8_t
+{
+    AUTO,
+    SCALAR,
+    CRC
+};
+
 enum DumpConfigType
 {
     DUMP_CONFIG_NONE = 0,
@@ -232,6 +241,10 @@ public:
     uint32_t tagged_packet_limit = 256;
     uint16_t event_trace_max = 0;
 
+    unsigned log_writers = 0;
+    unsigned log_writer_queue = 256;
+    bool log_writer_drop = false;
+
     std::string log_dir;
 
     //------------------------------------------------------
@@ -248,11 +261,17 @@ public:
     int pcre_ovector_size = 0;
     bool pcre_override = true;
 
+    bool pcre_jit = true;
+    bool pcre_jit_fallback = true;
+    unsigned pcre_jit_stack = 1024;  // KB
+
     int asn1_mem = 0;
     uint32_t run_flags = 0;
 
     unsigned offload_limit = 99999;  // disabled
     unsigned offload_threads = 0;    // disabled
+    unsigned offload_workers = 0;    // one thread per offload
+    bool offload_pool = false;       // workers per packet thread
 
 #ifdef HAVE_HYPERSCAN
     bool hyperscan_literals = false;
@@ -398,6 +417,8 @@ public:
 
     uint16_t tunnel_mask = 0;
 
+    HashMethod hash_method = HashMethod::SCALAR;
+
     // FIXIT-L this is temporary for legacy paf_max required only for HI;
     // it is not appropriate for multiple stream_tcp with different
     // paf_max; the HI splitter should pull from there
@@ -701,6 +722,9 @@ public:
     static bool static_hash()
     { return get_conf() && get_conf()->run_flags & RUN_FLAG__STATIC_HASH; }
 
+    static HashMethod get_hash_method()
+    { return get_conf() ? get_conf()->hash_method : HashMethod::SCALAR; }
+
     // This requests an entry in the scratch space vector and calls setup /
     // cleanup as appropriate
     SO_PUBLIC static int request_scratch(ScratchAllocator*);
@@ -375,6 +375,9 @@ static const Parameter s_params[] =
     { "--gen-msg-map", Parameter::PT_IMPLIED, nullptr, nullptr,
       "dump configured rules in gen-msg.map format for use by other tools" },
 
+    { "--hash-method", Parameter::PT_ENUM, "auto | scalar | crc", "scalar",
+      "<method> hash function for hash tables; auto uses crc if the cpu supports it" },
+
     { "--help", Parameter::PT_IMPLIED, nullptr, nullptr,
       "list command line options" },
 
@@ -923,6 +926,9 @@ bool SnortModule::set(const char*, Value& v, SnortConfig* sc)
         sc->output_flags |= OUTPUT_FLAG__ALERT_REFS;
         SnortConfig::set_log_quiet(true);
     }
+    else if ( v.is("--hash-method") )
+        sc->hash_method = (HashMethod)v.get_uint8();
+
     else if ( v.is("--help") )
         help_basic(sc, v.get_string());
 
@@ -1149,7 +1155,7 @@ bool SnortModule::set(const char*, Value& v, SnortConfig* sc)
 
 bool SnortModule::end(const char*, int, SnortConfig* sc)
 {
-    if ( sc->offload_threads and ThreadConfig::get_instance_max() != 1 )
+    if ( sc->offload_threads and !sc->offload_pool and ThreadConfig::get_instance_max() != 1 )
         ParseError("You can not enable experimental offload with more than one packet thread.");
 
     if ( no_warn_flowbits )
@@ -125,6 +125,7 @@ bool TimeProfilerStats::enabled = false;
 THREAD_LOCAL PacketCount pc;
 
 void packet_gettimeofday(struct timeval* tv) { *tv = s_packet_time; }
+time_t packet_time() { return s_packet_time.tv_sec; }
 MemoryContext::MemoryContext(MemoryTracker&) : saved(nullptr) { }
 MemoryContext::~MemoryContext() { }
 Packet::Packet(bool)
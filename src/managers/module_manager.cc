@@ -42,10 +42,13 @@
 #include "main/shell.h"
 #include "main/snort.h"
 #include "main/snort_config.h"
+#include "main/thread.h"
+#include "main/thread_config.h"
 #include "managers/inspector_manager.h"
 #include "parser/parse_conf.h"
 #include "parser/parser.h"
 #include "profiler/profiler.h"
+#include "utils/peg_snapshot.h"
 #include "utils/util.h"
 
 #include "plugin_manager.h"
@@ -62,6 +65,10 @@ struct ModHook
     const BaseApi* api;
     luaL_Reg* reg;
 
+    // counts published by packet threads and the totals last merged
+    PegSnapshot* snapshot = nullptr;
+    std::vector<PegCount> collected;
+
     ModHook(Module*, const BaseApi*);
     ~ModHook();
 
@@ -124,6 +131,8 @@ ModHook::~ModHook()
     if ( reg )
         delete[] reg;
 
+    delete snapshot;
+
     if ( api && api->mod_dtor )
         api->mod_dtor(mod);
     else
@@ -1353,15 +1362,44 @@ void ModuleManager::dump_stats(const char* skip, bool dynamic)
     }
 }
 
+// modules with a snapshot are published to the thread's own slot so packet
+// threads don't serialize on the stats mutex when stats are dumped
+static void accumulate(ModHook* mh, bool prep, bool accumulate_now_stats)
+{
+    if ( mh->snapshot )
+    {
+        if ( prep )
+            mh->mod->prep_counts();
+
+        if ( PegCount* p = mh->mod->get_counts() )
+            mh->snapshot->publish(get_instance_id(), p, accumulate_now_stats);
+        return;
+    }
+
+    lock_guard<mutex> lock(ModuleManager::stats_mutex);
+
+    if ( prep )
+        mh->mod->prep_counts();
+
+    mh->mod->sum_stats(accumulate_now_stats);
+}
+
 void ModuleManager::accumulate()
 {
-    auto mod_hooks = get_all_modhooks();
+    for ( auto& it : s_modules )
+        ::accumulate(it.second, true, true);
+}
 
-    for ( auto* mh : mod_hooks )
+void ModuleManager::accumulate(Module* m, bool accumulate_now_stats)
+{
+    ModHook* mh = get_hook(m->get_name());
+
+    if ( mh and mh->mod == m )
+        ::accumulate(mh, false, accumulate_now_stats);
+    else
     {
         lock_guard<mutex> lock(stats_mutex);
-        mh->mod->prep_counts();
-        mh->mod->sum_stats(true);
+        m->sum_stats(accumulate_now_stats);
     }
 }
 
@@ -1376,6 +1414,36 @@ void ModuleManager::accumulate_offload(const char* name)
     }
 }
 
+// offload threads may still add to the counts directly so only the change
+// since the last merge is added here
+void ModuleManager::collect()
+{
+    for ( auto& it : s_modules )
+    {
+        ModHook* mh = it.second;
+
+        if ( !mh->snapshot )
+            continue;
+
+        Module* m = mh->mod;
+        const PegInfo* pegs = m->get_pegs();
+        std::vector<PegCount> totals(mh->snapshot->get_num_pegs());
+        mh->snapshot->collect(totals.data());
+
+        lock_guard<mutex> lock(stats_mutex);
+
+        for ( unsigned i = 0; i < totals.size(); ++i )
+        {
+            if ( pegs[i].type == CountType::MAX )
+                m->set_max_peg_count(i, totals[i]);
+            else
+                m->add_peg_count(i, totals[i] - mh->collected[i]);
+        }
+        mh->collected.swap(totals);
+    }
+}
+
+// called before the packet threads start
 void ModuleManager::reset_stats(SnortConfig*)
 {
     auto mod_hooks = get_all_modhooks();
@@ -1383,7 +1451,18 @@ void ModuleManager::reset_stats(SnortConfig*)
     for ( auto* mh : mod_hooks )
     {
         lock_guard<mutex> lock(stats_mutex);
-        mh->mod->reset_stats();
+        Module* m = mh->mod;
+        m->reset_stats();
+
+        delete mh->snapshot;
+        mh->snapshot = nullptr;
+
+        if ( m->num_counts > 0 and !m->global_stats() and m->snapshot_stats() )
+        {
+            mh->snapshot = new PegSnapshot(
+                ThreadConfig::get_instance_max(), m->num_counts, m->get_pegs());
+            mh->collected.assign(m->num_counts, 0);
+        }
     }
 }
 
@@ -84,8 +84,15 @@ public:
 
     static void dump_stats(const char* skip = nullptr, bool dynamic = false);
 
+    // packet threads
     static void accumulate();
+    static void accumulate(Module*, bool accumulate_now_stats);
+
+    // offload threads
     static void accumulate_offload(const char* name);
+
+    // main thread
+    static void collect();
     static void reset_stats(SnortConfig*);
 
     static std::set<uint32_t> gids;
@@ -24,6 +24,14 @@
 
 #include "decode_b64.h"
 
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #include "utils/util_unfold.h"
 
 #include "decode_buffer.h"
@@ -120,6 +128,183 @@ uint8_t sf_decode64tab[256] =
     100,100,100,100,100,100,100,100,100,100,100,100,100,100,100,100
 };
 
+//-------------------------------------------------------------------------
+// vectorized decoding
+//-------------------------------------------------------------------------
+
+// The kernels decode blocks made up only of base64 alphabet characters, 4 characters to 3 octets,
+// and stop at the first block with anything else in it, such as '=' or characters to skip, which
+// are left to the table driven loop in sf_base64decode(). They return the number of characters
+// decoded. The x86 kernels store whole vectors, a few octets past the decoded ones, so they stop
+// when the output has less room than that.
+
+typedef uint32_t (*DecodeKernel)(const uint8_t* in, uint32_t in_len, uint8_t* out,
+    uint32_t out_len);
+
+#if defined(__x86_64__)
+
+// The intrinsics are compiled for the instruction set of each kernel with a target attribute so
+// the rest of the build doesn't depend on it. The cpu is checked once at startup.
+//
+// Characters are validated with two lookups, by their high and low nibbles, and a character is in
+// the alphabet if the bitwise and of its entries is zero. A third lookup by the high nibble, with
+// '/' moved to its own row, gives what to add to a character to get its 6 bit value. The values
+// are then merged in pairs, the pairs into 24 bit groups, and the groups shuffled into octets.
+#define LUT_LO 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, \
+    0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a
+#define LUT_HI 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, \
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+#define LUT_ROLL 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+#define PACK 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+
+__attribute__((target("ssse3")))
+static uint32_t decode_ssse3(const uint8_t* in, uint32_t in_len, uint8_t* out, uint32_t out_len)
+{
+    const __m128i lut_lo = _mm_setr_epi8(LUT_LO);
+    const __m128i lut_hi = _mm_setr_epi8(LUT_HI);
+    const __m128i lut_roll = _mm_setr_epi8(LUT_ROLL);
+    const __m128i pack = _mm_setr_epi8(PACK);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t done = 0;
+
+    for ( ; (in_len - done >= 16) and (out_len >= 16); done += 16, out += 12, out_len -= 12)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(in + done));
+        const __m128i hi = _mm_and_si128(_mm_srli_epi32(v, 4), nibble);
+        const __m128i lo = _mm_and_si128(v, nibble);
+        const __m128i bad = _mm_and_si128(_mm_shuffle_epi8(lut_lo, lo),
+            _mm_shuffle_epi8(lut_hi, hi));
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(bad, zero)) != 0xffff)
+            break;
+
+        const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(v, slash), hi));
+        const __m128i values = _mm_add_epi8(v, roll);
+        const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+
+        _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(groups, pack));
+    }
+    return done;
+}
+
+__attribute__((target("avx2")))
+static uint32_t decode_avx2(const uint8_t* in, uint32_t in_len, uint8_t* out, uint32_t out_len)
+{
+    const __m256i lut_lo = _mm256_setr_epi8(LUT_LO, LUT_LO);
+    const __m256i lut_hi = _mm256_setr_epi8(LUT_HI, LUT_HI);
+    const __m256i lut_roll = _mm256_setr_epi8(LUT_ROLL, LUT_ROLL);
+    const __m256i pack = _mm256_setr_epi8(PACK, PACK);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i slash = _mm256_set1_epi8('/');
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t done = 0;
+
+    for ( ; (in_len - done >= 32) and (out_len >= 32); done += 32, out += 24, out_len -= 24)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(in + done));
+        const __m256i hi = _mm256_and_si256(_mm256_srli_epi32(v, 4), nibble);
+        const __m256i lo = _mm256_and_si256(v, nibble);
+        const __m256i bad = _mm256_and_si256(_mm256_shuffle_epi8(lut_lo, lo),
+            _mm256_shuffle_epi8(lut_hi, hi));
+
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(bad, zero)) != -1)
+            break;
+
+        const __m256i roll = _mm256_shuffle_epi8(lut_roll,
+            _mm256_add_epi8(_mm256_cmpeq_epi8(v, slash), hi));
+        const __m256i values = _mm256_add_epi8(v, roll);
+        const __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        const __m256i groups = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+
+        // Each lane packs 12 octets at its start, then the lanes are joined
+        _mm256_storeu_si256((__m256i*)out,
+            _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(groups, pack), lanes));
+    }
+
+    // Pick up a remaining half vector
+    return done + decode_ssse3(in + done, in_len - done, out, out_len);
+}
+
+static DecodeKernel select_kernel()
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return decode_avx2;
+
+    if (__builtin_cpu_supports("ssse3"))
+        return decode_ssse3;
+
+    return nullptr;
+}
+
+#elif defined(__aarch64__)
+
+// NEON is always there on aarch64. The characters of 16 groups are loaded deinterleaved so each
+// vector holds one position of the groups, and the octets are stored interleaved again.
+static inline uint8x16_t sextets(uint8x16_t v, uint8x16_t& valid)
+{
+    const uint8x16_t upper = vcltq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8(26));
+    const uint8x16_t lower = vcltq_u8(vsubq_u8(v, vdupq_n_u8('a')), vdupq_n_u8(26));
+    const uint8x16_t digit = vcltq_u8(vsubq_u8(v, vdupq_n_u8('0')), vdupq_n_u8(10));
+    const uint8x16_t plus = vceqq_u8(v, vdupq_n_u8('+'));
+    const uint8x16_t slash = vceqq_u8(v, vdupq_n_u8('/'));
+
+    uint8x16_t values = vandq_u8(upper, vsubq_u8(v, vdupq_n_u8('A')));
+    values = vorrq_u8(values, vandq_u8(lower, vsubq_u8(v, vdupq_n_u8('a' - 26))));
+    values = vorrq_u8(values, vandq_u8(digit, vaddq_u8(v, vdupq_n_u8(52 - '0'))));
+    values = vorrq_u8(values, vandq_u8(plus, vdupq_n_u8(62)));
+    values = vorrq_u8(values, vandq_u8(slash, vdupq_n_u8(63)));
+
+    valid = vandq_u8(valid,
+        vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, vorrq_u8(plus, slash))));
+    return values;
+}
+
+static uint32_t decode_neon(const uint8_t* in, uint32_t in_len, uint8_t* out, uint32_t out_len)
+{
+    uint32_t done = 0;
+
+    for ( ; (in_len - done >= 64) and (out_len >= 48); done += 64, out += 48, out_len -= 48)
+    {
+        const uint8x16x4_t v = vld4q_u8(in + done);
+        uint8x16_t valid = vdupq_n_u8(0xff);
+        const uint8x16_t a = sextets(v.val[0], valid);
+        const uint8x16_t b = sextets(v.val[1], valid);
+        const uint8x16_t c = sextets(v.val[2], valid);
+        const uint8x16_t d = sextets(v.val[3], valid);
+
+        if (vminvq_u8(valid) == 0)
+            break;
+
+        uint8x16x3_t octets;
+        octets.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+        octets.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+        octets.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+        vst3q_u8(out, octets);
+    }
+    return done;
+}
+
+static DecodeKernel select_kernel()
+{ return decode_neon; }
+
+#else
+
+static DecodeKernel select_kernel()
+{ return nullptr; }
+
+#endif
+
+static DecodeKernel decode_kernel = select_kernel();
+
+// After a kernel stops, this many characters are decoded by table before trying it again
+static const uint32_t KERNEL_RETRY = 16;
+
 namespace snort
 {
 /* base64decode assumes the input data terminates with '=' and/or at the end of the input buffer
@@ -155,8 +340,24 @@ int sf_base64decode(uint8_t* inbuf, uint32_t inbuf_size, uint8_t* outbuf, uint32
     *bytes_written = 0;
     cursor = inbuf;
     outbuf_ptr = outbuf;
+    const uint8_t* kernel_resume = inbuf;
     while ((cursor < endofinbuf) && (n < max_base64_chars))
     {
+        // Runs of whole groups are decoded by the vectorized kernel, if there is one
+        if (decode_kernel && (base64data_ptr == base64data) && (cursor >= kernel_resume))
+        {
+            const uint32_t in_len = std::min((uint32_t)(endofinbuf - cursor), max_base64_chars - n);
+            const uint32_t done = decode_kernel(cursor, in_len, outbuf_ptr,
+                outbuf_size - *bytes_written);
+
+            cursor += done;
+            n += done;
+            outbuf_ptr += done / 4 * 3;
+            *bytes_written += done / 4 * 3;
+            kernel_resume = cursor + KERNEL_RETRY;
+            continue;
+        }
+
         if (sf_decode64tab[*cursor] != 100)
         {
             *base64data_ptr++ = *cursor;
@@ -218,3 +419,215 @@ int sf_base64decode(uint8_t* inbuf, uint32_t inbuf_size, uint8_t* outbuf, uint32
 }
 } // namespace snort
 
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <catch/snort_catch.h>
+
+static const char b64_alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Base64 like a mail attachment, in lines of 76 characters
+static std::string b64_encode(const std::vector<uint8_t>& data, bool lines = true)
+{
+    std::string s;
+    uint32_t line = 0;
+
+    for (size_t i = 0; i < data.size(); i += 3)
+    {
+        const uint32_t left = data.size() - i;
+        const uint32_t group = (data[i] << 16) | ((left > 1 ? data[i + 1] : 0) << 8) |
+            (left > 2 ? data[i + 2] : 0);
+
+        s += b64_alphabet[group >> 18];
+        s += b64_alphabet[(group >> 12) & 0x3f];
+        s += (left > 1) ? b64_alphabet[(group >> 6) & 0x3f] : '=';
+        s += (left > 2) ? b64_alphabet[group & 0x3f] : '=';
+
+        if (lines and ((line += 4) == 76))
+        {
+            s += "\r\n";
+            line = 0;
+        }
+    }
+    return s;
+}
+
+static std::vector<uint8_t> random_data(size_t size, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(size);
+    for (auto& d : data)
+        d = rng();
+    return data;
+}
+
+struct Decoded
+{
+    int ret;
+    uint32_t written;
+    std::vector<uint8_t> out;
+};
+
+static Decoded decode_with(DecodeKernel kernel, const std::string& in, uint32_t out_size)
+{
+    DecodeKernel saved = decode_kernel;
+    decode_kernel = kernel;
+
+    std::vector<uint8_t> buf(in.begin(), in.end());
+    Decoded d;
+    d.out.resize(out_size);
+    d.ret = sf_base64decode(buf.data(), buf.size(), d.out.data(), out_size, &d.written);
+    d.out.resize(d.written);
+
+    decode_kernel = saved;
+    return d;
+}
+
+TEST_CASE("base64 kernels decode the same as the table", "[base64]")
+{
+    std::vector<DecodeKernel> kernels;
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("ssse3"))
+        kernels.push_back(decode_ssse3);
+    if (__builtin_cpu_supports("avx2"))
+        kernels.push_back(decode_avx2);
+#elif defined(__aarch64__)
+    kernels.push_back(decode_neon);
+#endif
+
+    // Clean base64 with stray characters, padding and line breaks mixed in at different rates
+    const char stray[] = "=\r\n -*\x80\xff.";
+    std::mt19937 rng(7);
+
+    for (unsigned i = 0; i < 2000; ++i)
+    {
+        std::string in = b64_encode(random_data(rng() % 600, i), false);
+        const unsigned strays = (i % 4) ? rng() % 4 : 0;
+
+        for (unsigned k = 0; k < strays and !in.empty(); ++k)
+            in[rng() % in.size()] = stray[rng() % (sizeof(stray) - 1)];
+
+        // Sometimes the output is too small for all of it
+        const uint32_t out_size = (i % 3) ? in.size() : rng() % (in.size() + 1) + 1;
+        const Decoded expected = decode_with(nullptr, in, out_size);
+
+        for (auto kernel : kernels)
+        {
+            const Decoded actual = decode_with(kernel, in, out_size);
+            CHECK(actual.ret == expected.ret);
+            CHECK(actual.written == expected.written);
+            CHECK(actual.out == expected.out);
+        }
+    }
+}
+
+TEST_CASE("base64 decode fails on padding at the start of a group", "[base64]")
+{
+    for (auto kernel : { decode_kernel, (DecodeKernel)nullptr })
+    {
+        std::string in = b64_encode(random_data(48, 1), false) + "A===" + std::string(64, 'A');
+        CHECK(decode_with(kernel, in, 1000).ret == -1);
+
+        in = b64_encode(random_data(48, 1), false) + "QQ==" + std::string(64, 'A');
+        const Decoded d = decode_with(kernel, in, 1000);
+        CHECK(d.ret == 0);
+        CHECK(d.written == 49);
+    }
+}
+
+TEST_CASE("B64Decode carries partial groups over to the next segment", "[base64]")
+{
+    const std::vector<uint8_t> data = random_data(20000, 3);
+    const std::string text = b64_encode(data);
+    std::vector<uint8_t> decode_buf(65536);
+
+    for (uint32_t segment : { 1u, 3u, 77u, 1460u })
+    {
+        B64Decode b64(0, 0);
+        std::vector<uint8_t> decoded;
+
+        for (size_t i = 0; i < text.size(); i += segment)
+        {
+            const uint8_t* start = (const uint8_t*)text.data() + i;
+            const uint8_t* end = start + std::min((size_t)segment, text.size() - i);
+            const uint8_t* out;
+            uint32_t out_size = 0;
+
+            if (b64.decode_data(start, end, decode_buf.data()) == DECODE_SUCCESS)
+            {
+                b64.get_decoded_data(&out, &out_size);
+                decoded.insert(decoded.end(), out, out + out_size);
+            }
+        }
+        CHECK(decoded == data);
+    }
+}
+
+#ifdef BENCHMARK_TEST
+
+TEST_CASE("base64 decode benchmark", "[base64][benchmark]")
+{
+    // A 256K attachment
+    const std::vector<uint8_t> data = random_data(256 * 1024, 5);
+    const std::string text = b64_encode(data);
+    std::vector<uint8_t> stripped(text.begin(), text.end());
+    std::vector<uint8_t> out(data.size() + 3);
+    uint32_t size = 0;
+
+    sf_strip_CRLF((const uint8_t*)text.data(), text.size(), stripped.data(), stripped.size(),
+        &size);
+    stripped.resize(size);
+
+    DecodeKernel kernel = decode_kernel;
+
+    BENCHMARK("sf_base64decode table")
+    {
+        decode_kernel = nullptr;
+        uint32_t written = 0;
+        sf_base64decode(stripped.data(), stripped.size(), out.data(), out.size(), &written);
+        decode_kernel = kernel;
+        return written;
+    };
+
+    BENCHMARK("sf_base64decode vectorized")
+    {
+        uint32_t written = 0;
+        sf_base64decode(stripped.data(), stripped.size(), out.data(), out.size(), &written);
+        return written;
+    };
+
+    std::vector<uint8_t> decode_buf(65536);
+
+    BENCHMARK("B64Decode 1460 byte segments")
+    {
+        B64Decode b64(0, 0);
+        uint32_t total = 0;
+
+        for (size_t i = 0; i < text.size(); i += 1460)
+        {
+            const uint8_t* start = (const uint8_t*)text.data() + i;
+            const uint8_t* end = start + std::min((size_t)1460, text.size() - i);
+            const uint8_t* decoded;
+            uint32_t decoded_size = 0;
+
+            if (b64.decode_data(start, end, decode_buf.data()) == DECODE_SUCCESS)
+            {
+                b64.get_decoded_data(&decoded, &decoded_size);
+                total += decoded_size;
+            }
+        }
+        return total;
+    };
+}
+
+#endif
+#endif
@@ -27,12 +27,39 @@
 #include <cctype>
 #include <cstdlib>
 
+#include "utils/util_simd.h"
 #include "utils/util_unfold.h"
 
 #include "decode_buffer.h"
 
 using namespace snort;
 
+#ifdef HAVE_OCTETS16
+// Sets the lanes of '=' and octets that aren't printable, blank or line breaks
+static inline Octets16 qp_escape16(Octets16 v)
+{
+    const Octets16 print = and_not16(in_range16(v, 0x20, 0x7e), equal16(v, '='));
+    const Octets16 space = or16(equal16(v, '\t'), cr_lf16(v));
+    return not16(or16(print, space));
+}
+#endif
+
+// Copies the input up to the first octet that isn't copied as is by sf_qpdecode() a vector at a
+// time and returns the number of octets before it. Whole vectors are stored, so the output must
+// have room for one past the count.
+static inline uint32_t copy_literal(const char* src, uint32_t slen, char* dst, uint32_t dlen)
+{
+#ifdef HAVE_OCTETS16
+    return copy16((const uint8_t*)src, slen, (uint8_t*)dst, dlen, qp_escape16);
+#else
+    UNUSED(src);
+    UNUSED(slen);
+    UNUSED(dst);
+    UNUSED(dlen);
+    return 0;
+#endif
+}
+
 void QPDecode::reset_decode_state()
 {
     reset_decoded_bytes();
@@ -110,6 +137,15 @@ int sf_qpdecode(const char* src, uint32_t slen, char* dst, uint32_t dlen, uint32
 
     while ( (*bytes_read < slen) && (*bytes_copied < dlen))
     {
+        // Text is copied in vectors up to the next escape or octet to drop
+        const uint32_t copied = copy_literal(src + *bytes_read, slen - *bytes_read,
+            dst + *bytes_copied, dlen - *bytes_copied);
+        *bytes_read += copied;
+        *bytes_copied += copied;
+
+        if ( (*bytes_read == slen) || (*bytes_copied == dlen) )
+            break;
+
         char ch = src[*bytes_read];
         *bytes_read += 1;
 
@@ -173,3 +209,84 @@ int sf_qpdecode(const char* src, uint32_t slen, char* dst, uint32_t dlen, uint32
     return 0;
 }
 
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+#include <string>
+
+#include <catch/snort_catch.h>
+
+static std::string qp_decode(const std::string& in, uint32_t out_size, uint32_t& read)
+{
+    std::string out(out_size, '\0');
+    uint32_t copied = 0;
+    read = 0;
+
+    if (sf_qpdecode(in.data(), in.size(), &out[0], out_size, &read, &copied) != 0)
+        return "error";
+
+    out.resize(copied);
+    return out;
+}
+
+TEST_CASE("quoted-printable decode", "[qp]")
+{
+    uint32_t read;
+
+    SECTION("escapes and soft line breaks between long runs of text")
+    {
+        const std::string in = "The quick brown fox jumps=20over the lazy dog=\r\n"
+            "and the=3Dquick brown fox jumps over the lazy dog=\ntoo.\r\n";
+        CHECK(qp_decode(in, 200, read) ==
+            "The quick brown fox jumps over the lazy dogand the=quick brown fox jumps "
+            "over the lazy dogtoo.\r\n");
+        CHECK(read == in.size());
+    }
+    SECTION("control and 8 bit octets are dropped")
+    {
+        const std::string in = "abcdefghijklmno\x01pqrstuvwxyz\x80\xff" "0123456789abcdefghij";
+        CHECK(qp_decode(in, 200, read) == "abcdefghijklmnopqrstuvwxyz0123456789abcdefghij");
+    }
+    SECTION("an escape split at the end is left for the next call")
+    {
+        const std::string in = "abcdefghijklmnopqrstuvwxyz=4";
+        CHECK(qp_decode(in, 200, read) == "abcdefghijklmnopqrstuvwxyz");
+        CHECK(read == in.size() - 2);
+    }
+    SECTION("output is limited to the space given")
+    {
+        const std::string in = "abcdefghijklmnopqrstuvwxyz0123456789";
+        CHECK(qp_decode(in, 20, read) == "abcdefghijklmnopqrst");
+        CHECK(read == 20);
+    }
+}
+
+#ifdef BENCHMARK_TEST
+
+TEST_CASE("quoted-printable decode benchmark", "[qp][benchmark]")
+{
+    // Mostly plain text with the odd escape and soft line breaks, as mail bodies are
+    std::string text;
+    while (text.size() < 256 * 1024)
+    {
+        text += "Thanks for the update on the quarterly numbers. Let's go over the r=\r\n"
+            "esults on Monday =E2=80=93 I've attached the slides from last week's meeti=\r\n"
+            "ng so everyone has the same starting point.\r\n\r\n";
+    }
+    std::string out(text.size(), '\0');
+
+    BENCHMARK("sf_qpdecode 256K")
+    {
+        uint32_t read = 0;
+        uint32_t copied = 0;
+        sf_qpdecode(text.data(), text.size(), &out[0], out.size(), &read, &copied);
+        return copied;
+    };
+}
+
+#endif
+#endif
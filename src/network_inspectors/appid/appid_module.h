@@ -91,6 +91,8 @@ public:
     Usage get_usage() const override
     { return CONTEXT; }
     void sum_stats(bool) override;
+    bool snapshot_stats() const override
+    { return false; }
     void show_dynamic_stats() override;
 
     void set_trace(const snort::Trace*) const override;
@@ -1094,8 +1094,9 @@ void AppIdSession::publish_appid_event(AppidChangeBits& change_bits, const Packe
     if (change_bits.none())
         return;
 
+    static const DataEventId event_id = DataBus::get_id(APPID_EVENT_ANY_CHANGE);
     AppidEvent app_event(change_bits, is_http2, http2_stream_index, api, p);
-    DataBus::publish(APPID_EVENT_ANY_CHANGE, app_event, p.flow);
+    DataBus::publish(event_id, app_event, p.flow);
     if (appidDebug->is_active())
     {
         std::string str;
@@ -33,6 +33,7 @@
 
 #include "bind_module.h"
 #include "binding.h"
+#include "binding_index.h"
 
 using namespace snort;
 using namespace std;
@@ -484,6 +485,8 @@ private:
 private:
     vector<Binding> bindings;
     vector<Binding> policy_bindings;
+    BindingIndex index;
+    BindingIndex policy_index;
     Inspector* default_ssn_inspectors[to_utype(PktType::MAX)]{};
 };
 
@@ -565,6 +568,9 @@ bool Binder::configure(SnortConfig* sc)
     for (Binding& b : policy_bindings)
         b.configure(sc);
 
+    index.build(bindings);
+    policy_index.build(policy_bindings);
+
     // Grab default session inspectors if they exist for this policy
     for (int proto = to_utype(PktType::NONE); proto < to_utype(PktType::MAX); proto++)
     {
@@ -631,6 +637,7 @@ void Binder::remove_inspector_binding(SnortConfig*, const char* name)
         if (!strcmp(key, name))
         {
             bindings.erase(it);
+            index.build(bindings);
             return;
         }
     }
@@ -736,8 +743,13 @@ void Binder::get_policy_bindings(Flow& flow, const char* service)
     // FIXIT-L This will select the first policy ID of each type that it finds and ignore the rest.
     //          It gets potentially hairy if people start specifying overlapping policy types in
     //          overlapping rules.
-    for (const Binding& b : policy_bindings)
+    vector<unsigned> ids;
+    policy_index.find(flow, service, ids);
+
+    for (unsigned id : ids)
     {
+        const Binding& b = policy_bindings[id];
+
         // Skip any rules that don't contain an ID for a policy type we haven't set yet.
         if ((!b.use.inspection_index || inspection_index) && (!b.use.ips_index || ips_index))
             continue;
@@ -767,8 +779,8 @@ void Binder::get_policy_bindings(Flow& flow, const char* service)
     }
 }
 
-// FIXIT-P this is a simple linear search until functionality is nailed
-// down.  performance should be the focus of the next iteration.
+// the index only returns bindings that may match, in configuration order,
+// so the result is the same as checking every binding
 void Binder::get_bindings(Flow& flow, Stuff& stuff, const char* service)
 {
     // Evaluate policy ID bindings first
@@ -788,8 +800,13 @@ void Binder::get_bindings(Flow& flow, Stuff& stuff, const char* service)
     // Initialize the session inspector for both client and server to the default for this policy.
     stuff.client = stuff.server = default_ssn_inspectors[to_utype(flow.pkt_type)];
 
-    for (const Binding& b : bindings)
+    vector<unsigned> ids;
+    index.find(flow, service, ids);
+
+    for (unsigned id : ids)
     {
+        const Binding& b = bindings[id];
+
         if (!b.check_all(flow, service))
             continue;
 
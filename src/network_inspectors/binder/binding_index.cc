@@ -0,0 +1,592 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// binding_index.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "binding_index.h"
+
+#include <algorithm>
+
+#include "flow/flow.h"
+#include "flow/flow_key.h"
+#include "sfip/sf_cidr.h"
+#include "sfip/sf_ipvar.h"
+
+#if defined(UNIT_TEST) || defined(BENCHMARK_TEST)
+#include "catch/snort_catch.h"
+#include "parser/parse_ip.h"
+#endif
+
+using namespace snort;
+
+// vlan and port criteria with more values than this are filed as any since
+// checking the bitset is cheaper than adding the binding to that many lists
+static constexpr unsigned max_keys = 64;
+
+//-------------------------------------------------------------------------
+// network trie
+//-------------------------------------------------------------------------
+
+// a binary trie with ids at the node for each prefix; a lookup walks the
+// address bits and collects the ids of every containing prefix, not just
+// the longest, since any of them may be the first binding to match
+NetTrie::NetTrie() : nodes(2)
+{ }
+
+static bool get_words(const SfIp& ip, uint32_t words[4], unsigned& root, unsigned& max)
+{
+    if (ip.is_ip4())
+    {
+        words[0] = ntohl(ip.get_ip4_value());
+        root = 0;
+        max = 32;
+        return true;
+    }
+
+    if (ip.is_ip6())
+    {
+        for (unsigned i = 0; i < 4; ++i)
+            words[i] = ntohl(ip.get_ip6_ptr()[i]);
+        root = 1;
+        max = 128;
+        return true;
+    }
+    return false;
+}
+
+static inline unsigned get_bit(const uint32_t words[4], unsigned i)
+{ return (words[i / 32] >> (31 - i % 32)) & 1; }
+
+void NetTrie::insert(const SfCidr& cidr, unsigned id)
+{
+    uint32_t words[4];
+    unsigned root, max;
+
+    if (!get_words(*cidr.get_addr(), words, root, max))
+        return;
+
+    // v4 prefixes are stored in the v6 mapped range; 0.0.0.0 matches any
+    // v4 address regardless of length (see SfCidr::fast_cont4)
+    unsigned bits = cidr.get_bits();
+
+    if (max == 32)
+        bits = (bits > 96 and words[0]) ? bits - 96 : 0;
+
+    bits = std::min(bits, max);
+    unsigned n = root;
+
+    for (unsigned i = 0; i < bits; ++i)
+    {
+        unsigned b = get_bit(words, i);
+
+        if (nodes[n].child[b] < 0)
+        {
+            nodes[n].child[b] = nodes.size();
+            nodes.emplace_back();
+        }
+        n = nodes[n].child[b];
+    }
+
+    std::vector<unsigned>& v = nodes[n].ids;
+
+    if (v.empty() or v.back() != id)
+        v.emplace_back(id);
+}
+
+void NetTrie::find(const SfIp& ip, std::vector<unsigned>& ids) const
+{
+    uint32_t words[4];
+    unsigned root, max;
+
+    if (!get_words(ip, words, root, max))
+        return;
+
+    int n = root;
+
+    for (unsigned i = 0; ; ++i)
+    {
+        const Node& node = nodes[n];
+        ids.insert(ids.end(), node.ids.begin(), node.ids.end());
+
+        if (i == max)
+            break;
+
+        n = node.child[get_bit(words, i)];
+
+        if (n < 0)
+            break;
+    }
+}
+
+//-------------------------------------------------------------------------
+// build
+//-------------------------------------------------------------------------
+
+template <typename Map, typename Set>
+static void add_all(Map& map, const Set& set, unsigned id)
+{
+    for (auto key : set)
+        map[key].emplace_back(id);
+}
+
+template <typename Map, size_t N>
+static bool add_bits(Map& map, const std::bitset<N>& bits, unsigned id)
+{
+    if (bits.count() > max_keys)
+        return false;
+
+    for (unsigned i = 0; i < N; ++i)
+    {
+        if (bits.test(i))
+            map[i].emplace_back(id);
+    }
+    return true;
+}
+
+bool BindingIndex::add_vlans(const BindWhen& when, unsigned id)
+{
+    if (!when.has_criteria(BindWhen::Criteria::BWC_VLANS))
+        return false;
+
+    return add_bits(vlans, when.vlans, id);
+}
+
+// the split sets that are empty don't restrict the flow
+bool BindingIndex::add_intfs(const BindWhen& when, unsigned id)
+{
+    const std::unordered_set<int32_t>* set;
+
+    if (when.has_criteria(BindWhen::Criteria::BWC_INTFS))
+        set = &when.src_intfs;
+
+    else if (when.has_criteria(BindWhen::Criteria::BWC_SPLIT_INTFS))
+        set = when.src_intfs.empty() ? &when.dst_intfs : &when.src_intfs;
+
+    else
+        return false;
+
+    if (set->empty())
+        return false;
+
+    add_all(intfs, *set, id);
+    return true;
+}
+
+bool BindingIndex::add_groups(const BindWhen& when, unsigned id)
+{
+    const std::unordered_set<int16_t>* set;
+
+    if (when.has_criteria(BindWhen::Criteria::BWC_GROUPS))
+        set = &when.src_groups;
+
+    else if (when.has_criteria(BindWhen::Criteria::BWC_SPLIT_GROUPS))
+        set = when.src_groups.empty() ? &when.dst_groups : &when.src_groups;
+
+    else
+        return false;
+
+    if (set->empty())
+        return false;
+
+    add_all(groups, *set, id);
+    return true;
+}
+
+// negated or unset entries can match addresses outside the listed
+// prefixes so those lists are not indexed
+static bool is_indexable(const sfip_var_t* var)
+{
+    if (!var or var->mode != SFIP_LIST or var->neg_head or !var->head)
+        return false;
+
+    for (const sfip_node_t* node = var->head; node; node = node->next)
+    {
+        if (!node->ip->is_set())
+            return false;
+    }
+    return true;
+}
+
+bool BindingIndex::add_nets(const BindWhen& when, unsigned id)
+{
+    const sfip_var_t* var;
+
+    if (when.has_criteria(BindWhen::Criteria::BWC_NETS))
+        var = when.src_nets;
+
+    else if (when.has_criteria(BindWhen::Criteria::BWC_SPLIT_NETS))
+        var = is_indexable(when.src_nets) ? when.src_nets : when.dst_nets;
+
+    else
+        return false;
+
+    if (!is_indexable(var))
+        return false;
+
+    for (const sfip_node_t* node = var->head; node; node = node->next)
+        nets.insert(*node->ip, id);
+
+    return true;
+}
+
+bool BindingIndex::add_ports(const BindWhen& when, unsigned id)
+{
+    if (when.has_criteria(BindWhen::Criteria::BWC_PORTS))
+        return add_bits(ports, when.src_ports, id);
+
+    if (!when.has_criteria(BindWhen::Criteria::BWC_SPLIT_PORTS))
+        return false;
+
+    return add_bits(ports, when.src_ports, id) or add_bits(ports, when.dst_ports, id);
+}
+
+bool BindingIndex::add_service(const BindWhen& when, unsigned id)
+{
+    if (!when.has_criteria(BindWhen::Criteria::BWC_SVC))
+        return false;
+
+    services[when.svc].emplace_back(id);
+    return true;
+}
+
+// bindings are filed under the first criterion in order of how selective
+// it typically is; ids are added in increasing order so each list is sorted
+void BindingIndex::build(const std::vector<Binding>& bindings)
+{
+    any.clear();
+    vlans.clear();
+    intfs.clear();
+    groups.clear();
+    ports.clear();
+    services.clear();
+    nets = NetTrie();
+
+    for (unsigned id = 0; id < bindings.size(); ++id)
+    {
+        const BindWhen& when = bindings[id].when;
+
+        if (add_vlans(when, id) or add_intfs(when, id) or add_groups(when, id) or
+            add_nets(when, id) or add_ports(when, id) or add_service(when, id))
+            continue;
+
+        any.emplace_back(id);
+    }
+}
+
+//-------------------------------------------------------------------------
+// find
+//-------------------------------------------------------------------------
+
+template <typename Map, typename Key>
+static inline void add_ids(const Map& map, Key key, std::vector<unsigned>& ids)
+{
+    auto it = map.find(key);
+
+    if (it != map.end())
+        ids.insert(ids.end(), it->second.begin(), it->second.end());
+}
+
+// the client and server values are both used since the role of a binding
+// isn't known until it is checked
+void BindingIndex::find(const Flow& flow, const char* service, std::vector<unsigned>& ids) const
+{
+    ids.clear();
+
+    if (flow.key and !vlans.empty())
+        add_ids(vlans, flow.key->vlan_tag, ids);
+
+    if (!intfs.empty())
+    {
+        add_ids(intfs, flow.client_intf, ids);
+
+        if (flow.server_intf != flow.client_intf)
+            add_ids(intfs, flow.server_intf, ids);
+    }
+
+    if (!groups.empty())
+    {
+        add_ids(groups, flow.client_group, ids);
+
+        if (flow.server_group != flow.client_group)
+            add_ids(groups, flow.server_group, ids);
+    }
+
+    nets.find(flow.client_ip, ids);
+    nets.find(flow.server_ip, ids);
+
+    if (!ports.empty())
+    {
+        add_ids(ports, flow.client_port, ids);
+
+        if (flow.server_port != flow.client_port)
+            add_ids(ports, flow.server_port, ids);
+    }
+
+    if (!service)
+        service = flow.service;
+
+    if (service and !services.empty())
+        add_ids(services, service, ids);
+
+    if (ids.empty())
+    {
+        ids = any;
+        return;
+    }
+
+    ids.insert(ids.end(), any.begin(), any.end());
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#if defined(UNIT_TEST) || defined(BENCHMARK_TEST)
+
+static sfip_var_t* make_nets(const char* s)
+{ return sfip_var_from_string(s, "binder"); }
+
+static void make_flow(Flow& flow, FlowKey& key, unsigned i)
+{
+    SfIp cip, sip;
+    std::string c = "10." + std::to_string(i % 7) + "." + std::to_string(i % 5) + ".1";
+    std::string s = "192.168." + std::to_string(i % 3) + "." + std::to_string(i % 11);
+    cip.set(c.c_str());
+    sip.set(s.c_str());
+
+    memset(&key, 0, sizeof(key));
+    key.vlan_tag = i % 13;
+
+    flow.key = &key;
+    flow.pkt_type = (i % 2) ? PktType::TCP : PktType::UDP;
+    flow.client_ip = cip;
+    flow.server_ip = sip;
+    flow.client_port = 1024 + i % 17;
+    flow.server_port = (i % 4) ? 80 : 53;
+    flow.client_intf = i % 6;
+    flow.server_intf = i % 9;
+    flow.client_group = i % 4;
+    flow.server_group = i % 5;
+    flow.service = (i % 3) ? "http" : nullptr;
+}
+
+#endif
+
+#ifdef UNIT_TEST
+
+// each binding gets a mix of criteria so that every index is used and
+// many bindings fall through to any
+static void make_binding(Binding& b, unsigned i)
+{
+    switch (i % 9)
+    {
+    case 0:
+        b.when.add_criteria(BindWhen::Criteria::BWC_VLANS);
+        b.when.vlans.set(i % 13);
+        break;
+    case 1:
+        b.when.add_criteria(BindWhen::Criteria::BWC_SPLIT_INTFS);
+        b.when.dst_intfs.insert(i % 9);
+        break;
+    case 2:
+        b.when.add_criteria(BindWhen::Criteria::BWC_GROUPS);
+        b.when.src_groups.insert(i % 5);
+        b.when.role = BindWhen::BR_SERVER;
+        break;
+    case 3:
+        b.when.add_criteria(BindWhen::Criteria::BWC_NETS);
+        b.when.src_nets = make_nets((i % 2) ? "10.3.0.0/16" : "[192.168.1.0/24, 10.0.0.0/8]");
+        break;
+    case 4:
+        b.when.add_criteria(BindWhen::Criteria::BWC_SPLIT_NETS);
+        b.when.dst_nets = make_nets("!192.168.2.0/24");
+        break;
+    case 5:
+        b.when.add_criteria(BindWhen::Criteria::BWC_SPLIT_PORTS);
+        b.when.dst_ports.reset();
+        b.when.dst_ports.set((i % 2) ? 80 : 53);
+        break;
+    case 6:
+        b.when.add_criteria(BindWhen::Criteria::BWC_SVC);
+        b.when.svc = (i % 2) ? "http" : "dns";
+        break;
+    case 7:
+        b.when.add_criteria(BindWhen::Criteria::BWC_PROTO);
+        b.when.protos = PROTO_BIT__TCP;
+        break;
+    default:
+        b.when.add_criteria(BindWhen::Criteria::BWC_VLANS);
+        b.when.vlans.set();
+        break;
+    }
+}
+
+TEST_CASE("binding index matches linear search", "[binder]")
+{
+    std::vector<Binding> bindings(200);
+
+    for (unsigned i = 0; i < bindings.size(); ++i)
+        make_binding(bindings[i], i);
+
+    BindingIndex index;
+    index.build(bindings);
+
+    std::vector<unsigned> ids;
+
+    for (unsigned i = 0; i < 500; ++i)
+    {
+        Flow flow;
+        FlowKey key;
+        make_flow(flow, key, i);
+
+        for (const char* service : { (const char*)nullptr, "http", "dns" })
+        {
+            std::vector<unsigned> expect, actual;
+
+            for (unsigned id = 0; id < bindings.size(); ++id)
+                if (bindings[id].check_all(flow, service))
+                    expect.emplace_back(id);
+
+            index.find(flow, service, ids);
+            CHECK(std::is_sorted(ids.begin(), ids.end()));
+
+            for (auto id : ids)
+                if (bindings[id].check_all(flow, service))
+                    actual.emplace_back(id);
+
+            CHECK(expect == actual);
+        }
+        flow.key = nullptr;
+    }
+
+    for (auto& b : bindings)
+        b.clear();
+}
+
+TEST_CASE("net trie", "[binder]")
+{
+    NetTrie trie;
+    unsigned id = 0;
+
+    // sfip vars fold nested prefixes so build the cidrs directly
+    for (const char* s : { "10.0.0.0/8", "10.1.0.0/16", "0.0.0.0/0", "2001:db8::/32" })
+    {
+        SfCidr cidr;
+        REQUIRE(cidr.set(s) == SFIP_SUCCESS);
+        trie.insert(cidr, id++);
+    }
+
+    std::vector<unsigned> ids;
+    SfIp ip;
+
+    ip.set("10.1.2.3");
+    trie.find(ip, ids);
+    CHECK(ids.size() == 3);
+
+    ids.clear();
+    ip.set("11.1.2.3");
+    trie.find(ip, ids);
+    CHECK(ids.size() == 1);
+
+    ids.clear();
+    ip.set("2001:db8::1");
+    trie.find(ip, ids);
+    CHECK(ids.size() == 1);
+
+    ids.clear();
+    ip.set("2001:db9::1");
+    trie.find(ip, ids);
+    CHECK(ids.empty());
+}
+
+#endif
+
+//-------------------------------------------------------------------------
+// benchmarks
+//-------------------------------------------------------------------------
+
+#ifdef BENCHMARK_TEST
+
+// a binding per tenant vlan followed by a few service bindings that apply
+// to everyone, like a multi-tenant config with a shared default policy
+static void bench_bindings(unsigned num)
+{
+    std::vector<Binding> bindings(num + 3);
+
+    for (unsigned i = 0; i < num; ++i)
+    {
+        bindings[i].when.add_criteria(BindWhen::Criteria::BWC_VLANS);
+        bindings[i].when.vlans.set(1 + i % 4000);
+        bindings[i].when.add_criteria(BindWhen::Criteria::BWC_SVC);
+        bindings[i].when.svc = "ftp";
+    }
+    bindings[num].when.add_criteria(BindWhen::Criteria::BWC_SVC);
+    bindings[num].when.svc = "http";
+    bindings[num + 1].when.add_criteria(BindWhen::Criteria::BWC_SVC);
+    bindings[num + 1].when.svc = "dns";
+    bindings[num + 2].when.add_criteria(BindWhen::Criteria::BWC_PROTO);
+    bindings[num + 2].when.protos = PROTO_BIT__TCP;
+
+    BindingIndex index;
+    index.build(bindings);
+
+    Flow flow;
+    FlowKey key;
+    make_flow(flow, key, 1);
+    flow.service = "http";
+    key.vlan_tag = 4001;
+
+    std::string name = std::to_string(num) + " bindings";
+
+    BENCHMARK(name + " linear")
+    {
+        for (unsigned id = 0; id < bindings.size(); ++id)
+            if (bindings[id].check_all(flow))
+                return id;
+        return 0u;
+    };
+
+    std::vector<unsigned> ids;
+
+    BENCHMARK(name + " indexed")
+    {
+        index.find(flow, nullptr, ids);
+
+        for (auto id : ids)
+            if (bindings[id].check_all(flow))
+                return id;
+        return 0u;
+    };
+
+    flow.key = nullptr;
+}
+
+TEST_CASE("binder flow setup", "[binder][benchmark]")
+{
+    bench_bindings(10);
+    bench_bindings(1000);
+    bench_bindings(10000);
+}
+
+#endif
+
@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// binding_index.h
+
+#ifndef BINDING_INDEX_H
+#define BINDING_INDEX_H
+
+// BindingIndex narrows the bindings that must be checked for a flow.  Each
+// binding is filed under the values of one of its criteria (vlan, interface,
+// group, network, port, or service) and bindings without a usable criterion
+// are always candidates.  A flow collects the bindings filed under its own
+// values, which are then checked in configuration order with check_all() so
+// the first match semantics are unchanged.
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "binding.h"
+
+namespace snort
+{
+class Flow;
+struct SfIp;
+}
+
+class NetTrie
+{
+public:
+    NetTrie();
+
+    void insert(const snort::SfCidr&, unsigned id);
+    void find(const snort::SfIp&, std::vector<unsigned>& ids) const;
+
+private:
+    struct Node
+    {
+        int child[2] = { -1, -1 };
+        std::vector<unsigned> ids;
+    };
+    std::vector<Node> nodes;  // v4 root is 0, v6 root is 1
+};
+
+class BindingIndex
+{
+public:
+    void build(const std::vector<Binding>&);
+
+    // returns the indices of the bindings that may match in increasing order
+    void find(const snort::Flow&, const char* service, std::vector<unsigned>& ids) const;
+
+private:
+    bool add_vlans(const BindWhen&, unsigned id);
+    bool add_intfs(const BindWhen&, unsigned id);
+    bool add_groups(const BindWhen&, unsigned id);
+    bool add_nets(const BindWhen&, unsigned id);
+    bool add_ports(const BindWhen&, unsigned id);
+    bool add_service(const BindWhen&, unsigned id);
+
+private:
+    std::vector<unsigned> any;
+
+    std::unordered_map<uint16_t, std::vector<unsigned>> vlans;
+    std::unordered_map<int32_t, std::vector<unsigned>> intfs;
+    std::unordered_map<int16_t, std::vector<unsigned>> groups;
+    std::unordered_map<uint16_t, std::vector<unsigned>> ports;
+    std::unordered_map<std::string, std::vector<unsigned>> services;
+    NetTrie nets;
+};
+
+#endif
+
@@ -57,10 +57,7 @@ void BaseTracker::process(bool summary)
     if ( !summary )
     {
         for ( const ModuleConfig& mod : modules )
-        {
-            lock_guard<mutex> lock(ModuleManager::stats_mutex);
-            mod.ptr->sum_stats(false);
-        }
+            ModuleManager::accumulate(mod.ptr, false);
     }
 }
 
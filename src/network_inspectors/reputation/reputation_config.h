@@ -89,9 +89,12 @@ struct ReputationConfig
     std::string allowlist_path;
     bool memcap_reached = false;
     uint8_t* reputation_segment = nullptr;
+    uint32_t segment_used = 0;
     table_flat_t* ip_list = nullptr;
     ListFiles list_files;
     std::string list_dir;
+    std::string image;
+    std::string save_image;
 
     ~ReputationConfig();
 };
@@ -0,0 +1,620 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// reputation_image.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "reputation_image.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include "hash/hashes.h"
+#include "log/messages.h"
+#include "main/thread.h"
+#include "main/thread_config.h"
+#include "time/periodic.h"
+#include "utils/util.h"
+
+#include "reputation_parse.h"
+
+using namespace snort;
+
+// the list records follow the header and the segment starts on the next
+// page boundary so the table is page aligned in the mapping.  the layout
+// word changes if any of the structures in the segment change size.
+struct ReputationImageHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;
+    uint32_t num_lists;
+    uint32_t lists_size;
+    uint64_t segment_offset;
+    uint64_t segment_size;
+    uint8_t lists_digest[SHA256_HASH_SIZE];
+    uint8_t segment_digest[SHA256_HASH_SIZE];
+};
+
+// followed by num_intfs interface ids
+struct ReputationImageList
+{
+    uint32_t list_id;
+    uint8_t file_type;
+    uint8_t list_index;
+    uint8_t all_intfs_enabled;
+    uint8_t reserved;
+    uint32_t num_intfs;
+};
+
+static const char image_magic[8] = "snortrp";
+static const uint32_t image_version = 1;
+static const uint64_t image_align = 4096;
+
+// house keeping ticks between checks for a new image, about a second
+static const uint32_t image_check_period = 1000;
+
+static uint32_t image_layout()
+{
+    return sizeof(table_flat_t) ^ (sizeof(dir_table_flat_t) << 8) ^
+        (sizeof(dir_sub_table_flat_t) << 16) ^ (sizeof(DIR_Entry) << 24) ^
+        (sizeof(IPrepInfo) << 28);
+}
+
+static bool same_file(const struct stat& a, const struct stat& b)
+{
+    return a.st_dev == b.st_dev and a.st_ino == b.st_ino and a.st_size == b.st_size and
+        a.st_mtim.tv_sec == b.st_mtim.tv_sec and a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+//--------------------------------------------------------------------------
+// image
+//--------------------------------------------------------------------------
+
+ReputationImage::ReputationImage(void* p, size_t size, const struct stat& st) :
+    map(p), map_size(size), file(st)
+{ }
+
+ReputationImage::~ReputationImage()
+{
+    for ( auto& list : list_files )
+        delete list;
+
+    munmap(map, map_size);
+}
+
+ReputationImage* ReputationImage::load(const std::string& path, AllowAction allow_action)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if ( fd < 0 )
+    {
+        ErrorMessage("reputation: can't open image %s: %s\n", path.c_str(), get_error(errno));
+        return nullptr;
+    }
+
+    struct stat st;
+
+    if ( fstat(fd, &st) or (size_t)st.st_size < sizeof(ReputationImageHeader) )
+    {
+        ErrorMessage("reputation: %s is not a reputation image\n", path.c_str());
+        close(fd);
+        return nullptr;
+    }
+
+    // shared so every inspector instance and snort process using the image
+    // maps the same page cache instead of a private copy.  a file written
+    // in place would change or truncate the mapping under the packet
+    // threads, so images must be replaced by renaming a new file over them.
+    size_t len = st.st_size;
+    void* map = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if ( map == MAP_FAILED )
+    {
+        ErrorMessage("reputation: can't map image %s: %s\n", path.c_str(), get_error(errno));
+        return nullptr;
+    }
+
+    ReputationImage* image = new ReputationImage(map, len, st);
+
+    if ( !image->parse(allow_action) )
+    {
+        ErrorMessage("reputation: %s is damaged or was built by a different snort\n", path.c_str());
+        delete image;
+        return nullptr;
+    }
+    return image;
+}
+
+bool ReputationImage::parse(AllowAction allow_action)
+{
+    const ReputationImageHeader* h = (const ReputationImageHeader*)map;
+    const uint8_t* lists = (const uint8_t*)map + sizeof(*h);
+
+    if ( memcmp(h->magic, image_magic, sizeof(h->magic)) or h->version != image_version or
+        h->layout != image_layout() )
+        return false;
+
+    if ( h->lists_size > map_size - sizeof(*h) or
+        h->segment_offset < sizeof(*h) + h->lists_size or h->segment_offset % image_align or
+        h->segment_offset > map_size or h->segment_size != map_size - h->segment_offset or
+        h->segment_size < sizeof(table_flat_t) )
+        return false;
+
+    uint8_t digest[SHA256_HASH_SIZE];
+    sha256(lists, h->lists_size, digest);
+
+    if ( memcmp(digest, h->lists_digest, sizeof(digest)) )
+        return false;
+
+    sha256((const uint8_t*)map + h->segment_offset, h->segment_size, digest);
+
+    if ( memcmp(digest, h->segment_digest, sizeof(digest)) )
+        return false;
+
+    const uint8_t* end = lists + h->lists_size;
+
+    for ( uint32_t i = 0; i < h->num_lists; ++i )
+    {
+        ReputationImageList rec;
+
+        if ( (size_t)(end - lists) < sizeof(rec) )
+            return false;
+
+        memcpy(&rec, lists, sizeof(rec));
+        lists += sizeof(rec);
+
+        // entries in the segment refer to lists by position
+        if ( rec.list_index != i + 1 or (size_t)(end - lists) / sizeof(uint32_t) < rec.num_intfs )
+            return false;
+
+        ListFile* list = new ListFile;
+        list->file_type = rec.file_type;
+        list->list_id = rec.list_id;
+        list->list_index = rec.list_index;
+        list->all_intfs_enabled = rec.all_intfs_enabled;
+        set_list_type(list, allow_action);
+        list_files.emplace_back(list);
+
+        for ( uint32_t n = 0; n < rec.num_intfs; ++n )
+        {
+            uint32_t intf;
+            memcpy(&intf, lists, sizeof(intf));
+            lists += sizeof(intf);
+            list->intfs.insert(intf);
+        }
+    }
+
+    if ( lists != end )
+        return false;
+
+    ip_list = (table_flat_t*)((uint8_t*)map + h->segment_offset);
+    return true;
+}
+
+bool ReputationImage::changed(const std::string& path) const
+{
+    struct stat st;
+
+    if ( stat(path.c_str(), &st) )
+        return false;
+
+    return !same_file(st, file);
+}
+
+//--------------------------------------------------------------------------
+// compiler
+//--------------------------------------------------------------------------
+
+static bool write_all(int fd, const void* buf, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)buf;
+
+    while ( len )
+    {
+        ssize_t n = write(fd, p, len);
+
+        if ( n < 0 and errno == EINTR )
+            continue;
+
+        if ( n <= 0 )
+            return false;
+
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool save_reputation_image(const ReputationConfig& config, const std::string& path)
+{
+    if ( !config.ip_list or !config.segment_used )
+        return false;
+
+    std::string lists;
+
+    for ( auto list : config.list_files )
+    {
+        ReputationImageList rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.list_id = list->list_id;
+        rec.file_type = list->file_type;
+        rec.list_index = list->list_index;
+        rec.all_intfs_enabled = list->all_intfs_enabled;
+        rec.num_intfs = list->intfs.size();
+        lists.append((const char*)&rec, sizeof(rec));
+
+        for ( uint32_t intf : list->intfs )
+            lists.append((const char*)&intf, sizeof(intf));
+    }
+
+    ReputationImageHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, image_magic, sizeof(h.magic));
+    h.version = image_version;
+    h.layout = image_layout();
+    h.num_lists = config.list_files.size();
+    h.lists_size = lists.size();
+    h.segment_offset = (sizeof(h) + lists.size() + image_align - 1) & ~(image_align - 1);
+    h.segment_size = config.segment_used;
+    sha256((const unsigned char*)lists.data(), lists.size(), h.lists_digest);
+    sha256(config.reputation_segment, config.segment_used, h.segment_digest);
+
+    std::string pad(h.segment_offset - sizeof(h) - lists.size(), '\0');
+    std::string tmp = path + ".XXXXXX";
+    int fd = mkstemp(&tmp[0]);
+
+    if ( fd < 0 )
+    {
+        ErrorMessage("reputation: can't create image %s: %s\n", path.c_str(), get_error(errno));
+        return false;
+    }
+
+    bool ok = !fchmod(fd, 0644) and write_all(fd, &h, sizeof(h)) and
+        write_all(fd, lists.data(), lists.size()) and write_all(fd, pad.data(), pad.size()) and
+        write_all(fd, config.reputation_segment, config.segment_used);
+
+    ok = !close(fd) and ok;
+
+    if ( !ok or rename(tmp.c_str(), path.c_str()) )
+    {
+        ErrorMessage("reputation: can't write image %s: %s\n", path.c_str(), get_error(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------
+// swap
+//--------------------------------------------------------------------------
+
+static void check_image(void* pv)
+{ ((ReputationImageSwap*)pv)->check(); }
+
+ReputationImageSwap::ReputationImageSwap(
+    const std::string& p, AllowAction aa, ReputationImage* image) :
+    path(p), allow_action(aa), current(image)
+{
+    num_readers = ThreadConfig::get_instance_max();
+    readers = new Reader[num_readers];
+    Periodic::register_handler(check_image, this, 0, image_check_period);
+}
+
+ReputationImageSwap::~ReputationImageSwap()
+{
+    Periodic::unregister_handler(check_image, this);
+
+    for ( auto& r : retired )
+        delete r.second;
+
+    delete current.load();
+    delete[] readers;
+}
+
+// the generation is loaded before the image and a thread publishes the
+// generation it picked up before loading the image, so once a thread has
+// seen a generation it can no longer get an image replaced before it.
+const ReputationImage* ReputationImageSwap::get()
+{
+    assert(get_instance_id() < num_readers);
+    Reader& r = readers[get_instance_id()];
+    uint64_t g = generation.load();
+
+    if ( r.seen.load(std::memory_order_relaxed) != g )
+    {
+        r.seen.store(g);
+        r.image = current.load();
+    }
+    return r.image;
+}
+
+void ReputationImageSwap::release()
+{
+    Reader& r = readers[get_instance_id()];
+    r.seen.store(0);
+    r.image = nullptr;
+}
+
+// a retired image is freed once every active thread has picked up the
+// generation that replaced it.  threads that haven't started or have
+// released don't hold an image and will get the current one next.
+void ReputationImageSwap::free_retired()
+{
+    uint64_t oldest = UINT64_MAX;
+
+    for ( unsigned i = 0; i < num_readers; ++i )
+    {
+        uint64_t seen = readers[i].seen.load();
+
+        if ( seen and seen < oldest )
+            oldest = seen;
+    }
+
+    auto it = retired.begin();
+
+    while ( it != retired.end() )
+    {
+        if ( it->first <= oldest )
+        {
+            delete it->second;
+            it = retired.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+void ReputationImageSwap::check()
+{
+    free_retired();
+
+    if ( !current.load()->changed(path) )
+        return;
+
+    struct stat st;
+
+    if ( stat(path.c_str(), &st) or same_file(st, rejected) )
+        return;
+
+    ReputationImage* image = ReputationImage::load(path, allow_action);
+
+    if ( !image )
+    {
+        // don't try again until the file is replaced
+        rejected = st;
+        return;
+    }
+
+    ReputationImage* old = current.exchange(image);
+    uint64_t g = generation.load() + 1;
+    retired.emplace_back(g, old);
+    generation.store(g);
+
+    LogMessage("reputation: swapped in image %s\n", path.c_str());
+}
+
+//--------------------------------------------------------------------------
+// unit tests
+//--------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+#include <fstream>
+#include <iterator>
+
+#include "catch/snort_catch.h"
+#include "sfip/sf_ip.h"
+
+static std::string temp_dir()
+{
+    char dir[] = "/tmp/reputation_image_XXXXXX";
+    CHECK(mkdtemp(dir));
+    return dir;
+}
+
+static std::string read_file(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// written under another name and renamed like save_reputation_image() does
+static void replace_file(const std::string& path, const std::string& data)
+{
+    std::string tmp = path + ".new";
+    std::ofstream(tmp, std::ios::binary).write(data.data(), data.size());
+    CHECK(!rename(tmp.c_str(), path.c_str()));
+}
+
+// one block list with the given addresses, restricted to interfaces 3 and 7
+static void build_config(ReputationConfig& config, const std::string& dir,
+    const std::string& addrs)
+{
+    config.blocklist_path = dir + "/block.list";
+    replace_file(config.blocklist_path, addrs);
+
+    add_block_allow_List(&config);
+    estimate_num_entries(&config);
+    ip_list_init(config.num_entries + 1, &config);
+    REQUIRE(config.ip_list);
+
+    config.list_files[0]->list_id = 42;
+    config.list_files[0]->all_intfs_enabled = false;
+    config.list_files[0]->intfs = { 3, 7 };
+}
+
+static const IPrepInfo* lookup(const ReputationImage* image, const char* addr)
+{
+    SfIp ip;
+    CHECK(ip.set(addr) == SFIP_SUCCESS);
+    return (const IPrepInfo*)sfrt_flat_dir8x_lookup(&ip, image->get_ip_list());
+}
+
+TEST_CASE("reputation image round trip", "[reputation_image]")
+{
+    std::string dir = temp_dir();
+    std::string path = dir + "/rep.img";
+
+    ReputationConfig config;
+    build_config(config, dir, "10.1.2.3\n192.168.10.0/24\n");
+    CHECK(save_reputation_image(config, path));
+
+    ReputationImage* image = ReputationImage::load(path, TRUST);
+    REQUIRE(image);
+    CHECK(image->get_size() == read_file(path).size());
+
+    const ListFiles& lists = image->get_list_files();
+    REQUIRE(lists.size() == 1);
+    CHECK(lists[0]->list_id == 42);
+    CHECK(lists[0]->list_index == 1);
+    CHECK(lists[0]->list_type == BLOCKED);
+    CHECK(!lists[0]->all_intfs_enabled);
+    CHECK(lists[0]->intfs == std::set<unsigned>({ 3, 7 }));
+
+    const IPrepInfo* info = lookup(image, "10.1.2.3");
+    REQUIRE(info);
+    CHECK(info->list_indexes[0] == 1);
+
+    info = lookup(image, "192.168.10.77");
+    REQUIRE(info);
+    CHECK(info->list_indexes[0] == 1);
+
+    CHECK(!lookup(image, "10.1.2.4"));
+    CHECK(!image->changed(path));
+
+    delete image;
+}
+
+TEST_CASE("reputation image rejected", "[reputation_image]")
+{
+    std::string dir = temp_dir();
+    std::string path = dir + "/rep.img";
+
+    ReputationConfig config;
+    build_config(config, dir, "10.1.2.3\n");
+    CHECK(save_reputation_image(config, path));
+
+    std::string data = read_file(path);
+    REQUIRE(data.size() > sizeof(ReputationImageHeader) + sizeof(ReputationImageList));
+
+    ReputationImageHeader h;
+    memcpy(&h, data.data(), sizeof(h));
+
+    SECTION("truncated")
+    {
+        replace_file(path, data.substr(0, data.size() - 1));
+        CHECK(!ReputationImage::load(path, TRUST));
+
+        replace_file(path, data.substr(0, sizeof(h) - 1));
+        CHECK(!ReputationImage::load(path, TRUST));
+    }
+    SECTION("wrong layout")
+    {
+        h.layout ^= 1;
+        memcpy(&data[0], &h, sizeof(h));
+        replace_file(path, data);
+        CHECK(!ReputationImage::load(path, TRUST));
+    }
+    SECTION("bad list index")
+    {
+        // the digest is fixed up so only the index is wrong
+        ReputationImageList rec;
+        memcpy(&rec, &data[sizeof(h)], sizeof(rec));
+        rec.list_index = 2;
+        memcpy(&data[sizeof(h)], &rec, sizeof(rec));
+
+        sha256((const uint8_t*)&data[sizeof(h)], h.lists_size, h.lists_digest);
+        memcpy(&data[0], &h, sizeof(h));
+        replace_file(path, data);
+        CHECK(!ReputationImage::load(path, TRUST));
+    }
+    SECTION("damaged segment")
+    {
+        data[h.segment_offset] ^= 1;
+        replace_file(path, data);
+        CHECK(!ReputationImage::load(path, TRUST));
+    }
+}
+
+TEST_CASE("reputation image swap", "[reputation_image]")
+{
+    std::string dir = temp_dir();
+    std::string path = dir + "/rep.img";
+
+    ReputationConfig first;
+    build_config(first, dir, "10.1.2.3\n");
+    CHECK(save_reputation_image(first, path));
+
+    unsigned max = ThreadConfig::get_instance_max();
+    ThreadConfig::set_instance_max(2);
+
+    ReputationImage* image = ReputationImage::load(path, TRUST);
+    REQUIRE(image);
+    ReputationImageSwap swap(path, TRUST, image);
+
+    set_instance_id(0);
+    CHECK(swap.get() == image);
+    set_instance_id(1);
+    CHECK(swap.get() == image);
+
+    swap.check();
+    CHECK(swap.get_num_retired() == 0);
+
+    ReputationConfig second;
+    build_config(second, dir, "10.4.5.6\n");
+    CHECK(save_reputation_image(second, path));
+    swap.check();
+    CHECK(swap.get_num_retired() == 1);
+
+    // thread 0 moves on while thread 1 still holds the first image
+    set_instance_id(0);
+    const ReputationImage* current = swap.get();
+    CHECK(current != image);
+    CHECK(lookup(current, "10.4.5.6"));
+
+    swap.check();
+    CHECK(swap.get_num_retired() == 1);
+
+    set_instance_id(1);
+    CHECK(swap.get() == current);
+    swap.check();
+    CHECK(swap.get_num_retired() == 0);
+
+    // a damaged replacement is rejected and the current image kept
+    replace_file(path, "not an image");
+    swap.check();
+    CHECK(swap.get() == current);
+    CHECK(swap.get_num_retired() == 0);
+
+    swap.release();
+    set_instance_id(0);
+    swap.release();
+    ThreadConfig::set_instance_max(max);
+}
+
+#endif
@@ -0,0 +1,119 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// reputation_image.h
+
+#ifndef REPUTATION_IMAGE_H
+#define REPUTATION_IMAGE_H
+
+// A reputation image is the IP list segment built from the lists, saved with
+// the details of the lists its entries refer to.  The segment only holds
+// offsets, so the image is mapped read only and used in place instead of
+// parsing the lists again, and one mapping is shared by all packet threads.
+
+#include <sys/stat.h>
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "reputation_config.h"
+
+class ReputationImage
+{
+public:
+    // returns nullptr if the file can't be mapped or isn't a usable image
+    static ReputationImage* load(const std::string& path, AllowAction);
+    ~ReputationImage();
+
+    // true if the file at path has been replaced since it was mapped
+    bool changed(const std::string& path) const;
+
+    table_flat_t* get_ip_list() const
+    { return ip_list; }
+
+    const ListFiles& get_list_files() const
+    { return list_files; }
+
+    size_t get_size() const
+    { return map_size; }
+
+private:
+    ReputationImage(void* map, size_t size, const struct stat&);
+    bool parse(AllowAction);
+
+private:
+    void* map;
+    size_t map_size;
+    struct stat file;
+    table_flat_t* ip_list = nullptr;
+    ListFiles list_files;
+};
+
+// write the IP list and list files of a loaded config to path.  the image is
+// written under a temporary name and renamed so it never appears partially.
+bool save_reputation_image(const ReputationConfig&, const std::string& path);
+
+// Packet threads get the current image with get().  The main thread checks
+// the file periodically and swaps in a new image when it is replaced.  Each
+// packet thread notes the generation it last picked up, and a replaced image
+// is unmapped once every packet thread has picked up a later one.
+class ReputationImageSwap
+{
+public:
+    ReputationImageSwap(const std::string& path, AllowAction, ReputationImage*);
+    ~ReputationImageSwap();
+
+    // packet threads
+    const ReputationImage* get();
+    void release();
+
+    // main thread
+    void check();
+
+#ifdef UNIT_TEST
+    size_t get_num_retired() const
+    { return retired.size(); }
+#endif
+
+private:
+    void free_retired();
+
+    struct Reader
+    {
+        std::atomic<uint64_t> seen { 0 };
+        const ReputationImage* image = nullptr;
+        char pad[48];
+    };
+
+private:
+    std::string path;
+    AllowAction allow_action;
+    std::atomic<ReputationImage*> current;
+    std::atomic<uint64_t> generation { 1 };
+
+    Reader* readers;
+    unsigned num_readers;
+
+    std::vector<std::pair<uint64_t, ReputationImage*>> retired;
+    struct stat rejected = { };
+};
+
+#endif
+
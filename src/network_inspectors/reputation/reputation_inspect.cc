@@ -35,6 +35,7 @@
 #include "protocols/packet.h"
 
 
+#include "reputation_image.h"
 #include "reputation_parse.h"
 
 using namespace snort;
@@ -68,12 +69,15 @@ const char* AllowActionOption[] =
     nullptr
 };
 
-/*
- * Function prototype(s)
- */
-static void snort_reputation(ReputationConfig* GlobalConf, Packet* p);
+// the lists come from the config or from a mapped image
+struct IpLists
+{
+    table_flat_t* table;
+    const ListFiles* files;
+};
 
-static inline IPrepInfo* reputation_lookup(ReputationConfig* config, const SfIp* ip)
+static inline IPrepInfo* reputation_lookup(
+    ReputationConfig* config, const IpLists& lists, const SfIp* ip)
 {
     IPrepInfo* result;
 
@@ -85,19 +89,19 @@ static inline IPrepInfo* reputation_lookup(ReputationConfig* config, const SfIp*
         }
     }
 
-    result = (IPrepInfo*)sfrt_flat_dir8x_lookup(ip, config->ip_list);
+    result = (IPrepInfo*)sfrt_flat_dir8x_lookup(ip, lists.table);
 
     return (result);
 }
 
-static inline IPdecision get_reputation(ReputationConfig* config, IPrepInfo* rep_info,
-    uint32_t* listid, uint32_t ingress_intf, uint32_t egress_intf)
+static inline IPdecision get_reputation(ReputationConfig* config, const IpLists& lists,
+    IPrepInfo* rep_info, uint32_t* listid, uint32_t ingress_intf, uint32_t egress_intf)
 {
     IPdecision decision = DECISION_NULL;
 
     /*Walk through the IPrepInfo lists*/
-    uint8_t* base = (uint8_t*)config->ip_list;
-    ListFiles& list_info =  config->list_files;
+    uint8_t* base = (uint8_t*)lists.table;
+    const ListFiles& list_info = *lists.files;
 
     while (rep_info)
     {
@@ -135,7 +139,7 @@ static inline IPdecision get_reputation(ReputationConfig* config, IPrepInfo* rep
     return decision;
 }
 
-static bool decision_per_layer(ReputationConfig* config, Packet* p,
+static bool decision_per_layer(ReputationConfig* config, const IpLists& lists, Packet* p,
     uint32_t ingress_intf, uint32_t egress_intf, const ip::IpApi& ip_api, IPdecision* decision_final)
 {
     const SfIp* ip;
@@ -143,10 +147,11 @@ static bool decision_per_layer(ReputationConfig* config, Packet* p,
     IPrepInfo* result;
 
     ip = ip_api.get_src();
-    result = reputation_lookup(config, ip);
+    result = reputation_lookup(config, lists, ip);
     if (result)
     {
-        decision = get_reputation(config, result, &p->iplist_id, ingress_intf, egress_intf);
+        decision = get_reputation(
+            config, lists, result, &p->iplist_id, ingress_intf, egress_intf);
 
         if (decision == BLOCKED)
             *decision_final = BLOCKED_SRC;
@@ -162,10 +167,11 @@ static bool decision_per_layer(ReputationConfig* config, Packet* p,
     }
 
     ip = ip_api.get_dst();
-    result = reputation_lookup(config, ip);
+    result = reputation_lookup(config, lists, ip);
     if (result)
     {
-        decision = get_reputation(config, result, &p->iplist_id, ingress_intf, egress_intf);
+        decision = get_reputation(
+            config, lists, result, &p->iplist_id, ingress_intf, egress_intf);
 
         if (decision == BLOCKED)
             *decision_final = BLOCKED_DST;
@@ -183,7 +189,7 @@ static bool decision_per_layer(ReputationConfig* config, Packet* p,
     return false;
 }
 
-static IPdecision reputation_decision(ReputationConfig* config, Packet* p)
+static IPdecision reputation_decision(ReputationConfig* config, const IpLists& lists, Packet* p)
 {
     IPdecision decision_final = DECISION_NULL;
     uint32_t ingress_intf = 0;
@@ -200,7 +206,8 @@ static IPdecision reputation_decision(ReputationConfig* config, Packet* p)
 
     if (config->nested_ip == INNER)
     {
-        decision_per_layer(config, p, ingress_intf, egress_intf, p->ptrs.ip_api, &decision_final);
+        decision_per_layer(
+            config, lists, p, ingress_intf, egress_intf, p->ptrs.ip_api, &decision_final);
         return decision_final;
     }
 
@@ -213,7 +220,8 @@ static IPdecision reputation_decision(ReputationConfig* config, Packet* p)
     if (config->nested_ip == OUTER)
     {
         layer::set_outer_ip_api(p, p->ptrs.ip_api, p->ip_proto_next, num_layer);
-        decision_per_layer(config, p, ingress_intf, egress_intf, p->ptrs.ip_api, &decision_final);
+        decision_per_layer(
+            config, lists, p, ingress_intf, egress_intf, p->ptrs.ip_api, &decision_final);
     }
     else if (config->nested_ip == ALL)
     {
@@ -222,8 +230,8 @@ static IPdecision reputation_decision(ReputationConfig* config, Packet* p)
 
         while (!done and layer::set_outer_ip_api(p, p->ptrs.ip_api, p->ip_proto_next, num_layer))
         {
-            done = decision_per_layer(config, p, ingress_intf, egress_intf, p->ptrs.ip_api,
-                &decision_current);
+            done = decision_per_layer(config, lists, p, ingress_intf, egress_intf,
+                p->ptrs.ip_api, &decision_current);
             if (decision_current != DECISION_NULL)
             {
                 if (decision_current == BLOCKED_SRC or decision_current == BLOCKED_DST)
@@ -245,14 +253,14 @@ static IPdecision reputation_decision(ReputationConfig* config, Packet* p)
     return decision_final;
 }
 
-static void snort_reputation(ReputationConfig* config, Packet* p)
+static void snort_reputation(ReputationConfig* config, const IpLists& lists, Packet* p)
 {
     IPdecision decision;
 
-    if (!config->ip_list)
+    if (!lists.table)
         return;
 
-    decision = reputation_decision(config, p);
+    decision = reputation_decision(config, lists, p);
     Active* act = p->active;
 
     if (DECISION_NULL == decision)
@@ -389,6 +397,22 @@ Reputation::Reputation(ReputationConfig* pc)
     reputation_id = create_reputation_id();
     config = *pc;
     ReputationConfig* conf = &config;
+
+    if (!config.image.empty())
+    {
+        ReputationImage* image = ReputationImage::load(config.image, config.allow_action);
+
+        if (!image)
+        {
+            ParseError("reputation: can't load image %s", config.image.c_str());
+            return;
+        }
+
+        images = new ReputationImageSwap(config.image, config.allow_action, image);
+        reputationstats.memory_allocated = image->get_size();
+        return;
+    }
+
     if (!config.list_dir.empty())
         read_manifest(MANIFEST_FILENAME, conf);
 
@@ -403,6 +427,14 @@ Reputation::Reputation(ReputationConfig* pc)
 
     ip_list_init(conf->num_entries + 1, conf);
     reputationstats.memory_allocated = sfrt_flat_usage(conf->ip_list);
+
+    if (!config.save_image.empty() and save_reputation_image(config, config.save_image))
+        LogMessage("reputation: saved image %s\n", config.save_image.c_str());
+}
+
+Reputation::~Reputation()
+{
+    delete images;
 }
 
 void Reputation::show(const SnortConfig*) const
@@ -415,6 +447,8 @@ void Reputation::show(const SnortConfig*) const
     ConfigLogger::log_flag("scan_local", config.scanlocal);
     ConfigLogger::log_value("allow (action)", to_string(config.allow_action));
     ConfigLogger::log_value("allowlist", config.allowlist_path.c_str());
+    ConfigLogger::log_value("image", config.image.c_str());
+    ConfigLogger::log_value("save_image", config.save_image.c_str());
 }
 
 void Reputation::eval(Packet* p)
@@ -435,10 +469,26 @@ void Reputation::eval(Packet* p)
             p->flow->reputation_id = reputation_id; // disable future reputation checking
     }
 
-    snort_reputation(&config, p);
+    IpLists lists;
+
+    if (images)
+    {
+        const ReputationImage* image = images->get();
+        lists = { image->get_ip_list(), &image->get_list_files() };
+    }
+    else
+        lists = { config.ip_list, &config.list_files };
+
+    snort_reputation(&config, lists, p);
     ++reputationstats.packets;
 }
 
+void Reputation::tterm()
+{
+    if (images)
+        images->release();
+}
+
 //-------------------------------------------------------------------------
 // api stuff
 //-------------------------------------------------------------------------
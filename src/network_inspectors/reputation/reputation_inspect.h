@@ -23,16 +23,21 @@
 
 #include "reputation_module.h"
 
+class ReputationImageSwap;
+
 class Reputation : public snort::Inspector
 {
 public:
     Reputation(ReputationConfig*);
+    ~Reputation() override;
 
     void show(const snort::SnortConfig*) const override;
     void eval(snort::Packet*) override;
+    void tterm() override;
 
 private:
     ReputationConfig config;
+    ReputationImageSwap* images = nullptr;
     unsigned reputation_id;
 };
 
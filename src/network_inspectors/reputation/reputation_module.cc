@@ -84,6 +84,13 @@ static const Parameter s_params[] =
     { "whitelist", Parameter::PT_STRING, nullptr, nullptr,
       "whitelist file name with IP lists" },
 
+    { "image", Parameter::PT_STRING, nullptr, nullptr,
+      "precompiled reputation image to map instead of loading the lists; "
+      "update it by renaming a new image over it, not by writing it in place" },
+
+    { "save_image", Parameter::PT_STRING, nullptr, nullptr,
+      "write the loaded lists to this reputation image" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -172,6 +179,12 @@ bool ReputationModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("allowlist") or v.is("whitelist") )
         conf->allowlist_path = v.get_string();
 
+    else if ( v.is("image") )
+        conf->image = v.get_string();
+
+    else if ( v.is("save_image") )
+        conf->save_image = v.get_string();
+
     else
         return false;
 
@@ -137,21 +137,27 @@ void ip_list_init(uint32_t max_entries, ReputationConfig* config)
         for (size_t i = 0; i < config->list_files.size(); i++)
         {
             config->list_files[i]->list_index = (uint8_t)i + 1;
-            if (config->list_files[i]->file_type == ALLOW_LIST)
-            {
-                if (config->allow_action == DO_NOT_BLOCK)
-                    config->list_files[i]->list_type = TRUSTED_DO_NOT_BLOCK;
-                else
-                    config->list_files[i]->list_type = TRUSTED;
-            }
-            else if (config->list_files[i]->file_type == BLOCK_LIST)
-                config->list_files[i]->list_type = BLOCKED;
-            else if (config->list_files[i]->file_type == MONITOR_LIST)
-                config->list_files[i]->list_type = MONITORED;
-
+            set_list_type(config->list_files[i], config->allow_action);
             load_list_file(config->list_files[i], config);
         }
+
+        config->segment_used = mem_size - segment_unusedmem();
+    }
+}
+
+void set_list_type(ListFile* list_file, AllowAction allow_action)
+{
+    if (list_file->file_type == ALLOW_LIST)
+    {
+        if (allow_action == DO_NOT_BLOCK)
+            list_file->list_type = TRUSTED_DO_NOT_BLOCK;
+        else
+            list_file->list_type = TRUSTED;
     }
+    else if (list_file->file_type == BLOCK_LIST)
+        list_file->list_type = BLOCKED;
+    else if (list_file->file_type == MONITOR_LIST)
+        list_file->list_type = MONITORED;
 }
 
 static inline IPrepInfo* get_last_index(IPrepInfo* rep_info, uint8_t* base, int* last_index)
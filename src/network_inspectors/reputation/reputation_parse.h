@@ -28,5 +28,6 @@ void ip_list_init(uint32_t,ReputationConfig *config);
 void estimate_num_entries(ReputationConfig* config);
 int read_manifest(const char* filename, ReputationConfig* config);
 void add_block_allow_List(ReputationConfig* config);
+void set_list_type(ListFile*, AllowAction);
 
 #endif
@@ -56,6 +56,13 @@ public:
             return daq_msgs[curr_batch_idx++];
         return nullptr;
     }
+
+    // messages received but not yet returned by next_message()
+    const DAQ_Msg_h* get_pending_messages(unsigned& num) const
+    {
+        num = curr_batch_size - curr_batch_idx;
+        return daq_msgs + curr_batch_idx;
+    }
     int finalize_message(DAQ_Msg_h msg, DAQ_Verdict verdict);
     const char* get_error();
 
@@ -30,11 +30,14 @@
 #include "main/snort_config.h"
 #include "main/thread_config.h"
 #include "time/stopwatch.h"
+#include "utils/stats.h"
 
 #include "memory_context.h"
 #include "memory_profiler.h"
 #include "profiler_nodes.h"
+#include "profiler_snapshot.h"
 #include "rule_profiler.h"
+#include "sample_profiler.h"
 #include "time_profiler.h"
 
 #ifdef UNIT_TEST
@@ -76,11 +79,16 @@ void Profiler::start()
 {
     run_timer = new Stopwatch<SnortClock>;
     run_timer->start();
+
+    if ( SampleStack::is_enabled() )
+        SampleProfiler::start(SnortConfig::get_conf()->get_profiler()->sample.rate);
 }
 
 void Profiler::stop(uint64_t checks)
 {
     run_timer->stop();
+    SampleProfiler::stop();
+
     totalPerfStats.time.elapsed = run_timer->get();
     totalPerfStats.time.checks = checks;
 
@@ -92,6 +100,7 @@ void Profiler::consolidate_stats()
 {
     s_profiler_nodes.accumulate_nodes();
     MemoryProfiler::consolidate_fallthrough_stats();
+    SampleProfiler::consolidate(s_profiler_nodes);
 }
 
 void Profiler::reset_stats()
@@ -100,6 +109,12 @@ void Profiler::reset_stats()
     reset_rule_profiler_stats();
 }
 
+void Profiler::snapshot_stats(ProfilerSnapshot& snap)
+{
+    hr_duration runtime = run_timer ? run_timer->get() : 0_ticks;
+    snap.add_thread_stats(s_profiler_nodes, runtime, pc.analyzed_pkts);
+}
+
 void Profiler::show_stats()
 {
     const ProfilerNode& root = s_profiler_nodes.get_root();
@@ -122,6 +137,7 @@ void Profiler::show_stats()
     show_time_profiler_stats(s_profiler_nodes, config->time);
     show_memory_profiler_stats(s_profiler_nodes, config->memory);
     show_rule_profiler_stats(config->rule);
+    SampleProfiler::show(config->sample);
 }
 
 #ifdef UNIT_TEST
@@ -28,6 +28,7 @@ namespace snort
 {
 class Module;
 }
+class ProfilerSnapshot;
 
 class Profiler
 {
@@ -42,6 +43,9 @@ public:
 
     static void reset_stats();
     static void show_stats();
+
+    // thread local call; adds current stats without consolidating them
+    static void snapshot_stats(ProfilerSnapshot&);
 };
 
 extern THREAD_LOCAL snort::ProfileStats totalPerfStats;
@@ -26,6 +26,7 @@
 #include "memory_defs.h"
 #include "memory_profiler_defs.h"
 #include "rule_profiler_defs.h"
+#include "sample_profiler_defs.h"
 #include "time_profiler_defs.h"
 
 namespace snort
@@ -38,6 +39,7 @@ struct ProfilerConfig
     TimeProfilerConfig time;
     RuleProfilerConfig rule;
     MemoryProfilerConfig memory;
+    SampleProfilerConfig sample;
 };
 
 struct SO_PUBLIC ProfileStats
@@ -76,7 +78,8 @@ inline ProfileStats& ProfileStats::operator+=(const ProfileStats& rhs)
 class SO_PUBLIC ProfileContext
 {
 public:
-    ProfileContext(ProfileStats& stats) : time(stats.time), memory(stats.memory)
+    ProfileContext(ProfileStats& stats) :
+        time(stats.time), memory(stats.memory), sample(&stats)
     {
         prev_time = curr_time;
         if ( prev_time )
@@ -94,6 +97,7 @@ public:
 private:
     TimeContext time;
     MemoryContext memory;
+    SampleContext sample;
     TimeContext* prev_time;
     static THREAD_LOCAL TimeContext* curr_time;
 };
@@ -104,10 +108,11 @@ class NoMemContext
 {
 public:
     NoMemContext(ProfileStats& stats) :
-        time(stats.time) { }
+        time(stats.time), sample(&stats) { }
 
 private:
     TimeContext time;
+    SampleContext sample;
 };
 
 class ProfileDisabled
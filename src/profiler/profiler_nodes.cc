@@ -110,18 +110,15 @@ void ProfilerNode::set(get_profile_stats_fn fn)
 
 void ProfilerNode::accumulate()
 {
-    if ( is_set() )
-    {
-        const auto* local_stats = (*getter)();
-
-        if ( !local_stats )
-            return;
+    const auto* local_stats = get_local_stats();
 
-        get_stats();
+    if ( local_stats )
         stats += *local_stats;
-    }
 }
 
+const ProfileStats* ProfilerNode::get_local_stats() const
+{ return is_set() ? (*getter)() : nullptr; }
+
 void ProfilerNodeMap::register_node(const std::string &n, const char* pn, Module* m)
 { setup_node(get_node(n), get_node(pn ? pn : ROOT_NODE), m); }
 
@@ -0,0 +1,430 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// profiler_snapshot.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "profiler_snapshot.h"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "detection/detection_options.h"
+#include "detection/treenodes.h"
+#include "hash/ghash.h"
+#include "helpers/json_stream.h"
+#include "main/snort_config.h"
+#include "main/thread_config.h"
+
+#include "profiler.h"
+#include "profiler_nodes.h"
+#include "profiler_stats_table.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+// the last snapshot taken by the reset command; main thread only
+static ProfilerSnapshot* s_baseline = nullptr;
+
+//-------------------------------------------------------------------------
+// collection
+//-------------------------------------------------------------------------
+
+void ProfilerSnapshot::add_thread_stats(
+    const ProfilerNodeMap& nodes, hr_duration runtime, uint64_t packets)
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    hr_duration sum = 0_ticks;
+
+    for ( const auto& it : nodes )
+    {
+        const auto& node = it.second;
+
+        // total and other are only filled in at shutdown so derive them from
+        // the run time, as Profiler::show_stats() does
+        if ( node.name == ROOT_NODE )
+        {
+            modules[node.name] += TimeProfilerStats(runtime, packets);
+
+            for ( const auto* child : node.get_children() )
+            {
+                const auto* ps = child->get_local_stats();
+
+                if ( ps )
+                    sum += ps->time.elapsed;
+            }
+            continue;
+        }
+
+        if ( node.name == FLEX_NODE )
+            continue;
+
+        const auto* ps = node.get_local_stats();
+
+        if ( ps and ps->time )
+            modules[node.name] += ps->time;
+    }
+
+    if ( runtime > sum )
+        modules[FLEX_NODE] += TimeProfilerStats(runtime - sum, packets);
+
+    ++threads;
+}
+
+void ProfilerSnapshot::add_rule_stats()
+{
+    const SnortConfig* sc = SnortConfig::get_conf();
+    assert(sc);
+
+    std::unordered_map<const OptTreeNode*, OtnState> tree_stats;
+    detection_option_tree_get_otn_stats(sc->detection_option_tree_hash_table, tree_stats);
+
+    auto* otn_map = sc->otn_map;
+
+    for ( auto* h = otn_map->find_first(); h; h = otn_map->find_next() )
+    {
+        auto* otn = static_cast<OptTreeNode*>(h->data);
+        assert(otn);
+
+        // same totals as consolidating the otn states at shutdown
+        RuleStats rs;
+
+        for ( unsigned i = 0; i < ThreadConfig::get_instance_max(); ++i )
+        {
+            const auto& state = otn->state[i];
+
+            rs.elapsed += state.elapsed;
+            rs.elapsed_match += state.elapsed_match;
+            rs.checks += state.checks;
+            rs.matches += state.matches;
+            rs.alerts += state.alerts;
+            rs.timeouts += state.latency_timeouts;
+            rs.suspends += state.latency_suspends;
+        }
+
+        auto it = tree_stats.find(otn);
+
+        if ( it != tree_stats.end() )
+        {
+            const auto& state = it->second;
+
+            rs.elapsed += state.elapsed;
+            rs.elapsed_match += state.elapsed_match;
+            rs.checks = std::max(rs.checks, state.checks);
+            rs.timeouts += state.latency_timeouts;
+            rs.suspends += state.latency_suspends;
+        }
+
+        if ( rs.elapsed <= 0_ticks and !rs.checks )
+            continue;
+
+        rs.rev = otn->sigInfo.rev;
+        rules[{ otn->sigInfo.gid, otn->sigInfo.sid }] = rs;
+    }
+}
+
+template<typename T>
+static inline void sub(T& lhs, const T& rhs)
+{
+    // a counter that went backwards was cleared, eg by a reload
+    if ( lhs >= rhs )
+        lhs -= rhs;
+}
+
+void ProfilerSnapshot::subtract(const ProfilerSnapshot& baseline)
+{
+    for ( auto& it : modules )
+    {
+        auto b = baseline.modules.find(it.first);
+
+        if ( b == baseline.modules.end() )
+            continue;
+
+        sub(it.second.elapsed, b->second.elapsed);
+        sub(it.second.checks, b->second.checks);
+    }
+
+    for ( auto& it : rules )
+    {
+        auto b = baseline.rules.find(it.first);
+
+        if ( b == baseline.rules.end() )
+            continue;
+
+        auto& rs = it.second;
+        const auto& brs = b->second;
+
+        sub(rs.elapsed, brs.elapsed);
+        sub(rs.elapsed_match, brs.elapsed_match);
+        sub(rs.checks, brs.checks);
+        sub(rs.matches, brs.matches);
+        sub(rs.alerts, brs.alerts);
+        sub(rs.timeouts, brs.timeouts);
+        sub(rs.suspends, brs.suspends);
+    }
+}
+
+//-------------------------------------------------------------------------
+// output
+//-------------------------------------------------------------------------
+
+using ModuleEntry = std::pair<std::string, TimeProfilerStats>;
+using RuleEntry = std::pair<std::pair<uint32_t, uint32_t>, ProfilerSnapshot::RuleStats>;
+
+static inline hr_duration time_per(hr_duration d, uint64_t n)
+{ return n ? hr_duration(TO_TICKS(d) / n) : 0_ticks; }
+
+static inline long usecs(hr_duration d)
+{ return clock_usecs(TO_USECS(d)); }
+
+// worst first, by total time, as with the default shutdown output
+template<typename Map, typename Entry>
+static std::vector<Entry> get_worst(const Map& map, unsigned count)
+{
+    std::vector<Entry> entries;
+
+    for ( const auto& it : map )
+        if ( it.second.elapsed > 0_ticks or it.second.checks )
+            entries.emplace_back(it);
+
+    if ( !count or count > entries.size() )
+        count = entries.size();
+
+    std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+        [](const Entry& lhs, const Entry& rhs)
+        { return lhs.second.elapsed > rhs.second.elapsed; });
+
+    entries.resize(count);
+    return entries;
+}
+
+static const StatsTable::Field module_fields[] =
+{
+    { "#", 5, ' ', 0, std::ios_base::left },
+    { "module", 24, ' ', 0, std::ios_base::fmtflags() },
+    { "checks", 10, ' ', 0, std::ios_base::fmtflags() },
+    { "time(us)", 11, ' ', 0, std::ios_base::fmtflags() },
+    { "avg/check", 11, ' ', 1, std::ios_base::fmtflags() },
+    { "%/total", 9, ' ', 2, std::ios_base::fmtflags() },
+    { nullptr, 0, '\0', 0, std::ios_base::fmtflags() }
+};
+
+static const StatsTable::Field rule_fields[] =
+{
+    { "#", 5, '\0', 0, std::ios_base::left },
+    { "gid", 6, '\0', 0, std::ios_base::fmtflags() },
+    { "sid", 6, '\0', 0, std::ios_base::fmtflags() },
+    { "rev", 4, '\0', 0, std::ios_base::fmtflags() },
+    { "checks", 10, '\0', 0, std::ios_base::fmtflags() },
+    { "matches", 8, '\0', 0, std::ios_base::fmtflags() },
+    { "alerts", 7, '\0', 0, std::ios_base::fmtflags() },
+    { "time (us)", 10, '\0', 0, std::ios_base::fmtflags() },
+    { "avg/check", 10, '\0', 1, std::ios_base::fmtflags() },
+    { "avg/match", 10, '\0', 1, std::ios_base::fmtflags() },
+    { "avg/non-match", 14, '\0', 1, std::ios_base::fmtflags() },
+    { "timeouts", 9, '\0', 0, std::ios_base::fmtflags() },
+    { "suspends", 9, '\0', 0, std::ios_base::fmtflags() },
+    { nullptr, 0, '\0', 0, std::ios_base::fmtflags() }
+};
+
+static void print_title(
+    StatsTable& table, const char* title, unsigned count, unsigned threads, bool interval)
+{
+    table << StatsTable::SEP;
+    table << title << " (live, " << threads << (threads == 1 ? " thread" : " threads");
+    table << (interval ? ", since reset" : ", since start");
+
+    if ( count )
+        table << ", worst " << count;
+
+    table << ")\n";
+    table << StatsTable::HEADER;
+}
+
+std::string ProfilerSnapshot::get_text(const ProfilerConfig& config, bool interval) const
+{
+    std::ostringstream ss;
+
+    if ( config.time.show )
+    {
+        auto entries = get_worst<decltype(modules), ModuleEntry>(modules, config.time.count);
+        auto total = modules.find(ROOT_NODE);
+        TimeProfilerStats all = (total != modules.end()) ? total->second : TimeProfilerStats();
+
+        StatsTable table(module_fields, ss);
+        print_title(table, "module profile", config.time.count, threads, interval);
+
+        for ( unsigned i = 0; i < entries.size(); ++i )
+        {
+            const auto& e = entries[i];
+            double pct = (all.elapsed > 0_ticks) ?
+                double(TO_TICKS(e.second.elapsed)) / double(TO_TICKS(all.elapsed)) * 100.0 : 0.0;
+
+            table << StatsTable::ROW;
+            table << i + 1 << e.first << e.second.checks << usecs(e.second.elapsed);
+            table << usecs(time_per(e.second.elapsed, e.second.checks)) << pct;
+        }
+    }
+
+    if ( config.rule.show )
+    {
+        auto entries = get_worst<decltype(rules), RuleEntry>(rules, config.rule.count);
+
+        StatsTable table(rule_fields, ss);
+        print_title(table, "rule profile", config.rule.count, threads, interval);
+
+        for ( unsigned i = 0; i < entries.size(); ++i )
+        {
+            const auto& rs = entries[i].second;
+
+            table << StatsTable::ROW;
+            table << i + 1 << entries[i].first.first << entries[i].first.second << rs.rev;
+            table << rs.checks << rs.matches << rs.alerts << usecs(rs.elapsed);
+            table << usecs(time_per(rs.elapsed, rs.checks));
+            table << usecs(time_per(rs.elapsed_match, rs.matches));
+            table << usecs(time_per(rs.elapsed - rs.elapsed_match, rs.checks - rs.matches));
+            table << rs.timeouts << rs.suspends;
+        }
+    }
+
+    return ss.str();
+}
+
+std::string ProfilerSnapshot::get_json(const ProfilerConfig& config, bool interval) const
+{
+    std::ostringstream ss;
+    JsonStream json(ss);
+
+    json.open();
+    json.put("threads", threads);
+    json.put("interval", interval ? "reset" : "start");
+
+    if ( config.time.show )
+    {
+        auto entries = get_worst<decltype(modules), ModuleEntry>(modules, config.time.count);
+        json.open_array("modules");
+
+        for ( const auto& e : entries )
+        {
+            json.open();
+            json.put("module", e.first);
+            json.put("checks", e.second.checks);
+            json.put("time_us", usecs(e.second.elapsed));
+            json.put("avg_check_us", usecs(time_per(e.second.elapsed, e.second.checks)));
+            json.close();
+        }
+        json.close_array();
+    }
+
+    if ( config.rule.show )
+    {
+        auto entries = get_worst<decltype(rules), RuleEntry>(rules, config.rule.count);
+        json.open_array("rules");
+
+        for ( const auto& e : entries )
+        {
+            const auto& rs = e.second;
+
+            json.open();
+            json.put("gid", e.first.first);
+            json.put("sid", e.first.second);
+            json.put("rev", rs.rev);
+            json.put("checks", rs.checks);
+            json.put("matches", rs.matches);
+            json.put("alerts", rs.alerts);
+            json.put("time_us", usecs(rs.elapsed));
+            json.put("avg_check_us", usecs(time_per(rs.elapsed, rs.checks)));
+            json.put("timeouts", rs.timeouts);
+            json.put("suspends", rs.suspends);
+            json.close();
+        }
+        json.close_array();
+    }
+
+    json.close();
+    return ss.str();
+}
+
+//-------------------------------------------------------------------------
+// command
+//-------------------------------------------------------------------------
+
+bool ACProfilerSnapshot::execute(Analyzer&, void**)
+{
+    Profiler::snapshot_stats(*snapshot);
+    return true;
+}
+
+ACProfilerSnapshot::~ACProfilerSnapshot()
+{
+    snapshot->add_rule_stats();
+
+    if ( reset )
+    {
+        delete s_baseline;
+        s_baseline = snapshot;
+        request->respond("== profiler stats reset\n");
+        return;
+    }
+
+    const auto* config = SnortConfig::get_conf()->get_profiler();
+    assert(config);
+
+    if ( s_baseline )
+        snapshot->subtract(*s_baseline);
+
+    bool interval = s_baseline != nullptr;
+    std::string out = json ? snapshot->get_json(*config, interval) :
+        snapshot->get_text(*config, interval);
+
+    request->respond(out.c_str());
+    delete snapshot;
+}
+
+#ifdef UNIT_TEST
+
+TEST_CASE( "profiler snapshot subtract", "[profiler]" )
+{
+    ProfilerSnapshot baseline;
+    ProfilerSnapshot current;
+    ProfilerNodeMap nodes;
+
+    baseline.add_thread_stats(nodes, 10_ticks, 5);
+    current.add_thread_stats(nodes, 25_ticks, 12);
+    current.subtract(baseline);
+
+    ProfilerConfig config;
+    config.time.show = true;
+
+    // with no modules registered all of the run time is other
+    std::string text = current.get_json(config, true);
+    CHECK( text.find("\"module\": \"other\", \"checks\": 7") != std::string::npos );
+    CHECK( text.find("\"interval\": \"reset\"") != std::string::npos );
+}
+
+#endif
+
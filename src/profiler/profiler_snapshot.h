@@ -0,0 +1,93 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// profiler_snapshot.h
+
+#ifndef PROFILER_SNAPSHOT_H
+#define PROFILER_SNAPSHOT_H
+
+// ProfilerSnapshot collects the module and rule profile while packet threads
+// keep running.  Each packet thread adds its thread local module stats from an
+// analyzer command; the main thread adds the rule stats and formats the result
+// once every thread has contributed.  Nothing is reset or consolidated so the
+// shutdown output is unchanged.  A snapshot taken by the reset command is kept
+// as a baseline and subtracted from later snapshots to give interval deltas.
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "main/analyzer_command.h"
+
+#include "profiler_defs.h"
+
+class ProfilerNodeMap;
+
+class ProfilerSnapshot
+{
+public:
+    // packet thread call
+    void add_thread_stats(const ProfilerNodeMap&, hr_duration runtime, uint64_t packets);
+
+    // main thread calls, after all packet threads have added their stats
+    void add_rule_stats();
+    void subtract(const ProfilerSnapshot& baseline);
+
+    std::string get_text(const snort::ProfilerConfig&, bool interval) const;
+    std::string get_json(const snort::ProfilerConfig&, bool interval) const;
+
+    struct RuleStats
+    {
+        uint32_t rev = 0;
+        hr_duration elapsed = 0_ticks;
+        hr_duration elapsed_match = 0_ticks;
+        uint64_t checks = 0;
+        uint64_t matches = 0;
+        uint64_t alerts = 0;
+        uint64_t timeouts = 0;
+        uint64_t suspends = 0;
+    };
+
+private:
+    std::mutex stats_mutex;
+    unsigned threads = 0;
+
+    std::map<std::string, snort::TimeProfilerStats> modules;
+    std::map<std::pair<uint32_t, uint32_t>, RuleStats> rules;  // by gid:sid
+};
+
+class ACProfilerSnapshot : public snort::AnalyzerCommand
+{
+public:
+    ACProfilerSnapshot(bool reset, bool json, SharedRequest request) :
+        reset(reset), json(json), request(request) { }
+
+    bool execute(Analyzer&, void**) override;
+    const char* stringify() override { return "PROFILER_SNAPSHOT"; }
+    ~ACProfilerSnapshot() override;
+
+private:
+    ProfilerSnapshot* snapshot = new ProfilerSnapshot;
+    bool reset;
+    bool json;
+    SharedRequest request;
+};
+
+#endif
+
@@ -0,0 +1,445 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// sample_profiler.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sample_profiler.h"
+
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "log/messages.h"
+#include "main/thread.h"
+#include "utils/util.h"
+
+#include "profiler_defs.h"
+#include "profiler_nodes.h"
+#include "profiler_stats_table.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+#if defined(HAVE_TIMER_CREATE) && defined(SIGEV_THREAD_ID)
+#define SAMPLE_TIMER
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif
+
+#define s_sample_table_title "sample profile"
+#define s_sample_file "profile_samples.folded"
+
+constexpr unsigned SampleStack::max_depth;
+
+bool SampleStack::enabled = false;
+THREAD_LOCAL uint64_t SampleStack::frames[SampleStack::max_depth];
+THREAD_LOCAL volatile unsigned SampleStack::depth = 0;
+
+//-------------------------------------------------------------------------
+// per thread sample counts
+//-------------------------------------------------------------------------
+
+namespace
+{
+
+// a stack that was deeper than max_depth has depth max_depth + 1
+struct Sample
+{
+    uint64_t frames[SampleStack::max_depth];
+    uint64_t count;
+    unsigned depth;
+};
+
+// fixed size so the signal handler never allocates
+struct SampleTable
+{
+    static constexpr unsigned size = 2048;
+    static constexpr unsigned probes = 8;
+
+    Sample slots[size];
+    uint64_t samples;
+    uint64_t dropped;  // no free slot for a new stack
+};
+
+} // anonymous namespace
+
+static THREAD_LOCAL SampleTable* s_table = nullptr;
+
+#ifdef SAMPLE_TIMER
+static THREAD_LOCAL timer_t s_timer;
+static THREAD_LOCAL bool s_timer_set = false;
+#endif
+
+static void count_sample(SampleTable& t, const uint64_t* frames, unsigned depth)
+{
+    unsigned n = std::min(depth, SampleStack::max_depth);
+    uint64_t h = depth;
+
+    for ( unsigned i = 0; i < n; ++i )
+        h = (h ^ frames[i]) * 0x100000001b3;
+
+    h ^= h >> 29;
+    ++t.samples;
+
+    for ( unsigned i = 0; i < SampleTable::probes; ++i )
+    {
+        Sample& s = t.slots[(h + i) & (SampleTable::size - 1)];
+
+        if ( !s.count )
+        {
+            std::copy(frames, frames + n, s.frames);
+            s.depth = std::min(depth, SampleStack::max_depth + 1);
+            s.count = 1;
+            return;
+        }
+
+        if ( s.depth == std::min(depth, SampleStack::max_depth + 1) and
+            std::equal(frames, frames + n, s.frames) )
+        {
+            ++s.count;
+            return;
+        }
+    }
+    ++t.dropped;
+}
+
+#ifdef SAMPLE_TIMER
+static void sample_handler(int)
+{
+    SampleTable* t = s_table;
+
+    if ( t )
+        count_sample(*t, SampleStack::frames, SampleStack::depth);
+}
+#endif
+
+//-------------------------------------------------------------------------
+// totals from all threads
+//-------------------------------------------------------------------------
+
+static std::mutex s_stats_mutex;
+static std::map<std::string, uint64_t> s_self;
+static std::map<std::string, uint64_t> s_total;
+static uint64_t s_samples = 0;
+static uint64_t s_dropped = 0;
+
+static std::string get_frame_name(
+    uint64_t frame, const std::unordered_map<uint64_t, const char*>& names)
+{
+    if ( SampleStack::is_rule(frame) )
+    {
+        frame >>= 1;
+        return std::to_string(frame >> 32) + ":" + std::to_string(frame & 0xFFFFFFFF);
+    }
+    auto it = names.find(frame);
+    return it != names.end() ? it->second : "unknown";
+}
+
+// writes one line per stack in the folded format used by flamegraph tools
+static void fold_samples(
+    const SampleTable& t, const std::unordered_map<uint64_t, const char*>& names,
+    std::ostream& out)
+{
+    for ( const auto& s : t.slots )
+    {
+        if ( !s.count )
+            continue;
+
+        std::string stack = ROOT_NODE;
+        std::string leaf = FLEX_NODE;
+        std::set<std::string> seen;
+
+        for ( unsigned i = 0; i < std::min(s.depth, SampleStack::max_depth); ++i )
+        {
+            leaf = get_frame_name(s.frames[i], names);
+            stack += ';';
+            stack += leaf;
+
+            // recursion is only counted once toward the total
+            if ( seen.insert(leaf).second )
+                s_total[leaf] += s.count;
+        }
+
+        if ( !s.depth )
+        {
+            stack += ';';
+            stack += leaf;
+            s_total[leaf] += s.count;
+        }
+        else if ( s.depth > SampleStack::max_depth )
+            stack += ";...";
+
+        s_self[leaf] += s.count;
+        out << stack << ' ' << s.count << '\n';
+    }
+}
+
+//-------------------------------------------------------------------------
+// api
+//-------------------------------------------------------------------------
+
+bool SampleProfiler::is_supported()
+{
+#ifdef SAMPLE_TIMER
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SampleProfiler::start(unsigned rate)
+{
+#ifdef SAMPLE_TIMER
+    if ( !rate )
+        return;
+
+    static std::once_flag handler_once;
+
+    std::call_once(handler_once, []()
+    {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        action.sa_handler = sample_handler;
+        sigaction(SIGPROF, &action, nullptr);
+    });
+
+    s_table = new SampleTable();
+
+    // the timer counts this thread's cpu time so idle threads aren't sampled
+    struct sigevent sev;
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGPROF;
+    sev.sigev_notify_thread_id = syscall(SYS_gettid);
+
+    if ( timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &s_timer) )
+    {
+        WarningMessage("profiler: can't create sample timer: %s\n", get_error(errno));
+        return;
+    }
+    s_timer_set = true;
+
+    long nsecs = 1000000000L / rate;
+    struct itimerspec its;
+    its.it_interval.tv_sec = nsecs / 1000000000L;
+    its.it_interval.tv_nsec = nsecs % 1000000000L;
+    its.it_value = its.it_interval;
+
+    timer_settime(s_timer, 0, &its, nullptr);
+#else
+    UNUSED(rate);
+#endif
+}
+
+void SampleProfiler::stop()
+{
+#ifdef SAMPLE_TIMER
+    if ( s_timer_set )
+    {
+        timer_delete(s_timer);
+        s_timer_set = false;
+    }
+#endif
+}
+
+void SampleProfiler::consolidate(const ProfilerNodeMap& nodes)
+{
+    SampleTable* t = s_table;
+
+    if ( !t )
+        return;
+
+    // a signal already queued will find no table
+    s_table = nullptr;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    // module frames are the addresses of this thread's stats
+    std::unordered_map<uint64_t, const char*> names;
+
+    for ( const auto& it : nodes )
+    {
+        const auto* ps = it.second.get_local_stats();
+
+        if ( ps )
+            names[(uint64_t)(uintptr_t)ps] = it.second.name.c_str();
+    }
+
+    std::string file;
+    get_instance_file(file, s_sample_file);
+    std::ofstream out(file);
+
+    if ( !out )
+        WarningMessage("profiler: can't open %s: %s\n", file.c_str(), get_error(errno));
+
+    {
+        std::lock_guard<std::mutex> lock(s_stats_mutex);
+        fold_samples(*t, names, out);
+        s_samples += t->samples;
+        s_dropped += t->dropped;
+    }
+
+    delete t;
+}
+
+static const StatsTable::Field fields[] =
+{
+    { "#", 5, ' ', 0, std::ios_base::left },
+    { "frame", 24, ' ', 0, std::ios_base::fmtflags() },
+    { "self", 10, ' ', 0, std::ios_base::fmtflags() },
+    { "%self", 9, ' ', 2, std::ios_base::fmtflags() },
+    { "total", 10, ' ', 0, std::ios_base::fmtflags() },
+    { "%total", 9, ' ', 2, std::ios_base::fmtflags() },
+    { nullptr, 0, '\0', 0, std::ios_base::fmtflags() }
+};
+
+void SampleProfiler::show(const SampleProfilerConfig& config)
+{
+    if ( !config.show or !s_samples )
+        return;
+
+    std::vector<std::pair<std::string, uint64_t>> entries(s_self.begin(), s_self.end());
+    unsigned count = config.count;
+
+    if ( !count or count > entries.size() )
+        count = entries.size();
+
+    std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+        [](const std::pair<std::string, uint64_t>& lhs,
+        const std::pair<std::string, uint64_t>& rhs)
+        { return lhs.second > rhs.second; });
+
+    std::ostringstream ss;
+
+    {
+        StatsTable table(fields, ss);
+
+        table << StatsTable::SEP;
+        table << s_sample_table_title << " (" << s_samples << " samples";
+
+        if ( config.count )
+            table << ", worst " << config.count;
+
+        table << ")\n";
+        table << StatsTable::HEADER;
+
+        for ( unsigned i = 0; i < count; ++i )
+        {
+            const auto& e = entries[i];
+            uint64_t total = s_total[e.first];
+
+            table << StatsTable::ROW;
+            table << i + 1 << e.first;
+            table << e.second << double(e.second) * 100.0 / s_samples;
+            table << total << double(total) * 100.0 / s_samples;
+        }
+    }
+
+    LogMessage("%s", ss.str().c_str());
+
+    if ( s_dropped )
+        LogMessage("%s: " STDu64 " samples dropped, too many distinct stacks\n",
+            s_sample_table_title, s_dropped);
+}
+
+#ifdef UNIT_TEST
+
+TEST_CASE( "sample counts", "[profiler][sample_profiler]" )
+{
+    auto* t = new SampleTable();
+    uint64_t a[] = { 0x1000, 0x2000, SampleStack::rule_frame(1, 2000) };
+    uint64_t b[] = { 0x1000, 0x3000 };
+
+    count_sample(*t, a, 3);
+    count_sample(*t, b, 2);
+    count_sample(*t, a, 3);
+    count_sample(*t, a, 2);
+    count_sample(*t, nullptr, 0);
+
+    std::unordered_map<uint64_t, const char*> names =
+        { { 0x1000, "stream" }, { 0x2000, "detection" } };
+
+    std::ostringstream ss;
+    fold_samples(*t, names, ss);
+    std::string out = ss.str();
+
+    CHECK( t->samples == 5 );
+    CHECK( t->dropped == 0 );
+    CHECK( out.find("total;stream;detection;1:2000 2\n") != std::string::npos );
+    CHECK( out.find("total;stream;detection 1\n") != std::string::npos );
+    CHECK( out.find("total;stream;unknown 1\n") != std::string::npos );
+    CHECK( out.find("total;other 1\n") != std::string::npos );
+
+    CHECK( s_self["1:2000"] == 2 );
+    CHECK( s_total["stream"] == 4 );
+
+    delete t;
+}
+
+TEST_CASE( "sample stack", "[profiler][sample_profiler]" )
+{
+    SampleStack::set_enabled(true);
+
+    {
+        SampleContext outer((uint64_t)0x1000);
+
+        for ( unsigned i = 0; i < SampleStack::max_depth + 2; ++i )
+            SampleStack::push(0x2000);
+
+        CHECK( SampleStack::depth == SampleStack::max_depth + 3 );
+
+        for ( unsigned i = 0; i < SampleStack::max_depth + 2; ++i )
+            SampleStack::pop();
+
+        CHECK( SampleStack::frames[0] == 0x1000 );
+        CHECK( SampleStack::depth == 1 );
+    }
+    CHECK( SampleStack::depth == 0 );
+
+    SampleStack::set_enabled(false);
+
+    {
+        SampleContext off((uint64_t)0x1000);
+        CHECK( SampleStack::depth == 0 );
+    }
+}
+
+#endif
+
@@ -0,0 +1,109 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// sample_profiler_defs.h
+
+#ifndef SAMPLE_PROFILER_DEFS_H
+#define SAMPLE_PROFILER_DEFS_H
+
+// The sample profiler keeps a stack of the modules and rules active on each
+// packet thread.  A per thread cpu timer interrupts the thread at the
+// configured rate and the signal handler counts the current stack, so the
+// only cost on the packet path is a push and pop per profiled scope.  Frames
+// are the address of the module's ProfileStats or an encoded gid:sid.
+
+#include <atomic>
+#include <cstdint>
+
+#include "main/snort_types.h"
+#include "main/thread.h"
+
+struct SampleProfilerConfig
+{
+    bool show = false;
+    unsigned count = 0;
+    unsigned rate = 0;   // samples per second of thread cpu time
+};
+
+namespace snort
+{
+class SO_PUBLIC SampleStack
+{
+public:
+    static constexpr unsigned max_depth = 16;
+
+    static void set_enabled(bool b)
+    { enabled = b; }
+
+    static bool is_enabled()
+    { return enabled; }
+
+    static uint64_t rule_frame(uint32_t gid, uint32_t sid)
+    { return (((uint64_t)gid << 32 | sid) << 1) | 1; }
+
+    static bool is_rule(uint64_t frame)
+    { return frame & 1; }
+
+    // frames deeper than max_depth are counted but not recorded
+    static void push(uint64_t frame)
+    {
+        unsigned d = depth;
+
+        if ( d < max_depth )
+            frames[d] = frame;
+
+        // the handler runs on this thread so only the compiler can reorder
+        std::atomic_signal_fence(std::memory_order_release);
+        depth = d + 1;
+    }
+
+    static void pop()
+    { depth = depth - 1; }
+
+    static THREAD_LOCAL uint64_t frames[max_depth];
+    static THREAD_LOCAL volatile unsigned depth;
+
+private:
+    static bool enabled;
+};
+
+class SampleContext
+{
+public:
+    SampleContext(uint64_t frame) : pushed(frame and SampleStack::is_enabled())
+    {
+        if ( pushed )
+            SampleStack::push(frame);
+    }
+
+    SampleContext(const void* stats) : SampleContext((uint64_t)(uintptr_t)stats) { }
+
+    ~SampleContext()
+    {
+        if ( pushed )
+            SampleStack::pop();
+    }
+
+private:
+    // pop what was pushed even if sampling is turned off in between
+    const bool pushed;
+};
+}
+
+#endif
+
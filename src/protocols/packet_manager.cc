@@ -24,7 +24,6 @@
 #include "packet_manager.h"
 
 #include <daq.h>
-#include <mutex>
 
 #include "codecs/codec_module.h"
 #include "codecs/ip/checksum.h"
@@ -32,10 +31,13 @@
 #include "log/text_log.h"
 #include "main/snort_config.h"
 #include "main/snort_debug.h"
+#include "main/thread.h"
+#include "main/thread_config.h"
 #include "packet_io/active.h"
 #include "packet_io/sfdaq.h"
 #include "profiler/profiler_defs.h"
 #include "stream/stream.h"
+#include "utils/peg_snapshot.h"
 
 #include "eth.h"
 #include "icmp4.h"
@@ -864,10 +866,19 @@ uint16_t PacketManager::encode_get_max_payload(const Packet* p)
     return ETHERNET_MTU - (l.start - p->layers[0].start) - l.length;
 }
 
+// each packet thread publishes its counts to its own slot when it exits
+static PegSnapshot& get_snapshot(unsigned num_pegs)
+{
+    static PegSnapshot snapshot(ThreadConfig::get_instance_max(), num_pegs);
+    return snapshot;
+}
+
 void PacketManager::dump_stats()
 {
     std::vector<const char*> pkt_names;
 
+    get_snapshot(g_stats.size()).collect(&g_stats[0]);
+
     // zero out the default codecs
     g_stats[3] = 0;
     g_stats[CodecManager::s_proto_map[to_utype(ProtocolId::FINISHED_DECODE)] + stat_offset] = 0;
@@ -884,12 +895,7 @@ void PacketManager::dump_stats()
 
 void PacketManager::accumulate()
 {
-    static std::mutex stats_mutex;
-
-    std::lock_guard<std::mutex> lock(stats_mutex);
-    sum_stats(&g_stats[0], &s_stats[0], s_stats.size());
-
-    // mutex is automatically unlocked
+    get_snapshot(s_stats.size()).publish(get_instance_id(), &s_stats[0]);
 }
 
 const char* PacketManager::get_proto_name(ProtocolId protocol)
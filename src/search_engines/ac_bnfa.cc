@@ -75,6 +75,15 @@ public:
         return bnfaCompile(sc, obj);
     }
 
+    bool get_cache_key(std::string& key) override
+    { return obj and bnfaCacheKey(obj, key); }
+
+    bool get_compiled(std::string& blob) override
+    { return obj and bnfaSerialize(obj, blob); }
+
+    int set_compiled(SnortConfig* sc, const uint8_t* buf, size_t len) override
+    { return obj ? bnfaDeserialize(sc, obj, buf, len) : -1; }
+
     int _search(
         const uint8_t* T, int n, MpseMatch match,
         void* context, int* current_state) override
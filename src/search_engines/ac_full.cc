@@ -58,6 +58,15 @@ public:
     int prep_patterns(SnortConfig* sc) override
     { return acsmCompile2(sc, obj); }
 
+    bool get_cache_key(std::string& key) override
+    { return acsmCacheKey2(obj, key); }
+
+    bool get_compiled(std::string& blob) override
+    { return acsmSerialize2(obj, blob); }
+
+    int set_compiled(SnortConfig* sc, const uint8_t* buf, size_t len) override
+    { return acsmDeserialize2(sc, obj, buf, len); }
+
     int _search(
         const uint8_t* T, int n, MpseMatch match,
         void* context, int* current_state) override
@@ -0,0 +1,452 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// ac_full_simd is ac_full with a vectorized search kernel.  The state
+// machine is built exactly as for ac_full.  Single buffer searches fold case
+// with NEON / SSE2 and batch searches interleave the buffers of an MpseBatch
+// to hide state table load latency.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "framework/mpse.h"
+#include "framework/mpse_batch.h"
+
+#include "acsmx2.h"
+#include "pat_stats.h"
+
+using namespace snort;
+
+//-------------------------------------------------------------------------
+// "ac_full_simd"
+//-------------------------------------------------------------------------
+
+class AcfSimdMpse : public Mpse
+{
+private:
+    ACSM_STRUCT2* obj;
+
+public:
+    AcfSimdMpse(const MpseAgent* agent) : Mpse("ac_full_simd")
+    { obj = acsmNew2(agent, ACF_FULL); }
+
+    ~AcfSimdMpse() override
+    { acsmFree2(obj); }
+
+    void set_opt(int flag) override
+    {
+        acsmCompressStates(obj, flag);
+        obj->enable_dfa();
+    }
+
+    int add_pattern(
+        const uint8_t* P, unsigned m, const PatternDescriptor& desc, void* user) override
+    {
+        return acsmAddPattern2(obj, P, m, desc.no_case, desc.negated, user);
+    }
+
+    int prep_patterns(SnortConfig* sc) override
+    { return acsmCompile2(sc, obj); }
+
+    bool get_cache_key(std::string& key) override
+    { return acsmCacheKey2(obj, key); }
+
+    bool get_compiled(std::string& blob) override
+    { return acsmSerialize2(obj, blob); }
+
+    int set_compiled(SnortConfig* sc, const uint8_t* buf, size_t len) override
+    { return acsmDeserialize2(sc, obj, buf, len); }
+
+    int _search(
+        const uint8_t* T, int n, MpseMatch match,
+        void* context, int* current_state) override
+    {
+        if ( obj->dfa_enabled() )
+            return acsm_search_dfa_full_simd(obj, T, n, match, context, current_state);
+
+        return acsm_search_nfa(obj, T, n, match, context, current_state);
+    }
+
+    void _search(MpseBatch&, MpseType) override;
+
+    int search_all(
+        const uint8_t* T, int n, MpseMatch match,
+        void* context, int* current_state) override
+    {
+        if ( !obj->dfa_enabled() )
+            return acsm_search_nfa(obj, T, n, match, context, current_state);
+        else
+            return acsm_search_dfa_full_all_simd(obj, T, n, match, context, current_state);
+    }
+
+    int print_info() override
+    { return acsmPrintDetailInfo2(obj); }
+
+    int get_pattern_count() const override
+    { return acsmPatternCount2(obj); }
+};
+
+// buffers are queued as lanes until ACSM_MAX_LANES are pending or the
+// batch is exhausted; groups that are not ac_full_simd dfas are searched
+// immediately as they would be by the base class
+void AcfSimdMpse::_search(MpseBatch& batch, MpseType mpse_type)
+{
+    AcsmLane lanes[ACSM_MAX_LANES];
+    unsigned num = 0;
+
+    for ( auto& item : batch.items )
+    {
+        if (item.second.done)
+            continue;
+
+        item.second.error = false;
+        item.second.matches = 0;
+
+        for ( auto& so : item.second.so )
+        {
+            Mpse* mpse = (mpse_type == MPSE_TYPE_OFFLOAD) ?
+                so->get_offload_mpse() : so->get_normal_mpse();
+
+            AcfSimdMpse* acf = dynamic_cast<AcfSimdMpse*>(mpse);
+
+            if ( !acf or !acf->obj->dfa_enabled() )
+            {
+                int start_state = 0;
+                item.second.matches += mpse->search(
+                    item.first.buf, item.first.len, batch.mf, batch.context, &start_state);
+                continue;
+            }
+
+            pmqs.matched_bytes += item.first.len;
+            lanes[num++] = { acf->obj, item.first.buf, (int)item.first.len, &item.second.matches };
+
+            if ( num == ACSM_MAX_LANES )
+            {
+                acsm_search_dfa_full_lanes(lanes, num, batch.mf, batch.context);
+                num = 0;
+            }
+        }
+        item.second.done = true;
+    }
+
+    if ( num )
+        acsm_search_dfa_full_lanes(lanes, num, batch.mf, batch.context);
+}
+
+//-------------------------------------------------------------------------
+// api
+//-------------------------------------------------------------------------
+
+static Mpse* acfs_ctor(
+    const SnortConfig*, class Module*, const MpseAgent* agent)
+{
+    return new AcfSimdMpse(agent);
+}
+
+static void acfs_dtor(Mpse* p)
+{
+    delete p;
+}
+
+static void acfs_init()
+{
+    acsmx2_init_xlatcase();
+    acsm_init_summary();
+}
+
+static void acfs_print()
+{
+    acsmPrintSummaryInfo2();
+}
+
+static const MpseApi acfs_api =
+{
+    {
+        PT_SEARCH_ENGINE,
+        sizeof(MpseApi),
+        SEAPI_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        "ac_full_simd",
+        "Aho-Corasick Full with vectorized case folding and interleaved batch searches",
+        nullptr,
+        nullptr
+    },
+    MPSE_BASE,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    acfs_ctor,
+    acfs_dtor,
+    acfs_init,
+    acfs_print,
+    nullptr,
+};
+
+const BaseApi* se_ac_full_simd = &acfs_api.base;
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <catch/snort_catch.h>
+
+namespace
+{
+struct Hit
+{
+    void* user;
+    int index;
+
+    bool operator==(const Hit& rhs) const
+    { return user == rhs.user and index == rhs.index; }
+};
+
+// the lanes flavor reports hits from several buffers in one callback
+// stream so the buffer is recorded in the context
+struct HitList
+{
+    std::vector<Hit> hits;
+    int limit = 0;
+};
+
+int record(void* user, void*, int index, void* context, void*)
+{
+    HitList* hl = (HitList*)context;
+    hl->hits.push_back({ user, index });
+    return (hl->limit and (int)hl->hits.size() >= hl->limit) ? 1 : 0;
+}
+
+const char* const patterns[] =
+{
+    "GET", "HTTP/1.1", "host:", "select", "union", "cmd.exe", "/etc/passwd",
+    "a", "aa", "aaa", "ab", "ba", "\x90\x90\x90\x90", "script", "Content-Type"
+};
+
+ACSM_STRUCT2* make_acsm(bool compress)
+{
+    ACSM_STRUCT2* acsm = acsmNew2(nullptr, ACF_FULL);
+    acsmCompressStates(acsm, compress ? 1 : 0);
+    acsm->enable_dfa();
+
+    // one case sensitive pattern exercises the search_all() case check
+    for ( auto p : patterns )
+        acsmAddPattern2(acsm, (const uint8_t*)p, strlen(p), strcmp(p, "Content-Type"), false, (void*)p);
+
+    acsmCompile2(nullptr, acsm);
+    return acsm;
+}
+
+std::vector<uint8_t> make_data(size_t len, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> pick(0, sizeof(patterns)/sizeof(patterns[0]) - 1);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<uint8_t> data;
+
+    while ( data.size() < len )
+    {
+        if ( byte(gen) < 32 )
+        {
+            const char* p = patterns[pick(gen)];
+            for ( size_t i = 0; p[i] and data.size() < len; ++i )
+                data.push_back((byte(gen) & 1) ? tolower(p[i]) : p[i]);
+        }
+        else
+            data.push_back((uint8_t)byte(gen));
+    }
+    return data;
+}
+}
+
+TEST_CASE("ac_full_simd case folding matches xlatcase", "[ac_full_simd]")
+{
+    acsmx2_init_xlatcase();
+    ACSM_STRUCT2* acsm = acsmNew2(nullptr, ACF_FULL);
+    acsm->enable_dfa();
+    acsmAddPattern2(acsm, (const uint8_t*)"\xff", 1, true, false, (void*)1);
+    acsmCompile2(nullptr, acsm);
+
+    // every byte value at every alignment of a 16 byte vector
+    uint8_t data[256 + 17];
+    for ( unsigned i = 0; i < sizeof(data); ++i )
+        data[i] = (uint8_t)(i * 7);
+
+    for ( unsigned off = 0; off < 17; ++off )
+    {
+        HitList exp, act;
+        int s1 = 0, s2 = 0;
+        int n1 = acsm_search_dfa_full(acsm, data + off, 256, record, &exp, &s1);
+        int n2 = acsm_search_dfa_full_simd(acsm, data + off, 256, record, &act, &s2);
+        CHECK(n1 == n2);
+        CHECK(s1 == s2);
+        CHECK(exp.hits == act.hits);
+    }
+    acsmFree2(acsm);
+}
+
+TEST_CASE("ac_full_simd search equals ac_full", "[ac_full_simd]")
+{
+    acsmx2_init_xlatcase();
+
+    for ( bool compress : { false, true } )
+    {
+        ACSM_STRUCT2* acsm = make_acsm(compress);
+
+        for ( unsigned seed = 1; seed < 16; ++seed )
+        {
+            std::vector<uint8_t> data = make_data(seed * 97, seed);
+            int len = (int)data.size();
+
+            HitList exp, act;
+            int s1 = 0, s2 = 0;
+            CHECK(acsm_search_dfa_full(acsm, data.data(), len, record, &exp, &s1) ==
+                acsm_search_dfa_full_simd(acsm, data.data(), len, record, &act, &s2));
+            CHECK(s1 == s2);
+            CHECK(exp.hits == act.hits);
+
+            HitList exp_all, act_all;
+            s1 = s2 = 0;
+            CHECK(acsm_search_dfa_full_all(acsm, data.data(), len, record, &exp_all, &s1) ==
+                acsm_search_dfa_full_all_simd(acsm, data.data(), len, record, &act_all, &s2));
+            CHECK(exp_all.hits == act_all.hits);
+
+            // stop on the 3rd match
+            HitList exp_lim, act_lim;
+            exp_lim.limit = act_lim.limit = 3;
+            s1 = s2 = 0;
+            CHECK(acsm_search_dfa_full(acsm, data.data(), len, record, &exp_lim, &s1) ==
+                acsm_search_dfa_full_simd(acsm, data.data(), len, record, &act_lim, &s2));
+            CHECK(s1 == s2);
+            CHECK(exp_lim.hits == act_lim.hits);
+        }
+        acsmFree2(acsm);
+    }
+}
+
+TEST_CASE("ac_full_simd lanes equal sequential searches", "[ac_full_simd]")
+{
+    acsmx2_init_xlatcase();
+    ACSM_STRUCT2* small = make_acsm(true);
+    ACSM_STRUCT2* wide = make_acsm(false);
+
+    const unsigned num = 7;
+    std::vector<uint8_t> data[num];
+    AcsmLane lanes[num];
+    int matches[num] = { };
+    int total = 0;
+
+    std::vector<Hit> exp;
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        // lengths straddle the fold block and include an empty buffer
+        data[i] = make_data(i * 41, i + 100);
+        lanes[i] = { (i & 1) ? small : wide, data[i].data(), (int)data[i].size(), &matches[i] };
+
+        HitList hl;
+        int state = 0;
+        total += acsm_search_dfa_full(lanes[i].acsm, lanes[i].buf, lanes[i].len, record, &hl, &state);
+        exp.insert(exp.end(), hl.hits.begin(), hl.hits.end());
+    }
+
+    HitList act;
+    acsm_search_dfa_full_lanes(lanes, num, record, &act);
+
+    int sum = 0;
+    for ( auto m : matches )
+        sum += m;
+
+    CHECK(sum == total);
+    REQUIRE(act.hits.size() == exp.size());
+
+    // interleaving reorders hits across buffers but not their multiset
+    auto less = [](const Hit& a, const Hit& b)
+    { return a.user < b.user or (a.user == b.user and a.index < b.index); };
+
+    std::sort(exp.begin(), exp.end(), less);
+    std::sort(act.hits.begin(), act.hits.end(), less);
+    CHECK(exp == act.hits);
+
+    acsmFree2(small);
+    acsmFree2(wide);
+}
+
+#ifdef BENCHMARK_TEST
+
+TEST_CASE("ac_full_simd benchmark", "[ac_full_simd][benchmark]")
+{
+    acsmx2_init_xlatcase();
+    ACSM_STRUCT2* acsm = make_acsm(true);
+
+    std::vector<uint8_t> data[ACSM_MAX_LANES];
+    for ( unsigned i = 0; i < ACSM_MAX_LANES; ++i )
+        data[i] = make_data(1460, i + 1);
+
+    HitList hl;
+
+    BENCHMARK("ac_full 4 x 1460")
+    {
+        int n = 0;
+        for ( auto& d : data )
+        {
+            int state = 0;
+            hl.hits.clear();
+            n += acsm_search_dfa_full(acsm, d.data(), (int)d.size(), record, &hl, &state);
+        }
+        return n;
+    };
+
+    BENCHMARK("ac_full_simd 4 x 1460")
+    {
+        int n = 0;
+        for ( auto& d : data )
+        {
+            int state = 0;
+            hl.hits.clear();
+            n += acsm_search_dfa_full_simd(acsm, d.data(), (int)d.size(), record, &hl, &state);
+        }
+        return n;
+    };
+
+    BENCHMARK("ac_full_simd lanes 4 x 1460")
+    {
+        int matches = 0;
+        AcsmLane lanes[ACSM_MAX_LANES];
+        for ( unsigned i = 0; i < ACSM_MAX_LANES; ++i )
+            lanes[i] = { acsm, data[i].data(), (int)data[i].size(), &matches };
+        hl.hits.clear();
+        acsm_search_dfa_full_lanes(lanes, ACSM_MAX_LANES, record, &hl);
+        return matches;
+    };
+
+    acsmFree2(acsm);
+}
+
+#endif
+#endif
@@ -119,11 +119,21 @@
 
 #include <cassert>
 #include <list>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "log/messages.h"
 #include "utils/stats.h"
 #include "utils/util.h"
 
+#include "mpse_blob.h"
+
 using namespace snort;
 
 #define printf LogMessage
@@ -1362,6 +1372,204 @@ int acsmCompile2(SnortConfig* sc, ACSM_STRUCT2* acsm)
     return 0;
 }
 
+/*
+*   Search engine cache support - full format only.  Patterns are identified
+*   by their position in the pattern list which is the same for the same
+*   patterns added in the same order.  Match lists are saved as pattern
+*   indices and the rule option trees are rebuilt on load.
+*/
+static const uint32_t acsm_blob_version = 1;
+
+bool acsmCacheKey2(ACSM_STRUCT2* acsm, std::string& key)
+{
+    if ( acsm->acsmFormat != ACF_FULL )
+        return false;
+
+    MpseBlobWriter w(key);
+
+    w.put(acsm_blob_version);
+    w.put(acsm->acsmFormat);
+    w.put(acsm->acsmAlphabetSize);
+    w.put(acsm->compress_states);
+    w.put(acsm->dfa);
+    w.put(acsm->numPatterns);
+
+    for ( ACSM_PATTERN2* p = acsm->acsmPatterns; p; p = p->next )
+    {
+        w.put(p->n);
+        w.put(p->nocase);
+        w.put(p->negative);
+        w.put(p->casepatrn, p->n);
+    }
+    return true;
+}
+
+bool acsmSerialize2(ACSM_STRUCT2* acsm, std::string& blob)
+{
+    if ( acsm->acsmFormat != ACF_FULL or !acsm->acsmNextState )
+        return false;
+
+    std::unordered_map<const uint8_t*, uint32_t> index;
+    uint32_t n = 0;
+
+    for ( ACSM_PATTERN2* p = acsm->acsmPatterns; p; p = p->next )
+        index[p->patrn] = n++;
+
+    MpseBlobWriter w(blob);
+
+    w.put(acsm->acsmNumStates);
+    w.put(acsm->acsmNumTrans);
+    w.put(acsm->sizeofstate);
+
+    size_t row = acsm->sizeofstate * (acsm->acsmAlphabetSize + 2);
+
+    for ( int i = 0; i < acsm->acsmNumStates; ++i )
+        w.put(acsm->acsmNextState[i], row);
+
+    if ( !acsm->dfa )
+        w.put(acsm->acsmFailState, sizeof(acstate_t) * acsm->acsmNumStates);
+
+    uint32_t match_states = 0;
+
+    for ( int i = 0; i < acsm->acsmNumStates; ++i )
+        if ( acsm->acsmMatchList[i] )
+            ++match_states;
+
+    w.put(match_states);
+
+    for ( int i = 0; i < acsm->acsmNumStates; ++i )
+    {
+        if ( !acsm->acsmMatchList[i] )
+            continue;
+
+        uint32_t count = 0;
+
+        for ( ACSM_PATTERN2* m = acsm->acsmMatchList[i]; m; m = m->next )
+            ++count;
+
+        w.put(i);
+        w.put(count);
+
+        for ( ACSM_PATTERN2* m = acsm->acsmMatchList[i]; m; m = m->next )
+            w.put(index[m->patrn]);
+    }
+    return true;
+}
+
+int acsmDeserialize2(SnortConfig* sc, ACSM_STRUCT2* acsm, const uint8_t* buf, size_t len)
+{
+    if ( acsm->acsmFormat != ACF_FULL or acsm->acsmNextState )
+        return -1;
+
+    std::vector<ACSM_PATTERN2*> pats;
+
+    for ( ACSM_PATTERN2* p = acsm->acsmPatterns; p; p = p->next )
+        pats.emplace_back(p);
+
+    MpseBlobReader r(buf, len);
+    int num_states, num_trans, sizeofstate;
+
+    if ( !r.get(num_states) or !r.get(num_trans) or !r.get(sizeofstate) or num_states <= 0 )
+        return -1;
+
+    if ( sizeofstate != 1 and sizeofstate != 2 and sizeofstate != 4 )
+        return -1;
+
+    size_t row = sizeofstate * (acsm->acsmAlphabetSize + 2);
+    const uint8_t* rows = r.get(row * num_states);
+    const uint8_t* fail = nullptr;
+
+    if ( !rows )
+        return -1;
+
+    if ( !acsm->dfa and !(fail = r.get(sizeof(acstate_t) * num_states)) )
+        return -1;
+
+    acsm->acsmNumStates = num_states;
+    acsm->acsmMaxStates = num_states;
+    acsm->acsmNumTrans = num_trans;
+    acsm->sizeofstate = sizeofstate;
+
+    // from here on a failure leaves a partial state machine that can only be freed
+    acsm->acsmMatchList =
+        (ACSM_PATTERN2**)AC_MALLOC(sizeof(ACSM_PATTERN2*) * num_states,
+            ACSM2_MEMORY_TYPE__MATCHLIST);
+
+    acsm->acsmNextState =
+        (acstate_t**)AC_MALLOC_DFA(num_states * sizeof(acstate_t*), sizeofstate);
+
+    for ( int i = 0; i < num_states; ++i )
+    {
+        acsm->acsmNextState[i] = (acstate_t*)AC_MALLOC_DFA(row, sizeofstate);
+        memcpy(acsm->acsmNextState[i], rows + i * row, row);
+    }
+
+    if ( fail )
+    {
+        acsm->acsmFailState =
+            (acstate_t*)AC_MALLOC(sizeof(acstate_t) * num_states, ACSM2_MEMORY_TYPE__FAILSTATE);
+        memcpy(acsm->acsmFailState, fail, sizeof(acstate_t) * num_states);
+    }
+
+    uint32_t match_states;
+
+    if ( !r.get(match_states) )
+        return -2;
+
+    for ( uint32_t i = 0; i < match_states; ++i )
+    {
+        int state;
+        uint32_t count;
+
+        if ( !r.get(state) or !r.get(count) or state < 0 or state >= num_states )
+            return -2;
+
+        // keep the saved order since it determines the order of match callbacks
+        ACSM_PATTERN2** tail = &acsm->acsmMatchList[state];
+
+        for ( uint32_t j = 0; j < count; ++j )
+        {
+            uint32_t ix;
+
+            if ( !r.get(ix) or ix >= pats.size() )
+                return -2;
+
+            ACSM_PATTERN2* m = CopyMatchListEntry(pats[ix]);
+            m->next = nullptr;
+            *tail = m;
+            tail = &m->next;
+        }
+        summary.num_match_states++;
+    }
+
+    if ( !r.done() )
+        return -2;
+
+    for ( auto* p : pats )
+    {
+        summary.num_patterns++;
+        summary.num_characters += p->n;
+    }
+
+    if ( sizeofstate == 1 )
+        summary.num_1byte_instances++;
+    else if ( sizeofstate == 2 )
+        summary.num_2byte_instances++;
+    else if ( acsm->compress_states )
+        summary.num_4byte_instances++;
+
+    summary.num_states += acsm->acsmNumStates;
+    summary.num_transitions += acsm->acsmNumTrans;
+    summary.num_instances++;
+
+    memcpy(&summary.acsm, acsm, sizeof(ACSM_STRUCT2));
+
+    if ( acsm->agent )
+        acsmBuildMatchStateTrees2(sc, acsm);
+
+    return 0;
+}
+
 /*
 *   Get the NextState from the NFA, all NFA storage formats use this
 */
@@ -1817,6 +2025,317 @@ int acsm_search_dfa_full_all(
     return nfound;
 }
 
+/*
+*   Vectorized Full format DFA search
+*
+*   These walk the same full matrix as acsm_search_dfa_full() and
+*   acsm_search_dfa_full_all() and report the same matches at the same
+*   offsets.  The differences are:
+*
+*    1) case is folded a block at a time with NEON (aarch64) or SSE2
+*       (x86_64) into a small stack buffer instead of a xlatcase lookup per
+*       byte.  This relies on xlatcase being the C locale toupper(), ie only
+*       a-z are changed.  Other targets fall back to xlatcase.
+*    2) the lanes flavor steps up to ACSM_MAX_LANES independent buffers in
+*       lock step so that the state table loads of one buffer are in flight
+*       while the others are walked.  The next row of each buffer is
+*       prefetched as soon as the state is known.
+*/
+#define ACSM_FOLD_BLOCK 64
+
+static inline void acsm_fold_case(uint8_t* d, const uint8_t* s, int n)
+{
+    int i = 0;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x16_t lower = vdupq_n_u8('a');
+    const uint8x16_t range = vdupq_n_u8(26);
+    const uint8x16_t flip = vdupq_n_u8(0x20);
+
+    for ( ; i + 16 <= n; i += 16 )
+    {
+        uint8x16_t v = vld1q_u8(s + i);
+        uint8x16_t lc = vcltq_u8(vsubq_u8(v, lower), range);
+        vst1q_u8(d + i, vsubq_u8(v, vandq_u8(lc, flip)));
+    }
+#elif defined(__SSE2__)
+    // no unsigned byte compare in SSE2 so bias a-z to the bottom of the signed range
+    const __m128i bias = _mm_set1_epi8((char)(0x80 - 'a'));
+    const __m128i limit = _mm_set1_epi8((char)(-128 + 26));
+    const __m128i flip = _mm_set1_epi8(0x20);
+
+    for ( ; i + 16 <= n; i += 16 )
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i lc = _mm_cmplt_epi8(_mm_add_epi8(v, bias), limit);
+        _mm_storeu_si128((__m128i*)(d + i), _mm_sub_epi8(v, _mm_and_si128(lc, flip)));
+    }
+#endif
+
+    for ( ; i < n; i++ )
+        d[i] = xlatcase[ s[i] ];
+}
+
+// returns true if the search must stop
+template<bool all>
+static inline bool acsm_full_match(
+    ACSM_PATTERN2* mlist, const uint8_t* Tx, int index, MpseMatch match,
+    void* context, int& nfound)
+{
+    if ( !all )
+    {
+        nfound++;
+        return match(mlist->udata, mlist->rule_option_tree, index, context,
+            mlist->neg_list) > 0;
+    }
+
+    for ( ; mlist != nullptr; mlist = mlist->next )
+    {
+        if ( mlist->nocase || !memcmp(mlist->casepatrn, Tx + index - mlist->n, mlist->n) )
+        {
+            nfound++;
+            if (match(mlist->udata, mlist->rule_option_tree, index, context,
+                mlist->neg_list) > 0)
+                return true;
+        }
+    }
+    return false;
+}
+
+template<typename STATE, bool all>
+static inline int acsm_search_full_folded(
+    ACSM_STRUCT2* acsm, const uint8_t* Tx, int n, MpseMatch match,
+    void* context, int* current_state)
+{
+    STATE** NextState = (STATE**)acsm->acsmNextState;
+    ACSM_PATTERN2** MatchList = acsm->acsmMatchList;
+    uint8_t folded[ACSM_FOLD_BLOCK];
+
+    acstate_t state = *current_state;
+    int nfound = 0;
+
+    for ( int base = 0; base < n; base += ACSM_FOLD_BLOCK )
+    {
+        int len = (n - base < ACSM_FOLD_BLOCK) ? n - base : ACSM_FOLD_BLOCK;
+        acsm_fold_case(folded, Tx + base, len);
+
+        for ( int i = 0; i < len; i++ )
+        {
+            const STATE* ps = NextState[state];
+
+            if ( ps[1] )
+            {
+                ACSM_PATTERN2* mlist = MatchList[state];
+
+                if ( mlist and acsm_full_match<all>(mlist, Tx, base + i, match, context, nfound) )
+                {
+                    *current_state = state;
+                    return nfound;
+                }
+            }
+            state = ps[2u + folded[i]];
+        }
+    }
+
+    /* Check the last state for a pattern match */
+    if ( ACSM_PATTERN2* mlist = MatchList[state] )
+        acsm_full_match<all>(mlist, Tx, n, match, context, nfound);
+
+    *current_state = state;
+    return nfound;
+}
+
+template<bool all>
+static inline int acsm_search_dfa_full_folded(
+    ACSM_STRUCT2* acsm, const uint8_t* Tx, int n, MpseMatch match,
+    void* context, int* current_state)
+{
+    if (current_state == nullptr)
+        return 0;
+
+    switch (acsm->sizeofstate)
+    {
+    case 1:
+        return acsm_search_full_folded<uint8_t, all>(acsm, Tx, n, match, context, current_state);
+    case 2:
+        return acsm_search_full_folded<uint16_t, all>(acsm, Tx, n, match, context, current_state);
+    default:
+        break;
+    }
+    return acsm_search_full_folded<acstate_t, all>(acsm, Tx, n, match, context, current_state);
+}
+
+int acsm_search_dfa_full_simd(
+    ACSM_STRUCT2* acsm, const uint8_t* Tx, int n, MpseMatch match,
+    void* context, int* current_state)
+{
+    return acsm_search_dfa_full_folded<false>(acsm, Tx, n, match, context, current_state);
+}
+
+int acsm_search_dfa_full_all_simd(
+    ACSM_STRUCT2* acsm, const uint8_t* Tx, int n, MpseMatch match,
+    void* context, int* current_state)
+{
+    return acsm_search_dfa_full_folded<true>(acsm, Tx, n, match, context, current_state);
+}
+
+template<typename STATE>
+static void acsm_search_full_interleaved(
+    AcsmLane* lanes, unsigned num, MpseMatch match, void* context)
+{
+    struct Cursor
+    {
+        STATE** next;
+        ACSM_PATTERN2** mlist;
+        int pos;
+        int block;
+        int nfound;
+        acstate_t state;
+        bool done;
+        uint8_t folded[ACSM_FOLD_BLOCK];
+    };
+
+    Cursor cur[ACSM_MAX_LANES];
+    unsigned active = 0;
+
+    assert(num <= ACSM_MAX_LANES);
+
+    for ( unsigned i = 0; i < num; i++ )
+    {
+        Cursor& c = cur[i];
+        c.next = (STATE**)lanes[i].acsm->acsmNextState;
+        c.mlist = lanes[i].acsm->acsmMatchList;
+        c.pos = 0;
+        c.block = 0;
+        c.nfound = 0;
+        c.state = 0;
+        c.done = false;
+        active++;
+    }
+
+    while ( active )
+    {
+        int max_block = 0;
+
+        for ( unsigned i = 0; i < num; i++ )
+        {
+            Cursor& c = cur[i];
+
+            if ( c.done )
+            {
+                c.block = 0;
+                continue;
+            }
+            int left = lanes[i].len - c.pos;
+            c.block = (left < ACSM_FOLD_BLOCK) ? left : ACSM_FOLD_BLOCK;
+            acsm_fold_case(c.folded, lanes[i].buf + c.pos, c.block);
+
+            if ( c.block > max_block )
+                max_block = c.block;
+
+            __builtin_prefetch(c.next[c.state]);
+        }
+
+        for ( int k = 0; k < max_block; k++ )
+        {
+            for ( unsigned i = 0; i < num; i++ )
+            {
+                Cursor& c = cur[i];
+
+                if ( k >= c.block )
+                    continue;
+
+                const STATE* ps = c.next[c.state];
+
+                if ( ps[1] )
+                {
+                    ACSM_PATTERN2* mlist = c.mlist[c.state];
+
+                    if ( mlist and acsm_full_match<false>(
+                        mlist, lanes[i].buf, c.pos + k, match, context, c.nfound) )
+                    {
+                        c.done = true;
+                        c.block = 0;
+                        continue;
+                    }
+                }
+                c.state = ps[2u + c.folded[k]];
+
+                if ( k + 1 < c.block )
+                {
+                    const STATE* pn = c.next[c.state];
+                    __builtin_prefetch(pn);
+                    __builtin_prefetch(pn + 2u + c.folded[k + 1]);
+                }
+            }
+        }
+
+        active = 0;
+
+        for ( unsigned i = 0; i < num; i++ )
+        {
+            Cursor& c = cur[i];
+
+            if ( c.done )
+                continue;
+
+            c.pos += c.block;
+
+            if ( c.pos < lanes[i].len )
+            {
+                active++;
+                continue;
+            }
+
+            /* Check the last state for a pattern match */
+            if ( ACSM_PATTERN2* mlist = c.mlist[c.state] )
+                acsm_full_match<false>(mlist, lanes[i].buf, c.pos, match, context, c.nfound);
+
+            c.done = true;
+        }
+    }
+
+    for ( unsigned i = 0; i < num; i++ )
+        *lanes[i].matches += cur[i].nfound;
+}
+
+void acsm_search_dfa_full_lanes(
+    AcsmLane* lanes, unsigned num, MpseMatch match, void* context)
+{
+    // lanes are only interleaved with others of the same state width
+    AcsmLane group[3][ACSM_MAX_LANES];
+    unsigned count[3] = { 0, 0, 0 };
+
+    for ( unsigned i = 0; i < num; i++ )
+    {
+        unsigned g = (lanes[i].acsm->sizeofstate == 1) ? 0 :
+            (lanes[i].acsm->sizeofstate == 2) ? 1 : 2;
+
+        group[g][count[g]++] = lanes[i];
+
+        if ( count[g] < ACSM_MAX_LANES )
+            continue;
+
+        if ( g == 0 )
+            acsm_search_full_interleaved<uint8_t>(group[g], count[g], match, context);
+        else if ( g == 1 )
+            acsm_search_full_interleaved<uint16_t>(group[g], count[g], match, context);
+        else
+            acsm_search_full_interleaved<acstate_t>(group[g], count[g], match, context);
+
+        count[g] = 0;
+    }
+
+    if ( count[0] )
+        acsm_search_full_interleaved<uint8_t>(group[0], count[0], match, context);
+
+    if ( count[1] )
+        acsm_search_full_interleaved<uint16_t>(group[1], count[1], match, context);
+
+    if ( count[2] )
+        acsm_search_full_interleaved<acstate_t>(group[2], count[2], match, context);
+}
+
 /*
 *   Banded-Row format DFA search
 *   Do not change anything here, caching and prefetching
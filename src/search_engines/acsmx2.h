@@ -25,6 +25,7 @@
 // Version 2.0
 
 #include <cstdint>
+#include <string>
 
 #include "search_common.h"
 
@@ -135,6 +136,20 @@ struct ACSM_STRUCT2
     { return dfa; }
 };
 
+/*
+*   One buffer of an interleaved full DFA search.  Each lane is searched
+*   from the start state and the number of matches is added to *matches.
+*/
+#define ACSM_MAX_LANES 4
+
+struct AcsmLane
+{
+    ACSM_STRUCT2* acsm;
+    const uint8_t* buf;
+    int len;
+    int* matches;
+};
+
 /*
 *   Prototypes
 */
@@ -163,7 +178,19 @@ int acsm_search_dfa_full(
 int acsm_search_dfa_full_all(
     ACSM_STRUCT2*, const uint8_t* Tx, int n, MpseMatch, void* context, int* current_state);
 
+int acsm_search_dfa_full_simd(
+    ACSM_STRUCT2*, const uint8_t* T, int n, MpseMatch, void* context, int* current_state);
+
+int acsm_search_dfa_full_all_simd(
+    ACSM_STRUCT2*, const uint8_t* Tx, int n, MpseMatch, void* context, int* current_state);
+
+void acsm_search_dfa_full_lanes(AcsmLane*, unsigned num, MpseMatch, void* context);
+
 void acsmFree2(ACSM_STRUCT2*);
+
+bool acsmCacheKey2(ACSM_STRUCT2*, std::string&);
+bool acsmSerialize2(ACSM_STRUCT2*, std::string&);
+int acsmDeserialize2(snort::SnortConfig*, ACSM_STRUCT2*, const uint8_t*, size_t);
 int acsmPatternCount2(ACSM_STRUCT2*);
 void acsmCompressStates(ACSM_STRUCT2*, int);
 
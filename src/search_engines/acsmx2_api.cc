@@ -29,6 +29,7 @@ using namespace snort;
 
 extern const BaseApi* se_ac_banded;
 extern const BaseApi* se_ac_full;
+extern const BaseApi* se_ac_full_simd;
 extern const BaseApi* se_ac_sparse;
 extern const BaseApi* se_ac_sparse_bands;
 
@@ -40,6 +41,7 @@ const BaseApi* se_acsmx2[] =
 {
     se_ac_banded,
     se_ac_full,
+    se_ac_full_simd,
     se_ac_sparse,
     se_ac_sparse_bands,
     nullptr
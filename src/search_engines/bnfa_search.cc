@@ -147,11 +147,15 @@
 #include "bnfa_search.h"
 
 #include <list>
+#include <unordered_map>
+#include <vector>
 
 #include "log/messages.h"
 #include "utils/stats.h"
 #include "utils/util.h"
 
+#include "mpse_blob.h"
+
 using namespace snort;
 
 /*
@@ -1465,6 +1469,183 @@ int bnfaCompile(SnortConfig* sc, bnfa_struct_t* bnfa)
     return 0;
 }
 
+/*
+   Search engine cache support - sparse format only.  Patterns are identified
+   by their position in the pattern list which is the same for the same
+   patterns added in the same order.  Match lists are saved as pattern
+   indices and the rule option trees are rebuilt on load.
+*/
+static const uint32_t bnfa_blob_version = 1;
+
+bool bnfaCacheKey(bnfa_struct_t* bnfa, std::string& key)
+{
+    if ( bnfa->bnfaFormat != BNFA_SPARSE )
+        return false;
+
+    MpseBlobWriter w(key);
+
+    w.put(bnfa_blob_version);
+    w.put(bnfa->bnfaMethod);
+    w.put(bnfa->bnfaCaseMode);
+    w.put(bnfa->bnfaFormat);
+    w.put(bnfa->bnfaAlphabetSize);
+    w.put(bnfa->bnfaOpt);
+    w.put(bnfa->bnfaForceFullZeroState);
+    w.put(bnfa->bnfaPatternCnt);
+
+    for ( bnfa_pattern_t* p = bnfa->bnfaPatterns; p; p = p->next )
+    {
+        w.put(p->n);
+        w.put(p->nocase);
+        w.put(p->negative);
+        w.put(p->casepatrn, p->n);
+    }
+    return true;
+}
+
+// the transition list is a state word and a control word for each state
+// followed by either a full row or the sparse transitions
+static unsigned bnfa_trans_list_size(const bnfa_state_t* ps, unsigned max, int num_states)
+{
+    unsigned n = 0;
+
+    for ( int k = 0; k < num_states; ++k )
+    {
+        if ( n + 2 > max )
+            return 0;
+
+        bnfa_state_t ctl = ps[n + 1];
+        n += 2;
+
+        if ( ctl & BNFA_SPARSE_FULL_BIT )
+            n += BNFA_MAX_ALPHABET_SIZE;
+        else
+            n += (ctl & BNFA_SPARSE_COUNT_BITS) >> BNFA_SPARSE_COUNT_SHIFT;
+    }
+    return n <= max ? n : 0;
+}
+
+bool bnfaSerialize(bnfa_struct_t* bnfa, std::string& blob)
+{
+    if ( bnfa->bnfaFormat != BNFA_SPARSE or !bnfa->bnfaTransList )
+        return false;
+
+    std::unordered_map<const void*, uint32_t> index;
+    uint32_t n = 0;
+
+    for ( bnfa_pattern_t* p = bnfa->bnfaPatterns; p; p = p->next )
+        index[p] = n++;
+
+    unsigned words = bnfa_trans_list_size(bnfa->bnfaTransList, ~0u, bnfa->bnfaNumStates);
+
+    if ( !words )
+        return false;
+
+    MpseBlobWriter w(blob);
+
+    w.put(bnfa->bnfaNumStates);
+    w.put(bnfa->bnfaNumTrans);
+    w.put(bnfa->bnfaMatchStates);
+    w.put(words);
+    w.put(bnfa->bnfaTransList, words * sizeof(bnfa_state_t));
+
+    for ( int i = 0; i < bnfa->bnfaNumStates; ++i )
+    {
+        if ( !bnfa->bnfaMatchList[i] )
+            continue;
+
+        uint32_t count = 0;
+
+        for ( bnfa_match_node_t* m = bnfa->bnfaMatchList[i]; m; m = m->next )
+            ++count;
+
+        w.put(i);
+        w.put(count);
+
+        for ( bnfa_match_node_t* m = bnfa->bnfaMatchList[i]; m; m = m->next )
+            w.put(index[m->data]);
+    }
+    return true;
+}
+
+int bnfaDeserialize(SnortConfig* sc, bnfa_struct_t* bnfa, const uint8_t* buf, size_t len)
+{
+    if ( bnfa->bnfaFormat != BNFA_SPARSE or bnfa->bnfaTransList )
+        return -1;
+
+    std::vector<bnfa_pattern_t*> pats;
+
+    for ( bnfa_pattern_t* p = bnfa->bnfaPatterns; p; p = p->next )
+        pats.emplace_back(p);
+
+    MpseBlobReader r(buf, len);
+    int num_states, num_trans, match_states;
+    unsigned words;
+
+    if ( !r.get(num_states) or !r.get(num_trans) or !r.get(match_states) or !r.get(words) )
+        return -1;
+
+    if ( num_states <= 0 or num_states > BNFA_SPARSE_MAX_STATE or !words )
+        return -1;
+
+    const bnfa_state_t* ps = (const bnfa_state_t*)r.get(words * sizeof(bnfa_state_t));
+
+    if ( !ps )
+        return -1;
+
+    bnfa->bnfaNumStates = num_states;
+    bnfa->bnfaMaxStates = num_states;
+    bnfa->bnfaNumTrans = num_trans;
+    bnfa->bnfaMatchStates = match_states;
+
+    // from here on a failure leaves a partial state machine that can only be freed
+    bnfa->bnfaMatchList = (bnfa_match_node_t**)BNFA_MALLOC(sizeof(void*) * num_states,
+        bnfa->matchlist_memory);
+
+    bnfa->bnfaTransList = BNFA_MALLOC(words * sizeof(bnfa_state_t), bnfa->nextstate_memory);
+    memcpy(bnfa->bnfaTransList, ps, words * sizeof(bnfa_state_t));
+
+    if ( bnfa_trans_list_size(bnfa->bnfaTransList, words, num_states) != words )
+        return -2;
+
+    for ( int i = 0; i < match_states; ++i )
+    {
+        int state;
+        uint32_t count;
+
+        if ( !r.get(state) or !r.get(count) or state < 0 or state >= num_states )
+            return -2;
+
+        // keep the saved order since it determines the order of match callbacks
+        bnfa_match_node_t** tail = &bnfa->bnfaMatchList[state];
+
+        for ( uint32_t j = 0; j < count; ++j )
+        {
+            uint32_t ix;
+
+            if ( !r.get(ix) or ix >= pats.size() )
+                return -2;
+
+            bnfa_match_node_t* m = (bnfa_match_node_t*)BNFA_MALLOC(
+                sizeof(bnfa_match_node_t), bnfa->matchlist_memory);
+
+            m->data = pats[ix];
+            *tail = m;
+            tail = &m->next;
+        }
+    }
+
+    if ( !r.done() )
+        return -2;
+
+    bnfaAccumInfo(bnfa);
+
+    if ( bnfa->agent )
+        bnfaBuildMatchStateTrees(sc, bnfa);
+
+    return 0;
+}
+
 /*
    binary array search on sparse transition array
 
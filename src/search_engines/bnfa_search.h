@@ -31,6 +31,7 @@
 */
 
 #include <cstdint>
+#include <string>
 
 #include "search_common.h"
 
@@ -170,6 +171,10 @@ int bnfaAddPattern(
 
 int bnfaCompile(snort::SnortConfig*, bnfa_struct_t*);
 
+bool bnfaCacheKey(bnfa_struct_t*, std::string&);
+bool bnfaSerialize(bnfa_struct_t*, std::string&);
+int bnfaDeserialize(snort::SnortConfig*, bnfa_struct_t*, const uint8_t*, size_t);
+
 unsigned _bnfa_search_csparse_nfa(
     bnfa_struct_t * pstruct, const uint8_t* t, int tlen, MpseMatch,
     void* context, unsigned sindex, int* current_state);
@@ -26,6 +26,7 @@
 #include <hs_runtime.h>
 
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 
 #include "framework/module.h"
@@ -36,10 +37,12 @@
 #include "main/thread.h"
 #include "utils/stats.h"
 
+#include "mpse_blob.h"
+
 using namespace snort;
 
 static const char* s_name = "hyperscan";
-static const char* s_help = "intel hyperscan-based mpse with regex support";
+static const char* s_help = "hyperscan-based mpse with regex support (intel hyperscan or vectorscan)";
 
 struct Pattern
 {
@@ -154,6 +157,10 @@ public:
     int prep_patterns(SnortConfig*) override;
     void reuse_search() override;
 
+    bool get_cache_key(std::string&) override;
+    bool get_compiled(std::string&) override;
+    int set_compiled(SnortConfig*, const uint8_t*, size_t) override;
+
     int _search(const uint8_t*, int, MpseMatch, void*, int*) override;
 
     int get_pattern_count() const override
@@ -225,7 +232,7 @@ int HyperscanMpse::prep_patterns(SnortConfig* sc)
 
     if ( hs_valid_platform() != HS_SUCCESS )
     {
-        ParseError("This host does not support Hyperscan.");
+        ParseError("This host does not support Hyperscan %s.", hs_version());
         return -1;
     }
 
@@ -265,9 +272,65 @@ int HyperscanMpse::prep_patterns(SnortConfig* sc)
     return 0;
 }
 
+// the database embeds the hyperscan version and platform and is checked
+// when deserialized but the key includes the version so that an upgrade
+// doesn't just trade hits for deserialization failures.
+bool HyperscanMpse::get_cache_key(std::string& key)
+{
+    MpseBlobWriter w(key);
+    std::string version = hs_version();
+
+    w.put(version.c_str(), version.size() + 1);
+    w.put((uint32_t)pvector.size());
+
+    for ( auto& p : pvector )
+    {
+        w.put(p.flags);
+        w.put(p.negate);
+        w.put(p.pat.c_str(), p.pat.size() + 1);
+    }
+    return true;
+}
+
+bool HyperscanMpse::get_compiled(std::string& blob)
+{
+    char* bytes = nullptr;
+    size_t len = 0;
+
+    if ( !hs_db or hs_serialize_database(hs_db, &bytes, &len) != HS_SUCCESS )
+        return false;
+
+    blob.append(bytes, len);
+    free(bytes);
+    return true;
+}
+
+int HyperscanMpse::set_compiled(SnortConfig* sc, const uint8_t* buf, size_t len)
+{
+    if ( pvector.empty() or hs_db )
+        return -1;
+
+    if ( hs_deserialize_database((const char*)buf, len, &hs_db) != HS_SUCCESS or !hs_db )
+    {
+        hs_db = nullptr;
+        return -1;
+    }
+
+    if ( hs_error_t err = hs_alloc_scratch(hs_db, &s_scratch[get_instance_id()]) )
+    {
+        ParseError("can't allocate search scratch space (%d)", err);
+        return -3;
+    }
+
+    if ( agent )
+        user_ctor(sc);
+
+    return 0;
+}
+
 void HyperscanMpse::reuse_search()
 {
-    if ( pvector.empty() )
+    if ( pvector.empty() or get_instance_id() >= s_scratch.size() )
         return;
 
     if ( hs_error_t err = hs_alloc_scratch(hs_db, &s_scratch[get_instance_id()]) )
@@ -347,7 +410,20 @@ static bool scratch_setup(SnortConfig* sc)
     for ( unsigned i = 0; i < sc->num_slots; ++i )
     {
         hs_scratch_t** ss = (hs_scratch_t**) &sc->state[i][scratch_index];
-        hs_clone_scratch(max, ss);
+
+        if ( hs_error_t err = hs_clone_scratch(max, ss) )
+        {
+            // cleanup is only called if setup succeeds
+            for ( unsigned j = 0; j < i; ++j )
+            {
+                hs_free_scratch((hs_scratch_t*)sc->state[j][scratch_index]);
+                sc->state[j][scratch_index] = nullptr;
+            }
+            *ss = nullptr;
+            hs_free_scratch(max);
+            ParseError("can't clone search scratch space (%d)", err);
+            return false;
+        }
     }
     hs_free_scratch(max);
     return true;
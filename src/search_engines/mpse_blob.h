@@ -0,0 +1,84 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// mpse_blob.h
+
+#ifndef MPSE_BLOB_H
+#define MPSE_BLOB_H
+
+// helpers for building cache keys and compiled state machine blobs for the
+// search engine cache.  values are stored in host byte order; the cache is
+// not meant to be shared across architectures.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+class MpseBlobWriter
+{
+public:
+    MpseBlobWriter(std::string& s) : blob(s) { }
+
+    template <typename T>
+    void put(const T& v)
+    { blob.append((const char*)&v, sizeof(v)); }
+
+    void put(const void* p, size_t n)
+    { blob.append((const char*)p, n); }
+
+private:
+    std::string& blob;
+};
+
+class MpseBlobReader
+{
+public:
+    MpseBlobReader(const uint8_t* p, size_t n) : next(p), end(p + n) { }
+
+    template <typename T>
+    bool get(T& v)
+    {
+        if ( (size_t)(end - next) < sizeof(v) )
+            return false;
+
+        memcpy(&v, next, sizeof(v));
+        next += sizeof(v);
+        return true;
+    }
+
+    // returns nullptr if fewer than n bytes remain
+    const uint8_t* get(size_t n)
+    {
+        if ( (size_t)(end - next) < n )
+            return nullptr;
+
+        const uint8_t* p = next;
+        next += n;
+        return p;
+    }
+
+    bool done() const
+    { return next == end; }
+
+private:
+    const uint8_t* next;
+    const uint8_t* end;
+};
+
+#endif
+
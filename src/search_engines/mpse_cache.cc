@@ -0,0 +1,412 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// mpse_cache.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "mpse_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "framework/mpse.h"
+#include "hash/hashes.h"
+#include "log/messages.h"
+#include "time/clock_defs.h"
+#include "utils/util.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+// the state machine follows the header.  the digest guards against
+// truncated or damaged files since engines trust their own state tables.
+struct MpseCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t size;
+    uint64_t compile_usecs;
+    uint8_t digest[SHA256_HASH_SIZE];
+};
+
+static const char cache_magic[8] = "snortmc";
+static const uint32_t cache_version = 1;
+
+MpseCache::MpseCache(const std::string& d) : dir(d)
+{
+    enabled = !mkdir(dir.c_str(), 0700) or errno == EEXIST;
+
+    if ( !enabled )
+        ErrorMessage("search engine cache disabled, can't create %s: %s\n",
+            dir.c_str(), get_error(errno));
+}
+
+std::string MpseCache::get_path(const std::string& key) const
+{
+    static const char* hex = "0123456789abcdef";
+    uint8_t digest[SHA256_HASH_SIZE];
+
+    sha256((const unsigned char*)key.data(), key.size(), digest);
+
+    std::string path = dir + "/";
+
+    for ( auto b : digest )
+    {
+        path += hex[b >> 4];
+        path += hex[b & 0xF];
+    }
+    return path + ".mpse";
+}
+
+int MpseCache::prep(Mpse* m, SnortConfig* sc)
+{
+    std::string key = m->get_method();
+    key += '\0';
+
+    if ( !enabled or !m->get_cache_key(key) )
+        return m->prep_patterns(sc);
+
+    std::string path = get_path(key);
+    int ret = load(m, sc, path);
+
+    if ( ret != -1 )
+        return ret;
+
+    stats.misses++;
+
+    hr_time start = SnortClock::now();
+    ret = m->prep_patterns(sc);
+
+    if ( !ret )
+        save(m, path, clock_usecs(TO_USECS(SnortClock::now() - start)));
+
+    return ret;
+}
+
+// returns -1 if the engine must still be compiled
+int MpseCache::load(Mpse* m, SnortConfig* sc, const std::string& path)
+{
+    hr_time start = SnortClock::now();
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if ( fd < 0 )
+        return -1;
+
+    struct stat st;
+
+    if ( fstat(fd, &st) or (size_t)st.st_size < sizeof(MpseCacheHeader) )
+    {
+        close(fd);
+        return -1;
+    }
+
+    size_t len = st.st_size;
+    void* map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if ( map == MAP_FAILED )
+        return -1;
+
+    const MpseCacheHeader* h = (const MpseCacheHeader*)map;
+    const uint8_t* blob = (const uint8_t*)map + sizeof(*h);
+    int ret = -1;
+
+    if ( !memcmp(h->magic, cache_magic, sizeof(h->magic)) and h->version == cache_version and
+        h->size == len - sizeof(*h) )
+    {
+        uint8_t digest[SHA256_HASH_SIZE];
+        sha256(blob, h->size, digest);
+
+        if ( !memcmp(digest, h->digest, sizeof(digest)) )
+            ret = m->set_compiled(sc, blob, h->size);
+    }
+
+    if ( !ret )
+    {
+        uint64_t usecs = clock_usecs(TO_USECS(SnortClock::now() - start));
+        stats.hits++;
+
+        if ( h->compile_usecs > usecs )
+            stats.usecs_saved += h->compile_usecs - usecs;
+    }
+    else if ( ret != -1 )
+        ErrorMessage("search engine cache: can't load %s\n", path.c_str());
+
+    munmap(map, len);
+    return ret;
+}
+
+static bool write_all(int fd, const void* buf, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)buf;
+
+    while ( len )
+    {
+        ssize_t n = write(fd, p, len);
+
+        if ( n < 0 and errno == EINTR )
+            continue;
+
+        if ( n <= 0 )
+            return false;
+
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+void MpseCache::save(Mpse* m, const std::string& path, uint64_t compile_usecs)
+{
+    std::string blob;
+
+    if ( !m->get_compiled(blob) )
+        return;
+
+    MpseCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, cache_magic, sizeof(h.magic));
+    h.version = cache_version;
+    h.size = blob.size();
+    h.compile_usecs = compile_usecs;
+    sha256((const unsigned char*)blob.data(), blob.size(), h.digest);
+
+    std::string tmp = path + ".XXXXXX";
+    int fd = mkstemp(&tmp[0]);
+
+    if ( fd < 0 )
+    {
+        stats.write_failures++;
+        return;
+    }
+
+    bool ok = write_all(fd, &h, sizeof(h)) and write_all(fd, blob.data(), blob.size());
+    ok = !close(fd) and ok;
+
+    if ( !ok or rename(tmp.c_str(), path.c_str()) )
+    {
+        unlink(tmp.c_str());
+        stats.write_failures++;
+    }
+}
+
+//--------------------------------------------------------------------------
+// unit tests
+//--------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+#include <dirent.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// compiles by joining the patterns; loading can be told to reject or fail
+class CacheTestMpse : public Mpse
+{
+public:
+    CacheTestMpse() : Mpse("cache_test") { }
+
+    int add_pattern(const uint8_t* pat, unsigned len, const PatternDescriptor&, void*) override
+    { pats.emplace_back((const char*)pat, len); return 0; }
+
+    int prep_patterns(SnortConfig*) override
+    {
+        ++compiles;
+        for ( auto& p : pats )
+            compiled += p + "|";
+        return 0;
+    }
+
+    bool get_cache_key(std::string& key) override
+    {
+        for ( auto& p : pats )
+            key += p + '\0';
+        return true;
+    }
+
+    bool get_compiled(std::string& blob) override
+    { blob = compiled; return true; }
+
+    int set_compiled(SnortConfig*, const uint8_t* buf, size_t len) override
+    {
+        if ( load_ret )
+            return load_ret;
+
+        compiled.assign((const char*)buf, len);
+        ++loads;
+        return 0;
+    }
+
+    int _search(const uint8_t*, int, MpseMatch, void*, int*) override
+    { return 0; }
+
+    std::vector<std::string> pats;
+    std::string compiled;
+    unsigned compiles = 0;
+    unsigned loads = 0;
+    int load_ret = 0;
+};
+
+static void add(CacheTestMpse& m, const char* s)
+{ m.add_pattern((const uint8_t*)s, strlen(s), Mpse::PatternDescriptor(), nullptr); }
+
+// a cache directory under a new /tmp directory; both are removed with the
+// cache files when the test is done
+struct TempDir
+{
+    TempDir()
+    {
+        char tmp[] = "/tmp/mpse_cache_XXXXXX";
+        CHECK(mkdtemp(tmp));
+        top = tmp;
+        dir = top + "/cache";
+    }
+
+    ~TempDir()
+    {
+        if ( DIR* d = opendir(dir.c_str()) )
+        {
+            while ( dirent* de = readdir(d) )
+            {
+                if ( strcmp(de->d_name, ".") and strcmp(de->d_name, "..") )
+                    unlink((dir + "/" + de->d_name).c_str());
+            }
+            closedir(d);
+            rmdir(dir.c_str());
+        }
+        rmdir(top.c_str());
+    }
+
+    std::string top;
+    std::string dir;
+};
+
+TEST_CASE("mpse cache temp dir", "[mpse_cache]")
+{
+    std::string top;
+    {
+        TempDir tmp;
+        top = tmp.top;
+        MpseCache cache(tmp.dir);
+
+        CacheTestMpse a;
+        add(a, "foo");
+        CHECK(cache.prep(&a, nullptr) == 0);
+    }
+    CHECK(access(top.c_str(), F_OK) != 0);
+}
+
+TEST_CASE("mpse cache hit and miss", "[mpse_cache]")
+{
+    TempDir tmp;
+    MpseCache cache(tmp.dir);
+
+    CacheTestMpse a;
+    add(a, "foo");
+    add(a, "bar");
+    CHECK(cache.prep(&a, nullptr) == 0);
+    CHECK(a.compiles == 1);
+    CHECK(cache.get_stats().misses == 1);
+
+    CacheTestMpse b;
+    add(b, "foo");
+    add(b, "bar");
+    CHECK(cache.prep(&b, nullptr) == 0);
+    CHECK(b.compiles == 0);
+    CHECK(b.loads == 1);
+    CHECK(b.compiled == a.compiled);
+    CHECK(cache.get_stats().hits == 1);
+
+    // different order is a different key
+    CacheTestMpse c;
+    add(c, "bar");
+    add(c, "foo");
+    CHECK(cache.prep(&c, nullptr) == 0);
+    CHECK(c.compiles == 1);
+    CHECK(cache.get_stats().misses == 2);
+}
+
+TEST_CASE("mpse cache fallback", "[mpse_cache]")
+{
+    TempDir tmp;
+    const std::string& dir = tmp.dir;
+    MpseCache cache(dir);
+
+    CacheTestMpse a;
+    add(a, "foo");
+    CHECK(cache.prep(&a, nullptr) == 0);
+
+    SECTION("rejected")
+    {
+        CacheTestMpse b;
+        add(b, "foo");
+        b.load_ret = -1;
+        CHECK(cache.prep(&b, nullptr) == 0);
+        CHECK(b.compiles == 1);
+    }
+    SECTION("failed")
+    {
+        CacheTestMpse b;
+        add(b, "foo");
+        b.load_ret = -2;
+        CHECK(cache.prep(&b, nullptr) == -2);
+        CHECK(b.compiles == 0);
+    }
+    SECTION("damaged")
+    {
+        DIR* d = opendir(dir.c_str());
+        REQUIRE(d);
+
+        while ( dirent* de = readdir(d) )
+        {
+            std::string path = dir + "/" + de->d_name;
+
+            if ( path.size() > 5 and !path.compare(path.size() - 5, 5, ".mpse") )
+            {
+                FILE* f = fopen(path.c_str(), "a");
+                REQUIRE(f);
+                fputc('x', f);
+                fclose(f);
+            }
+        }
+        closedir(d);
+
+        CacheTestMpse b;
+        add(b, "foo");
+        CHECK(cache.prep(&b, nullptr) == 0);
+        CHECK(b.compiles == 1);
+        CHECK(b.loads == 0);
+    }
+}
+
+#endif
+
@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// mpse_cache.h
+
+#ifndef MPSE_CACHE_H
+#define MPSE_CACHE_H
+
+// MpseCache keeps compiled search engines in a directory so that startup and
+// reload can map them instead of compiling again.  each file is named by a
+// hash of the engine's cache key so there is no index to maintain.  files are
+// written under a temporary name and renamed so concurrent compile threads and
+// processes never see a partial file.  stale files are never removed.
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace snort
+{
+class Mpse;
+struct SnortConfig;
+}
+
+class MpseCache
+{
+public:
+    MpseCache(const std::string& dir);
+
+    // load the engine from the cache or compile it with prep_patterns() and
+    // save it.  returns zero on success like prep_patterns().
+    int prep(snort::Mpse*, snort::SnortConfig*);
+
+    struct Stats
+    {
+        std::atomic<uint64_t> hits { 0 };
+        std::atomic<uint64_t> misses { 0 };
+        std::atomic<uint64_t> write_failures { 0 };
+        std::atomic<uint64_t> usecs_saved { 0 };
+    };
+
+    const Stats& get_stats() const
+    { return stats; }
+
+private:
+    std::string get_path(const std::string& key) const;
+    int load(snort::Mpse*, snort::SnortConfig*, const std::string& path);
+    void save(snort::Mpse*, const std::string& path, uint64_t compile_usecs);
+
+private:
+    std::string dir;
+    bool enabled;
+    Stats stats;
+};
+
+#endif
+
@@ -259,6 +259,21 @@ TEST(mpse_hs_match, empty)
     CHECK(hits == 0);
 }
 
+TEST(mpse_hs_match, no_scratch)
+{
+    Mpse::PatternDescriptor desc;
+
+    CHECK(hs->add_pattern((const uint8_t*)"foo", 3, desc, s_user) == 0);
+    CHECK(hs->prep_patterns(snort_conf) == 0);
+
+    // scratch was not cloned to the packet thread slot
+    int state = 0;
+    CHECK(hs->search((const uint8_t*)"foo", 3, match, nullptr, &state) == 0);
+    CHECK(hits == 0);
+
+    do_cleanup = scratcher->setup(snort_conf);
+}
+
 TEST(mpse_hs_match, single)
 {
     Mpse::PatternDescriptor desc;
@@ -425,6 +440,32 @@ TEST(mpse_hs_multi, single)
     CHECK(hits == 1);
 }
 
+TEST(mpse_hs_multi, compiled)
+{
+    Mpse::PatternDescriptor desc;
+
+    CHECK(hs1->add_pattern((const uint8_t*)"uba", 3, desc, s_user) == 0);
+    CHECK(hs2->add_pattern((const uint8_t*)"uba", 3, desc, s_user) == 0);
+
+    std::string key1, key2;
+    CHECK(hs1->get_cache_key(key1));
+    CHECK(hs2->get_cache_key(key2));
+    CHECK(key1 == key2);
+
+    CHECK(hs1->prep_patterns(snort_conf) == 0);
+
+    std::string blob;
+    CHECK(hs1->get_compiled(blob));
+    CHECK(hs2->set_compiled(snort_conf, (const uint8_t*)"junk", 4) == -1);
+    CHECK(hs2->set_compiled(snort_conf, (const uint8_t*)blob.data(), blob.size()) == 0);
+
+    do_cleanup = scratcher->setup(snort_conf);
+
+    int state = 0;
+    CHECK(hs2->search((const uint8_t*)"fubar", 5, match, nullptr, &state) == 1);
+    CHECK(hits == 1);
+}
+
 //-------------------------------------------------------------------------
 // main
 //-------------------------------------------------------------------------
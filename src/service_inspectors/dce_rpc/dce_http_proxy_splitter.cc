@@ -172,6 +172,12 @@ const StreamBuffer StreamSplitter::reassemble(
     return { nullptr, 0 };
 }
 
+const StreamBuffer StreamSplitter::gather(
+    Flow*, const StreamBuffer*, unsigned, unsigned, bool)
+{
+    return { nullptr, 0 };
+}
+
 //--------------------------------------------------------------------------
 // unit tests
 //--------------------------------------------------------------------------
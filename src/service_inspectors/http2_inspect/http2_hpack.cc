@@ -30,6 +30,17 @@
 #include "http2_flow_data.h"
 #include "http2_start_line.h"
 
+#ifdef BENCHMARK_TEST
+#include <string>
+#include <vector>
+
+#include "catch/snort_catch.h"
+#include "flow/flow.h"
+
+#include "http2_request_line.h"
+#include "http2_status_line.h"
+#endif
+
 using namespace HttpCommon;
 using namespace Http2Enums;
 
@@ -117,7 +128,9 @@ bool Http2HpackDecoder::decode_indexed_name(const uint8_t* encoded_header_buffer
         return false;
     }
 
-    name.set(entry->name);
+    // The entry's strings may move or be freed when the header line is added to the dynamic
+    // table, so the name refers to the copy in the decoded header
+    name.set(bytes_written, decoded_header_buffer, false);
     return true;
 }
 
@@ -385,3 +398,70 @@ Field Http2HpackDecoder::get_decoded_headers(const uint8_t* const decoded_header
 {
     return Field(decoded_headers_size, decoded_headers, false);
 }
+
+#ifdef BENCHMARK_TEST
+
+// RFC 7541 C.4 and C.6, the request and response examples with Huffman coding. They are replayed
+// on one connection so the dynamic table keeps adding and evicting entries.
+static const std::vector<std::vector<uint8_t>> request_blocks =
+{
+    { 0x82, 0x86, 0x84, 0x41, 0x8c, 0xf1, 0xe3, 0xc2, 0xe5, 0xf2, 0x3a, 0x6b, 0xa0, 0xab, 0x90,
+      0xf4, 0xff },
+    { 0x82, 0x86, 0x84, 0xbe, 0x58, 0x86, 0xa8, 0xeb, 0x10, 0x64, 0x9c, 0xbf },
+    { 0x82, 0x87, 0x85, 0xbf, 0x40, 0x88, 0x25, 0xa8, 0x49, 0xe9, 0x5b, 0xa9, 0x7d, 0x7f, 0x89,
+      0x25, 0xa8, 0x49, 0xe9, 0x5b, 0xb8, 0xe8, 0xb4, 0xbf },
+};
+
+static const std::vector<std::vector<uint8_t>> response_blocks =
+{
+    { 0x48, 0x82, 0x64, 0x02, 0x58, 0x85, 0xae, 0xc3, 0x77, 0x1a, 0x4b, 0x61, 0x96, 0xd0, 0x7a,
+      0xbe, 0x94, 0x10, 0x54, 0xd4, 0x44, 0xa8, 0x20, 0x05, 0x95, 0x04, 0x0b, 0x81, 0x66, 0xe0,
+      0x82, 0xa6, 0x2d, 0x1b, 0xff, 0x6e, 0x91, 0x9d, 0x29, 0xad, 0x17, 0x18, 0x63, 0xc7, 0x8f,
+      0x0b, 0x97, 0xc8, 0xe9, 0xae, 0x82, 0xae, 0x43, 0xd3 },
+    { 0x48, 0x83, 0x64, 0x0e, 0xff, 0xc1, 0xc0, 0xbf },
+    { 0x88, 0xc1, 0x61, 0x96, 0xd0, 0x7a, 0xbe, 0x94, 0x10, 0x54, 0xd4, 0x44, 0xa8, 0x20, 0x05,
+      0x95, 0x04, 0x0b, 0x81, 0x66, 0xe0, 0x84, 0xa6, 0x2d, 0x1b, 0xff, 0xc0, 0x5a, 0x83, 0x9b,
+      0xd9, 0xab, 0x77, 0xad, 0x94, 0xe7, 0x82, 0x1d, 0xd7, 0xf2, 0xe6, 0xc7, 0xb3, 0x35, 0xdf,
+      0xdf, 0xcd, 0x5b, 0x39, 0x60, 0xd5, 0xaf, 0x27, 0x08, 0x7f, 0x36, 0x72, 0xc1, 0xab, 0x27,
+      0x0f, 0xb5, 0x29, 0x1f, 0x95, 0x87, 0x31, 0x60, 0x65, 0xc0, 0x03, 0xed, 0x4e, 0xe5, 0xb1,
+      0x06, 0x3d, 0x50, 0x07 },
+};
+
+template <typename StartLine>
+static void bench_blocks(const char* name, SourceId source_id,
+    const std::vector<std::vector<uint8_t>>& blocks, uint32_t table_size)
+{
+    snort::Flow flow;
+    Http2FlowData flow_data(&flow);
+    Http2HpackDecoder* decoder = flow_data.get_hpack_decoder(source_id);
+    Http2EventGen events;
+    Http2Infractions infractions;
+    std::vector<uint8_t> decoded(MAX_OCTETS);
+
+    decoder->get_decode_table()->settings_table_size_update(table_size);
+
+    size_t bytes = 0;
+    for (const auto& b : blocks)
+        bytes += b.size();
+
+    BENCHMARK(std::string(name) + " (" + std::to_string(bytes) + " bytes)")
+    {
+        bool ok = true;
+
+        for (const auto& b : blocks)
+        {
+            StartLine start_line(&events, &infractions);
+            ok = decoder->decode_headers(b.data(), b.size(), decoded.data(), &start_line, false)
+                and ok;
+        }
+        return ok;
+    };
+}
+
+TEST_CASE("hpack decode", "[http2][benchmark]")
+{
+    bench_blocks<Http2RequestLine>("hpack requests", SRC_CLIENT, request_blocks, 4096);
+    bench_blocks<Http2StatusLine>("hpack responses", SRC_SERVER, response_blocks, 256);
+}
+
+#endif
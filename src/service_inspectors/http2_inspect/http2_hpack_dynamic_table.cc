@@ -24,21 +24,13 @@
 #include "http2_hpack_dynamic_table.h"
 #include "http2_module.h"
 
+#include <new>
 #include <string.h>
 
 #include "http2_hpack_table.h"
 
 using namespace Http2Enums;
 
-HpackDynamicTable::~HpackDynamicTable()
-{
-    for (std::vector<HpackTableEntry*>::iterator it = circular_buf.begin();
-        it != circular_buf.end(); ++it)
-    {
-        delete *it;
-    }
-}
-
 bool HpackDynamicTable::add_entry(const Field& name, const Field& value)
 {
     // The add only fails if the underlying circular array is out of space
@@ -55,16 +47,22 @@ bool HpackDynamicTable::add_entry(const Field& name, const Field& value)
         return true;
     }
 
-    // Create new entry. This is done before pruning because the entry referenced by the new name
-    // may be pruned.
-    HpackTableEntry* new_entry = new HpackTableEntry(name, value);
-
     // If add entry would exceed max table size, evict old entries
     prune_to_size(max_size - new_entry_size);
 
+    // The name may be the strings of an entry that was just evicted, or one that is moved if the
+    // arena is compacted, so the old arena is kept until the name is copied
+    std::unique_ptr<uint8_t[]> old_arena;
+    const uint32_t pos = reserve(name.length() + value.length(), old_arena);
+    uint8_t* const strings = arena.get() + pos;
+
+    memmove(strings, name.start(), name.length());
+    memcpy(strings + name.length(), value.start(), value.length());
+
     // Add new entry to the front of the table (newest entry = lowest index)
     start = (start + ARRAY_CAPACITY - 1) % ARRAY_CAPACITY;
-    circular_buf[start] = new_entry;
+    circular_buf[start] = { pos, static_cast<uint16_t>(name.length()),
+        static_cast<uint16_t>(value.length()) };
 
     num_entries++;
     if (num_entries > Http2Module::get_peg_counts(PEG_MAX_TABLE_ENTRIES))
@@ -74,6 +72,76 @@ bool HpackDynamicTable::add_entry(const Field& name, const Field& value)
     return true;
 }
 
+// Returns the arena offset for strings of the given length. The strings of an entry are never
+// split across the end of the arena.
+uint32_t HpackDynamicTable::reserve(uint32_t length, std::unique_ptr<uint8_t[]>& old_arena)
+{
+    const uint32_t tail = num_entries ? get_offset((start + num_entries - 1) % ARRAY_CAPACITY) : 0;
+    uint32_t pos;
+
+    if (!arena)
+    {
+        compact(length, old_arena);
+        pos = arena_head;
+    }
+    else if (!arena_wrapped and (arena_size - arena_head >= length))
+        pos = arena_head;
+
+    else if (!arena_wrapped and (tail >= length))
+    {
+        pos = 0;
+        arena_wrapped = true;
+    }
+    else if (arena_wrapped and (tail - arena_head >= length))
+        pos = arena_head;
+
+    else
+    {
+        compact(length, old_arena);
+        pos = arena_head;
+    }
+
+    arena_head = pos + length;
+    return pos;
+}
+
+// Copy the live strings to the start of a new arena that is at least twice as big as the live
+// strings and the new ones so the ring has room to wrap. The old arena is handed back to the
+// caller.
+void HpackDynamicTable::compact(uint32_t length, std::unique_ptr<uint8_t[]>& old_arena)
+{
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < num_entries; i++)
+    {
+        const Slot& slot = circular_buf[(start + i) % ARRAY_CAPACITY];
+        live += slot.name_length + slot.value_length;
+    }
+
+    uint32_t new_size = arena_size ? arena_size : DEFAULT_MAX_SIZE;
+    while (new_size < 2 * (live + length))
+        new_size *= 2;
+
+    uint8_t* const new_arena = new uint8_t[new_size];
+    uint32_t pos = 0;
+
+    // Oldest first
+    for (uint32_t i = num_entries; i > 0; i--)
+    {
+        Slot& slot = circular_buf[(start + i - 1) % ARRAY_CAPACITY];
+        const uint32_t strings_length = slot.name_length + slot.value_length;
+
+        memcpy(new_arena + pos, arena.get() + slot.offset, strings_length);
+        slot.offset = pos;
+        pos += strings_length;
+    }
+
+    old_arena = std::move(arena);
+    arena.reset(new_arena);
+    arena_size = new_size;
+    arena_head = pos;
+    arena_wrapped = false;
+}
+
 const HpackTableEntry* HpackDynamicTable::get_entry(uint32_t virtual_index) const
 {
     const uint32_t dyn_index = virtual_index - HpackIndexTable::STATIC_MAX_INDEX - 1;
@@ -81,8 +149,11 @@ const HpackTableEntry* HpackDynamicTable::get_entry(uint32_t virtual_index) cons
     if (dyn_index + 1 > num_entries)
         return nullptr;
 
-    const uint32_t arr_index = (start + dyn_index) % ARRAY_CAPACITY;
-    return circular_buf[arr_index];
+    const Slot& slot = circular_buf[(start + dyn_index) % ARRAY_CAPACITY];
+    const uint8_t* const strings = arena.get() + slot.offset;
+    new (&entry) HpackTableEntry(slot.name_length, strings, slot.value_length,
+        strings + slot.name_length);
+    return &entry;
 }
 
 /* This is called when adding a new entry and when receiving a dynamic table size update.
@@ -96,11 +167,21 @@ void HpackDynamicTable::prune_to_size(uint32_t new_max_size)
     while (rfc_table_size > new_max_size)
     {
         const uint32_t last_index = (start + num_entries - 1 + ARRAY_CAPACITY) % ARRAY_CAPACITY;
+        const Slot& last = circular_buf[last_index];
         num_entries--;
-        rfc_table_size -= circular_buf[last_index]->name.length() +
-            circular_buf[last_index]->value.length() + RFC_ENTRY_OVERHEAD;
-        delete circular_buf[last_index];
-        circular_buf[last_index] = nullptr;
+        rfc_table_size -= last.name_length + last.value_length + RFC_ENTRY_OVERHEAD;
+
+        // Evicting an entry only frees its strings in the arena
+        if (num_entries == 0)
+        {
+            arena_head = 0;
+            arena_wrapped = false;
+        }
+        else if (get_offset((last_index + ARRAY_CAPACITY - 1) % ARRAY_CAPACITY) <
+            get_offset(last_index))
+        {
+            arena_wrapped = false;
+        }
     }
 }
 
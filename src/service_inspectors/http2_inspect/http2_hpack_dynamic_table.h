@@ -20,21 +20,34 @@
 #ifndef HTTP2_HPACK_DYNAMIC_TABLE_H
 #define HTTP2_HPACK_DYNAMIC_TABLE_H
 
+#include "service_inspectors/http_inspect/http_enum.h"
 #include "service_inspectors/http_inspect/http_field.h"
 #include "main/snort_types.h"
 
 #include "http2_enum.h"
 
+#include <memory>
 #include <vector>
 
-struct HpackTableEntry;
+struct HpackTableEntry
+{
+    HpackTableEntry(uint32_t name_len, const uint8_t* _name, uint32_t value_len,
+        const uint8_t* _value) : name { static_cast<int32_t>(name_len), _name },
+        value { static_cast<int32_t>(value_len), _value } { }
+    HpackTableEntry() = default;
+    Field name;
+    Field value;
+};
 
+// The name and value of each dynamic table entry are stored together in a byte ring, the arena, in
+// the order the entries were added, so adding and evicting entries does not allocate. The arena is
+// reallocated and compacted only when a new entry does not fit in the free space on either side of
+// the live strings. The circular array only holds where the strings of each entry are.
 class HpackDynamicTable
 {
 public:
     // FIXIT-P This array can be optimized to start smaller and grow on demand
-    HpackDynamicTable() : circular_buf(ARRAY_CAPACITY, nullptr) {}
-    ~HpackDynamicTable();
+    HpackDynamicTable() : circular_buf(ARRAY_CAPACITY) {}
     const HpackTableEntry* get_entry(uint32_t index) const;
     bool add_entry(const Field& name, const Field& value);
     void update_size(uint32_t new_size);
@@ -50,8 +63,27 @@ private:
     uint32_t start = 0;
     uint32_t num_entries = 0;
     uint32_t rfc_table_size = 0;
-    std::vector<HpackTableEntry*> circular_buf;
+
+    struct Slot
+    {
+        uint32_t offset;
+        uint16_t name_length;
+        uint16_t value_length;
+    };
+    static_assert(HttpEnums::MAX_OCTETS <= UINT16_MAX, "decoded strings must fit in a Slot");
+    std::vector<Slot> circular_buf;
+
+    // get_entry() returns this, so it is only valid until the next lookup
+    mutable HpackTableEntry entry;
+
+    std::unique_ptr<uint8_t[]> arena;
+    uint32_t arena_size = 0;
+    uint32_t arena_head = 0;      // where the next strings go
+    bool arena_wrapped = false;   // the newest strings are before the oldest
 
     void prune_to_size(uint32_t new_max_size);
+    uint32_t get_offset(uint32_t arr_index) const { return circular_buf[arr_index].offset; }
+    uint32_t reserve(uint32_t length, std::unique_ptr<uint8_t[]>& old_arena);
+    void compact(uint32_t length, std::unique_ptr<uint8_t[]>& old_arena);
 };
 #endif
@@ -32,10 +32,6 @@ using namespace Http2Enums;
 
 static const uint8_t HUFFMAN_FLAG = 0x80;
 
-// Minimum bit length for each lookup table
-static const uint8_t min_decode_len[HUFFMAN_LOOKUP_MAX + 1] =
-    {5, 2, 2, 3, 5, 1, 1, 2, 2, 2, 2, 3, 3, 3, 4};
-
 bool Http2HpackStringDecode::translate(const uint8_t* in_buff, const uint32_t in_len,
     uint32_t& bytes_consumed, uint8_t* out_buff, const uint32_t out_len, uint32_t& bytes_written,
     Http2EventGen* const events, Http2Infractions* const infractions, bool partial_header) const
@@ -96,64 +92,10 @@ bool Http2HpackStringDecode::get_string(const uint8_t* in_buff, const uint32_t e
     return true;
 }
 
-// return is tail/padding
-bool Http2HpackStringDecode::get_next_byte(const uint8_t* in_buff, const uint32_t last_byte,
-    uint32_t& bytes_consumed, uint8_t& cur_bit, uint8_t match_len, uint8_t& byte,
-    bool& another_search) const
-{
-    another_search = true;
-    cur_bit += match_len;
-
-    if (cur_bit >= 8) // done with current bit
-    {
-        bytes_consumed++;
-        cur_bit -= 8;
-    }
-
-    bool tail = false;
-    uint8_t msb, lsb = 0xff;
-    if (bytes_consumed == last_byte)
-    {
-        // bytes consumed must be bigger than 1 - int length is at least 1
-        msb = in_buff[bytes_consumed-1];
-        another_search = false;
-        tail = true;
-    }
-    else if ((bytes_consumed + 1) == last_byte)
-    {
-        if (cur_bit != 0)
-        {
-            msb = in_buff[bytes_consumed++];
-            tail = true;
-        }
-        else
-        {
-            byte = in_buff[bytes_consumed];
-            return false;
-        }
-    }
-    else
-    {
-        msb = in_buff[bytes_consumed];
-        lsb = in_buff[bytes_consumed+1];
-    }
-
-    const uint16_t tmp = (uint16_t)(msb << 8) | lsb;
-    byte = (tmp & (0xff00 >> cur_bit)) >> (8 - cur_bit);
-    return tail;
-}
-
 bool Http2HpackStringDecode::get_huffman_string(const uint8_t* in_buff, const uint32_t encoded_len,
     uint32_t& bytes_consumed, uint8_t* out_buff, const uint32_t out_len, uint32_t& bytes_written,
     Http2Infractions* const infractions) const
 {
-    const uint32_t last_encoded_byte = bytes_consumed + encoded_len;
-    uint8_t byte;
-    uint8_t cur_bit = 0;
-    HuffmanEntry result = { 0, 0, HUFFMAN_LOOKUP_1 };
-    bool another_search = false;
-    HuffmanState state = HUFFMAN_LOOKUP_1;
-
     // Check length
     const uint32_t max_length = floor(encoded_len * 8.0/5.0);
     if (max_length > out_len)
@@ -162,83 +104,83 @@ bool Http2HpackStringDecode::get_huffman_string(const uint8_t* in_buff, const ui
         return false;
     }
 
-    while (!get_next_byte(in_buff, last_encoded_byte, bytes_consumed, cur_bit, result.len, byte,
-        another_search))
-    {
-        result = huffman_decode[state][byte];
-
-        switch (result.state) {
+    // Keep the positions local so the output stores don't force them to memory
+    const uint8_t* in = in_buff + bytes_consumed;
+    const uint8_t* const end = in + encoded_len;
+    uint8_t* out = out_buff + bytes_written;
 
-        case HUFFMAN_MATCH:
-            out_buff[bytes_written++] = result.symbol;
-            state = HUFFMAN_LOOKUP_1;
-            break;
+    uint64_t bits = 0;    // next bits of input, most significant first
+    unsigned num_bits = 0;
+    uint32_t bits_used = 0;
+    uint8_t node = HuffmanLookup::ROOT;
 
-        case HUFFMAN_LOOKUP_2:
-        case HUFFMAN_LOOKUP_3:
-        case HUFFMAN_LOOKUP_4:
-        case HUFFMAN_LOOKUP_5:
-        case HUFFMAN_LOOKUP_6:
-        case HUFFMAN_LOOKUP_7:
-        case HUFFMAN_LOOKUP_8:
-        case HUFFMAN_LOOKUP_9:
-        case HUFFMAN_LOOKUP_10:
-        case HUFFMAN_LOOKUP_11:
-        case HUFFMAN_LOOKUP_12:
-        case HUFFMAN_LOOKUP_13:
-        case HUFFMAN_LOOKUP_14:
-        case HUFFMAN_LOOKUP_15:
-            state = result.state;
-            break;
+    while (true)
+    {
+        while ((num_bits <= 56) and (in < end))
+        {
+            bits |= (uint64_t)*in++ << (56 - num_bits);
+            num_bits += 8;
+        }
 
-        case HUFFMAN_FAILURE:
-            *infractions += INF_HUFFMAN_DECODED_EOS;
-            return false;
+        if ((node == HuffmanLookup::ROOT) and (num_bits >= HuffmanLookup::LOOKUP_BITS))
+        {
+            const HuffmanLookup::Entry& entry =
+                huffman_lookup.find(bits >> (64 - HuffmanLookup::LOOKUP_BITS));
+
+            if (entry.count)
+            {
+                *out++ = entry.symbol[0];
+                if (entry.count > 1)
+                    *out++ = entry.symbol[1];
+
+                bits <<= entry.len;
+                num_bits -= entry.len;
+                bits_used += entry.len;
+                continue;
+            }
+        }
 
-        default:
+        if (num_bits == 0)
             break;
-        }
-    }
 
-    // Tail needs 1 last lookup in case the leftover is big enough for a match.
-    // Make sure match length <= available length
-    uint8_t leftover_len = 8 - cur_bit;
-    uint8_t old_result_len = result.len;
-    HuffmanState old_result_state = result.state;
+        // Long codes and the tail
+        const int16_t child = huffman_lookup.node(node).child[bits >> 63];
+        bits <<= 1;
+        num_bits--;
+        bits_used++;
 
-    if (another_search && (leftover_len >= min_decode_len[state]))
-    {
-        result = huffman_decode[state][byte];
-        if ((result.state == HUFFMAN_MATCH) && (result.len <= leftover_len))
+        if (!HuffmanLookup::is_leaf(child))
+            node = child;
+
+        else if (HuffmanLookup::symbol(child) == HuffmanLookup::EOS)
         {
-            out_buff[bytes_written++] = result.symbol;
-            byte = (byte << result.len) | (((uint16_t)1 << result.len) - 1);
+            bytes_consumed += (bits_used - 1) / 8;
+            bytes_written = out - out_buff;
+            *infractions += INF_HUFFMAN_DECODED_EOS;
+            return false;
         }
         else
         {
-            // Use leftover bits for padding check if previous lookup was a match
-            if (old_result_state == HUFFMAN_MATCH)
-                result.len = leftover_len;
-            else
-                result.len = old_result_len;
+            *out++ = HuffmanLookup::symbol(child);
+            node = HuffmanLookup::ROOT;
         }
     }
 
-    // Padding check
-    if (result.len < 8)
+    bytes_consumed += encoded_len;
+    bytes_written = out - out_buff;
+
+    // Padding check. RFC 7541 5.2: padding is up to 7 bits of the EOS code, which is all 1s.
+    const HuffmanLookup::Node& pending = huffman_lookup.node(node);
+
+    if (pending.depth >= 8)
     {
-        if (byte != 0xff)
-        {
-            *infractions += INF_HUFFMAN_BAD_PADDING;
-            return false;
-        }
+        *infractions += INF_HUFFMAN_INCOMPLETE_CODE_PADDING;
+        return false;
     }
-    else if (result.state != HUFFMAN_MATCH)
+    if (!pending.ones)
     {
-        *infractions += INF_HUFFMAN_INCOMPLETE_CODE_PADDING;
+        *infractions += INF_HUFFMAN_BAD_PADDING;
         return false;
     }
-
     return true;
 }
-
@@ -32,17 +32,6 @@
 
 using namespace Http2Enums;
 
-HpackTableEntry::HpackTableEntry(const Field& copy_name, const Field& copy_value)
-{
-    uint8_t* new_name = new uint8_t[copy_name.length()];
-    uint8_t* new_value = new uint8_t[copy_value.length()];
-    memcpy(new_name, copy_name.start(), copy_name.length());
-    memcpy(new_value, copy_value.start(), copy_value.length());
-
-    name.set(copy_name.length(), new_name, true);
-    value.set(copy_value.length(), new_value, true);
-}
-
 const HpackTableEntry HpackIndexTable::static_table[STATIC_MAX_INDEX + 1] =
 {
     MAKE_TABLE_ENTRY("", ""),
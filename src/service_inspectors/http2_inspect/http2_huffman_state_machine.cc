@@ -19,6 +19,10 @@
 
 #include "http2_huffman_state_machine.h"
 
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
 const HuffmanEntry huffman_decode[HUFFMAN_LOOKUP_MAX+1] [UINT8_MAX+1] =
 {
     { // HUFFMAN_LOOKUP_1
@@ -1849,3 +1853,100 @@ const HuffmanEntry huffman_decode[HUFFMAN_LOOKUP_MAX+1] [UINT8_MAX+1] =
         {6, (char)0, HUFFMAN_FAILURE}, {6, (char)0, HUFFMAN_FAILURE},
     },
 };
+
+// Rebuild the tree from the byte tables. A match of len bits is repeated for every value of the
+// remaining bits so only the first one is added. The only failure is EOS.
+namespace
+{
+class HuffmanTree
+{
+public:
+    HuffmanTree()
+    {
+        nodes.push_back({ { NONE, NONE }, 0, true });
+        walk(HUFFMAN_LOOKUP_1, 0, 0);
+        assert(nodes.size() == HuffmanLookup::NUM_NODES);
+    }
+
+    std::vector<HuffmanLookup::Node> nodes;
+
+private:
+    static const int16_t NONE = -1;
+
+    void walk(HuffmanState state, uint32_t code, unsigned len);
+    void add(uint32_t code, unsigned len, unsigned sym);
+};
+
+void HuffmanTree::walk(HuffmanState state, uint32_t code, unsigned len)
+{
+    for (unsigned b = 0; b <= UINT8_MAX; b++)
+    {
+        const HuffmanEntry& e = huffman_decode[state][b];
+
+        if ((e.state == HUFFMAN_MATCH) or (e.state == HUFFMAN_FAILURE))
+        {
+            if (b & ((1 << (8 - e.len)) - 1))
+                continue;
+
+            const unsigned sym = (e.state == HUFFMAN_MATCH) ?
+                (uint8_t)e.symbol : HuffmanLookup::EOS;
+            add((code << e.len) | (b >> (8 - e.len)), len + e.len, sym);
+        }
+        else
+        {
+            assert(e.len == 8);
+            walk(e.state, (code << 8) | b, len + 8);
+        }
+    }
+}
+
+void HuffmanTree::add(uint32_t code, unsigned len, unsigned sym)
+{
+    unsigned cur = HuffmanLookup::ROOT;
+
+    for (unsigned i = len - 1; i > 0; i--)
+    {
+        const unsigned bit = (code >> i) & 1;
+
+        if (nodes[cur].child[bit] == NONE)
+        {
+            nodes[cur].child[bit] = nodes.size();
+            nodes.push_back({ { NONE, NONE }, (uint8_t)(nodes[cur].depth + 1),
+                nodes[cur].ones and bit });
+        }
+        cur = nodes[cur].child[bit];
+    }
+    nodes[cur].child[code & 1] = -2 - (int16_t)sym;
+}
+}
+
+HuffmanLookup::HuffmanLookup()
+{
+    const HuffmanTree tree;
+    std::copy(tree.nodes.begin(), tree.nodes.end(), nodes);
+
+    for (unsigned bits = 0; bits < (1 << LOOKUP_BITS); bits++)
+    {
+        Entry& entry = table[bits];
+        unsigned cur = ROOT;
+        entry = { 0, 0, { 0, 0 } };
+
+        for (unsigned i = 1; (i <= LOOKUP_BITS) and (entry.count < 2); i++)
+        {
+            const int16_t c = nodes[cur].child[(bits >> (LOOKUP_BITS - i)) & 1];
+
+            if (!is_leaf(c))
+                cur = c;
+
+            else
+            {
+                assert(symbol(c) != EOS);
+                entry.symbol[entry.count++] = symbol(c);
+                entry.len = i;
+                cur = ROOT;
+            }
+        }
+    }
+}
+
+const HuffmanLookup huffman_lookup;
@@ -53,5 +53,53 @@ struct HuffmanEntry
 
 extern const HuffmanEntry huffman_decode[][UINT8_MAX+1];
 
+// The strings are decoded with a table derived from huffman_decode that is indexed by the next
+// LOOKUP_BITS bits of input. Each entry has the symbols whose codes are complete within those bits,
+// up to 2, and the number of bits they use. Longer codes and the end of a string walk the Huffman
+// tree a bit at a time.
+class HuffmanLookup
+{
+public:
+    static const unsigned LOOKUP_BITS = 12;
+    static const unsigned NUM_NODES = 256;
+    static const uint8_t ROOT = 0;
+    static const unsigned EOS = 256;
+
+    struct Entry
+    {
+        uint8_t len;      // bits used by the symbols
+        uint8_t count;    // 0 if the next code is longer than LOOKUP_BITS
+        uint8_t symbol[2];
+    };
+
+    // Interior node of the tree. Leaves are stored in the child as -2 - symbol.
+    struct Node
+    {
+        int16_t child[2];
+        uint8_t depth;
+        bool ones;        // path from the root is all 1s
+    };
+
+    HuffmanLookup();
+
+    const Entry& find(uint16_t bits) const
+    { return table[bits]; }
+
+    const Node& node(uint8_t n) const
+    { return nodes[n]; }
+
+    static bool is_leaf(int16_t child)
+    { return child < -1; }
+
+    static unsigned symbol(int16_t child)
+    { return -2 - child; }
+
+private:
+    Entry table[1 << LOOKUP_BITS];
+    Node nodes[NUM_NODES];
+};
+
+extern const HuffmanLookup huffman_lookup;
+
 #endif
 
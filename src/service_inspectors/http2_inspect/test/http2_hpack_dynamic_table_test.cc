@@ -0,0 +1,204 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// http2_hpack_dynamic_table_test.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "../http2_enum.h"
+#include "../http2_hpack_table.h"
+#include "../http2_module.h"
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <utility>
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+
+// Stubs whose sole purpose is to make the test code link
+THREAD_LOCAL PegCount Http2Module::peg_counts[Http2Enums::PEG_COUNT__MAX] = { };
+
+using namespace Http2Enums;
+
+static const uint32_t FIRST_INDEX = HpackIndexTable::STATIC_MAX_INDEX + 1;
+
+static Field make_field(const std::string& s)
+{ return Field(s.size(), (const uint8_t*)s.c_str()); }
+
+static bool entry_is(const HpackTableEntry* entry, const std::string& name,
+    const std::string& value)
+{
+    return entry and
+        (std::string((const char*)entry->name.start(), entry->name.length()) == name) and
+        (std::string((const char*)entry->value.start(), entry->value.length()) == value);
+}
+
+TEST_GROUP(http2_hpack_dynamic_table)
+{
+    HpackDynamicTable table;
+};
+
+TEST(http2_hpack_dynamic_table, newest_first)
+{
+    CHECK(table.add_entry(make_field("custom-key"), make_field("custom-header")));
+    CHECK(table.add_entry(make_field("cache-control"), make_field("no-cache")));
+    CHECK(entry_is(table.get_entry(FIRST_INDEX), "cache-control", "no-cache"));
+    CHECK(entry_is(table.get_entry(FIRST_INDEX + 1), "custom-key", "custom-header"));
+    CHECK(table.get_entry(FIRST_INDEX + 2) == nullptr);
+}
+
+TEST(http2_hpack_dynamic_table, empty_strings)
+{
+    CHECK(table.add_entry(make_field(""), make_field("")));
+    CHECK(table.add_entry(make_field("a"), make_field("")));
+    CHECK(entry_is(table.get_entry(FIRST_INDEX), "a", ""));
+    CHECK(entry_is(table.get_entry(FIRST_INDEX + 1), "", ""));
+}
+
+TEST(http2_hpack_dynamic_table, evict_oldest)
+{
+    // each entry is 32 + 2 bytes
+    table.update_size(3 * 34);
+    CHECK(table.add_entry(make_field("a"), make_field("1")));
+    CHECK(table.add_entry(make_field("b"), make_field("2")));
+    CHECK(table.add_entry(make_field("c"), make_field("3")));
+    CHECK(table.add_entry(make_field("d"), make_field("4")));
+    CHECK(entry_is(table.get_entry(FIRST_INDEX), "d", "4"));
+    CHECK(entry_is(table.get_entry(FIRST_INDEX + 2), "b", "2"));
+    CHECK(table.get_entry(FIRST_INDEX + 3) == nullptr);
+
+    table.update_size(34);
+    CHECK(entry_is(table.get_entry(FIRST_INDEX), "d", "4"));
+    CHECK(table.get_entry(FIRST_INDEX + 1) == nullptr);
+}
+
+TEST(http2_hpack_dynamic_table, too_big_clears)
+{
+    table.update_size(40);
+    CHECK(table.add_entry(make_field("a"), make_field("1")));
+    CHECK(table.add_entry(make_field("name"), make_field("value")));
+    CHECK(table.get_entry(FIRST_INDEX) == nullptr);
+}
+
+TEST(http2_hpack_dynamic_table, name_of_evicted_entry)
+{
+    // the new entry reuses the name of the entry it evicts
+    const std::string name(40, 'n');
+    table.update_size(32 + 40 + 10);
+    CHECK(table.add_entry(make_field(name), make_field("1")));
+
+    for (unsigned i = 0; i < 100; i++)
+    {
+        const HpackTableEntry* entry = table.get_entry(FIRST_INDEX);
+        Field indexed_name;
+        indexed_name.set(entry->name);
+        const std::string value = std::to_string(i);
+        CHECK(table.add_entry(indexed_name, make_field(value)));
+        CHECK(entry_is(table.get_entry(FIRST_INDEX), name, value));
+        CHECK(table.get_entry(FIRST_INDEX + 1) == nullptr);
+    }
+}
+
+TEST(http2_hpack_dynamic_table, array_capacity)
+{
+    table.update_size(1 << 20);
+    for (unsigned i = 0; i < 512; i++)
+        CHECK(table.add_entry(make_field(""), make_field("")));
+    CHECK(!table.add_entry(make_field(""), make_field("")));
+}
+
+// Compare with a simple list of strings while entries of varied sizes wrap around the arena and
+// the table size changes
+TEST(http2_hpack_dynamic_table, ring)
+{
+    std::deque<std::pair<std::string, std::string>> expect;
+    uint32_t size = 0;
+    uint32_t max_size = 4096;
+    uint32_t seed = 1;
+
+    for (unsigned i = 0; i < 20000; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+
+        if ((seed >> 8) % 500 == 0)
+        {
+            max_size = 256 + (seed >> 16) % 8192;
+            table.update_size(max_size);
+
+            while (size > max_size)
+            {
+                size -= expect.back().first.size() + expect.back().second.size() + 32;
+                expect.pop_back();
+            }
+        }
+        std::string name;
+        bool indexed = !expect.empty() and (seed >> 4) % 3 == 0;
+
+        if (indexed)
+            name = expect[(seed >> 12) % expect.size()].first;
+        else
+            name = std::string(1 + (seed >> 12) % 20, 'a' + i % 26);
+
+        const std::string value(((seed >> 20) % 7 == 0) ? (seed >> 8) % 1500 : (seed >> 8) % 40,
+            'A' + i % 26);
+
+        if (indexed)
+        {
+            const uint32_t index = FIRST_INDEX + (std::find_if(expect.begin(), expect.end(),
+                [&name](const std::pair<std::string, std::string>& e)
+                { return e.first == name; }) - expect.begin());
+            Field indexed_name;
+            indexed_name.set(table.get_entry(index)->name);
+            CHECK(table.add_entry(indexed_name, make_field(value)));
+        }
+        else
+            CHECK(table.add_entry(make_field(name), make_field(value)));
+
+        const uint32_t entry_size = name.size() + value.size() + 32;
+
+        while (!expect.empty() and (size + entry_size > max_size))
+        {
+            size -= expect.back().first.size() + expect.back().second.size() + 32;
+            expect.pop_back();
+        }
+        if (entry_size <= max_size)
+        {
+            expect.emplace_front(name, value);
+            size += entry_size;
+        }
+
+        for (unsigned j = 0; j < expect.size(); j++)
+        {
+            if (!entry_is(table.get_entry(FIRST_INDEX + j), expect[j].first, expect[j].second))
+            {
+                CHECK(false);
+                return;
+            }
+        }
+        CHECK(table.get_entry(FIRST_INDEX + expect.size()) == nullptr);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,195 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// http2_hpack_test.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "../http2_enum.h"
+#include "../http2_flow_data.h"
+#include "../http2_hpack.h"
+#include "../http2_module.h"
+#include "../http2_start_line.h"
+#include "../../http_inspect/http_common.h"
+
+#include <string>
+#include <vector>
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+using namespace Http2Enums;
+using namespace HttpCommon;
+
+namespace snort
+{
+// Stubs whose sole purpose is to make the test code link
+unsigned FlowData::flow_data_id = 0;
+FlowData::FlowData(unsigned, Inspector*) {}
+FlowData::~FlowData() = default;
+int DetectionEngine::queue_event(unsigned int, unsigned int, Actions::Type) { return 0; }
+}
+
+THREAD_LOCAL PegCount Http2Module::peg_counts[PEG_COUNT__MAX] = { };
+unsigned Http2FlowData::inspector_id = 0;
+Http2DataCutter::Http2DataCutter(Http2FlowData* flow_data, SourceId src_id) :
+    session_data(flow_data), source_id(src_id) { }
+Http2FlowData::Http2FlowData(Flow*) :
+    FlowData(inspector_id),
+    flow(nullptr),
+    hi(nullptr),
+    hpack_decoder { Http2HpackDecoder(this, SRC_CLIENT, events[SRC_CLIENT],
+                        infractions[SRC_CLIENT]),
+                    Http2HpackDecoder(this, SRC_SERVER, events[SRC_SERVER],
+                        infractions[SRC_SERVER]) },
+    data_cutter { Http2DataCutter(this, SRC_CLIENT), Http2DataCutter(this, SRC_SERVER) }
+{ }
+Http2FlowData::~Http2FlowData()
+{
+    for (int k=0; k <= 1; k++)
+    {
+        delete infractions[k];
+        delete events[k];
+    }
+}
+uint32_t Http2ConnectionSettings::get_param(uint16_t) { return 4096; }
+Http2StartLine::~Http2StartLine() = default;
+Http2Stream::~Http2Stream() = default;
+
+// Keeps the pseudo-header names it is given so the test can see where they point
+class TestStartLine : public Http2StartLine
+{
+public:
+    TestStartLine(Http2EventGen* events, Http2Infractions* infractions) :
+        Http2StartLine(events, infractions) { }
+
+    bool generate_start_line(Field&, bool) override { return true; }
+    void process_pseudo_header(const Field& name, const Field&) override
+    {
+        name_starts.emplace_back(name.start());
+        names.emplace_back((const char*)name.start(), name.length());
+    }
+
+    std::vector<const uint8_t*> name_starts;
+    std::vector<std::string> names;
+};
+
+// HPACK integer with an n-bit prefix, RFC 7541 5.1
+static void encode_int(std::string& block, uint8_t first, unsigned prefix_bits, uint32_t value)
+{
+    const uint32_t max_prefix = (1 << prefix_bits) - 1;
+    if (value < max_prefix)
+    {
+        block += (char)(first | value);
+        return;
+    }
+    block += (char)(first | max_prefix);
+    value -= max_prefix;
+    while (value >= 128)
+    {
+        block += (char)((value % 128) | 0x80);
+        value /= 128;
+    }
+    block += (char)value;
+}
+
+// string literal without Huffman coding
+static void encode_string(std::string& block, const std::string& s)
+{
+    encode_int(block, 0, 7, s.length());
+    block += s;
+}
+
+// literal header field with incremental indexing and a new name
+static std::string literal_new_name(const std::string& name, const std::string& value)
+{
+    std::string block;
+    block += (char)0x40;
+    encode_string(block, name);
+    encode_string(block, value);
+    return block;
+}
+
+// literal header field with incremental indexing and an indexed name
+static std::string literal_indexed_name(uint32_t index, const std::string& value)
+{
+    std::string block;
+    encode_int(block, 0x40, 6, index);
+    encode_string(block, value);
+    return block;
+}
+
+TEST_GROUP(http2_hpack_decode)
+{
+    Http2FlowData* session_data = nullptr;
+    Http2HpackDecoder* decoder = nullptr;
+    std::vector<uint8_t> decoded;
+
+    void setup() override
+    {
+        session_data = new Http2FlowData(nullptr);
+        decoder = session_data->get_hpack_decoder(SRC_CLIENT);
+        decoded.resize(MAX_OCTETS);
+    }
+
+    void teardown() override
+    {
+        delete session_data;
+    }
+
+    bool decode(const std::string& block, TestStartLine& start_line)
+    {
+        return decoder->decode_headers((const uint8_t*)block.data(), block.length(),
+            decoded.data(), &start_line, false);
+    }
+};
+
+// A header line whose name is indexed from the dynamic table and is itself added to the table.
+// The new value doesn't fit in the arena on either side of the live strings so the arena is
+// compacted and the old one freed while the line is decoded. The name must not refer to it.
+TEST(http2_hpack_decode, indexed_name_survives_compaction)
+{
+    Http2EventGen events;
+    Http2Infractions infractions;
+    TestStartLine start_line(&events, &infractions);
+
+    // oldest entry, evicted to make room for the last one
+    CHECK(decode(literal_new_name("x", std::string(2000, 'y')), start_line));
+    CHECK(decode(literal_new_name(":authority", std::string(1000, 'v')), start_line));
+    CHECK(decode(literal_indexed_name(HpackIndexTable::STATIC_MAX_INDEX + 1,
+        std::string(2100, 'w')), start_line));
+
+    CHECK(start_line.names.size() == 2);
+    CHECK(start_line.names[1] == ":authority");
+
+    const uint8_t* const name = start_line.name_starts[1];
+    CHECK(name >= decoded.data() and name < decoded.data() + decoded.size());
+
+    const HpackTableEntry* entry =
+        decoder->get_decode_table()->lookup(HpackIndexTable::STATIC_MAX_INDEX + 1);
+    CHECK(entry != nullptr);
+    CHECK(std::string((const char*)entry->name.start(), entry->name.length()) == ":authority");
+    CHECK(entry->value.length() == 2100);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
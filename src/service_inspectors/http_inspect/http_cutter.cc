@@ -26,6 +26,8 @@
 #include "http_common.h"
 #include "http_enum.h"
 #include "http_module.h"
+#include "http_scan.h"
+#include "http_unzip_share.h"
 
 using namespace HttpEnums;
 
@@ -86,6 +88,13 @@ ScanResult HttpStartCutter::cut(const uint8_t* buffer, uint32_t length,
                 break;
             }
         }
+        if (validated && (num_crlf == 0))
+        {
+            // Nothing more to check until the end of the start line
+            k += HttpScan::find_cr_lf(buffer + k, length - k);
+            if (k == length)
+                break;
+        }
         if (buffer[k] == '\n')
         {
             num_crlf++;
@@ -194,6 +203,10 @@ ScanResult HttpHeaderCutter::cut(const uint8_t* buffer, uint32_t length,
         switch (state)
         {
         case ZERO:
+            // Skip to the end of this header line
+            k += HttpScan::find_cr_lf(buffer + k, length - k);
+            if (k == length)
+                break;
             if (buffer[k] == '\r')
             {
                 state = HALF;
@@ -278,12 +291,16 @@ ScanResult HttpHeaderCutter::cut(const uint8_t* buffer, uint32_t length,
     return SCAN_NOT_FOUND;
 }
 
-HttpBodyCutter::HttpBodyCutter(AcceleratedBlocking accelerated_blocking_, CompressId compression_)
-    : accelerated_blocking(accelerated_blocking_), compression(compression_)
+HttpBodyCutter::HttpBodyCutter(AcceleratedBlocking accelerated_blocking_, CompressId compression_,
+    HttpUnzipShare* unzip_share_)
+    : accelerated_blocking(accelerated_blocking_), compression(compression_),
+    unzip_share(unzip_share_)
 {
     if (accelerated_blocking != AB_NONE)
     {
-        if ((compression == CMP_GZIP) || (compression == CMP_DEFLATE))
+        // When the unzipped data is shared with reassemble() the zlib stream belongs to the share
+        if (((compression == CMP_GZIP) || (compression == CMP_DEFLATE)) &&
+            (unzip_share == nullptr))
         {
             compress_stream = new z_stream;
             compress_stream->zalloc = Z_NULL;
@@ -707,6 +724,9 @@ ScanResult HttpBodyChunkCutter::cut(const uint8_t* buffer, uint32_t length,
             // planned to delete them during reassembly. Because they are not part of a valid chunk
             // they will be reassembled after all. This will overrun the adjusted_target making the
             // message section a little bigger than planned. It's not important.
+            // reassemble() will unzip any chunk header octets from the bad chunk along with the
+            // data so it cannot use what the cutter unzips from here on.
+            skip_unzip();
             uint32_t skip_amount = length-k;
             skip_amount = (skip_amount <= adjusted_target-data_seen) ? skip_amount :
                 adjusted_target-data_seen;
@@ -849,6 +869,8 @@ bool HttpBodyCutter::need_accelerated_blocking(const uint8_t* data, uint32_t len
             detention_required = true;
             return true;
         }
+        if (packet_detained || detention_required)
+            skip_unzip();
         break;
     case AB_INSPECT:
         // Script detection requires continuous scanning of the data because every packet is a new
@@ -862,6 +884,14 @@ bool HttpBodyCutter::need_accelerated_blocking(const uint8_t* data, uint32_t len
     return false;
 }
 
+// Once this cutter passes over data without unzipping it, reassemble() cannot use anything the
+// cutter unzips afterward and must take over the unzipping.
+void HttpBodyCutter::skip_unzip()
+{
+    if (unzip_share != nullptr)
+        unzip_share->hand_off();
+}
+
 bool HttpBodyCutter::find_partial(const uint8_t* input_buf, uint32_t input_length, bool end)
 {
     for (uint32_t k = 0; k < input_length; k++)
@@ -893,14 +923,27 @@ bool HttpBodyCutter::dangerous(const uint8_t* data, uint32_t length)
     uint32_t input_length = length;
     uint8_t* decomp_output = nullptr;
 
-    // Zipped flows must be decompressed before we can check them. Unzipping for accelerated
-    // blocking is completely separate from the unzipping done later in reassemble().
+    // Zipped flows must be decompressed before we can check them. Unless there is an unzip share,
+    // unzipping for accelerated blocking is completely separate from the unzipping done later in
+    // reassemble().
     if ((compression == CMP_GZIP) || (compression == CMP_DEFLATE))
     {
         // Previous decompression failures make it impossible to search for scripts
         if (decompress_failed)
             return true;
 
+        if (unzip_share != nullptr)
+        {
+            const uint8_t* output;
+            uint32_t output_length;
+            if (!unzip_share->unzip(data, length, output, output_length))
+            {
+                decompress_failed = true;
+                return true;
+            }
+            return find_match(output, output_length);
+        }
+
         const uint32_t decomp_buffer_size = MAX_OCTETS;
         decomp_output = new uint8_t[decomp_buffer_size];
 
@@ -926,6 +969,11 @@ bool HttpBodyCutter::dangerous(const uint8_t* data, uint32_t length)
 
     std::unique_ptr<uint8_t[]> uniq(decomp_output);
 
+    return find_match(input_buf, input_length);
+}
+
+bool HttpBodyCutter::find_match(const uint8_t* input_buf, uint32_t input_length)
+{
     if ( input_length > string_length )
     {
         if ( partial_match and find_partial(input_buf, input_length, true) )
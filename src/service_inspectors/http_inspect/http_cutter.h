@@ -28,6 +28,8 @@
 #include "http_enum.h"
 #include "http_event.h"
 
+class HttpUnzipShare;
+
 //-------------------------------------------------------------------------
 // HttpCutter class and subclasses
 //-------------------------------------------------------------------------
@@ -103,16 +105,18 @@ class HttpBodyCutter : public HttpCutter
 {
 public:
     HttpBodyCutter(HttpEnums::AcceleratedBlocking accelerated_blocking_,
-        HttpEnums::CompressId compression_);
+        HttpEnums::CompressId compression_, HttpUnzipShare* unzip_share_);
     ~HttpBodyCutter() override;
     void soft_reset() override { octets_seen = 0; packet_detained = false; }
     void detain_ended() { packet_detained = false; }
 
 protected:
     bool need_accelerated_blocking(const uint8_t* data, uint32_t length);
+    void skip_unzip();
 
 private:
     bool dangerous(const uint8_t* data, uint32_t length);
+    bool find_match(const uint8_t* input_buf, uint32_t input_length);
     bool find_partial(const uint8_t*, uint32_t, bool);
 
     const HttpEnums::AcceleratedBlocking accelerated_blocking;
@@ -121,6 +125,7 @@ private:
     bool detention_required = false;
     HttpEnums::CompressId compression;
     z_stream* compress_stream = nullptr;
+    HttpUnzipShare* const unzip_share;
     bool decompress_failed = false;
     snort::LiteralSearch* finder = nullptr;
     snort::LiteralSearch::Handle* handle = nullptr;
@@ -134,8 +139,8 @@ class HttpBodyClCutter : public HttpBodyCutter
 public:
     HttpBodyClCutter(int64_t expected_length,
         HttpEnums::AcceleratedBlocking accelerated_blocking,
-        HttpEnums::CompressId compression) :
-        HttpBodyCutter(accelerated_blocking, compression), remaining(expected_length)
+        HttpEnums::CompressId compression, HttpUnzipShare* unzip_share) :
+        HttpBodyCutter(accelerated_blocking, compression, unzip_share), remaining(expected_length)
         { assert(remaining > 0); }
     HttpEnums::ScanResult cut(const uint8_t*, uint32_t length, HttpInfractions*, HttpEventGen*,
         uint32_t flow_target, bool stretch, HttpEnums::H2BodyState) override;
@@ -148,8 +153,8 @@ class HttpBodyOldCutter : public HttpBodyCutter
 {
 public:
     HttpBodyOldCutter(HttpEnums::AcceleratedBlocking accelerated_blocking,
-        HttpEnums::CompressId compression) :
-        HttpBodyCutter(accelerated_blocking, compression)
+        HttpEnums::CompressId compression, HttpUnzipShare* unzip_share) :
+        HttpBodyCutter(accelerated_blocking, compression, unzip_share)
         {}
     HttpEnums::ScanResult cut(const uint8_t*, uint32_t, HttpInfractions*, HttpEventGen*,
         uint32_t flow_target, bool stretch, HttpEnums::H2BodyState) override;
@@ -159,8 +164,8 @@ class HttpBodyChunkCutter : public HttpBodyCutter
 {
 public:
     HttpBodyChunkCutter(HttpEnums::AcceleratedBlocking accelerated_blocking,
-        HttpEnums::CompressId compression) :
-        HttpBodyCutter(accelerated_blocking, compression)
+        HttpEnums::CompressId compression, HttpUnzipShare* unzip_share) :
+        HttpBodyCutter(accelerated_blocking, compression, unzip_share)
         {}
     HttpEnums::ScanResult cut(const uint8_t* buffer, uint32_t length,
         HttpInfractions* infractions, HttpEventGen* events, uint32_t flow_target, bool stretch,
@@ -184,8 +189,9 @@ class HttpBodyH2Cutter : public HttpBodyCutter
 public:
     HttpBodyH2Cutter(int64_t expected_length,
         HttpEnums::AcceleratedBlocking accelerated_blocking,
-        HttpEnums::CompressId compression) :
-        HttpBodyCutter(accelerated_blocking, compression), expected_body_length(expected_length)
+        HttpEnums::CompressId compression, HttpUnzipShare* unzip_share) :
+        HttpBodyCutter(accelerated_blocking, compression, unzip_share),
+        expected_body_length(expected_length)
         {}
     HttpEnums::ScanResult cut(const uint8_t* buffer, uint32_t length, HttpInfractions*,
         HttpEventGen*, uint32_t flow_target, bool stretch, HttpEnums::H2BodyState state) override;
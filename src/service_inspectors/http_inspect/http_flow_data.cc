@@ -34,6 +34,7 @@
 #include "http_msg_status.h"
 #include "http_test_manager.h"
 #include "http_transaction.h"
+#include "http_unzip_share.h"
 #include "http_uri.h"
 
 using namespace snort;
@@ -90,6 +91,7 @@ HttpFlowData::~HttpFlowData()
         update_deallocations(partial_detect_length[k]);
         HttpTransaction::delete_transaction(transaction[k], nullptr);
         delete cutter[k];
+        delete unzip_share[k];
         if (compress_stream[k] != nullptr)
         {
             inflateEnd(compress_stream[k]);
@@ -142,6 +144,8 @@ void HttpFlowData::half_reset(SourceId source_id)
         delete compress_stream[source_id];
         compress_stream[source_id] = nullptr;
     }
+    delete unzip_share[source_id];
+    unzip_share[source_id] = nullptr;
     if (mime_state[source_id] != nullptr)
     {
         delete mime_state[source_id];
@@ -185,6 +189,8 @@ void HttpFlowData::trailer_prep(SourceId source_id)
         delete compress_stream[source_id];
         compress_stream[source_id] = nullptr;
     }
+    delete unzip_share[source_id];
+    unzip_share[source_id] = nullptr;
     detection_status[source_id] = DET_REACTIVATING;
 }
 
@@ -38,6 +38,7 @@ class HttpJsNorm;
 class HttpMsgSection;
 class HttpCutter;
 class HttpQueryParser;
+class HttpUnzipShare;
 
 class HttpFlowData : public snort::FlowData
 {
@@ -145,6 +146,7 @@ private:
     bool stretch_section_to_packet[2] = { false, false };
     HttpEnums::AcceleratedBlocking accelerated_blocking[2] =
         { HttpEnums::AB_NONE, HttpEnums::AB_NONE };
+    HttpUnzipShare* unzip_share[2] = { nullptr, nullptr };
 
     // *** Inspector's internal data about the current message
     struct FdCallbackContext
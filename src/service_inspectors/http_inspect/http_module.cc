@@ -76,6 +76,10 @@ const Parameter HttpModule::http_params[] =
     { "unzip", Parameter::PT_BOOL, nullptr, "true",
       "decompress gzip and deflate message bodies" },
 
+    { "unzip_share_memcap", Parameter::PT_INT, "0:max32", "0",
+      "maximum bytes of unzipped body data per flow direction saved by script detection and "
+      "detained inspection for reuse by reassembly (0 unzips twice)" },
+
     { "normalize_utf", Parameter::PT_BOOL, nullptr, "true",
       "normalize charset utf encodings in response bodies" },
 
@@ -194,6 +198,10 @@ bool HttpModule::set(const char*, Value& val, SnortConfig*)
     {
         params->unzip = val.get_bool();
     }
+    else if (val.is("unzip_share_memcap"))
+    {
+        params->unzip_share_memcap = val.get_uint32();
+    }
     else if (val.is("normalize_utf"))
     {
         params->normalize_utf = val.get_bool();
@@ -41,6 +41,7 @@ public:
     int64_t response_depth = -1;
 
     bool unzip = true;
+    uint32_t unzip_share_memcap = 0;
     bool normalize_utf = true;
     bool decompress_pdf = false;
     bool decompress_swf = false;
@@ -29,6 +29,7 @@
 #include "http_common.h"
 #include "http_enum.h"
 #include "http_msg_request.h"
+#include "http_scan.h"
 
 using namespace HttpCommon;
 using namespace HttpEnums;
@@ -167,22 +168,20 @@ int32_t HttpMsgHeadShared::find_next_header(const uint8_t* buffer, int32_t lengt
     for (; is_cr_lf[buffer[k]]; k++);
     num_seps = k;
 
-    for (k++; k < length; k++)
+    // Jump from one CR or LF to the next
+    for (k++; (k += HttpScan::find_cr_lf(buffer + k, length - k)) < length; k++)
     {
-        if (is_cr_lf[buffer[k]])
+        // Check for wrapping
+        if (((buffer[k] == '\r') && (buffer[k+1] == '\n') && !is_sp_tab[buffer[k+2]]) ||
+            ((buffer[k] == '\n') && !is_sp_tab[buffer[k+1]]) ||
+            ((buffer[k] == '\r') && !is_sp_tab_lf[buffer[k+1]]))
         {
-            // Check for wrapping
-            if (((buffer[k] == '\r') && (buffer[k+1] == '\n') && !is_sp_tab[buffer[k+2]]) ||
-                ((buffer[k] == '\n') && !is_sp_tab[buffer[k+1]]) ||
-                ((buffer[k] == '\r') && !is_sp_tab_lf[buffer[k+1]]))
-            {
-                return k - num_seps;
-            }
-            else
-            {
-                add_infraction(INF_HEADER_WRAPPING);
-                create_event(EVENT_HEADER_WRAPPING);
-            }
+            return k - num_seps;
+        }
+        else
+        {
+            add_infraction(INF_HEADER_WRAPPING);
+            create_event(EVENT_HEADER_WRAPPING);
         }
     }
     return length - num_seps;
@@ -197,12 +196,8 @@ void HttpMsgHeadShared::parse_header_lines()
 
     for (int k=0; k < num_headers; k++)
     {
-        int colon;
-        for (colon=0; colon < header_line[k].length(); colon++)
-        {
-            if (header_line[k].start()[colon] == ':')
-                break;
-        }
+        const int colon = HttpScan::find_octet(header_line[k].start(), header_line[k].length(),
+            ':');
         if (colon < header_line[k].length())
         {
             header_name[k].set(colon, header_line[k].start());
@@ -39,6 +39,7 @@
 #include "http_inspect.h"
 #include "http_msg_request.h"
 #include "http_msg_body.h"
+#include "http_unzip_share.h"
 
 using namespace snort;
 using namespace HttpCommon;
@@ -59,10 +60,10 @@ void HttpMsgHeader::publish()
 
     HttpEvent http_event(this, session_data->for_http2, stream_id);
 
-    const char* key = (source_id == SRC_CLIENT) ?
-        HTTP_REQUEST_HEADER_EVENT_KEY : HTTP_RESPONSE_HEADER_EVENT_KEY;
+    static const DataEventId request_id = DataBus::get_id(HTTP_REQUEST_HEADER_EVENT_KEY);
+    static const DataEventId response_id = DataBus::get_id(HTTP_RESPONSE_HEADER_EVENT_KEY);
 
-    DataBus::publish(key, http_event, flow);
+    DataBus::publish((source_id == SRC_CLIENT) ? request_id : response_id, http_event, flow);
 }
 
 const Field& HttpMsgHeader::get_true_ip()
@@ -404,6 +405,22 @@ void HttpMsgHeader::prepare_body()
             session_data->accelerated_blocking[source_id] = AB_DETAIN;
     }
 
+    // The body cutter must unzip this body to look for scripts. Let reassemble() reuse its work.
+    delete session_data->unzip_share[source_id];
+    session_data->unzip_share[source_id] = nullptr;
+    if ((params->unzip_share_memcap > 0) &&
+        (session_data->accelerated_blocking[source_id] != AB_NONE) &&
+        ((session_data->compression[source_id] == CMP_GZIP) ||
+         (session_data->compression[source_id] == CMP_DEFLATE)))
+    {
+        HttpUnzipShare* const share = new HttpUnzipShare(session_data,
+            session_data->compression[source_id], params->unzip_share_memcap);
+        if (share->is_ready())
+            session_data->unzip_share[source_id] = share;
+        else
+            delete share;
+    }
+
     if (source_id == SRC_CLIENT)
     {
         HttpModule::increment_peg_counts(PEG_REQUEST_BODY);
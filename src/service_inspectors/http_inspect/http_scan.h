@@ -0,0 +1,42 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// http_scan.h
+
+#ifndef HTTP_SCAN_H
+#define HTTP_SCAN_H
+
+#include <cstdint>
+
+//-------------------------------------------------------------------------
+// Vectorized searches for the delimiters that split the start line and header block
+//
+// Most octets of a start line or header are neither CR nor LF. The splitter and header parsing
+// use these to jump from one line end to the next instead of examining every octet. The kernel
+// is chosen at compile time: AVX2 or SSE2 on x86 and NEON on ARM, with a plain loop otherwise.
+//-------------------------------------------------------------------------
+
+namespace HttpScan
+{
+// Offset of the first CR or LF in buffer or length if there is none
+int32_t find_cr_lf(const uint8_t* buffer, int32_t length);
+
+// Offset of the first occurrence of octet in buffer or length if there is none
+int32_t find_octet(const uint8_t* buffer, int32_t length, uint8_t octet);
+} // end namespace HttpScan
+
+#endif
@@ -61,9 +61,14 @@ private:
         unsigned length) const;
     static void decompress_copy(uint8_t* buffer, uint32_t& offset, const uint8_t* data,
         uint32_t length, HttpEnums::CompressId& compression, z_stream*& compress_stream,
-        bool at_start, HttpInfractions* infractions, HttpEventGen* events);
+        HttpUnzipShare* unzip_share, bool at_start, HttpInfractions* infractions,
+        HttpEventGen* events);
     static void detain_packet(snort::Packet* pkt);
 
+#if defined(REG_TEST) || defined(UNIT_TEST)
+    friend class HttpUnitTestSetup;
+#endif
+
     HttpInspect* const my_inspector;
     const HttpCommon::SourceId source_id;
 };
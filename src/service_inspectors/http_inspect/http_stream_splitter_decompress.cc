@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// http_stream_splitter_decompress.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "http_stream_splitter.h"
+#include "http_unzip_share.h"
+
+using namespace HttpEnums;
+
+void HttpStreamSplitter::decompress_copy(uint8_t* buffer, uint32_t& offset, const uint8_t* data,
+    uint32_t length, HttpEnums::CompressId& compression, z_stream*& compress_stream,
+    HttpUnzipShare* unzip_share, bool at_start, HttpInfractions* infractions,
+    HttpEventGen* events)
+{
+    // Use what the body cutter already unzipped. Whatever it cannot account for is processed below
+    // as usual.
+    if ((unzip_share != nullptr) && unzip_share->in_use() &&
+        ((compression == CMP_GZIP) || (compression == CMP_DEFLATE)))
+    {
+        const uint8_t* const start = data;
+        if (unzip_share->copy(buffer, offset, data, length, compression, compress_stream,
+            infractions, events))
+        {
+            return;
+        }
+        at_start = at_start && (data == start);
+    }
+
+    if ((compression == CMP_GZIP) || (compression == CMP_DEFLATE))
+    {
+        compress_stream->next_in = const_cast<Bytef*>(data);
+        compress_stream->avail_in = length;
+        compress_stream->next_out = buffer + offset;
+        compress_stream->avail_out = MAX_OCTETS - offset;
+        int ret_val = inflate(compress_stream, Z_SYNC_FLUSH);
+
+        if ((ret_val == Z_OK) || (ret_val == Z_STREAM_END))
+        {
+            offset = MAX_OCTETS - compress_stream->avail_out;
+            if (compress_stream->avail_in > 0)
+            {
+                // There are two ways not to consume all the input
+                if (ret_val == Z_STREAM_END)
+                {
+                    // The zipped data stream ended but there is more input data
+                    *infractions += INF_GZIP_EARLY_END;
+                    events->create_event(EVENT_GZIP_EARLY_END);
+                    const uInt num_copy =
+                        (compress_stream->avail_in <= compress_stream->avail_out) ?
+                        compress_stream->avail_in : compress_stream->avail_out;
+                    memcpy(buffer + offset, data + (length - compress_stream->avail_in), num_copy);
+                    offset += num_copy;
+                }
+                else
+                {
+                    assert(compress_stream->avail_out == 0);
+                    // The data expanded too much
+                    *infractions += INF_GZIP_OVERRUN;
+                    events->create_event(EVENT_GZIP_OVERRUN);
+                }
+                compression = CMP_NONE;
+                inflateEnd(compress_stream);
+                delete compress_stream;
+                compress_stream = nullptr;
+            }
+            return;
+        }
+        else if ((compression == CMP_DEFLATE) && at_start && (ret_val == Z_DATA_ERROR))
+        {
+            // Some incorrect implementations of deflate don't use the expected header. Feed a
+            // dummy header to zlib and retry the inflate.
+            static constexpr uint8_t zlib_header[2] = { 0x78, 0x01 };
+
+            inflateReset(compress_stream);
+            compress_stream->next_in = const_cast<Bytef*>(zlib_header);
+            compress_stream->avail_in = sizeof(zlib_header);
+            inflate(compress_stream, Z_SYNC_FLUSH);
+
+            // Start over at the beginning
+            decompress_copy(buffer, offset, data, length, compression, compress_stream, nullptr,
+                false, infractions, events);
+            return;
+        }
+        else
+        {
+            *infractions += INF_GZIP_FAILURE;
+            events->create_event(EVENT_GZIP_FAILURE);
+            compression = CMP_NONE;
+            inflateEnd(compress_stream);
+            delete compress_stream;
+            compress_stream = nullptr;
+            // Since we failed to uncompress the data, fall through
+        }
+    }
+
+    // The following precaution is necessary because mixed compressed and uncompressed data can
+    // cause the buffer to overrun even though we are not decompressing right now
+    if (length > MAX_OCTETS - offset)
+    {
+        length = MAX_OCTETS - offset;
+        *infractions += INF_GZIP_OVERRUN;
+        events->create_event(EVENT_GZIP_OVERRUN);
+    }
+    memcpy(buffer + offset, data, length);
+    offset += length;
+}
+
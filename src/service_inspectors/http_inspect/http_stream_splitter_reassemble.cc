@@ -100,8 +100,8 @@ void HttpStreamSplitter::chunk_spray(HttpFlowData* session_data, uint8_t* buffer
                 (session_data->section_offset[source_id] == 0);
             decompress_copy(buffer, session_data->section_offset[source_id], data+k, skip_amount,
                 session_data->compression[source_id], session_data->compress_stream[source_id],
-                at_start, session_data->get_infractions(source_id),
-                session_data->events[source_id]);
+                session_data->unzip_share[source_id], at_start,
+                session_data->get_infractions(source_id), session_data->events[source_id]);
             if ((expected -= skip_amount) == 0)
                 curr_state = CHUNK_DCRLF1;
             k += skip_amount-1;
@@ -130,8 +130,8 @@ void HttpStreamSplitter::chunk_spray(HttpFlowData* session_data, uint8_t* buffer
                 (session_data->section_offset[source_id] == 0);
             decompress_copy(buffer, session_data->section_offset[source_id], data+k, skip_amount,
                 session_data->compression[source_id], session_data->compress_stream[source_id],
-                at_start, session_data->get_infractions(source_id),
-                session_data->events[source_id]);
+                session_data->unzip_share[source_id], at_start,
+                session_data->get_infractions(source_id), session_data->events[source_id]);
             k += skip_amount-1;
             break;
           }
@@ -139,89 +139,6 @@ void HttpStreamSplitter::chunk_spray(HttpFlowData* session_data, uint8_t* buffer
     }
 }
 
-void HttpStreamSplitter::decompress_copy(uint8_t* buffer, uint32_t& offset, const uint8_t* data,
-    uint32_t length, HttpEnums::CompressId& compression, z_stream*& compress_stream,
-    bool at_start, HttpInfractions* infractions, HttpEventGen* events)
-{
-    if ((compression == CMP_GZIP) || (compression == CMP_DEFLATE))
-    {
-        compress_stream->next_in = const_cast<Bytef*>(data);
-        compress_stream->avail_in = length;
-        compress_stream->next_out = buffer + offset;
-        compress_stream->avail_out = MAX_OCTETS - offset;
-        int ret_val = inflate(compress_stream, Z_SYNC_FLUSH);
-
-        if ((ret_val == Z_OK) || (ret_val == Z_STREAM_END))
-        {
-            offset = MAX_OCTETS - compress_stream->avail_out;
-            if (compress_stream->avail_in > 0)
-            {
-                // There are two ways not to consume all the input
-                if (ret_val == Z_STREAM_END)
-                {
-                    // The zipped data stream ended but there is more input data
-                    *infractions += INF_GZIP_EARLY_END;
-                    events->create_event(EVENT_GZIP_EARLY_END);
-                    const uInt num_copy =
-                        (compress_stream->avail_in <= compress_stream->avail_out) ?
-                        compress_stream->avail_in : compress_stream->avail_out;
-                    memcpy(buffer + offset, data + (length - compress_stream->avail_in), num_copy);
-                    offset += num_copy;
-                }
-                else
-                {
-                    assert(compress_stream->avail_out == 0);
-                    // The data expanded too much
-                    *infractions += INF_GZIP_OVERRUN;
-                    events->create_event(EVENT_GZIP_OVERRUN);
-                }
-                compression = CMP_NONE;
-                inflateEnd(compress_stream);
-                delete compress_stream;
-                compress_stream = nullptr;
-            }
-            return;
-        }
-        else if ((compression == CMP_DEFLATE) && at_start && (ret_val == Z_DATA_ERROR))
-        {
-            // Some incorrect implementations of deflate don't use the expected header. Feed a
-            // dummy header to zlib and retry the inflate.
-            static constexpr uint8_t zlib_header[2] = { 0x78, 0x01 };
-
-            inflateReset(compress_stream);
-            compress_stream->next_in = const_cast<Bytef*>(zlib_header);
-            compress_stream->avail_in = sizeof(zlib_header);
-            inflate(compress_stream, Z_SYNC_FLUSH);
-
-            // Start over at the beginning
-            decompress_copy(buffer, offset, data, length, compression, compress_stream, false,
-                infractions, events);
-            return;
-        }
-        else
-        {
-            *infractions += INF_GZIP_FAILURE;
-            events->create_event(EVENT_GZIP_FAILURE);
-            compression = CMP_NONE;
-            inflateEnd(compress_stream);
-            delete compress_stream;
-            compress_stream = nullptr;
-            // Since we failed to uncompress the data, fall through
-        }
-    }
-
-    // The following precaution is necessary because mixed compressed and uncompressed data can
-    // cause the buffer to overrun even though we are not decompressing right now
-    if (length > MAX_OCTETS - offset)
-    {
-        length = MAX_OCTETS - offset;
-        *infractions += INF_GZIP_OVERRUN;
-        events->create_event(EVENT_GZIP_OVERRUN);
-    }
-    memcpy(buffer + offset, data, length);
-    offset += length;
-}
-
 const StreamBuffer HttpStreamSplitter::reassemble(Flow* flow, unsigned total,
     unsigned, const uint8_t* data, unsigned len, uint32_t flags, unsigned& copied)
 {
@@ -400,8 +317,8 @@ const StreamBuffer HttpStreamSplitter::reassemble(Flow* flow, unsigned total,
              (session_data->section_offset[source_id] == 0);
         decompress_copy(buffer, session_data->section_offset[source_id], data, len,
             session_data->compression[source_id], session_data->compress_stream[source_id],
-            at_start, session_data->get_infractions(source_id),
-            session_data->events[source_id]);
+            session_data->unzip_share[source_id], at_start,
+            session_data->get_infractions(source_id), session_data->events[source_id]);
     }
     else
     {
@@ -76,20 +76,24 @@ HttpCutter* HttpStreamSplitter::get_cutter(SectionType type,
         return (HttpCutter*)new HttpBodyClCutter(
             session_data->data_length[source_id],
             session_data->accelerated_blocking[source_id],
-            session_data->compression[source_id]);
+            session_data->compression[source_id],
+            session_data->unzip_share[source_id]);
     case SEC_BODY_CHUNK:
         return (HttpCutter*)new HttpBodyChunkCutter(
             session_data->accelerated_blocking[source_id],
-            session_data->compression[source_id]);
+            session_data->compression[source_id],
+            session_data->unzip_share[source_id]);
     case SEC_BODY_OLD:
         return (HttpCutter*)new HttpBodyOldCutter(
             session_data->accelerated_blocking[source_id],
-            session_data->compression[source_id]);
+            session_data->compression[source_id],
+            session_data->unzip_share[source_id]);
     case SEC_BODY_H2:
         return (HttpCutter*)new HttpBodyH2Cutter(
             session_data->data_length[source_id],
             session_data->accelerated_blocking[source_id],
-            session_data->compression[source_id]);
+            session_data->compression[source_id],
+            session_data->unzip_share[source_id]);
     default:
         assert(false);
         return nullptr;
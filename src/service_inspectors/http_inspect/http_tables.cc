@@ -443,6 +443,8 @@ const PegInfo HttpModule::peg_names[PEG_COUNT_MAX+1] =
     { CountType::SUM, "pipelined_flows", "total HTTP connections containing pipelined requests" },
     { CountType::SUM, "pipelined_requests", "total requests placed in a pipeline" },
     { CountType::SUM, "total_bytes", "total HTTP data bytes inspected" },
+    { CountType::SUM, "unzip_shared_bytes", "total unzipped bytes reused from the body cutter" },
+    { CountType::SUM, "unzip_share_fallbacks", "total times reassembly resumed its own unzip" },
     { CountType::END, nullptr, nullptr }
 };
 
@@ -0,0 +1,451 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// http_unzip_share.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "http_unzip_share.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "http_common.h"
+#include "http_flow_data.h"
+#include "http_module.h"
+
+using namespace HttpEnums;
+
+HttpUnzipShare::HttpUnzipShare(HttpFlowData* session_data_, CompressId compression,
+    uint32_t memcap_) : session_data(session_data_), compression_type(compression),
+    memcap(memcap_)
+{
+    assert((compression == CMP_GZIP) || (compression == CMP_DEFLATE));
+    stream = new z_stream;
+    stream->zalloc = Z_NULL;
+    stream->zfree = Z_NULL;
+    stream->next_in = Z_NULL;
+    stream->avail_in = 0;
+    const int window_bits = (compression == CMP_GZIP) ? GZIP_WINDOW_BITS : DEFLATE_WINDOW_BITS;
+    if (inflateInit2(stream, window_bits) != Z_OK)
+    {
+        delete stream;
+        stream = nullptr;
+        return;
+    }
+    session_data->update_allocations(stream_memory);
+    front_adler = adler32(0L, Z_NULL, 0);
+}
+
+HttpUnzipShare::~HttpUnzipShare()
+{
+    if (stream != nullptr)
+    {
+        inflateEnd(stream);
+        delete stream;
+        session_data->update_deallocations(stream_memory);
+    }
+    delete_handoff();
+    release_buffer();
+    if (scratch != nullptr)
+    {
+        delete[] scratch;
+        session_data->update_deallocations(MAX_OCTETS);
+    }
+}
+
+bool HttpUnzipShare::unzip(const uint8_t* data, uint32_t length, const uint8_t*& output,
+    uint32_t& output_length)
+{
+    output_length = 0;
+    if (!stream_ok)
+        return false;
+
+    // inflate() cannot make progress without input and reports an error. Do not record that as a
+    // piece because reassemble() will never see it.
+    if (length == 0)
+    {
+        hand_off();
+        stream_ok = false;
+        return false;
+    }
+
+    // Whatever does not fit under the memcap is left for reassemble() to unzip again
+    if (saving && !reserve())
+    {
+        hand_off();
+    }
+
+    uint8_t* out;
+    if (saving)
+        out = buffer + tail;
+    else
+    {
+        if (scratch == nullptr)
+        {
+            scratch = new uint8_t[MAX_OCTETS];
+            session_data->update_allocations(MAX_OCTETS);
+        }
+        out = scratch;
+    }
+
+    stream->next_in = const_cast<Bytef*>(data);
+    stream->avail_in = length;
+    stream->next_out = out;
+    stream->avail_out = MAX_OCTETS;
+    int ret_val = inflate(stream, Z_SYNC_FLUSH);
+
+    // Same second chance decompress_copy() gives a deflate body that is missing the zlib header
+    if ((ret_val == Z_DATA_ERROR) && saving && (compression_type == CMP_DEFLATE) &&
+        (scan_octets == 0))
+    {
+        static constexpr uint8_t zlib_header[2] = { 0x78, 0x01 };
+
+        inflateReset(stream);
+        stream->next_in = const_cast<Bytef*>(zlib_header);
+        stream->avail_in = sizeof(zlib_header);
+        stream->next_out = out;
+        stream->avail_out = MAX_OCTETS;
+        inflate(stream, Z_SYNC_FLUSH);
+
+        stream->next_in = const_cast<Bytef*>(data);
+        stream->avail_in = length;
+        stream->next_out = out;
+        stream->avail_out = MAX_OCTETS;
+        ret_val = inflate(stream, Z_SYNC_FLUSH);
+    }
+
+    const uint32_t consumed = length - stream->avail_in;
+    PieceEnd end;
+    if ((ret_val == Z_OK) && (stream->avail_in == 0))
+        end = PE_OK;
+    else if ((ret_val == Z_STREAM_END) && (stream->avail_in == 0))
+        end = PE_END;
+    else if (ret_val == Z_STREAM_END)
+        end = PE_EARLY_END;
+    else if (ret_val == Z_OK)
+        end = PE_OVERRUN;
+    else
+        end = PE_FAILURE;
+
+    output = out;
+    output_length = (end != PE_FAILURE) ? MAX_OCTETS - stream->avail_out : 0;
+    scan_octets += length;
+
+    if (saving)
+    {
+        pieces.push_back({ consumed, output_length, adler32(adler32(0L, Z_NULL, 0), data,
+            consumed), end });
+        tail += output_length;
+    }
+
+    if ((end == PE_OK) || (end == PE_END))
+        return true;
+
+    // Nothing after this point can be unzipped the same way twice
+    stream_ok = false;
+    saving = false;
+    return false;
+}
+
+void HttpUnzipShare::hand_off()
+{
+    if (!saving)
+        return;
+    saving = false;
+    if (detached)
+        return;
+    HttpModule::increment_peg_counts(PEG_UNZIP_SHARE_FALLBACKS);
+    handed_off = true;
+
+    handoff = new z_stream;
+    if (inflateCopy(handoff, stream) != Z_OK)
+    {
+        delete handoff;
+        handoff = nullptr;
+        return;
+    }
+    session_data->update_allocations(stream_memory);
+    handoff_octets = scan_octets;
+}
+
+bool HttpUnzipShare::copy(uint8_t* out, uint32_t& offset, const uint8_t*& data,
+    uint32_t& length, CompressId& compression, z_stream*& compress_stream,
+    HttpInfractions* infractions, HttpEventGen* events)
+{
+    assert(!detached);
+    const CallStart start = { offset, data, length, reassemble_octets };
+
+    if (stream_ended)
+    {
+        if (length > 0)
+            early_end(out, offset, data, length, compression, compress_stream, infractions,
+                events);
+        return true;
+    }
+
+    // inflate() makes no progress with no input and reports an error
+    if (length == 0)
+    {
+        fail(compression, compress_stream, infractions, events);
+        return true;
+    }
+
+    while (length > 0)
+    {
+        if (pieces.empty())
+        {
+            if (take_over(compress_stream))
+            {
+                detach();
+                return false;
+            }
+            // The cutter did not leave a stream for this point
+            HttpModule::increment_peg_counts(PEG_UNZIP_SHARE_FALLBACKS);
+            fall_back(start, data, offset, data, length, compression, compress_stream,
+                infractions, events);
+            return false;
+        }
+
+        Piece& piece = pieces.front();
+
+        // The output of this piece alone overflows the buffer so decompress_copy() would have
+        // overrun as soon as it started on it
+        if ((piece.end == PE_OVERRUN) && (front_seen == 0))
+        {
+            emit(out, offset, piece.out_length);
+            *infractions += INF_GZIP_OVERRUN;
+            events->create_event(EVENT_GZIP_OVERRUN);
+            end_compression(compression, compress_stream);
+            return true;
+        }
+
+        const uint32_t num_seen = (piece.comp_length - front_seen <= length) ?
+            piece.comp_length - front_seen : length;
+        front_adler = adler32(front_adler, data, num_seen);
+        front_seen += num_seen;
+        data += num_seen;
+        length -= num_seen;
+        reassemble_octets += num_seen;
+
+        // Rest of this piece is in the next section
+        if (front_seen < piece.comp_length)
+            break;
+
+        const PieceEnd end = piece.end;
+        const uint32_t out_length = piece.out_length;
+        const bool match = (front_adler == piece.adler);
+        pieces.pop_front();
+        front_seen = 0;
+        front_adler = adler32(0L, Z_NULL, 0);
+
+        if (!match || (end == PE_FAILURE))
+        {
+            if (!match)
+                HttpModule::increment_peg_counts(PEG_UNZIP_SHARE_FALLBACKS);
+            fall_back(start, data - num_seen, offset, data, length, compression,
+                compress_stream, infractions, events);
+            return false;
+        }
+
+        if (!emit(out, offset, out_length))
+        {
+            *infractions += INF_GZIP_OVERRUN;
+            events->create_event(EVENT_GZIP_OVERRUN);
+            end_compression(compression, compress_stream);
+            return true;
+        }
+
+        if (end == PE_EARLY_END)
+        {
+            early_end(out, offset, data, length, compression, compress_stream, infractions,
+                events);
+            return true;
+        }
+        if (end == PE_END)
+        {
+            stream_ended = true;
+            if (length > 0)
+            {
+                early_end(out, offset, data, length, compression, compress_stream,
+                    infractions, events);
+            }
+            return true;
+        }
+    }
+    return true;
+}
+
+bool HttpUnzipShare::reserve()
+{
+    const uint32_t used = tail - head;
+    if (used == 0)
+        head = tail = 0;
+    if ((uint64_t)used + MAX_OCTETS > memcap)
+        return false;
+    if (tail + MAX_OCTETS <= buffer_size)
+        return true;
+    if (used + MAX_OCTETS <= buffer_size)
+    {
+        memmove(buffer, buffer + head, used);
+        head = 0;
+        tail = used;
+        return true;
+    }
+
+    uint32_t new_size = (buffer_size > 0) ? 2 * buffer_size : 2 * MAX_OCTETS;
+    if (new_size < used + MAX_OCTETS)
+        new_size = used + MAX_OCTETS;
+    if (new_size > memcap)
+        new_size = memcap;
+    uint8_t* const new_buffer = new uint8_t[new_size];
+    if (used > 0)
+        memcpy(new_buffer, buffer + head, used);
+    release_buffer();
+    buffer = new_buffer;
+    buffer_size = new_size;
+    head = 0;
+    tail = used;
+    session_data->update_allocations(buffer_size);
+    return true;
+}
+
+bool HttpUnzipShare::take_over(z_stream*& compress_stream)
+{
+    z_stream* next;
+    if ((handoff != nullptr) && (handoff_octets == reassemble_octets))
+    {
+        // reassemble() owns it now like its own stream
+        next = handoff;
+        handoff = nullptr;
+        session_data->update_deallocations(stream_memory);
+    }
+    else if (!handed_off && stream_ok && (scan_octets == reassemble_octets))
+    {
+        next = new z_stream;
+        if (inflateCopy(next, stream) != Z_OK)
+        {
+            delete next;
+            return false;
+        }
+    }
+    else
+        return false;
+
+    assert(compress_stream != nullptr);
+    inflateEnd(compress_stream);
+    delete compress_stream;
+    compress_stream = next;
+    return true;
+}
+
+// The saved output cannot be used from resume onward. If there is a stream for where this call
+// started, decompress_copy() redoes the whole call just as it would have without sharing. That is
+// the caller's own stream when nothing has been shared yet. Otherwise the output already copied
+// is kept and the rest is copied raw as a decompression failure.
+void HttpUnzipShare::fall_back(const CallStart& start, const uint8_t* resume, uint32_t& offset,
+    const uint8_t*& data, uint32_t& length, CompressId& compression, z_stream*& compress_stream,
+    HttpInfractions* infractions, HttpEventGen* events)
+{
+    reassemble_octets = start.octets;
+    if ((start.octets == 0) || take_over(compress_stream))
+    {
+        offset = start.offset;
+        data = start.data;
+        length = start.length;
+        detach();
+        return;
+    }
+
+    length += data - resume;
+    data = resume;
+    fail(compression, compress_stream, infractions, events);
+}
+
+void HttpUnzipShare::early_end(uint8_t* out, uint32_t& offset, const uint8_t* data,
+    uint32_t length, CompressId& compression, z_stream*& compress_stream,
+    HttpInfractions* infractions, HttpEventGen* events)
+{
+    // Same as decompress_copy(): data after the end of the zlib stream is copied raw
+    *infractions += INF_GZIP_EARLY_END;
+    events->create_event(EVENT_GZIP_EARLY_END);
+    const uint32_t num_copy = (length <= MAX_OCTETS - offset) ? length : MAX_OCTETS - offset;
+    memcpy(out + offset, data, num_copy);
+    offset += num_copy;
+    end_compression(compression, compress_stream);
+}
+
+void HttpUnzipShare::fail(CompressId& compression, z_stream*& compress_stream,
+    HttpInfractions* infractions, HttpEventGen* events)
+{
+    *infractions += INF_GZIP_FAILURE;
+    events->create_event(EVENT_GZIP_FAILURE);
+    end_compression(compression, compress_stream);
+}
+
+bool HttpUnzipShare::emit(uint8_t* out, uint32_t& offset, uint32_t length)
+{
+    assert(tail - head >= length);
+    const uint32_t room = MAX_OCTETS - offset;
+    const uint32_t num_copy = (length <= room) ? length : room;
+    memcpy(out + offset, buffer + head, num_copy);
+    offset += num_copy;
+    head += length;
+    HttpModule::increment_peg_counts(PEG_UNZIP_SHARED_BYTES, num_copy);
+    return length <= room;
+}
+
+void HttpUnzipShare::end_compression(CompressId& compression, z_stream*& compress_stream)
+{
+    compression = CMP_NONE;
+    inflateEnd(compress_stream);
+    delete compress_stream;
+    compress_stream = nullptr;
+    detach();
+}
+
+void HttpUnzipShare::detach()
+{
+    detached = true;
+    saving = false;
+    pieces.clear();
+    release_buffer();
+    delete_handoff();
+}
+
+void HttpUnzipShare::delete_handoff()
+{
+    if (handoff == nullptr)
+        return;
+    inflateEnd(handoff);
+    delete handoff;
+    handoff = nullptr;
+    session_data->update_deallocations(stream_memory);
+}
+
+void HttpUnzipShare::release_buffer()
+{
+    if (buffer == nullptr)
+        return;
+    session_data->update_deallocations(buffer_size);
+    delete[] buffer;
+    buffer = nullptr;
+    buffer_size = 0;
+    head = tail = 0;
+}
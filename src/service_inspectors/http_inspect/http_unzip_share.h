@@ -0,0 +1,142 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// http_unzip_share.h
+
+#ifndef HTTP_UNZIP_SHARE_H
+#define HTTP_UNZIP_SHARE_H
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <deque>
+
+#include "http_enum.h"
+#include "http_event.h"
+
+class HttpFlowData;
+
+//-------------------------------------------------------------------------
+// Unzipped message body data shared between the body cutter and reassemble()
+//
+// The body cutter unzips each piece of compressed data it examines into a buffer bounded by a
+// memcap and records how much compressed data produced it and how zlib finished. reassemble()
+// consumes the same compressed data in the same order, so it copies the saved output and repeats
+// what decompress_copy() would have done instead of running zlib a second time.
+//
+// When the memcap would be exceeded or the cutter is about to pass over data without unzipping it,
+// the cutter gives reassemble() a copy of its zlib stream. reassemble() switches to that stream
+// once it has used up the saved output and from then on unzips for itself.
+//-------------------------------------------------------------------------
+
+class HttpUnzipShare
+{
+public:
+    HttpUnzipShare(HttpFlowData* session_data, HttpEnums::CompressId compression,
+        uint32_t memcap);
+    ~HttpUnzipShare();
+    bool is_ready() const { return stream != nullptr; }
+
+    // Cutter side. unzip() returns false if the data could not be cleanly unzipped.
+    bool unzip(const uint8_t* data, uint32_t length, const uint8_t*& output,
+        uint32_t& output_length);
+    void hand_off();
+
+    // reassemble() side. Returns true if all the data was handled. Otherwise data and length are
+    // left pointing at what remains, which decompress_copy() must process using compression and
+    // compress_stream. Either may have been changed.
+    bool copy(uint8_t* buffer, uint32_t& offset, const uint8_t*& data, uint32_t& length,
+        HttpEnums::CompressId& compression, z_stream*& compress_stream,
+        HttpInfractions* infractions, HttpEventGen* events);
+    bool in_use() const { return !detached; }
+
+    // Charged to the flow for each zlib stream: the inflate state and a 32K window
+    static const uint32_t stream_memory = sizeof(z_stream) + 7 * 1024 + 32 * 1024;
+
+private:
+    // PE_END means the zlib stream ended with the last compressed octet of the piece,
+    // PE_EARLY_END means it ended with compressed octets left over
+    enum PieceEnd { PE_OK, PE_END, PE_EARLY_END, PE_OVERRUN, PE_FAILURE };
+
+    struct Piece
+    {
+        uint32_t comp_length;   // compressed octets zlib consumed
+        uint32_t out_length;    // unzipped octets it produced
+        uLong adler;            // checksum of the compressed octets
+        PieceEnd end;
+    };
+
+    // where reassemble() was when copy() was called
+    struct CallStart
+    {
+        uint32_t offset;
+        const uint8_t* data;
+        uint32_t length;
+        uint64_t octets;
+    };
+
+    bool reserve();
+    void delete_handoff();
+    bool take_over(z_stream*& compress_stream);
+    void fall_back(const CallStart& start, const uint8_t* resume, uint32_t& offset,
+        const uint8_t*& data, uint32_t& length, HttpEnums::CompressId& compression,
+        z_stream*& compress_stream, HttpInfractions* infractions, HttpEventGen* events);
+    void early_end(uint8_t* buffer, uint32_t& offset, const uint8_t* data, uint32_t length,
+        HttpEnums::CompressId& compression, z_stream*& compress_stream,
+        HttpInfractions* infractions, HttpEventGen* events);
+    void fail(HttpEnums::CompressId& compression, z_stream*& compress_stream,
+        HttpInfractions* infractions, HttpEventGen* events);
+    bool emit(uint8_t* buffer, uint32_t& offset, uint32_t length);
+    void end_compression(HttpEnums::CompressId& compression, z_stream*& compress_stream);
+    void detach();
+    void release_buffer();
+
+    HttpFlowData* const session_data;
+    const HttpEnums::CompressId compression_type;
+    const uint32_t memcap;
+
+    // cutter's zlib stream and the total compressed octets fed to it
+    z_stream* stream = nullptr;
+    uint64_t scan_octets = 0;
+    bool stream_ok = true;
+    bool saving = true;
+
+    // stream copy for reassemble() and the compressed position it applies to
+    z_stream* handoff = nullptr;
+    uint64_t handoff_octets = 0;
+    bool handed_off = false;
+
+    // unzipped output not yet used by reassemble()
+    std::deque<Piece> pieces;
+    uint8_t* buffer = nullptr;
+    uint32_t buffer_size = 0;
+    uint32_t head = 0;
+    uint32_t tail = 0;
+
+    // output for the cutter once saving has stopped
+    uint8_t* scratch = nullptr;
+
+    // reassemble() progress through the front piece
+    uint64_t reassemble_octets = 0;
+    uint32_t front_seen = 0;
+    uLong front_adler = 0;
+    bool stream_ended = false;
+    bool detached = false;
+};
+
+#endif
+
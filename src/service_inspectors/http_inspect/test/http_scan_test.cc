@@ -0,0 +1,102 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// http_scan_test.cc
+// unit test main
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "service_inspectors/http_inspect/http_scan.h"
+
+#include <cstring>
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+static const int32_t buffer_size = 200;
+
+TEST_GROUP(http_scan_test)
+{
+    // Extra room on each side to test every alignment and catch reads outside the buffer
+    uint8_t storage[buffer_size + 64];
+
+    void setup() override
+    {
+        memset(storage, 'a', sizeof(storage));
+    }
+};
+
+TEST(http_scan_test, no_match)
+{
+    for (int32_t length = 0; length <= buffer_size; length++)
+        CHECK(HttpScan::find_cr_lf(storage + 1, length) == length);
+}
+
+TEST(http_scan_test, every_position)
+{
+    for (int32_t align = 0; align < 32; align++)
+    {
+        uint8_t* const buffer = storage + align;
+        for (int32_t length = 1; length <= 80; length++)
+        {
+            for (int32_t pos = 0; pos < length; pos++)
+            {
+                buffer[pos] = ((pos & 1) == 0) ? '\r' : '\n';
+                CHECK(HttpScan::find_cr_lf(buffer, length) == pos);
+                buffer[pos] = 'a';
+            }
+        }
+    }
+}
+
+TEST(http_scan_test, match_beyond_length)
+{
+    storage[40] = '\n';
+    CHECK(HttpScan::find_cr_lf(storage, 40) == 40);
+    CHECK(HttpScan::find_cr_lf(storage, 41) == 40);
+    storage[17] = '\r';
+    CHECK(HttpScan::find_cr_lf(storage, 41) == 17);
+    CHECK(HttpScan::find_cr_lf(storage + 18, 23) == 22);
+}
+
+TEST(http_scan_test, near_misses)
+{
+    // Octets one away from CR and LF and with the high bit set must not match
+    const uint8_t others[] = { '\t', '\v', '\f', 0x0e, 0x8a, 0x8d, 0xff, 0x00 };
+    for (int32_t k = 0; k < buffer_size; k++)
+        storage[k] = others[k % sizeof(others)];
+    CHECK(HttpScan::find_cr_lf(storage, buffer_size) == buffer_size);
+    storage[buffer_size - 1] = '\r';
+    CHECK(HttpScan::find_cr_lf(storage, buffer_size) == buffer_size - 1);
+}
+
+TEST(http_scan_test, find_octet)
+{
+    memcpy(storage, "Content-Type: text/html", 23);
+    CHECK(HttpScan::find_octet(storage, 23, ':') == 12);
+    CHECK(HttpScan::find_octet(storage, 12, ':') == 12);
+    CHECK(HttpScan::find_octet(storage, 0, ':') == 0);
+    CHECK(HttpScan::find_octet(storage, 23, '\n') == 23);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,432 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// http_unzip_share_test.cc
+// unit tests comparing reassemble() with an unzip share to unzipping twice
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "service_inspectors/http_inspect/http_unzip_share.h"
+
+#include <string>
+#include <vector>
+
+#include "service_inspectors/http_inspect/http_common.h"
+#include "service_inspectors/http_inspect/http_enum.h"
+#include "service_inspectors/http_inspect/http_flow_data.h"
+#include "service_inspectors/http_inspect/http_module.h"
+#include "service_inspectors/http_inspect/http_stream_splitter.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+using namespace HttpEnums;
+
+namespace snort
+{
+// Stubs whose sole purpose is to make the test code link
+unsigned FlowData::flow_data_id = 0;
+FlowData::FlowData(unsigned, Inspector*) {}
+FlowData::~FlowData() = default;
+int DetectionEngine::queue_event(unsigned int, unsigned int, Actions::Type) { return 0; }
+fd_status_t File_Decomp_StopFree(fd_session_t*) { return File_Decomp_OK; }
+uint32_t str_to_hash(const uint8_t *, size_t) { return 0; }
+
+static int64_t allocated = 0;
+void FlowData::update_allocations(size_t n) { allocated += n; }
+void FlowData::update_deallocations(size_t n) { allocated -= n; }
+}
+
+THREAD_LOCAL PegCount HttpModule::peg_counts[PEG_COUNT_MAX] = { };
+
+class HttpUnitTestSetup
+{
+public:
+    static void decompress_copy(uint8_t* buffer, uint32_t& offset, const uint8_t* data,
+        uint32_t length, CompressId& compression, z_stream*& compress_stream,
+        HttpUnzipShare* unzip_share, bool at_start, HttpInfractions* infractions,
+        HttpEventGen* events)
+    {
+        HttpStreamSplitter::decompress_copy(buffer, offset, data, length, compression,
+            compress_stream, unzip_share, at_start, infractions, events);
+    }
+};
+
+//--------------------------------------------------------------------------
+// helpers
+//--------------------------------------------------------------------------
+
+static std::string make_text(unsigned length)
+{
+    static const char* const words[] =
+        { "<script>", "var ", "x", " = ", "document", ".write(", "'hello'", ");\n", "</p>" };
+    std::string text;
+    uint32_t r = 12345;
+
+    while (text.length() < length)
+    {
+        r = r * 1103515245 + 12345;
+        text += words[(r >> 16) % (sizeof(words) / sizeof(words[0]))];
+    }
+    text.resize(length);
+    return text;
+}
+
+static std::string gzip(const std::string& text)
+{
+    z_stream z = { };
+    CHECK(deflateInit2(&z, Z_BEST_SPEED, Z_DEFLATED, GZIP_WINDOW_BITS, 8,
+        Z_DEFAULT_STRATEGY) == Z_OK);
+
+    std::string out(deflateBound(&z, text.length()), '\0');
+    z.next_in = (Bytef*)text.data();
+    z.avail_in = text.length();
+    z.next_out = (Bytef*)&out[0];
+    z.avail_out = out.length();
+    CHECK(deflate(&z, Z_FINISH) == Z_STREAM_END);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return out;
+}
+
+static std::vector<std::string> split(const std::string& body, unsigned size)
+{
+    std::vector<std::string> sections;
+    for (unsigned k = 0; k < body.length(); k += size)
+        sections.emplace_back(body.substr(k, size));
+    return sections;
+}
+
+struct Result
+{
+    std::string output;
+    uint64_t infractions;
+    uint64_t events;
+};
+
+class Reassembler
+{
+public:
+    Reassembler(HttpUnzipShare* share_) : share(share_)
+    {
+        stream = new z_stream;
+        stream->zalloc = Z_NULL;
+        stream->zfree = Z_NULL;
+        stream->next_in = Z_NULL;
+        stream->avail_in = 0;
+        CHECK(inflateInit2(stream, GZIP_WINDOW_BITS) == Z_OK);
+    }
+
+    ~Reassembler()
+    {
+        if (stream != nullptr)
+        {
+            inflateEnd(stream);
+            delete stream;
+        }
+    }
+
+    void section(const std::string& data)
+    {
+        uint32_t offset = 0;
+        HttpUnitTestSetup::decompress_copy(buffer, offset, (const uint8_t*)data.data(),
+            data.length(), compression, stream, share, at_start, &infractions, &events);
+        result.output.append((const char*)buffer, offset);
+        at_start = false;
+    }
+
+    const Result& get_result()
+    {
+        result.infractions = infractions.get_raw();
+        result.events = events.get_raw();
+        return result;
+    }
+
+private:
+    HttpUnzipShare* const share;
+    CompressId compression = CMP_GZIP;
+    z_stream* stream;
+    bool at_start = true;
+    HttpInfractions infractions;
+    HttpEventGen events;
+    uint8_t buffer[MAX_OCTETS];
+    Result result;
+};
+
+// what reassemble() produces when it does its own unzipping
+static Result unzip_twice(const std::vector<std::string>& sections)
+{
+    Reassembler r(nullptr);
+    for (auto& s : sections)
+        r.section(s);
+    return r.get_result();
+}
+
+// the cutter unzips each section before reassemble() copies it
+static Result unzip_shared(const std::vector<std::string>& sections, uint32_t memcap,
+    HttpFlowData* flow_data)
+{
+    HttpUnzipShare share(flow_data, CMP_GZIP, memcap);
+    CHECK(share.is_ready());
+    Reassembler r(&share);
+
+    for (auto& s : sections)
+    {
+        const uint8_t* output;
+        uint32_t output_length;
+        share.unzip((const uint8_t*)s.data(), s.length(), output, output_length);
+        r.section(s);
+    }
+    return r.get_result();
+}
+
+static void check_same(const Result& shared, const Result& twice)
+{
+    CHECK(shared.output == twice.output);
+    CHECK(shared.infractions == twice.infractions);
+    CHECK(shared.events == twice.events);
+}
+
+//--------------------------------------------------------------------------
+// tests
+//--------------------------------------------------------------------------
+
+TEST_GROUP(http_unzip_share)
+{
+    HttpFlowData* flow_data = nullptr;
+    PegCount shared_bytes = 0;
+    PegCount fallbacks = 0;
+
+    void setup() override
+    {
+        flow_data = new HttpFlowData;
+        allocated = 0;
+        shared_bytes = HttpModule::get_peg_counts(PEG_UNZIP_SHARED_BYTES);
+        fallbacks = HttpModule::get_peg_counts(PEG_UNZIP_SHARE_FALLBACKS);
+    }
+
+    void teardown() override
+    {
+        delete flow_data;
+    }
+
+    PegCount get_shared_bytes()
+    { return HttpModule::get_peg_counts(PEG_UNZIP_SHARED_BYTES) - shared_bytes; }
+
+    PegCount get_fallbacks()
+    { return HttpModule::get_peg_counts(PEG_UNZIP_SHARE_FALLBACKS) - fallbacks; }
+};
+
+TEST(http_unzip_share, clean)
+{
+    const std::string text = make_text(100000);
+    const auto sections = split(gzip(text), 1000);
+
+    const Result twice = unzip_twice(sections);
+    CHECK(twice.output == text);
+
+    check_same(unzip_shared(sections, 1 << 20, flow_data), twice);
+    CHECK(get_shared_bytes() == text.length());
+    CHECK(get_fallbacks() == 0);
+    CHECK(allocated == 0);
+}
+
+TEST(http_unzip_share, truncated)
+{
+    const std::string text = make_text(50000);
+    std::string body = gzip(text);
+    body.resize(body.length() / 2);
+    const auto sections = split(body, 700);
+
+    const Result twice = unzip_twice(sections);
+    CHECK(twice.output.length() > 0);
+    check_same(unzip_shared(sections, 1 << 20, flow_data), twice);
+}
+
+TEST(http_unzip_share, early_end)
+{
+    const std::string text = make_text(20000);
+    const std::string trailer = "trailing garbage after the gzip member";
+    const auto sections = split(gzip(text) + trailer, 500);
+
+    const Result twice = unzip_twice(sections);
+    CHECK(twice.output == text + trailer);
+    CHECK(twice.infractions != 0);
+    check_same(unzip_shared(sections, 1 << 20, flow_data), twice);
+}
+
+TEST(http_unzip_share, corrupt)
+{
+    const std::string text = make_text(50000);
+    std::string body = gzip(text);
+    for (unsigned k = 2000; k < 2100; k++)
+        body[k] = ~body[k];
+    const auto sections = split(body, 800);
+
+    const Result twice = unzip_twice(sections);
+    CHECK(twice.infractions != 0);
+    check_same(unzip_shared(sections, 1 << 20, flow_data), twice);
+}
+
+TEST(http_unzip_share, corrupt_first_section)
+{
+    std::string body = gzip(make_text(5000));
+    body[1] = 0;
+    const auto sections = split(body, 1000);
+
+    check_same(unzip_shared(sections, 1 << 20, flow_data), unzip_twice(sections));
+}
+
+// The cutter runs out of memcap part way through and reassemble() takes over its stream
+TEST(http_unzip_share, memcap)
+{
+    const std::string text = make_text(400000);
+    const auto sections = split(gzip(text), 4000);
+
+    const Result twice = unzip_twice(sections);
+    CHECK(twice.output == text);
+
+    HttpUnzipShare share(flow_data, CMP_GZIP, 2 * MAX_OCTETS);
+    Reassembler r(&share);
+    const uint8_t* output;
+    uint32_t output_length;
+
+    // the cutter gets well ahead of reassemble() so the saved output piles up
+    for (unsigned k = 0; k < sections.size(); k++)
+    {
+        share.unzip((const uint8_t*)sections[k].data(), sections[k].length(), output,
+            output_length);
+        CHECK(allocated <= 2 * MAX_OCTETS + 2 * HttpUnzipShare::stream_memory + MAX_OCTETS);
+        if (k >= 8)
+            r.section(sections[k - 8]);
+    }
+    for (unsigned k = sections.size() - 8; k < sections.size(); k++)
+        r.section(sections[k]);
+
+    check_same(r.get_result(), twice);
+    CHECK(get_fallbacks() == 1);
+    CHECK(!share.in_use());
+}
+
+// The cutter skips unzipping and hands off its stream at that point
+TEST(http_unzip_share, hand_off)
+{
+    const std::string text = make_text(60000);
+    const auto sections = split(gzip(text), 1500);
+    const Result twice = unzip_twice(sections);
+
+    HttpUnzipShare share(flow_data, CMP_GZIP, 1 << 20);
+    Reassembler r(&share);
+    const uint8_t* output;
+    uint32_t output_length;
+
+    for (unsigned k = 0; k < 3; k++)
+    {
+        CHECK(share.unzip((const uint8_t*)sections[k].data(), sections[k].length(), output,
+            output_length));
+    }
+    share.hand_off();
+    CHECK(allocated > 0);
+
+    for (auto& s : sections)
+        r.section(s);
+
+    check_same(r.get_result(), twice);
+    CHECK(!share.in_use());
+    CHECK(get_shared_bytes() > 0);
+    CHECK(get_shared_bytes() < text.length());
+}
+
+// reassemble() sees different data than the cutter unzipped. The first section is redone on the
+// caller's own stream.
+TEST(http_unzip_share, mismatch_first_section)
+{
+    const std::string text = make_text(30000);
+    const auto sections = split(gzip(text), 1000);
+    auto scanned = sections;
+    scanned[0][100] = ~scanned[0][100];
+
+    HttpUnzipShare share(flow_data, CMP_GZIP, 1 << 20);
+    Reassembler r(&share);
+    const uint8_t* output;
+    uint32_t output_length;
+
+    for (auto& s : scanned)
+        share.unzip((const uint8_t*)s.data(), s.length(), output, output_length);
+    for (auto& s : sections)
+        r.section(s);
+
+    check_same(r.get_result(), unzip_twice(sections));
+    CHECK(get_fallbacks() == 1);
+}
+
+// Later on, the output already copied is kept and the rest is copied raw. The cutter scans
+// half sections so the call that fails already has output from its first piece.
+TEST(http_unzip_share, mismatch_later)
+{
+    const std::string text = make_text(30000);
+    const std::string body = gzip(text);
+    const auto sections = split(body, 1000);
+    std::string scanned_body = body;
+    scanned_body[3600] = ~scanned_body[3600];
+    const auto scanned = split(scanned_body, 500);
+
+    HttpUnzipShare share(flow_data, CMP_GZIP, 1 << 20);
+    Reassembler r(&share);
+    const uint8_t* output;
+    uint32_t output_length;
+
+    for (auto& s : scanned)
+        share.unzip((const uint8_t*)s.data(), s.length(), output, output_length);
+    for (auto& s : sections)
+        r.section(s);
+
+    // the first three and a half sections unzipped as usual followed by the rest raw
+    const std::string expected = unzip_twice(split(body.substr(0, 3500), 500)).output +
+        body.substr(3500);
+
+    const Result& shared = r.get_result();
+    CHECK(shared.output == expected);
+    CHECK(shared.infractions != 0);
+    CHECK(get_fallbacks() == 1);
+}
+
+// A stream copied by hand_off() before reassemble() starts is released when it is not used
+TEST(http_unzip_share, release)
+{
+    const auto sections = split(gzip(make_text(10000)), 1000);
+    {
+        HttpUnzipShare share(flow_data, CMP_GZIP, 1 << 20);
+        const uint8_t* output;
+        uint32_t output_length;
+        share.unzip((const uint8_t*)sections[0].data(), sections[0].length(), output,
+            output_length);
+        share.hand_off();
+        CHECK(allocated > 0);
+    }
+    CHECK(allocated == 0);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -41,6 +41,9 @@ public:
     Status scan(snort::Packet*, const uint8_t* data, uint32_t len,
         uint32_t flags, uint32_t* fp) override;
 
+    bool can_gather() override
+    { return true; }
+
     bool is_paf() override
     {
         return true;
@@ -76,6 +76,9 @@ const PegInfo base_pegs[] =
     { CountType::SUM, "reload_allowed_deletes", "number of allowed flows deleted by config reloads" },
     { CountType::SUM, "reload_blocked_deletes", "number of blocked flows deleted by config reloads" },
     { CountType::SUM, "reload_offloaded_deletes", "number of offloaded flows deleted by config reloads" },
+    { CountType::SUM, "prefetch_batches", "daq message batches scanned for flow prefetch" },
+    { CountType::SUM, "prefetch_keys", "flow keys computed from raw messages for prefetch" },
+    { CountType::SUM, "prefetch_hits", "prefetched keys that matched a cached flow" },
     { CountType::END, nullptr, nullptr }
 };
 
@@ -98,6 +101,9 @@ void base_prep()
     stream_base_stats.reload_allowed_flow_deletes = flow_con->get_deletes(FlowDeleteState::ALLOWED);
     stream_base_stats.reload_offloaded_flow_deletes= flow_con->get_deletes(FlowDeleteState::OFFLOADED);
     stream_base_stats.reload_blocked_flow_deletes= flow_con->get_deletes(FlowDeleteState::BLOCKED);
+    stream_base_stats.prefetch_batches = flow_con->get_prefetch_batches();
+    stream_base_stats.prefetch_keys = flow_con->get_prefetch_keys();
+    stream_base_stats.prefetch_hits = flow_con->get_prefetch_hits();
     ExpectCache* exp_cache = flow_con->get_exp_cache();
 
     if ( exp_cache )
@@ -72,6 +72,12 @@ static const Parameter s_params[] =
         "use zero for production, non-zero for testing at given size (for TCP and user)" },
 #endif
 
+    { "flow_prefetch", Parameter::PT_BOOL, nullptr, "false",
+      "prefetch flows a few daq messages ahead of processing them (requires restart)" },
+
+    { "flow_table", Parameter::PT_ENUM, "chained | cuckoo", "chained",
+      "flow hash table: chained with exact lru or cuckoo with clock pruning (requires restart)" },
+
     { "ip_frags_only", Parameter::PT_BOOL, nullptr, "false",
             "don't process non-frag flows" },
 
@@ -163,6 +169,16 @@ bool StreamModule::set(const char* fqn, Value& v, SnortConfig* c)
             c->set_run_flags(RUN_FLAG__IP_FRAGS_ONLY);
         return true;
     }
+    else if ( v.is("flow_prefetch") )
+    {
+        config.flow_cache_cfg.prefetch = v.get_bool();
+        return true;
+    }
+    else if ( v.is("flow_table") )
+    {
+        config.flow_cache_cfg.table_type = (FlowTableType)v.get_uint8();
+        return true;
+    }
     else if ( v.is("max_flows") )
     {
         config.flow_cache_cfg.max_flows = v.get_uint32();
@@ -332,6 +348,9 @@ bool StreamUnloadReloadResourceManager::tune_resources(unsigned work_limit)
 
 void StreamModuleConfig::show() const
 {
+    ConfigLogger::log_flag("flow_prefetch", flow_cache_cfg.prefetch);
+    ConfigLogger::log_value("flow_table",
+        flow_cache_cfg.table_type == FlowTableType::CUCKOO ? "cuckoo" : "chained");
     ConfigLogger::log_value("max_flows", flow_cache_cfg.max_flows);
     ConfigLogger::log_value("pruning_timeout", flow_cache_cfg.pruning_timeout);
 
@@ -67,6 +67,9 @@ struct BaseStats
      PegCount reload_allowed_flow_deletes;
      PegCount reload_blocked_flow_deletes;
      PegCount reload_offloaded_flow_deletes;
+     PegCount prefetch_batches;
+     PegCount prefetch_keys;
+     PegCount prefetch_hits;
 };
 
 extern const PegInfo base_pegs[];
@@ -149,6 +152,8 @@ public:
 
     void prep_counts() override;
     void sum_stats(bool) override;
+    bool snapshot_stats() const override
+    { return false; }
     void show_stats() override;
     void reset_stats() override;
 
@@ -42,6 +42,7 @@
 #include "target_based/snort_protocols.h"
 #include "utils/util.h"
 
+#include "tcp/tcp_segment_node.h"
 #include "tcp/tcp_session.h"
 #include "tcp/tcp_stream_session.h"
 #include "tcp/tcp_stream_tracker.h"
@@ -81,6 +82,13 @@ void Stream::delete_flow(Flow* flow)
     flow_con->release_flow(flow, PruneReason::NONE);
 }
 
+unsigned Stream::prefetch_flows(const DAQ_Msg_h* msgs, unsigned num, unsigned num_done, int dlt)
+{
+    if ( flow_con )
+        return flow_con->prefetch_flows(msgs, num, num_done, dlt);
+    return num_done;
+}
+
 //-------------------------------------------------------------------------
 // key foo
 //-------------------------------------------------------------------------
@@ -841,6 +849,12 @@ bool Stream::set_packet_action_to_hold(Packet* p)
     return p->flow->session->set_packet_action_to_hold(p);
 }
 
+bool Stream::defer_verdict(Packet* p, DAQ_Verdict verdict)
+{
+    assert(p->packet_flags & PKT_RETAINED);
+    return TcpSegmentNode::defer_verdict(p->daq_msg, verdict);
+}
+
 void Stream::set_no_ack_mode(Flow* flow, bool on_off)
 {
     assert(flow and flow->session and flow->pkt_type == PktType::TCP);
@@ -78,6 +78,10 @@ public:
 
     static void handle_timeouts(bool idle);
     static void prune_flows();
+
+    // hint that these messages are about to be processed; see
+    // FlowControl::prefetch_flows()
+    static unsigned prefetch_flows(const DAQ_Msg_h*, unsigned num, unsigned num_done, int dlt);
     static bool expected_flow(Flow*, Packet*);
 
     // Looks in the flow cache for flow session with specified key and returns
@@ -248,6 +252,10 @@ public:
     static uint8_t get_tcp_options_len(Flow*, bool to_server);
 
     static bool set_packet_action_to_hold(Packet*);
+
+    // for packets with PKT_RETAINED; returns true if stream will finalize
+    // the daq message with the given verdict once it is no longer needed
+    static bool defer_verdict(Packet*, DAQ_Verdict);
     static void set_no_ack_mode(Flow*, bool);
 
 private:
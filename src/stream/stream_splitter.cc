@@ -60,6 +60,26 @@ const StreamBuffer StreamSplitter::reassemble(
     return { nullptr, 0 };
 }
 
+const StreamBuffer StreamSplitter::gather(
+    Flow*, const StreamBuffer* views, unsigned num, unsigned total, bool in_place)
+{
+    if ( num == 1 and in_place )
+        return views[0];
+
+    unsigned max;
+    uint8_t* pdu_buf = DetectionEngine::get_next_buffer(max);
+    unsigned offset = 0;
+
+    assert(total < max);
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        memcpy(pdu_buf + offset, views[i].data, views[i].length);
+        offset += views[i].length;
+    }
+    return { pdu_buf, offset };
+}
+
 //--------------------------------------------------------------------------
 // atom splitter
 //--------------------------------------------------------------------------
@@ -79,6 +79,18 @@ public:
         unsigned& copied       // actual data copied (1 <= copied <= len)
         );
 
+    // if true and stream_tcp.max_retained is set, tcp reassembly calls
+    // gather() once with a complete pdu instead of calling reassemble() for
+    // each segment.  only splitters using the default reassemble() should
+    // return true.
+    virtual bool can_gather() { return false; }
+
+    // views are the pieces of the pdu in order.  if in_place, they remain
+    // valid until the pdu is inspected so a single view may be returned as
+    // is; otherwise the data must be copied.
+    virtual const StreamBuffer gather(
+        Flow*, const StreamBuffer* views, unsigned num, unsigned total, bool in_place);
+
     virtual bool is_paf() { return false; }
     virtual unsigned max(Flow* = nullptr);
     virtual unsigned adjust_to_fit(unsigned len) { return len; }
@@ -115,6 +127,7 @@ public:
     Status scan(Packet*, const uint8_t*, uint32_t, uint32_t, uint32_t*) override;
     unsigned adjust_to_fit(unsigned len) override;
     void update() override;
+    bool can_gather() override { return true; }
 
 private:
     void reset();
@@ -134,6 +147,7 @@ public:
     LogSplitter(bool);
 
     Status scan(Packet*, const uint8_t*, uint32_t, uint32_t, uint32_t*) override;
+    bool can_gather() override { return true; }
 };
 
 //-------------------------------------------------------------------------
@@ -145,6 +159,7 @@ public:
     StopAndWaitSplitter(bool b) : StreamSplitter(b) { }
 
     Status scan(Packet*, const uint8_t*, uint32_t, uint32_t, uint32_t*) override;
+    bool can_gather() override { return true; }
 
 private:
     bool saw_data()
@@ -214,7 +214,7 @@ void SegmentOverlapEditor::left_overlap_keep_first(TcpReassemblerState& trs)
             if (trs.sos.tcp_ips_data == NORM_MODE_ON)
             {
                 unsigned offset = trs.sos.tsd->get_seq() - trs.sos.left->i_seq;
-                trs.sos.tsd->rewrite_payload(0, trs.sos.left->data + offset);
+                trs.sos.tsd->rewrite_payload(0, trs.sos.left->base + offset);
             }
             tcp_norm_stats[PC_TCP_IPS_DATA][trs.sos.tcp_ips_data]++;
         }
@@ -225,7 +225,7 @@ void SegmentOverlapEditor::left_overlap_keep_first(TcpReassemblerState& trs)
                 unsigned offset = trs.sos.tsd->get_seq() - trs.sos.left->i_seq;
                 unsigned length =
                     trs.sos.left->i_seq + trs.sos.left->i_len - trs.sos.tsd->get_seq();
-                trs.sos.tsd->rewrite_payload(0, trs.sos.left->data + offset, length);
+                trs.sos.tsd->rewrite_payload(0, trs.sos.left->base + offset, length);
             }
 
             tcp_norm_stats[PC_TCP_IPS_DATA][trs.sos.tcp_ips_data]++;
@@ -333,7 +333,7 @@ void SegmentOverlapEditor::right_overlap_truncate_new(TcpReassemblerState& trs)
         unsigned offset = trs.sos.right->i_seq - trs.sos.tsd->get_seq();
         unsigned length =
             trs.sos.tsd->get_seq() + trs.sos.tsd->get_len() - trs.sos.right->i_seq;
-        trs.sos.tsd->rewrite_payload(offset, trs.sos.right->data, length);
+        trs.sos.tsd->rewrite_payload(offset, trs.sos.right->base, length);
     }
 
     tcp_norm_stats[PC_TCP_IPS_DATA][trs.sos.tcp_ips_data]++;
@@ -347,7 +347,7 @@ void SegmentOverlapEditor::full_right_overlap_truncate_new(TcpReassemblerState&
     if ( trs.sos.tcp_ips_data == NORM_MODE_ON )
     {
         unsigned offset = trs.sos.right->i_seq - trs.sos.tsd->get_seq();
-        trs.sos.tsd->rewrite_payload(offset, trs.sos.right->data, trs.sos.right->i_len);
+        trs.sos.tsd->rewrite_payload(offset, trs.sos.right->base, trs.sos.right->i_len);
     }
 
     tcp_norm_stats[PC_TCP_IPS_DATA][trs.sos.tcp_ips_data]++;
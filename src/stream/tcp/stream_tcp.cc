@@ -75,7 +75,7 @@ bool StreamTcp::configure(SnortConfig* sc)
 void StreamTcp::tinit()
 {
     TcpHAManager::tinit();
-    TcpSession::sinit();
+    TcpSession::sinit(config->max_retained);
 }
 
 void StreamTcp::tterm()
@@ -108,6 +108,14 @@ const PegInfo tcp_pegs[] =
     { CountType::SUM, "partial_flush_bytes", "partial flush total bytes" },
     { CountType::SUM, "inspector_fallbacks", "count of fallbacks from assigned service inspector" },
     { CountType::SUM, "partial_fallbacks", "count of fallbacks from assigned service stream splitter" },
+    { CountType::NOW, "segs_pooled", "number of queued segments allocated from the segment pool" },
+    { CountType::NOW, "seg_pool_free", "number of free segment pool nodes" },
+    { CountType::NOW, "seg_pool_slabs", "number of 2 MB slabs mapped by the segment pool" },
+    { CountType::SUM, "seg_pool_misses", "segments allocated from the heap because they didn't fit the pool" },
+    { CountType::SUM, "segs_retained", "segments queued without copying the payload from the daq message" },
+    { CountType::NOW, "msgs_retained", "number of daq messages currently held by queued segments" },
+    { CountType::SUM, "retain_fallbacks", "segments copied because the retention budget or daq message pool was exhausted" },
+    { CountType::SUM, "pdus_in_place", "reassembled PDUs inspected directly from a queued segment" },
     { CountType::END, nullptr, nullptr }
 };
 
@@ -190,6 +198,9 @@ static const Parameter s_params[] =
     { "max_pdu", Parameter::PT_INT, "1460:32768", "16384",
       "maximum reassembled PDU size" },
 
+    { "max_retained", Parameter::PT_INT, "0:max32", "0",
+      "maximum daq messages each packet thread may hold to queue passive payload without copying" },
+
     { "no_ack", Parameter::PT_BOOL, nullptr, "false",
       "received data is implicitly acked immediately" },
 
@@ -309,6 +320,9 @@ bool StreamTcpModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("max_pdu") )
         config->paf_max = v.get_uint16();
 
+    else if ( v.is("max_retained") )
+        config->max_retained = v.get_uint32();
+
     else if ( v.is("no_ack") )
         config->no_ack = v.get_bool();
 
@@ -109,6 +109,14 @@ struct TcpStats
     PegCount partial_flush_bytes;
     PegCount inspector_fallbacks;
     PegCount partial_fallbacks;
+    PegCount segs_pooled;
+    PegCount seg_pool_free;
+    PegCount seg_pool_slabs;
+    PegCount seg_pool_misses;
+    PegCount segs_retained;
+    PegCount msgs_retained;
+    PegCount retain_fallbacks;
+    PegCount pdus_in_place;
 };
 
 extern THREAD_LOCAL struct TcpStats tcpStats;
@@ -366,8 +366,107 @@ void TcpReassembler::show_rebuilt_packet(const TcpReassemblerState& trs, Packet*
     }
 }
 
+// collect views of the queued data so the splitter gets the whole pdu in
+// one call and the data is copied at most once.  a pdu from one segment
+// is inspected in place when nothing can defer its detection past the
+// flush; the segment is pinned until then.  returns -1 if there are too
+// many segments to gather.
+int TcpReassembler::gather_data_segments(TcpReassemblerState& trs, uint32_t flush_len, Packet* pdu)
+{
+    StreamBuffer views[max_views];
+    unsigned num = 0;
+
+    TcpSegmentNode* tsn = trs.sos.seglist.cur_rseg;
+    uint32_t to_seq = tsn->c_seq + flush_len;
+    uint32_t remaining_bytes = flush_len;
+    bool missing = false;
+
+    while ( remaining_bytes )
+    {
+        if ( num == max_views )
+            return -1;
+
+        unsigned len = ( tsn->c_len <= remaining_bytes ) ? tsn->c_len : remaining_bytes;
+        views[num++] = { tsn->payload(), len };
+        remaining_bytes -= len;
+
+        if ( tsn->is_packet_missing(to_seq) )
+        {
+            missing = true;
+            break;
+        }
+
+        if ( !remaining_bytes or !next_no_gap(*tsn) )
+            break;
+
+        tsn = tsn->next;
+    }
+
+    // as with reassemble(), nothing is produced unless the pdu is complete
+    if ( !remaining_bytes )
+    {
+        Flow* flow = trs.sos.session->flow;
+        tsn = trs.sos.seglist.cur_rseg;
+
+        bool in_place = num == 1 and !flow->is_suspended() and
+            flush_len < SnortConfig::get_conf()->offload_limit and tsn->pin();
+
+        const StreamBuffer sb = trs.tracker->get_splitter()->gather(
+            flow, views, num, flush_len, in_place);
+
+        if ( in_place and sb.data != views[0].data )
+            TcpSegmentNode::unpin();
+        else if ( in_place )
+            tcpStats.pdus_in_place++;
+
+        pdu->data = sb.data;
+        pdu->dsize = sb.length;
+    }
+
+    uint32_t total_flushed = 0;
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        tsn = trs.sos.seglist.cur_rseg;
+        unsigned len = views[i].length;
+
+        total_flushed += len;
+        tsn->c_seq += len;
+        tsn->c_len -= len;
+        tsn->offset += len;
+
+        if ( !tsn->c_len )
+        {
+            trs.flush_count++;
+            update_next(trs, *tsn);
+        }
+    }
+
+    if ( missing )
+    {
+        if ( !trs.tracker->is_fin_seq_set() or
+            SEQ_LEQ(to_seq, trs.tracker->get_fin_final_seq()) )
+        {
+            trs.tracker->set_tf_flags(TF_MISSING_PKT);
+        }
+    }
+
+    return total_flushed;
+}
+
 int TcpReassembler::flush_data_segments(TcpReassemblerState& trs, uint32_t flush_len, Packet* pdu)
 {
+    // gathering is tied to retention so the default config still
+    // reassembles segment by segment
+    if ( trs.sos.session->tcp_config->max_retained and
+        trs.tracker->get_splitter()->can_gather() )
+    {
+        int flushed = gather_data_segments(trs, flush_len, pdu);
+
+        if ( flushed >= 0 )
+            return flushed;
+    }
+
     uint32_t flags = PKT_PDU_HEAD;
     uint32_t to_seq = trs.sos.seglist.cur_rseg->c_seq + flush_len;
     uint32_t remaining_bytes = flush_len;
@@ -532,6 +631,8 @@ int TcpReassembler::flush_to_seq(
         else
             last_pdu = nullptr;
 
+        TcpSegmentNode::unpin();
+
         trs.tracker->finalize_held_packet(p);
     }
     else
@@ -49,6 +49,8 @@ public:
 protected:
     TcpReassembler() = default;
 
+    static constexpr unsigned max_views = 64;
+
     void add_reassembly_segment(
         TcpReassemblerState&, TcpSegmentDescriptor&, uint16_t len, uint32_t slide,
         uint32_t trunc, uint32_t seq, TcpSegmentNode* left) override;
@@ -66,6 +68,7 @@ protected:
         (TcpReassemblerState&, TcpSegmentNode* tail, const TcpSegmentDescriptor&);
     void show_rebuilt_packet(const TcpReassemblerState&, snort::Packet*);
     int flush_data_segments(TcpReassemblerState&, uint32_t flush_len, snort::Packet* pdu);
+    int gather_data_segments(TcpReassemblerState&, uint32_t flush_len, snort::Packet* pdu);
     void prep_pdu(
         TcpReassemblerState&, snort::Flow*, snort::Packet*, uint32_t pkt_flags, snort::Packet*);
     snort::Packet* initialize_pdu(
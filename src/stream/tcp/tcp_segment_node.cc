@@ -25,44 +25,185 @@
 
 #include "tcp_segment_node.h"
 
+#include <cassert>
+
+#include "main/analyzer.h"
 #include "main/thread.h"
 #include "memory/memory_cap.h"
+#include "packet_io/sfdaq.h"
+#include "packet_io/sfdaq_instance.h"
 #include "utils/util.h"
 
 #include "segment_overlap_editor.h"
 #include "tcp_module.h"
+#include "tcp_segment_pool.h"
 
-#define USE_RESERVE
-#ifdef USE_RESERVE
-static THREAD_LOCAL TcpSegmentNode* reserved = nullptr;
-static THREAD_LOCAL unsigned reserve_sz = 0;
+using namespace snort;
 
-static constexpr unsigned num_res = 4096;
-static constexpr unsigned res_min = 1024;
-static constexpr unsigned res_max = 1460;
-#endif
+//-------------------------------------------------------------------------
+// thread state
+//-------------------------------------------------------------------------
 
-void TcpSegmentNode::setup()
+// a retained message is referenced by each segment pointing into it plus
+// the analyzer until it has a verdict for the packet.  pending messages
+// are those still waiting on the analyzer; there are at most a few.
+struct RetainedMessage
 {
-#ifdef USE_RESERVE
-    reserved = nullptr;
-    reserve_sz = 0;
-#endif
+    DAQ_Msg_h msg;
+    DAQ_Verdict verdict;
+    unsigned refs;
+    RetainedMessage* next;
+};
+
+static THREAD_LOCAL TcpSegmentPool* pool = nullptr;
+static THREAD_LOCAL RetainedMessage* retained_msgs = nullptr;
+static THREAD_LOCAL RetainedMessage* free_retained = nullptr;
+static THREAD_LOCAL RetainedMessage* pending = nullptr;
+static THREAD_LOCAL unsigned num_retained = 0;
+
+// state is retired rather than deleted if segments are still queued when
+// the thread terminates; the last term() deletes it.
+static THREAD_LOCAL bool retired = false;
+
+// the segment a pdu is being inspected from in place
+static THREAD_LOCAL TcpSegmentNode* pinned = nullptr;
+static THREAD_LOCAL bool pinned_termed = false;
+
+static void update_pool_pegs()
+{
+    tcpStats.segs_pooled = pool->get_in_use();
+    tcpStats.seg_pool_free = pool->get_free();
+    tcpStats.seg_pool_slabs = pool->get_slabs();
+}
+
+static void delete_thread_state()
+{
+    delete pool;
+    pool = nullptr;
+
+    delete[] retained_msgs;
+    retained_msgs = free_retained = pending = nullptr;
+
+    retired = false;
+}
+
+void TcpSegmentNode::setup(unsigned max_retained)
+{
+    // each stream_tcp instance calls this; the first one sets the budget
+    if ( pool )
+        return;
+
+    pool = new TcpSegmentPool;
+
+    if ( max_retained )
+    {
+        retained_msgs = new RetainedMessage[max_retained];
+
+        for ( unsigned i = 0; i < max_retained; ++i )
+        {
+            retained_msgs[i].next = free_retained;
+            free_retained = retained_msgs + i;
+        }
+    }
 }
 
 void TcpSegmentNode::clear()
 {
-#ifdef USE_RESERVE
-    while ( reserved )
+    if ( !pool or retired )
+        return;
+
+    if ( pool->get_in_use() or num_retained )
+        retired = true;
+    else
+        delete_thread_state();
+}
+
+//-------------------------------------------------------------------------
+// daq message retention
+//-------------------------------------------------------------------------
+
+static RetainedMessage* retain(Packet* p)
+{
+    if ( !retained_msgs or retired or (p->packet_flags & (PKT_PSEUDO | PKT_RETAINED)) )
+        return nullptr;
+
+    // holding a message that will be forwarded would delay it
+    if ( !p->daq_msg or SFDAQ::forwarding_packet(p->pkth) )
+        return nullptr;
+
+    // the payload must be in the message and not, e.g., a defrag buffer
+    const uint8_t* start = daq_msg_get_data(p->daq_msg);
+    const uint8_t* end = start + daq_msg_get_data_len(p->daq_msg);
+
+    if ( p->data < start or p->data + p->dsize > end )
+        return nullptr;
+
+    // same heuristic as packet holds to keep the daq from running dry
+    if ( !free_retained or !p->daq_instance or
+        p->daq_instance->get_pool_available() < p->daq_instance->get_batch_size() )
     {
-        TcpSegmentNode* tsn = reserved;
-        reserved = reserved->next;
-        memory::MemoryCap::update_deallocations(sizeof(*tsn) + tsn->size);
-        tcpStats.mem_in_use -= tsn->size;
-        snort_free(tsn);
+        tcpStats.retain_fallbacks++;
+        return nullptr;
     }
-    reserve_sz = 0;
-#endif
+
+    RetainedMessage* rm = free_retained;
+    free_retained = rm->next;
+
+    rm->msg = p->daq_msg;
+    rm->verdict = DAQ_VERDICT_PASS;
+    rm->refs = 1;
+    rm->next = pending;
+    pending = rm;
+
+    p->packet_flags |= PKT_RETAINED;
+    tcpStats.msgs_retained = ++num_retained;
+
+    return rm;
+}
+
+static void free_message(RetainedMessage* rm)
+{
+    rm->next = free_retained;
+    free_retained = rm;
+    tcpStats.msgs_retained = --num_retained;
+}
+
+static void unref(RetainedMessage* rm)
+{
+    assert(rm->refs);
+
+    if ( --rm->refs )
+        return;
+
+    Analyzer::get_local_analyzer()->finalize_daq_message(rm->msg, rm->verdict);
+    free_message(rm);
+}
+
+bool TcpSegmentNode::defer_verdict(DAQ_Msg_h msg, DAQ_Verdict verdict)
+{
+    RetainedMessage** prev = &pending;
+
+    while ( *prev and (*prev)->msg != msg )
+        prev = &(*prev)->next;
+
+    RetainedMessage* rm = *prev;
+    assert(rm);
+
+    if ( !rm )
+        return false;
+
+    *prev = rm->next;
+    rm->next = nullptr;
+
+    // if the segments are already gone the caller finalizes
+    if ( !--rm->refs )
+    {
+        free_message(rm);
+        return false;
+    }
+
+    rm->verdict = verdict;
+    return true;
 }
 
 //-------------------------------------------------------------------------
@@ -70,29 +211,49 @@ void TcpSegmentNode::clear()
 //-------------------------------------------------------------------------
 
 TcpSegmentNode* TcpSegmentNode::create(
-    const struct timeval& tv, const uint8_t* payload, uint16_t len)
+    const struct timeval& tv, const uint8_t* payload, uint16_t len, RetainedMessage* rm)
 {
-    TcpSegmentNode* tsn;
+    // retained payload stays in the daq message
+    unsigned copy_len = rm ? 0 : len;
+
+    TcpSegmentNode* tsn = nullptr;
+    uint8_t cls = TcpSegmentPool::no_class;
 
-#ifdef USE_RESERVE
-    if ( reserved and len > res_min and len <= res_max )
+    if ( pool and !retired )
+        tsn = (TcpSegmentNode*)pool->get(sizeof(*tsn) + copy_len, cls);
+
+    if ( tsn )
     {
-        tsn = reserved;
-        reserved = tsn->next;
-        --reserve_sz;
+        // account for the whole block so memcap matches what is held
+        tsn->size = TcpSegmentPool::get_block_size(cls) - sizeof(*tsn);
+        update_pool_pegs();
     }
     else
-#endif
     {
-        size_t size = sizeof(*tsn) + len;
-        memory::MemoryCap::update_allocations(size);
-        tsn = (TcpSegmentNode*)snort_alloc(size);
-        tsn->size = len;
-        tcpStats.mem_in_use += len;
+        tsn = (TcpSegmentNode*)snort_alloc(sizeof(*tsn) + copy_len);
+        tsn->size = copy_len;
+        tcpStats.seg_pool_misses++;
     }
+    memory::MemoryCap::update_allocations(sizeof(*tsn) + tsn->size);
+    tcpStats.mem_in_use += tsn->size;
+
+    tsn->pool_class = cls;
     tsn->tv = tv;
     tsn->i_len = tsn->c_len = len;
-    memcpy(tsn->data, payload, len);
+
+    if ( rm )
+    {
+        rm->refs++;
+        tsn->base = payload;
+        tsn->retained = rm;
+        tcpStats.segs_retained++;
+    }
+    else
+    {
+        memcpy(tsn->data, payload, len);
+        tsn->base = tsn->data;
+        tsn->retained = nullptr;
+    }
 
     tsn->prev = tsn->next = nullptr;
     tsn->i_seq = tsn->c_seq = 0;
@@ -104,31 +265,60 @@ TcpSegmentNode* TcpSegmentNode::create(
 
 TcpSegmentNode* TcpSegmentNode::init(const TcpSegmentDescriptor& tsd)
 {
-    return create(tsd.get_pkt()->pkth->ts, tsd.get_pkt()->data, tsd.get_len());
+    Packet* p = tsd.get_pkt();
+    return create(p->pkth->ts, p->data, tsd.get_len(), retain(p));
 }
 
 TcpSegmentNode* TcpSegmentNode::init(TcpSegmentNode& tns)
 {
-    return create(tns.tv, tns.payload(), tns.c_len);
+    return create(tns.tv, tns.payload(), tns.c_len, tns.retained);
 }
 
 void TcpSegmentNode::term()
 {
-#ifdef USE_RESERVE
-    if ( size == res_max and reserve_sz < num_res )
-    {
-        next = reserved;
-        reserved = this;
-        reserve_sz++;
-    }
+    memory::MemoryCap::update_deallocations(sizeof(*this) + size);
+    tcpStats.mem_in_use -= size;
+    tcpStats.segs_released++;
+
+    if ( this == pinned )
+        pinned_termed = true;
     else
-#endif
-    {
-        memory::MemoryCap::update_deallocations(sizeof(*this) + size);
-        tcpStats.mem_in_use -= size;
+        release();
+}
+
+void TcpSegmentNode::release()
+{
+    if ( retained )
+        unref(retained);
+
+    if ( pool_class == TcpSegmentPool::no_class )
         snort_free(this);
+    else
+    {
+        pool->put(this, pool_class);
+        update_pool_pegs();
     }
-    tcpStats.segs_released++;
+
+    if ( retired and !pool->get_in_use() and !num_retained )
+        delete_thread_state();
+}
+
+bool TcpSegmentNode::pin()
+{
+    if ( pinned )
+        return false;
+
+    pinned = this;
+    return true;
+}
+
+void TcpSegmentNode::unpin()
+{
+    if ( pinned and pinned_termed )
+        pinned->release();
+
+    pinned = nullptr;
+    pinned_termed = false;
 }
 
 bool TcpSegmentNode::is_retransmit(const uint8_t* rdata, uint16_t rsize,
@@ -141,12 +331,12 @@ bool TcpSegmentNode::is_retransmit(const uint8_t* rdata, uint16_t rsize,
     if ( orig_dsize == c_len )
     {
         uint16_t cmp_len = ( c_len <= rsize ) ? c_len : rsize;
-        if ( !memcmp(data, rdata, cmp_len) )
+        if ( !memcmp(base, rdata, cmp_len) )
             return true;
     }
     //Checking for a possible split of segment in which case
     //we compare complete data of the segment to find a retransmission
-    else if ( (orig_dsize == rsize) and !memcmp(data, rdata, rsize) )
+    else if ( (orig_dsize == rsize) and !memcmp(base, rdata, rsize) )
     {
         if ( full_retransmit )
             *full_retransmit = true;
@@ -22,22 +22,32 @@
 #ifndef TCP_SEGMENT_H
 #define TCP_SEGMENT_H
 
+#include <daq_common.h>
+
 #include "tcp_segment_descriptor.h"
 #include "tcp_defs.h"
 
 class TcpSegmentDescriptor;
+struct RetainedMessage;
 
 //-----------------------------------------------------------------
 // we make a lot of TcpSegments so it is organized by member
 // size/alignment requirements to minimize unused space
 // ... however, use of padding below is critical, adjust if needed
 // and we use the struct hack to avoid 2 allocs per node
+//
+// when retention is enabled the payload may instead be left in the daq
+// message, which isn't finalized until the last segment referencing it
+// is released.  use payload() rather than data.
 //-----------------------------------------------------------------
 
 class TcpSegmentNode
 {
 private:
-    static TcpSegmentNode* create(const struct timeval& tv, const uint8_t* segment, uint16_t len);
+    static TcpSegmentNode* create(
+        const struct timeval& tv, const uint8_t* segment, uint16_t len, RetainedMessage*);
+
+    void release();
 
 public:
     static TcpSegmentNode* init(const TcpSegmentDescriptor&);
@@ -45,13 +55,22 @@ public:
 
     void term();
 
-    static void setup();
+    static void setup(unsigned max_retained);
     static void clear();
 
+    // called by the analyzer for packets with PKT_RETAINED; returns true if
+    // the message is still referenced and will be finalized by stream
+    static bool defer_verdict(DAQ_Msg_h, DAQ_Verdict);
+
+    // keep this node's payload valid while a pdu is inspected in place;
+    // pin() returns false if another node is already pinned
+    bool pin();
+    static void unpin();
+
     bool is_retransmit(const uint8_t*, uint16_t size, uint32_t, uint16_t, bool*);
 
-    uint8_t* payload()
-    { return data + offset; }
+    const uint8_t* payload()
+    { return base + offset; }
 
     bool is_packet_missing(uint32_t to_seq)
     {
@@ -64,6 +83,8 @@ public:
 public:
     TcpSegmentNode* prev;
     TcpSegmentNode* next;
+    const uint8_t* base;        // payload; data or the retained daq message
+    RetainedMessage* retained;  // daq message holding the payload or nullptr
 
     struct timeval tv;
     uint32_t ts;
@@ -73,6 +94,7 @@ public:
     uint16_t c_len;             // length of data remaining for reassembly
     uint16_t offset;
     uint16_t size;              // actual allocated size (overlaps cause i_len to differ)
+    uint8_t pool_class;         // TcpSegmentPool size class or no_class if from the heap
     uint8_t data[1];
 };
 
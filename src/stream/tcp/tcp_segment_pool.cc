@@ -0,0 +1,262 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// tcp_segment_pool.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "tcp_segment_pool.h"
+
+#include <sys/mman.h>
+
+#include <cassert>
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+constexpr uint8_t TcpSegmentPool::num_classes;
+constexpr uint8_t TcpSegmentPool::no_class;
+constexpr size_t TcpSegmentPool::slab_size;
+
+// block sizes include the node header; all are multiples of the cache line
+// size.  the mtu class fits a 1460 byte payload and the jumbo class 9000.
+const size_t TcpSegmentPool::block_size[num_classes] = { 128, 512, 1536, 9216 };
+
+TcpSegmentPool::~TcpSegmentPool()
+{
+    assert(!in_use);
+
+    for ( auto* s : slabs )
+        munmap(s, slab_size);
+}
+
+// over map by a slab so the start can be aligned for a huge page
+static void* map_slab(size_t size)
+{
+    size_t len = 2 * size;
+    void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if ( p == MAP_FAILED )
+        return nullptr;
+
+    uint8_t* base = (uint8_t*)p;
+    uint8_t* slab = (uint8_t*)(((uintptr_t)base + size - 1) & ~(uintptr_t)(size - 1));
+
+    if ( slab > base )
+        munmap(base, slab - base);
+
+    if ( base + len > slab + size )
+        munmap(slab + size, (base + len) - (slab + size));
+
+#ifdef MADV_HUGEPAGE
+    madvise(slab, size, MADV_HUGEPAGE);
+#endif
+
+    return slab;
+}
+
+bool TcpSegmentPool::add_slab(SizeClass& sc)
+{
+    void* slab = map_slab(slab_size);
+
+    if ( !slab )
+        return false;
+
+    slabs.emplace_back(slab);
+    sc.next = (uint8_t*)slab;
+    sc.end = sc.next + slab_size;
+    return true;
+}
+
+void* TcpSegmentPool::get(size_t size, uint8_t& cls)
+{
+    cls = 0;
+
+    while ( block_size[cls] < size )
+    {
+        if ( ++cls == num_classes )
+        {
+            cls = no_class;
+            return nullptr;
+        }
+    }
+
+    SizeClass& sc = classes[cls];
+    void* block;
+
+    if ( sc.free )
+    {
+        block = sc.free;
+        sc.free = sc.free->next;
+    }
+    else
+    {
+        // blocks are carved as needed so untouched pages stay unmapped
+        if ( sc.next + block_size[cls] > sc.end and !add_slab(sc) )
+        {
+            cls = no_class;
+            return nullptr;
+        }
+        block = sc.next;
+        sc.next += block_size[cls];
+        ++carved;
+    }
+    ++in_use;
+    return block;
+}
+
+void TcpSegmentPool::put(void* block, uint8_t cls)
+{
+    assert(cls < num_classes and in_use);
+
+    FreeBlock* fb = (FreeBlock*)block;
+    fb->next = classes[cls].free;
+    classes[cls].free = fb;
+    --in_use;
+}
+
+#ifdef UNIT_TEST
+
+TEST_CASE("segment pool classes", "[tcp_segment_pool]")
+{
+    TcpSegmentPool pool;
+    uint8_t cls;
+
+    void* small = pool.get(100, cls);
+    CHECK(small);
+    CHECK(cls == 0);
+    pool.put(small, cls);
+
+    void* mtu = pool.get(1460 + 56, cls);
+    CHECK(mtu);
+    CHECK(TcpSegmentPool::get_block_size(cls) == 1536);
+    pool.put(mtu, cls);
+
+    void* jumbo = pool.get(9000 + 56, cls);
+    CHECK(jumbo);
+    CHECK(TcpSegmentPool::get_block_size(cls) == 9216);
+    pool.put(jumbo, cls);
+
+    CHECK(!pool.get(65535, cls));
+    CHECK(cls == TcpSegmentPool::no_class);
+
+    CHECK(pool.get_slabs() == 3);
+    CHECK(pool.get_in_use() == 0);
+    CHECK(pool.get_free() == 3);
+}
+
+TEST_CASE("segment pool reuse", "[tcp_segment_pool]")
+{
+    TcpSegmentPool pool;
+    uint8_t cls;
+
+    void* a = pool.get(1500, cls);
+    pool.put(a, cls);
+    CHECK(pool.get(1400, cls) == a);
+
+    // fill more than a slab
+    unsigned n = TcpSegmentPool::slab_size / TcpSegmentPool::get_block_size(cls) + 1;
+    std::vector<void*> blocks;
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        void* p = pool.get(1500, cls);
+        CHECK(((uintptr_t)p & 63) == 0);
+        blocks.emplace_back(p);
+    }
+    CHECK(pool.get_slabs() == 2);
+    CHECK(pool.get_in_use() == n + 1);
+
+    for ( auto* p : blocks )
+        pool.put(p, cls);
+
+    pool.put(a, cls);
+    CHECK(pool.get_in_use() == 0);
+}
+
+#endif
+
+#ifdef BENCHMARK_TEST
+
+#include <cstring>
+#include <string>
+
+#include "utils/util.h"
+
+// a reassembly queue stand in: each iteration releases the oldest of a
+// window of queued segments and allocates a new one.  payload sizes are a
+// mix of small, mtu, and jumbo segments.  only the node header is written
+// since the payload copy costs the same either way.
+static void bench_segments(unsigned window, bool pooled)
+{
+    static const uint16_t lens[] = { 1460, 1460, 1460, 1460, 120, 1460, 536, 9000 };
+    TcpSegmentPool pool;
+    std::vector<std::pair<void*, uint8_t>> queue(window, { nullptr, 0 });
+    unsigned i = 0;
+
+    std::string name = pooled ? "pool " : "heap ";
+    name += std::to_string(window) + " queued";
+
+    BENCHMARK(std::string(name))
+    {
+        auto& q = queue[i % window];
+        uint16_t len = lens[i++ & 7];
+
+        if ( q.first )
+        {
+            if ( pooled )
+                pool.put(q.first, q.second);
+            else
+                snort_free(q.first);
+        }
+
+        if ( pooled )
+            q.first = pool.get(64 + len, q.second);
+        else
+            q.first = snort_alloc(64 + len);
+
+        memset(q.first, 0, 64);
+        return q.first;
+    };
+
+    for ( auto& q : queue )
+    {
+        if ( !q.first )
+            continue;
+
+        if ( pooled )
+            pool.put(q.first, q.second);
+        else
+            snort_free(q.first);
+    }
+}
+
+TEST_CASE("segment allocation", "[tcp_segment_pool][benchmark]")
+{
+    for ( unsigned window : { 64, 4096, 65536 } )
+    {
+        bench_segments(window, false);
+        bench_segments(window, true);
+    }
+}
+
+#endif
+
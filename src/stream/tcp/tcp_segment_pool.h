@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// tcp_segment_pool.h
+
+#ifndef TCP_SEGMENT_POOL_H
+#define TCP_SEGMENT_POOL_H
+
+// TcpSegmentPool is a per thread slab allocator for segment nodes.  blocks
+// are carved from 2 MB slabs in a few size classes that cover small, mtu,
+// and jumbo payloads.  slabs are aligned and advised so the kernel can back
+// them with transparent huge pages.  freed blocks go on a free list for
+// their class and are reused; slabs are only unmapped when the pool is
+// deleted.  requests larger than the biggest class return nullptr and the
+// caller must use the heap.
+//
+// the pool does no memcap accounting; callers account for each block they
+// get so that pruning sees memory drop as segments are released.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TcpSegmentPool
+{
+public:
+    TcpSegmentPool() = default;
+    ~TcpSegmentPool();
+
+    TcpSegmentPool(const TcpSegmentPool&) = delete;
+    TcpSegmentPool& operator=(const TcpSegmentPool&) = delete;
+
+    // returns a block of at least size bytes and sets its class
+    void* get(size_t size, uint8_t& cls);
+
+    // return a block from get() with the class it was given
+    void put(void*, uint8_t cls);
+
+    static size_t get_block_size(uint8_t cls)
+    { return block_size[cls]; }
+
+    unsigned get_slabs() const
+    { return slabs.size(); }
+
+    unsigned get_in_use() const
+    { return in_use; }
+
+    unsigned get_free() const
+    { return carved - in_use; }
+
+    static constexpr uint8_t num_classes = 4;
+    static constexpr uint8_t no_class = 0xFF;
+    static constexpr size_t slab_size = 2 * 1024 * 1024;
+
+private:
+    struct FreeBlock
+    { FreeBlock* next; };
+
+    struct SizeClass
+    {
+        FreeBlock* free = nullptr;
+        uint8_t* next = nullptr;   // uncarved space in the current slab
+        uint8_t* end = nullptr;
+    };
+
+    bool add_slab(SizeClass&);
+
+    static const size_t block_size[num_classes];
+
+    SizeClass classes[num_classes];
+    std::vector<void*> slabs;
+    unsigned carved = 0;
+    unsigned in_use = 0;
+};
+
+#endif
+
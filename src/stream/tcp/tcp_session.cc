@@ -66,10 +66,10 @@
 
 using namespace snort;
 
-void TcpSession::sinit()
+void TcpSession::sinit(unsigned max_retained)
 {
     TcpSegmentDescriptor::setup();
-    TcpSegmentNode::setup();
+    TcpSegmentNode::setup(max_retained);
 }
 
 void TcpSession::sterm()
@@ -292,7 +292,10 @@ void TcpSession::update_perf_base_state(char newState)
     flow->update_session_flags(session_flags);
 
     if ( fire_event )
-        DataBus::publish(FLOW_STATE_EVENT, nullptr, flow);
+    {
+        static const DataEventId event_id = DataBus::get_id(FLOW_STATE_EVENT);
+        DataBus::publish(event_id, nullptr, flow);
+    }
 }
 
 bool TcpSession::flow_exceeds_config_thresholds(const TcpSegmentDescriptor& tsd)
@@ -38,7 +38,7 @@ public:
     TcpSession(snort::Flow*);
     ~TcpSession() override;
 
-    static void sinit();
+    static void sinit(unsigned max_retained);
     static void sterm();
 
     bool setup(snort::Packet*) override;
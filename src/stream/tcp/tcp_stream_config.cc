@@ -39,6 +39,7 @@ void TcpStreamConfig::show() const
 {
     ConfigLogger::log_value("flush_factor", flush_factor);
     ConfigLogger::log_value("max_pdu", paf_max);
+    ConfigLogger::log_value("max_retained", max_retained);
     ConfigLogger::log_value("max_window", max_window);
     ConfigLogger::log_flag("no_ack", no_ack);
     ConfigLogger::log_value("overlap_limit", overlap_limit);
@@ -68,6 +68,7 @@ public:
     uint32_t max_consec_small_seg_size = STREAM_DEFAULT_MAX_SMALL_SEG_SIZE;
 
     uint32_t paf_max = 16384;
+    uint32_t max_retained = 0;
     int hs_timeout = -1;
 
     bool no_ack;
@@ -261,6 +261,10 @@ int TcpStreamSession::update_alert(Packet* p, uint32_t gid, uint32_t sid,
 
 bool TcpStreamSession::set_packet_action_to_hold(Packet* p)
 {
+    // the held packet queue would finalize a message segments still use
+    if ( p->packet_flags & PKT_RETAINED )
+        return false;
+
     if ( p->is_from_client() )
         return server.set_held_packet(p);
     else
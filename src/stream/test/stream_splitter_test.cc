@@ -51,8 +51,13 @@ Packet::~Packet() { }
 struct Packet* DetectionEngine::get_current_packet()
 { return nullptr; }
 
-uint8_t* DetectionEngine::get_next_buffer(unsigned int&)
-{ return nullptr; }
+static uint8_t pdu_buf[1024];
+
+uint8_t* DetectionEngine::get_next_buffer(unsigned int& max)
+{
+    max = sizeof(pdu_buf);
+    return pdu_buf;
+}
 
 StreamSplitter* Stream::get_splitter(Flow*, bool)
 { return next_splitter; }
@@ -165,6 +170,109 @@ TEST(other_splitter, stop_and_wait)
     CHECK(flushed == 2);
 }
 
+//--------------------------------------------------------------------------
+// gather tests
+//--------------------------------------------------------------------------
+
+// like a plugin splitter written before gather() existed
+class ReassembleSplitter : public StreamSplitter
+{
+public:
+    ReassembleSplitter() : StreamSplitter(true) { }
+
+    Status scan(Packet*, const uint8_t*, uint32_t, uint32_t, uint32_t*) override
+    { return SEARCH; }
+
+    const StreamBuffer reassemble(Flow* f, unsigned total, unsigned offset,
+        const uint8_t* data, unsigned len, uint32_t flags, unsigned& copied) override
+    {
+        calls++;
+        return StreamSplitter::reassemble(f, total, offset, data, len, flags, copied);
+    }
+
+    unsigned calls = 0;
+};
+
+TEST_GROUP(gather) { };
+
+TEST(gather, opt_in)
+{
+    ReassembleSplitter rs;
+    CHECK(!rs.can_gather());
+
+    AtomSplitter as(true);
+    CHECK(as.can_gather());
+
+    StopAndWaitSplitter ws(true);
+    CHECK(ws.can_gather());
+}
+
+// the default config reassembles segment by segment; the pdu must be the
+// same as the one gathered when messages are retained
+TEST(gather, same_as_reassemble)
+{
+    ReassembleSplitter rs;
+    const uint8_t a[] = "abc";
+    const uint8_t b[] = "defgh";
+    const StreamBuffer views[] = { { a, 3 }, { b, 5 }, { a, 1 } };
+    unsigned offset = 0;
+    StreamBuffer sb = { nullptr, 0 };
+
+    for ( unsigned i = 0; i < 3; ++i )
+    {
+        uint32_t flags = (i == 0 ? PKT_PDU_HEAD : 0) | (i == 2 ? PKT_PDU_TAIL : 0);
+        unsigned copied = 0;
+
+        sb = rs.reassemble(nullptr, 9, offset, views[i].data, views[i].length, flags, copied);
+        CHECK(copied == views[i].length);
+        offset += copied;
+
+        if ( i < 2 )
+            CHECK(sb.data == nullptr);
+    }
+    CHECK(rs.calls == 3);
+    CHECK(sb.length == 9);
+
+    uint8_t reassembled[9];
+    memcpy(reassembled, sb.data, sizeof(reassembled));
+
+    LogSplitter ls(true);
+    sb = ls.gather(nullptr, views, 3, 9, false);
+    CHECK(sb.length == 9);
+    MEMCMP_EQUAL(reassembled, sb.data, 9);
+}
+
+TEST(gather, single)
+{
+    LogSplitter s(true);
+    const uint8_t seg[] = "abcdef";
+    const StreamBuffer view = { seg, 6 };
+
+    CHECK(s.can_gather());
+
+    StreamBuffer sb = s.gather(nullptr, &view, 1, 6, true);
+    CHECK(sb.data == seg);
+    CHECK(sb.length == 6);
+
+    sb = s.gather(nullptr, &view, 1, 6, false);
+    CHECK(sb.data == pdu_buf);
+    CHECK(sb.length == 6);
+    MEMCMP_EQUAL(seg, sb.data, 6);
+}
+
+TEST(gather, multiple)
+{
+    LogSplitter s(true);
+    const uint8_t a[] = "abc";
+    const uint8_t b[] = "defgh";
+    const StreamBuffer views[] = { { a, 3 }, { b, 5 }, { a, 1 } };
+
+    StreamBuffer sb = s.gather(nullptr, views, 3, 9, true);
+    CHECK(sb.data == pdu_buf);
+    CHECK(sb.length == 9);
+    MEMCMP_EQUAL("abcdefgha", sb.data, 9);
+}
+
 //-------------------------------------------------------------------------
 // main
 //-------------------------------------------------------------------------
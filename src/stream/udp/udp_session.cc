@@ -124,7 +124,8 @@ bool UdpSession::setup(Packet* p)
 
     SESSION_STATS_ADD(udpStats)
 
-    DataBus::publish(FLOW_STATE_EVENT, p);
+    static const DataEventId event_id = DataBus::get_id(FLOW_STATE_EVENT);
+    DataBus::publish(event_id, p);
 
     if ( flow->ssn_state.ignore_direction != SSN_DIR_NONE )
     {
@@ -51,6 +51,12 @@ void Periodic::register_handler(PeriodicHook hook, void* arg, uint16_t priority,
     s_periodic_handlers.emplace(it, hook, arg, priority, period);
 }
 
+void Periodic::unregister_handler(PeriodicHook hook, void* arg)
+{
+    s_periodic_handlers.remove_if([hook, arg](const PeriodicHookNode& node)
+        { return node.hook == hook and node.arg == arg; });
+}
+
 void Periodic::check()
 {
     for ( auto& it : s_periodic_handlers )
@@ -119,5 +125,26 @@ TEST_CASE("periodic", "[periodic]")
     CHECK( s_periodic_handlers.empty() );
 }
 
+TEST_CASE("periodic unregister", "[periodic]")
+{
+    const int
+        arg1 = 1,
+        arg2 = 2;
+
+    const std::vector<int> expect = { arg2 };
+
+    s_test_args.clear();
+
+    Periodic::register_handler(s_test_handler, (void*)&arg1, 1, 0);
+    Periodic::register_handler(s_test_handler, (void*)&arg2, 1, 0);
+    Periodic::unregister_handler(s_test_handler, (void*)&arg1);
+
+    Periodic::check();
+    CHECK( s_test_args == expect );
+
+    Periodic::unregister_all();
+    s_test_args.clear();
+}
+
 #endif
 
@@ -29,6 +29,7 @@ class Periodic
 public:
     // lower number is higher priority
     static void register_handler(PeriodicHook, void*, uint16_t priority, uint32_t);
+    static void unregister_handler(PeriodicHook, void*);
     static void check();
 
     static void unregister_all();
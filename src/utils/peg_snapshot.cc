@@ -0,0 +1,123 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// peg_snapshot.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "peg_snapshot.h"
+
+#include <cassert>
+#include <cstdint>
+
+// a slot is the sequence followed by the counts, rounded up to whole cache
+// lines so threads publishing at the same time don't share a line
+static const unsigned line_counts = 64 / sizeof(PegCount);
+
+PegSnapshot::PegSnapshot(unsigned threads, unsigned n, const PegInfo* pi) :
+    pegs(pi), num_threads(threads), num_pegs(n),
+    stride((n + 1 + line_counts - 1) / line_counts * line_counts),
+    buf(threads * stride + line_counts - 1)
+{
+    uintptr_t p = (uintptr_t)buf.data();
+    unsigned skip = ((64 - p % 64) % 64) / sizeof(PegCount);
+    data = buf.data() + skip;
+}
+
+// the odd sequence is stored before the counts change and the release fence
+// keeps the count stores after it.  the final even store releases the counts.
+void PegSnapshot::publish(unsigned thread, PegCount* p, bool accumulate_now)
+{
+    assert(thread < num_threads);
+    std::atomic<PegCount>* slot = get_slot(thread);
+    std::atomic<PegCount>* counts = slot + 1;
+
+    PegCount seq = slot->load(std::memory_order_relaxed);
+    slot->store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for ( unsigned i = 0; i < num_pegs; ++i )
+    {
+        PegCount c = counts[i].load(std::memory_order_relaxed);
+
+        switch ( pegs ? pegs[i].type : CountType::SUM )
+        {
+        case CountType::SUM:
+            c += p[i];
+            p[i] = 0;
+            break;
+
+        case CountType::NOW:
+            if ( accumulate_now )
+                c = p[i];
+            break;
+
+        case CountType::MAX:
+            if ( p[i] > c )
+                c = p[i];
+            break;
+
+        case CountType::END:
+            break;
+        }
+        counts[i].store(c, std::memory_order_relaxed);
+    }
+    slot->store(seq + 2, std::memory_order_release);
+}
+
+void PegSnapshot::collect(PegCount* totals) const
+{
+    std::vector<PegCount> copy(num_pegs);
+
+    for ( unsigned i = 0; i < num_pegs; ++i )
+        totals[i] = 0;
+
+    for ( unsigned t = 0; t < num_threads; ++t )
+    {
+        const std::atomic<PegCount>* slot = get_slot(t);
+        const std::atomic<PegCount>* counts = slot + 1;
+        PegCount seq;
+
+        do
+        {
+            seq = slot->load(std::memory_order_acquire);
+
+            if ( seq & 1 )
+                continue;
+
+            for ( unsigned i = 0; i < num_pegs; ++i )
+                copy[i] = counts[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        while ( (seq & 1) or seq != slot->load(std::memory_order_relaxed) );
+
+        for ( unsigned i = 0; i < num_pegs; ++i )
+        {
+            if ( pegs and pegs[i].type == CountType::MAX )
+            {
+                if ( copy[i] > totals[i] )
+                    totals[i] = copy[i];
+            }
+            else
+                totals[i] += copy[i];
+        }
+    }
+}
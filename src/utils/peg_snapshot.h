@@ -0,0 +1,70 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// peg_snapshot.h
+
+#ifndef PEG_SNAPSHOT_H
+#define PEG_SNAPSHOT_H
+
+// Per thread peg counts that can be read while packet threads update them.
+// Each packet thread owns one slot which it updates under a sequence lock.
+// Readers retry if a slot changed while they copied it, so publishing never
+// waits on a reader and readers never wait on each other.
+
+#include <atomic>
+#include <vector>
+
+#include "framework/counts.h"
+
+class PegSnapshot
+{
+public:
+    // without pegs all counts are summed
+    PegSnapshot(unsigned num_threads, unsigned num_pegs, const PegInfo* = nullptr);
+
+    // called only by the thread owning the slot.  sums are added to the slot
+    // and cleared in pegs, now counts replace the slot if accumulate_now,
+    // and max counts keep the larger value.
+    void publish(unsigned thread, PegCount* pegs, bool accumulate_now = true);
+
+    // totals over all slots: max counts are the largest value and all
+    // other counts are summed.  safe to call while threads publish.
+    void collect(PegCount* totals) const;
+
+    unsigned get_num_pegs() const
+    { return num_pegs; }
+
+private:
+    std::atomic<PegCount>* get_slot(unsigned thread)
+    { return &data[thread * stride]; }
+
+    const std::atomic<PegCount>* get_slot(unsigned thread) const
+    { return &data[thread * stride]; }
+
+private:
+    const PegInfo* pegs;
+    unsigned num_threads;
+    unsigned num_pegs;
+    unsigned stride;
+
+    std::vector<std::atomic<PegCount>> buf;
+    std::atomic<PegCount>* data;
+};
+
+#endif
+
@@ -207,6 +207,21 @@ const PegInfo pc_names[] =
     { CountType::SUM, "pcre_match_limit", "total number of times pcre hit the match limit" },
     { CountType::SUM, "pcre_recursion_limit", "total number of times pcre hit the recursion limit" },
     { CountType::SUM, "pcre_error", "total number of times pcre returns error" },
+    { CountType::SUM, "pcre_jit_searches", "total number of pcre searches run with jit compiled code" },
+    { CountType::SUM, "pcre_interp_searches", "total number of pcre searches run by the interpreter" },
+    { CountType::SUM, "pcre_jit_stack_limit", "total number of times pcre hit the jit stack limit" },
+    { CountType::SUM, "offload_wakes", "times an idle offload worker had to be woken" },
+    { CountType::SUM, "offload_parks", "times an offload worker stopped spinning and slept" },
+    { CountType::SUM, "offload_under_2us", "worker offloads completed within 2 usecs of being queued" },
+    { CountType::SUM, "offload_under_8us", "worker offloads completed within 2 to 8 usecs" },
+    { CountType::SUM, "offload_under_32us", "worker offloads completed within 8 to 32 usecs" },
+    { CountType::SUM, "offload_under_128us", "worker offloads completed within 32 to 128 usecs" },
+    { CountType::SUM, "offload_under_512us", "worker offloads completed within 128 to 512 usecs" },
+    { CountType::SUM, "offload_over_512us", "worker offloads that took 512 usecs or more" },
+    { CountType::SUM, "offload_stolen", "shared pool offloads run by a worker other than the thread's own" },
+    { CountType::SUM, "offload_pool_usecs", "shared pool worker time spent on this thread's offloads" },
+    { CountType::SUM, "eval_memo_hits", "relative rule option subtrees not reevaluated for the same cursor" },
+    { CountType::SUM, "eval_memo_misses", "relative rule option subtrees evaluated and memoized" },
     { CountType::END, nullptr, nullptr }
 };
 
@@ -222,6 +237,9 @@ const PegInfo proc_names[] =
     { CountType::SUM, "attribute_table_reloads", "number of times hosts attribute table was reloaded" },
     { CountType::SUM, "attribute_table_hosts", "number of hosts added to the attribute table" },
     { CountType::SUM, "attribute_table_overflow", "number of host additions that failed due to attribute table full" },
+    { CountType::SUM, "mpse_cache_hits", "search engines loaded from search_engine.cache_dir" },
+    { CountType::SUM, "mpse_cache_misses", "search engines compiled and saved to search_engine.cache_dir" },
+    { CountType::SUM, "mpse_cache_usecs_saved", "compile time avoided by loading cached search engines" },
     { CountType::END, nullptr, nullptr }
 };
 
@@ -229,6 +247,8 @@ const PegInfo proc_names[] =
 
 void DropStats()
 {
+    ModuleManager::collect();
+
     LogLabel("Packet Statistics");
     ModuleManager::get_module("daq")->show_stats();
 
@@ -69,6 +69,21 @@ struct PacketCount
     PegCount pcre_match_limit;
     PegCount pcre_recursion_limit;
     PegCount pcre_error;
+    PegCount pcre_jit_searches;
+    PegCount pcre_interp_searches;
+    PegCount pcre_jit_stack_limit;
+    PegCount offload_wakes;
+    PegCount offload_parks;
+    PegCount offload_under_2us;
+    PegCount offload_under_8us;
+    PegCount offload_under_32us;
+    PegCount offload_under_128us;
+    PegCount offload_under_512us;
+    PegCount offload_over_512us;
+    PegCount offload_stolen;
+    PegCount offload_pool_usecs;
+    PegCount eval_memo_hits;
+    PegCount eval_memo_misses;
 };
 
 struct ProcessCount
@@ -83,6 +98,9 @@ struct ProcessCount
     PegCount attribute_table_reloads;
     PegCount attribute_table_hosts;     // FIXIT-D - remove when host attribute pegs updated
     PegCount attribute_table_overflow;  // FIXIT-D - remove when host attribute pegs updated
+    PegCount mpse_cache_hits;
+    PegCount mpse_cache_misses;
+    PegCount mpse_cache_usecs_saved;
 };
 
 extern ProcessCount proc_stats;
@@ -0,0 +1,144 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// peg_snapshot_test.cc
+// unit tests for PegSnapshot class
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "../peg_snapshot.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+static const PegInfo test_pegs[] =
+{
+    { CountType::SUM, "sum", "summed" },
+    { CountType::NOW, "now", "current" },
+    { CountType::MAX, "max", "maximum" },
+    { CountType::END, nullptr, nullptr }
+};
+
+TEST_GROUP(peg_snapshot)
+{ };
+
+TEST(peg_snapshot, publish_by_type)
+{
+    PegSnapshot snap(2, 3, test_pegs);
+    PegCount totals[3];
+
+    PegCount t0[3] = { 5, 7, 9 };
+    snap.publish(0, t0);
+    CHECK(t0[0] == 0);
+    CHECK(t0[1] == 7);
+    CHECK(t0[2] == 9);
+
+    PegCount t1[3] = { 3, 2, 4 };
+    snap.publish(1, t1);
+
+    t0[0] = 1;
+    t0[1] = 6;
+    t0[2] = 8;
+    snap.publish(0, t0);
+
+    snap.collect(totals);
+    CHECK(totals[0] == 9);
+    CHECK(totals[1] == 8);
+    CHECK(totals[2] == 9);
+
+    t1[1] = 1;
+    snap.publish(1, t1, false);
+    snap.collect(totals);
+    CHECK(totals[1] == 8);
+}
+
+TEST(peg_snapshot, all_sums)
+{
+    PegSnapshot snap(1, 2);
+    PegCount t[2] = { 1, 2 };
+    PegCount totals[2];
+
+    snap.publish(0, t);
+    t[0] = 1;
+    t[1] = 2;
+    snap.publish(0, t);
+
+    snap.collect(totals);
+    CHECK(totals[0] == 2);
+    CHECK(totals[1] == 4);
+}
+
+// every publish adds the same amount to each count so a torn read would
+// show counts that differ
+TEST(peg_snapshot, consistent_while_publishing)
+{
+    const unsigned num_threads = 4;
+    const unsigned num_pegs = 11;
+    const unsigned rounds = 20000;
+
+    PegSnapshot snap(num_threads, num_pegs);
+    std::atomic<unsigned> done { 0 };
+    std::vector<std::thread> threads;
+
+    for ( unsigned t = 0; t < num_threads; ++t )
+    {
+        threads.emplace_back([&snap, &done, t]()
+        {
+            std::vector<PegCount> pegs(num_pegs);
+
+            for ( unsigned r = 0; r < rounds; ++r )
+            {
+                for ( auto& p : pegs )
+                    p = t + 1;
+
+                snap.publish(t, pegs.data());
+            }
+            ++done;
+        });
+    }
+
+    std::vector<PegCount> totals(num_pegs);
+    bool torn = false;
+
+    while ( done < num_threads )
+    {
+        snap.collect(totals.data());
+
+        for ( auto c : totals )
+            torn = torn or c != totals[0];
+    }
+
+    for ( auto& t : threads )
+        t.join();
+
+    snap.collect(totals.data());
+    CHECK(!torn);
+    CHECK(totals[0] == rounds * (1 + 2 + 3 + 4));
+    CHECK(totals[num_pegs - 1] == totals[0]);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,147 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// util_simd.h
+
+#ifndef UTIL_SIMD_H
+#define UTIL_SIMD_H
+
+// 16 octet vector scans for decoders that look for a few delimiters in mostly plain text. A
+// caller supplies a match function that sets the lanes of the octets it stops on, and finishes
+// with its own scalar loop from the returned count. SSE2 on x86 and NEON on ARM are chosen at
+// compile time. HAVE_OCTETS16 is only defined when one of them is available.
+
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_OCTETS16
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAVE_OCTETS16
+#endif
+
+#ifdef HAVE_OCTETS16
+namespace snort
+{
+#if defined(__SSE2__)
+typedef __m128i Octets16;
+
+inline Octets16 load16(const uint8_t* p)
+{ return _mm_loadu_si128((const __m128i*)p); }
+
+inline void store16(uint8_t* p, Octets16 v)
+{ _mm_storeu_si128((__m128i*)p, v); }
+
+inline Octets16 equal16(Octets16 v, uint8_t c)
+{ return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); }
+
+// lo <= v <= hi, compared unsigned
+inline Octets16 in_range16(Octets16 v, uint8_t lo, uint8_t hi)
+{
+    const __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(hi - lo)), d);
+}
+
+inline Octets16 or16(Octets16 a, Octets16 b)
+{ return _mm_or_si128(a, b); }
+
+// a and not b
+inline Octets16 and_not16(Octets16 a, Octets16 b)
+{ return _mm_andnot_si128(b, a); }
+
+inline Octets16 not16(Octets16 v)
+{ return _mm_xor_si128(v, _mm_set1_epi8(-1)); }
+
+// Position of the first set lane, or 16 if none is set
+inline unsigned first16(Octets16 match)
+{
+    const uint32_t hits = _mm_movemask_epi8(match);
+    return hits ? __builtin_ctz(hits) : 16;
+}
+
+#else
+typedef uint8x16_t Octets16;
+
+inline Octets16 load16(const uint8_t* p)
+{ return vld1q_u8(p); }
+
+inline void store16(uint8_t* p, Octets16 v)
+{ vst1q_u8(p, v); }
+
+inline Octets16 equal16(Octets16 v, uint8_t c)
+{ return vceqq_u8(v, vdupq_n_u8(c)); }
+
+inline Octets16 in_range16(Octets16 v, uint8_t lo, uint8_t hi)
+{ return vcleq_u8(vsubq_u8(v, vdupq_n_u8(lo)), vdupq_n_u8(hi - lo)); }
+
+inline Octets16 or16(Octets16 a, Octets16 b)
+{ return vorrq_u8(a, b); }
+
+inline Octets16 and_not16(Octets16 a, Octets16 b)
+{ return vbicq_u8(a, b); }
+
+inline Octets16 not16(Octets16 v)
+{ return vmvnq_u8(v); }
+
+inline unsigned first16(Octets16 match)
+{
+    // NEON has no movemask. Narrowing leaves four bits per octet in a 64-bit value.
+    const uint64_t hits = vget_lane_u64(vreinterpret_u64_u8(
+        vshrn_n_u16(vreinterpretq_u16_u8(match), 4)), 0);
+    return hits ? (__builtin_ctzll(hits) >> 2) : 16;
+}
+#endif
+
+inline Octets16 cr_lf16(Octets16 v)
+{ return or16(equal16(v, '\r'), equal16(v, '\n')); }
+
+// Number of octets before the first match, or in the whole vectors of buffer if there is none
+template <typename Match>
+inline uint32_t skip16(const uint8_t* buffer, uint32_t length, Match match)
+{
+    uint32_t k = 0;
+    for (; length - k >= 16; k += 16)
+    {
+        const unsigned hit = first16(match(load16(buffer + k)));
+        if (hit < 16)
+            return k + hit;
+    }
+    return k;
+}
+
+// Same as skip16() while copying each vector examined. Whole vectors are stored, so the output
+// must have room for one past the count.
+template <typename Match>
+inline uint32_t copy16(const uint8_t* in, uint32_t in_len, uint8_t* out, uint32_t out_len,
+    Match match)
+{
+    uint32_t k = 0;
+    for (; (in_len - k >= 16) && (out_len - k >= 16); k += 16)
+    {
+        const Octets16 v = load16(in + k);
+        store16(out + k, v);
+        const unsigned hit = first16(match(v));
+        if (hit < 16)
+            return k + hit;
+    }
+    return k;
+}
+}
+#endif
+
+#endif
@@ -24,6 +24,24 @@
 
 #include "util_unfold.h"
 
+#include "util_simd.h"
+
+// Copies the input up to the first CR or LF a vector at a time and returns the number of octets
+// before it. Whole vectors are stored, so the output must have room for one past the count.
+static inline uint32_t copy_to_line_end(const uint8_t* in, uint32_t in_len, uint8_t* out,
+    uint32_t out_len)
+{
+#ifdef HAVE_OCTETS16
+    return snort::copy16(in, in_len, out, out_len, snort::cr_lf16);
+#else
+    UNUSED(in);
+    UNUSED(in_len);
+    UNUSED(out);
+    UNUSED(out_len);
+    return 0;
+#endif
+}
+
 namespace snort
 {
 /* Given a string, removes header folding (\r\n followed by linear whitespace)
@@ -120,6 +138,16 @@ int sf_strip_CRLF(const uint8_t* inbuf, uint32_t inbuf_size, uint8_t* outbuf,
     outbuf_ptr = outbuf;
     while ((cursor < endofinbuf) && (n < outbuf_size))
     {
+        // Lines are copied in vectors, leaving the line breaks and the tail to the loop
+        const uint32_t copied = copy_to_line_end(cursor, endofinbuf - cursor, outbuf_ptr,
+            outbuf_size - n);
+        cursor += copied;
+        outbuf_ptr += copied;
+        n += copied;
+
+        if ((cursor == endofinbuf) || (n == outbuf_size))
+            break;
+
         if ((*cursor != '\n') && (*cursor != '\r'))
         {
             *outbuf_ptr++ = *cursor;